@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "car-bugreportd"
+
+#include "FileTransfer.h"
+
+#include <android-base/file.h>
+#include <android-base/macros.h>
+#include <android-base/unique_fd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <log/log_main.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace android {
+namespace car {
+namespace bugreport {
+
+namespace {
+
+// Largest number of bytes moved by a single sendfile() or splice() call.
+constexpr size_t kKernelChunkSize = 1024 * 1024;
+// Size requested for the splice() pipe. The kernel may grant less.
+constexpr int kPipeSize = 1024 * 1024;
+// Size of the user-space buffer of the fallback loop.
+constexpr size_t kBufferSize = 65536;
+
+enum class Result {
+    DONE,     // Reached EOF
+    REFUSED,  // The kernel does not support this method for these descriptors
+    FAILED,
+};
+
+// Errors meaning the kernel cannot do this kind of transfer between these descriptors, as
+// opposed to an actual I/O error.
+bool isRefused(int error) {
+    return error == EINVAL || error == ENOSYS || error == EOPNOTSUPP || error == EXDEV;
+}
+
+void logError(const char* name, const char* call) {
+    // EAGAIN really means time out, so make that clear.
+    if (errno == EAGAIN) {
+        ALOGE("%s on %s timed out", call, name);
+    } else {
+        ALOGE("%s on %s terminated abnormally (%s)", call, name, strerror(errno));
+    }
+}
+
+// The helpers below copy until EOF or until |*bytes| reaches |limit|, whichever comes first.
+size_t nextChunk(size_t chunk_size, uint64_t bytes, uint64_t limit) {
+    return static_cast<size_t>(std::min<uint64_t>(chunk_size, limit - bytes));
+}
+
+Result transferWithSendfile(int fd_in, int fd_out, const char* name, uint64_t limit,
+                            uint64_t* bytes) {
+    while (*bytes < limit) {
+        ssize_t sent = TEMP_FAILURE_RETRY(sendfile(fd_out, fd_in, nullptr,
+                                                   nextChunk(kKernelChunkSize, *bytes, limit)));
+        if (sent == 0) {
+            return Result::DONE;
+        }
+        if (sent == -1) {
+            if (isRefused(errno)) {
+                return Result::REFUSED;
+            }
+            logError(name, "sendfile");
+            return Result::FAILED;
+        }
+        *bytes += sent;
+    }
+    return Result::DONE;
+}
+
+Result transferWithSplice(int fd_in, int fd_out, const char* name, uint64_t limit,
+                          uint64_t* bytes) {
+    android::base::unique_fd pipe_read, pipe_write;
+    if (!android::base::Pipe(&pipe_read, &pipe_write)) {
+        ALOGW("Failed to create a pipe for %s (%s)", name, strerror(errno));
+        return Result::REFUSED;
+    }
+    // A larger pipe means fewer round trips; the default one only holds 64KB.
+    fcntl(pipe_write, F_SETPIPE_SZ, kPipeSize);
+
+    while (*bytes < limit) {
+        ssize_t in_pipe = TEMP_FAILURE_RETRY(splice(fd_in, nullptr, pipe_write, nullptr,
+                                                    nextChunk(kKernelChunkSize, *bytes, limit),
+                                                    SPLICE_F_MOVE | SPLICE_F_MORE));
+        if (in_pipe == 0) {
+            return Result::DONE;
+        }
+        if (in_pipe == -1) {
+            // Nothing is left in the pipe at this point, so the next method can take over.
+            if (isRefused(errno)) {
+                return Result::REFUSED;
+            }
+            logError(name, "splice");
+            return Result::FAILED;
+        }
+
+        while (in_pipe > 0) {
+            ssize_t out = TEMP_FAILURE_RETRY(splice(pipe_read, nullptr, fd_out, nullptr, in_pipe,
+                                                    SPLICE_F_MOVE | SPLICE_F_MORE));
+            if (out == -1 && isRefused(errno)) {
+                // Hand what is already in the pipe over by hand before giving up on splice.
+                char buffer[kBufferSize];
+                while (in_pipe > 0) {
+                    ssize_t copied = copyChunk(pipe_read, fd_out, buffer,
+                                               std::min(sizeof(buffer),
+                                                        static_cast<size_t>(in_pipe)));
+                    if (copied <= 0) {
+                        return Result::FAILED;
+                    }
+                    in_pipe -= copied;
+                    *bytes += copied;
+                }
+                return Result::REFUSED;
+            }
+            if (out <= 0) {
+                logError(name, "splice");
+                return Result::FAILED;
+            }
+            in_pipe -= out;
+            *bytes += out;
+        }
+    }
+    return Result::DONE;
+}
+
+Result transferWithBuffer(int fd_in, int fd_out, const char* name, uint64_t limit,
+                          uint64_t* bytes) {
+    char buffer[kBufferSize];
+    while (*bytes < limit) {
+        ssize_t copied = copyChunk(fd_in, fd_out, buffer,
+                                   nextChunk(sizeof(buffer), *bytes, limit));
+        if (copied == 0) {
+            return Result::DONE;
+        }
+        if (copied == -1) {
+            ALOGE("Failed to copy %s", name);
+            return Result::FAILED;
+        }
+        *bytes += copied;
+    }
+    return Result::DONE;
+}
+
+}  // namespace
+
+const char* toString(TransferMethod method) {
+    switch (method) {
+        case TransferMethod::SENDFILE:
+            return "sendfile";
+        case TransferMethod::SPLICE:
+            return "splice";
+        case TransferMethod::BUFFERED:
+            return "buffered";
+    }
+    return "unknown";
+}
+
+bool transferBytes(int fd_in, int fd_out, uint64_t length, const char* name,
+                   TransferMethod method, TransferStats* out_stats) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    TransferStats stats;
+    stats.method = method;
+    Result result = Result::REFUSED;
+    while (result == Result::REFUSED) {
+        switch (stats.method) {
+            case TransferMethod::SENDFILE:
+                result = transferWithSendfile(fd_in, fd_out, name, length, &stats.bytes);
+                break;
+            case TransferMethod::SPLICE:
+                result = transferWithSplice(fd_in, fd_out, name, length, &stats.bytes);
+                break;
+            case TransferMethod::BUFFERED:
+                result = transferWithBuffer(fd_in, fd_out, name, length, &stats.bytes);
+                // The buffered loop is never refused.
+                break;
+        }
+        if (result == Result::REFUSED) {
+            TransferMethod next = stats.method == TransferMethod::SENDFILE
+                    ? TransferMethod::SPLICE
+                    : TransferMethod::BUFFERED;
+            ALOGI("%s refused for %s after %" PRIu64 " bytes (%s), falling back to %s",
+                  toString(stats.method), name, stats.bytes, strerror(errno), toString(next));
+            stats.method = next;
+        }
+    }
+    if (result == Result::DONE && length != kUntilEof && stats.bytes < length) {
+        ALOGE("%s ended after %" PRIu64 " of %" PRIu64 " bytes", name, stats.bytes, length);
+        result = Result::FAILED;
+    }
+
+    stats.seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+                            std::chrono::steady_clock::now() - t0)
+                            .count();
+    if (out_stats != nullptr) {
+        *out_stats = stats;
+    }
+    return result == Result::DONE;
+}
+
+bool transferAll(int fd_in, int fd_out, const char* name, TransferMethod method,
+                 TransferStats* out_stats) {
+    TransferStats stats;
+    bool success = transferBytes(fd_in, fd_out, kUntilEof, name, method, &stats);
+    const double mb_per_sec =
+            stats.seconds > 0 ? stats.bytes / stats.seconds / (1024 * 1024) : 0;
+    ALOGI("%s %s: %" PRIu64 " bytes in %.03fs (%.1f MB/s) using %s", name,
+          success ? "copied" : "failed", stats.bytes, stats.seconds, mb_per_sec,
+          toString(stats.method));
+
+    if (out_stats != nullptr) {
+        *out_stats = stats;
+    }
+    return success;
+}
+
+ssize_t copyChunk(int fd_in, int fd_out, void* buffer, size_t buffer_len) {
+    ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd_in, buffer, buffer_len));
+    if (bytes_read == 0) {
+        return 0;
+    }
+    if (bytes_read == -1) {
+        // EAGAIN really means time out, so make that clear.
+        if (errno == EAGAIN) {
+            ALOGE("read timed out");
+        } else {
+            ALOGE("read terminated abnormally (%s)", strerror(errno));
+        }
+        return -1;
+    }
+    // copy all bytes to the output socket
+    if (!android::base::WriteFully(fd_out, buffer, bytes_read)) {
+        ALOGE("write failed");
+        return -1;
+    }
+    return bytes_read;
+}
+
+}  // namespace bugreport
+}  // namespace car
+}  // namespace android
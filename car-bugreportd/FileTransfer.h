@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAR_BUGREPORTD_FILE_TRANSFER_H_
+#define CAR_BUGREPORTD_FILE_TRANSFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android {
+namespace car {
+namespace bugreport {
+
+// How the bytes are moved from the input to the output descriptor.
+enum class TransferMethod {
+    // Kernel-side copy from a file, without going through user space.
+    SENDFILE,
+    // Kernel-side copy through an intermediate pipe. Works for any input the kernel can splice
+    // from, sockets included.
+    SPLICE,
+    // Plain read()/write() loop through a user-space buffer.
+    BUFFERED,
+};
+
+const char* toString(TransferMethod method);
+
+struct TransferStats {
+    uint64_t bytes = 0;
+    double seconds = 0;
+    // The method that moved the last bytes. Starts from the requested method and only moves
+    // down the list above when the kernel refuses it.
+    TransferMethod method = TransferMethod::SENDFILE;
+};
+
+// Copies everything from |fd_in|, from its current offset until EOF, to |fd_out|.
+//
+// Starts with |method| and falls back to the next method whenever the kernel refuses the
+// current one for these descriptors (EINVAL, ENOSYS, ...), continuing from where the previous
+// method stopped. Any other error aborts the transfer. Logs the throughput when done.
+//
+// Returns true if success. |out_stats| is optional and filled in either way.
+bool transferAll(int fd_in, int fd_out, const char* name,
+                 TransferMethod method = TransferMethod::SENDFILE,
+                 TransferStats* out_stats = nullptr);
+
+// Passed as |length| to transferBytes() to copy until EOF.
+constexpr uint64_t kUntilEof = UINT64_MAX;
+
+// Same as transferAll(), but copies exactly |length| bytes, failing if |fd_in| reaches EOF
+// first, and does not log anything on success.
+bool transferBytes(int fd_in, int fd_out, uint64_t length, const char* name,
+                   TransferMethod method = TransferMethod::SENDFILE,
+                   TransferStats* out_stats = nullptr);
+
+// Reads once from |fd_in| into |buffer| and writes everything that was read to |fd_out|.
+// Returns the number of bytes copied, 0 on EOF, or -1 on error.
+ssize_t copyChunk(int fd_in, int fd_out, void* buffer, size_t buffer_len);
+
+}  // namespace bugreport
+}  // namespace car
+}  // namespace android
+
+#endif  // CAR_BUGREPORTD_FILE_TRANSFER_H_
@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "car-bugreportd"
+
+#include "ZipArchiver.h"
+
+#include <android-base/file.h>
+#include <android-base/strings.h>
+#include <errno.h>
+#include <log/log_main.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace android {
+namespace car {
+namespace bugreport {
+
+namespace {
+
+constexpr uint32_t kLocalHeaderSignature = 0x04034b50;
+constexpr uint32_t kCentralHeaderSignature = 0x02014b50;
+constexpr uint32_t kEndOfCentralDirectorySignature = 0x06054b50;
+// Zip 2.0, the first version with deflate.
+constexpr uint16_t kVersionNeeded = 20;
+constexpr uint16_t kMethodStored = 0;
+constexpr uint16_t kMethodDeflated = 8;
+// Without zip64, the entry count is 16 bits and the sizes and offsets are 32 bits.
+constexpr size_t kMaxEntries = std::numeric_limits<uint16_t>::max();
+constexpr uint64_t kMaxSize = std::numeric_limits<uint32_t>::max();
+
+// Files in these formats are already compressed, so they are stored as is.
+constexpr const char* kCompressedExtensions[] = {".png", ".jpg", ".jpeg", ".webp", ".zip", ".gz"};
+
+struct Entry {
+    std::string name;
+    bool ready = false;
+    bool valid = false;
+    uint16_t method = kMethodStored;
+    uint32_t crc = 0;
+    uint32_t compressed_size = 0;
+    uint32_t uncompressed_size = 0;
+    // Released once written.
+    std::string data;
+    // Offset of the local header in the archive.
+    uint32_t offset = 0;
+};
+
+void putLe16(std::string* out, uint16_t value) {
+    out->push_back(static_cast<char>(value));
+    out->push_back(static_cast<char>(value >> 8));
+}
+
+void putLe32(std::string* out, uint32_t value) {
+    putLe16(out, static_cast<uint16_t>(value));
+    putLe16(out, static_cast<uint16_t>(value >> 16));
+}
+
+bool isCompressed(const std::string& filepath) {
+    for (const char* extension : kCompressedExtensions) {
+        if (android::base::EndsWithIgnoreCase(filepath, extension)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Raw deflate, as stored in zip entries. Returns false if the data did not shrink.
+bool deflateData(const std::string& in, std::string* out) {
+    z_stream stream = {};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out->resize(deflateBound(&stream, in.size()));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    stream.avail_in = in.size();
+    stream.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+    stream.avail_out = out->size();
+    int result = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END || stream.total_out >= in.size()) {
+        return false;
+    }
+    out->resize(stream.total_out);
+    return true;
+}
+
+void prepareEntry(const std::string& filepath, Entry* entry) {
+    std::string contents;
+    if (!android::base::ReadFileToString(filepath, &contents)) {
+        ALOGE("Failed to read %s: %s", filepath.c_str(), strerror(errno));
+        return;
+    }
+    if (contents.size() > kMaxSize) {
+        ALOGE("%s is too large to be zipped", filepath.c_str());
+        return;
+    }
+    entry->uncompressed_size = contents.size();
+    entry->crc = crc32(0, reinterpret_cast<const Bytef*>(contents.data()), contents.size());
+    if (!isCompressed(filepath) && deflateData(contents, &entry->data)) {
+        entry->method = kMethodDeflated;
+    } else {
+        entry->method = kMethodStored;
+        entry->data = std::move(contents);
+    }
+    entry->compressed_size = entry->data.size();
+    entry->valid = true;
+}
+
+// MS-DOS time and date of |now|, as the zip headers have them.
+void toDosTime(time_t now, uint16_t* dos_time, uint16_t* dos_date) {
+    struct tm tm;
+    localtime_r(&now, &tm);
+    // The MS-DOS epoch is 1980.
+    int year = std::max(tm.tm_year + 1900, 1980) - 1980;
+    *dos_time = (tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec >> 1);
+    *dos_date = (year << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday;
+}
+
+// Fields shared by the local and the central headers, from the version needed on.
+void putEntryFields(std::string* out, const Entry& entry, uint16_t dos_time, uint16_t dos_date) {
+    putLe16(out, kVersionNeeded);
+    putLe16(out, 0);  // flags
+    putLe16(out, entry.method);
+    putLe16(out, dos_time);
+    putLe16(out, dos_date);
+    putLe32(out, entry.crc);
+    putLe32(out, entry.compressed_size);
+    putLe32(out, entry.uncompressed_size);
+    putLe16(out, entry.name.size());
+    putLe16(out, 0);  // extra field length
+}
+
+}  // namespace
+
+bool zipFiles(const std::vector<std::string>& files, int fd, unsigned num_threads) {
+    if (files.size() > kMaxEntries) {
+        ALOGE("Too many files to zip: %zu", files.size());
+        return false;
+    }
+    std::vector<Entry> entries(files.size());
+    std::mutex lock;
+    std::condition_variable ready;
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < files.size(); i = next++) {
+            Entry entry;
+            entry.name = android::base::Basename(files[i]);
+            prepareEntry(files[i], &entry);
+            std::lock_guard<std::mutex> guard(lock);
+            entries[i] = std::move(entry);
+            entries[i].ready = true;
+            ready.notify_all();
+        }
+    };
+    std::vector<std::thread> workers;
+    num_threads = std::max(1u, std::min<unsigned>(num_threads, files.size()));
+    for (unsigned i = 0; i < num_threads; ++i) {
+        workers.emplace_back(worker);
+    }
+
+    uint16_t dos_time, dos_date;
+    toDosTime(time(nullptr), &dos_time, &dos_date);
+    uint64_t offset = 0;
+    bool success = true;
+    for (auto& entry : entries) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            ready.wait(guard, [&entry]() { return entry.ready; });
+        }
+        if (!entry.valid) {
+            continue;
+        }
+        std::string header;
+        putLe32(&header, kLocalHeaderSignature);
+        putEntryFields(&header, entry, dos_time, dos_date);
+        header += entry.name;
+        if (offset + header.size() + entry.data.size() > kMaxSize) {
+            ALOGE("The zip file is too large to add %s", entry.name.c_str());
+            entry.valid = false;
+            continue;
+        }
+        if (!android::base::WriteFully(fd, header.data(), header.size()) ||
+            !android::base::WriteFully(fd, entry.data.data(), entry.data.size())) {
+            ALOGE("Failed to write %s to the zip file: %s", entry.name.c_str(), strerror(errno));
+            success = false;
+            // Let the workers run out of files.
+            next = files.size();
+            break;
+        }
+        entry.offset = offset;
+        offset += header.size() + entry.data.size();
+        std::string().swap(entry.data);
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    if (!success) {
+        return false;
+    }
+
+    std::string directory;
+    uint16_t count = 0;
+    for (const auto& entry : entries) {
+        if (!entry.valid) {
+            continue;
+        }
+        putLe32(&directory, kCentralHeaderSignature);
+        putLe16(&directory, kVersionNeeded);  // version made by
+        putEntryFields(&directory, entry, dos_time, dos_date);
+        putLe16(&directory, 0);  // comment length
+        putLe16(&directory, 0);  // disk number
+        putLe16(&directory, 0);  // internal attributes
+        putLe32(&directory, 0);  // external attributes
+        putLe32(&directory, entry.offset);
+        directory += entry.name;
+        ++count;
+    }
+    if (offset + directory.size() > kMaxSize) {
+        ALOGE("The zip file is too large for its central directory");
+        return false;
+    }
+    const uint32_t directory_size = directory.size();
+    putLe32(&directory, kEndOfCentralDirectorySignature);
+    putLe16(&directory, 0);  // disk number
+    putLe16(&directory, 0);  // disk with the central directory
+    putLe16(&directory, count);
+    putLe16(&directory, count);
+    putLe32(&directory, directory_size);
+    putLe32(&directory, offset);
+    putLe16(&directory, 0);  // comment length
+    if (!android::base::WriteFully(fd, directory.data(), directory.size())) {
+        ALOGE("Failed to write the zip central directory: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+}  // namespace bugreport
+}  // namespace car
+}  // namespace android
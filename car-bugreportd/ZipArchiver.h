@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAR_BUGREPORTD_ZIP_ARCHIVER_H_
+#define CAR_BUGREPORTD_ZIP_ARCHIVER_H_
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace car {
+namespace bugreport {
+
+// Writes |files| to |fd|, which may be a socket, as a zip archive. Each entry is named after
+// the base name of its file.
+//
+// Files in formats that are already compressed, such as the PNG screenshots, are stored as
+// is. The others are deflated on up to |num_threads| threads in parallel, and the entries are
+// written in the order of |files| as soon as they are ready. ZipWriter can't take data that
+// was compressed elsewhere, so the archive is written here.
+//
+// Every entry is held in memory until it is written, which suits the few extra files of a
+// bugreport. Files that cannot be read are left out. Returns false if the archive could not be
+// written.
+bool zipFiles(const std::vector<std::string>& files, int fd, unsigned num_threads);
+
+}  // namespace bugreport
+}  // namespace car
+}  // namespace android
+
+#endif  // CAR_BUGREPORTD_ZIP_ARCHIVER_H_
@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "car-bugreportd"
+
+#include "ZipStreamer.h"
+
+#include <android-base/file.h>
+#include <android-base/macros.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <log/log_main.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "FileTransfer.h"
+
+namespace android {
+namespace car {
+namespace bugreport {
+
+namespace {
+
+constexpr uint32_t kLocalHeaderSignature = 0x04034b50;
+constexpr uint32_t kCentralHeaderSignature = 0x02014b50;
+constexpr size_t kLocalHeaderSize = 30;
+// General purpose flag telling that the sizes follow the data instead of being in the header.
+constexpr uint16_t kDataDescriptorFlag = 1 << 3;
+// Sizes are moved to the zip64 extra field when they do not fit.
+constexpr uint32_t kZip64Marker = 0xFFFFFFFF;
+
+// The file is rescanned at least this often, in case an inotify event was missed.
+constexpr int kRescanIntervalMs = 1000;
+// Space is released in whole blocks.
+constexpr uint64_t kReleaseBlockSize = 4096;
+
+uint16_t readLe16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t readLe32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+double secondsSince(std::chrono::steady_clock::time_point t0,
+                    std::chrono::steady_clock::time_point t1) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+}
+
+// Reads and throws away everything pending on |fd|, which is non-blocking.
+void drain(int fd) {
+    char buffer[4096];
+    while (TEMP_FAILURE_RETRY(read(fd, buffer, sizeof(buffer))) > 0) {
+    }
+}
+
+}  // namespace
+
+uint64_t findSafeOffset(int fd, uint64_t from) {
+    uint64_t offset = from;
+    while (true) {
+        uint8_t header[kLocalHeaderSize];
+        if (!android::base::ReadFullyAtOffset(fd, header, sizeof(header), offset) ||
+            readLe32(header) != kLocalHeaderSignature) {
+            return offset;
+        }
+        const uint16_t flags = readLe16(header + 6);
+        const uint32_t compressed_size = readLe32(header + 18);
+        if ((flags & kDataDescriptorFlag) != 0 || compressed_size == kZip64Marker) {
+            return offset;
+        }
+
+        const uint64_t next = offset + kLocalHeaderSize + readLe16(header + 26) +
+                readLe16(header + 28) + compressed_size;
+        uint8_t signature[4];
+        if (!android::base::ReadFullyAtOffset(fd, signature, sizeof(signature), next)) {
+            return offset;
+        }
+        const uint32_t next_signature = readLe32(signature);
+        if (next_signature != kLocalHeaderSignature && next_signature != kCentralHeaderSignature) {
+            return offset;
+        }
+        offset = next;
+    }
+}
+
+ZipStreamer::ZipStreamer(int listen_fd) : mListenFd(listen_fd) {}
+
+ZipStreamer::~ZipStreamer() {
+    abort();
+}
+
+bool ZipStreamer::start(const std::string& zip_path) {
+    if (isStarted() || mListenFd < 0) {
+        return false;
+    }
+    mWakeFd.reset(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    mInotifyFd.reset(inotify_init1(IN_CLOEXEC | IN_NONBLOCK));
+    if (mWakeFd == -1 || mInotifyFd == -1) {
+        ALOGE("Cannot stream %s (%s)", zip_path.c_str(), strerror(errno));
+        return false;
+    }
+    // Watching the directory also tells when the file shows up.
+    const std::string dir = android::base::Dirname(zip_path);
+    if (inotify_add_watch(mInotifyFd, dir.c_str(),
+                          IN_CREATE | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE) == -1) {
+        ALOGW("Cannot watch %s (%s), polling instead", dir.c_str(), strerror(errno));
+    }
+
+    mZipPath = zip_path;
+    mStartTime = std::chrono::steady_clock::now();
+    mThread = std::thread([this]() { run(); });
+    ALOGI("Streaming %s", zip_path.c_str());
+    return true;
+}
+
+bool ZipStreamer::finish(const std::string& final_path) {
+    if (!isStarted()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mState == State::RUNNING) {
+            mState = State::FINISHING;
+            mFinalPath = final_path;
+        }
+    }
+    wake();
+    mThread.join();
+
+    std::lock_guard<std::mutex> lock(mLock);
+    ALOGI("%s %s: %" PRIu64 " bytes, %" PRIu64 " of them while it was written, first byte after "
+          "%.02fs, done after %.02fs, %" PRIu64 " bytes released early", mZipPath.c_str(),
+          mSuccess ? "streamed" : "failed", mStats.bytes_sent, mStats.bytes_streamed,
+          mStats.seconds_to_first_byte, mStats.seconds, mStats.bytes_released);
+    return mSuccess;
+}
+
+void ZipStreamer::abort() {
+    if (!isStarted()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mState = State::ABORTING;
+    }
+    wake();
+    mThread.join();
+}
+
+ZipStreamer::Stats ZipStreamer::getStats() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+void ZipStreamer::wake() {
+    uint64_t one = 1;
+    TEMP_FAILURE_RETRY(write(mWakeFd, &one, sizeof(one)));
+}
+
+bool ZipStreamer::openZip(const std::string& path) {
+    // Writing is only needed to release space, so do without it if not allowed.
+    mZipFd.reset(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDWR | O_CLOEXEC)));
+    if (mZipFd != -1) {
+        return true;
+    }
+    mZipFd.reset(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+    if (mZipFd != -1) {
+        mCanRelease = false;
+        return true;
+    }
+    return false;
+}
+
+bool ZipStreamer::forward(uint64_t length) {
+    TransferStats stats;
+    bool success = transferBytes(mZipFd, mOutputFd, length, mZipPath.c_str(),
+                                 TransferMethod::SENDFILE, &stats);
+    if (mSent == 0 && stats.bytes > 0) {
+        mFirstByteTime = std::chrono::steady_clock::now();
+    }
+    mSent += stats.bytes;
+    return success;
+}
+
+void ZipStreamer::releaseSentSpace() {
+    const uint64_t end = mSent / kReleaseBlockSize * kReleaseBlockSize;
+    if (!mCanRelease || end <= mReleased) {
+        return;
+    }
+    if (fallocate(mZipFd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, mReleased,
+                  end - mReleased) == -1) {
+        // Not every file system can do it; the space then comes back when the file is removed.
+        ALOGI("Cannot release space of %s (%s)", mZipPath.c_str(), strerror(errno));
+        mCanRelease = false;
+        return;
+    }
+    mReleased = end;
+}
+
+void ZipStreamer::run() {
+    bool success = false;
+    uint64_t bytes_streamed = 0;
+    while (true) {
+        struct pollfd fds[] = {
+                {.fd = mWakeFd, .events = POLLIN},
+                {.fd = mInotifyFd, .events = POLLIN},
+                {.fd = mOutputFd == -1 ? mListenFd : -1, .events = POLLIN},
+        };
+        if (TEMP_FAILURE_RETRY(poll(fds, arraysize(fds), kRescanIntervalMs)) == -1) {
+            ALOGE("poll failed while streaming %s (%s)", mZipPath.c_str(), strerror(errno));
+            break;
+        }
+        drain(mWakeFd);
+        drain(mInotifyFd);
+
+        State state;
+        std::string final_path;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            state = mState;
+            final_path = mFinalPath;
+        }
+        if (state == State::ABORTING) {
+            break;
+        }
+
+        if (mZipFd == -1 && !openZip(mZipPath) && state == State::FINISHING) {
+            // Never saw the file under its first name.
+            mZipPath = final_path;
+            if (!openZip(mZipPath)) {
+                ALOGE("Failed to open zip file %s.", mZipPath.c_str());
+                break;
+            }
+        }
+
+        // Once the writer is done, wait for the client like the plain copy does.
+        if (mOutputFd == -1 && ((fds[2].revents & POLLIN) != 0 || state == State::FINISHING)) {
+            mOutputFd.reset(TEMP_FAILURE_RETRY(accept4(mListenFd, nullptr, nullptr,
+                                                       SOCK_CLOEXEC)));
+            if (mOutputFd == -1) {
+                ALOGE("accept(control socket): %s", strerror(errno));
+                break;
+            }
+        }
+        if (mOutputFd == -1 || mZipFd == -1) {
+            continue;
+        }
+
+        if (state == State::FINISHING) {
+            // What is left is the last entry and the central directory.
+            bytes_streamed = mSent;
+            success = forward(kUntilEof);
+            break;
+        }
+        const uint64_t safe_offset = findSafeOffset(mZipFd, mSent);
+        if (safe_offset > mSent) {
+            if (!forward(safe_offset - mSent)) {
+                break;
+            }
+            releaseSentSpace();
+        }
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mLock);
+    mSuccess = success;
+    mStats.bytes_sent = mSent;
+    mStats.bytes_streamed = success ? bytes_streamed : mSent;
+    mStats.bytes_released = mReleased;
+    mStats.seconds_to_first_byte = secondsSince(mStartTime, mSent > 0 ? mFirstByteTime : now);
+    mStats.seconds = secondsSince(mStartTime, now);
+    // Closing the socket tells the client the whole file was sent.
+    mOutputFd.reset();
+    mZipFd.reset();
+}
+
+}  // namespace bugreport
+}  // namespace car
+}  // namespace android
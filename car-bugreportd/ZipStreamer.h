@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAR_BUGREPORTD_ZIP_STREAMER_H_
+#define CAR_BUGREPORTD_ZIP_STREAMER_H_
+
+#include <android-base/unique_fd.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace android {
+namespace car {
+namespace bugreport {
+
+// Returns the offset up to which a zip file that is still being written is final, scanning
+// local file entries from |from|, which must be the start of one.
+//
+// A zip writer on a seekable file goes back to fill in the sizes of an entry's local header
+// once the entry is done, and only then starts the next entry. So an entry is final once the
+// next local header, or the central directory, shows up right after its data. Entries using a
+// data descriptor, and zip64 entries, end the scan.
+uint64_t findSafeOffset(int fd, uint64_t from);
+
+// Forwards a zip file to a socket while another process is still writing it.
+//
+// The file is tailed with inotify, and every entry the writer is done with is sent right away,
+// so that the reader gets data long before the writer finishes. Once it has been sent, the
+// space of that part of the file is handed back to the file system, which keeps the disk
+// usage down while a large bugreport is generated. The rest of the file, including the
+// central directory, is sent by finish().
+class ZipStreamer {
+public:
+    struct Stats {
+        uint64_t bytes_sent = 0;
+        // Bytes sent before the writer finished.
+        uint64_t bytes_streamed = 0;
+        // Bytes whose disk space was released early.
+        uint64_t bytes_released = 0;
+        // From start() until the first byte was sent, or until the end if nothing was streamed.
+        double seconds_to_first_byte = 0;
+        double seconds = 0;
+    };
+
+    // The first client connecting to |listen_fd|, a listening socket, receives the zip file.
+    // The socket is not closed by the streamer.
+    explicit ZipStreamer(int listen_fd);
+    ~ZipStreamer();
+
+    // Starts tailing |zip_path| on a background thread. The file does not need to exist yet.
+    bool start(const std::string& zip_path);
+    bool isStarted() const { return mThread.joinable(); }
+
+    // To be called once the writer closed the file, possibly renamed to |final_path|. Sends
+    // the rest of the file, waiting for a client to connect if none has yet, and returns true
+    // if the whole file was sent.
+    bool finish(const std::string& final_path);
+
+    // Stops tailing without sending the rest of the file.
+    void abort();
+
+    Stats getStats();
+
+private:
+    enum class State {
+        RUNNING,
+        FINISHING,
+        ABORTING,
+    };
+
+    void run();
+    void wake();
+    bool openZip(const std::string& path);
+    bool forward(uint64_t length);
+    void releaseSentSpace();
+
+    const int mListenFd;
+
+    std::mutex mLock;
+    State mState = State::RUNNING;
+    std::string mFinalPath;
+    bool mSuccess = false;
+    Stats mStats;
+
+    // Only touched by the streaming thread once it is started.
+    std::string mZipPath;
+    android::base::unique_fd mZipFd;
+    android::base::unique_fd mOutputFd;
+    android::base::unique_fd mInotifyFd;
+    android::base::unique_fd mWakeFd;
+    bool mCanRelease = true;
+    uint64_t mSent = 0;
+    uint64_t mReleased = 0;
+    std::chrono::steady_clock::time_point mStartTime;
+    std::chrono::steady_clock::time_point mFirstByteTime;
+
+    std::thread mThread;
+};
+
+}  // namespace bugreport
+}  // namespace car
+}  // namespace android
+
+#endif  // CAR_BUGREPORTD_ZIP_STREAMER_H_
@@ -33,18 +33,26 @@
 #include <private/android_filesystem_config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/epoll.h>
 #include <sys/prctl.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
-#include <ziparchive/zip_writer.h>
 
+#include <algorithm>
 #include <chrono>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "FileTransfer.h"
+#include "ZipArchiver.h"
+#include "ZipStreamer.h"
+
 namespace {
 // Directory used for keeping temporary files
 constexpr const char* kTempDirectory = "/data/user_de/0/com.android.shell/temp_bugreport_files";
@@ -55,26 +63,43 @@ constexpr const char* kCarBrOutputSocket = "car_br_output_socket";
 // Socket to write the extra bugreport zip file. This zip file contains data that does not exist
 // in bugreport file generated by dumpstate.
 constexpr const char* kCarBrExtraOutputSocket = "car_br_extra_output_socket";
+// The prefix used by bugreportz protocol to indicate where the bugreport is being written.
+constexpr const char* kBeginPrefix = "BEGIN:";
 // The prefix used by bugreportz protocol to indicate bugreport finished successfully.
 constexpr const char* kOkPrefix = "OK:";
-// Number of connect attempts to dumpstate socket
-constexpr const int kMaxDumpstateConnectAttempts = 20;
-// Wait time between connect attempts
-constexpr const int kWaitTimeBetweenConnectAttemptsInSec = 1;
+// The prefix used by bugreportz protocol to indicate bugreport failed.
+constexpr const char* kFailPrefix = "FAIL:";
+// Not part of the bugreportz protocol: car-bugreportd reports how long each phase took with
+// TIMING:<phase>:<seconds> lines, all before the final OK: or FAIL: line.
+constexpr const char* kTimingPrefix = "TIMING:";
+// Time given to dumpstate to create its socket once started
+constexpr const int kDumpstateConnectTimeoutInSec = 20;
+// Wait time between connect attempts, doubling after each one
+constexpr std::chrono::milliseconds kConnectRetryInitialDelay(50);
+constexpr std::chrono::milliseconds kConnectRetryMaxDelay(1000);
 // Wait time for dumpstate. Set a timeout so that if nothing is read in 10 minutes, we'll stop
 // reading and quit. No timeout in dumpstate is longer than 60 seconds, so this gives lots of leeway
 // in case of unforeseen time outs.
 constexpr const int kDumpstateTimeoutInSec = 600;
 // The prefix for screenshot filename in the generated zip file.
 constexpr const char* kScreenshotPrefix = "/screenshot";
+// Time given to all screencap commands together.
+constexpr const int kScreenshotTimeoutInSec = 10;
+// How often commands are checked on when the kernel cannot tell when they exit.
+constexpr std::chrono::milliseconds kCommandPollInterval(100);
+// epoll key of the dumpstate socket. Screenshots use their index.
+constexpr uint64_t kDumpstateKey = UINT64_MAX;
 
 using android::OK;
 using android::PhysicalDisplayId;
 using android::status_t;
 using android::SurfaceComposerClient;
+using android::car::bugreport::transferAll;
+using android::car::bugreport::zipFiles;
+using android::car::bugreport::ZipStreamer;
 
-// Returns a valid socket descriptor or -1 on failure.
-int openSocket(const char* service) {
+// Returns a listening socket descriptor or -1 on failure.
+int listenSocket(const char* service) {
     int s = android_get_control_socket(service);
     if (s < 0) {
         ALOGE("android_get_control_socket(%s): %s", service, strerror(errno));
@@ -85,7 +110,14 @@ int openSocket(const char* service) {
         ALOGE("listen(control socket): %s", strerror(errno));
         return -1;
     }
+    return s;
+}
 
+// Returns a valid socket descriptor or -1 on failure.
+int acceptSocket(int s) {
+    if (s < 0) {
+        return -1;
+    }
     struct sockaddr addr;
     socklen_t alen = sizeof(addr);
     int fd = accept(s, &addr, &alen);
@@ -96,16 +128,25 @@ int openSocket(const char* service) {
     return fd;
 }
 
+// Returns a valid socket descriptor or -1 on failure.
+int openSocket(const char* service) {
+    return acceptSocket(listenSocket(service));
+}
+
 // Processes the given dumpstate progress protocol |line| and updates
 // |out_last_nonempty_line| when |line| is non-empty, and |out_zip_path| when
-// the bugreport is finished.
+// the bugreport is finished. Starts |streamer| once the zip file path is known.
 void processLine(const std::string& line, std::string* out_zip_path,
-                 std::string* out_last_nonempty_line) {
+                 std::string* out_last_nonempty_line, ZipStreamer* streamer) {
     // The protocol is documented in frameworks/native/cmds/bugreportz/readme.md
     if (line.empty()) {
         return;
     }
     *out_last_nonempty_line = line;
+    if (line.find(kBeginPrefix) == 0) {
+        streamer->start(line.substr(strlen(kBeginPrefix)));
+        return;
+    }
     if (line.find(kOkPrefix) != 0) {
         return;
     }
@@ -113,160 +154,246 @@ void processLine(const std::string& line, std::string* out_zip_path,
     return;
 }
 
-// Sends the contents of the zip fileto |outfd|.
-// Returns true if success
-void zipFilesToFd(const std::vector<std::string>& extra_files, int outfd) {
-    // pass fclose as Deleter to close the file when unique_ptr is destroyed.
-    std::unique_ptr<FILE, decltype(fclose)*> outfile = {fdopen(outfd, "wb"), fclose};
-    if (outfile == nullptr) {
-        ALOGE("Failed to open output descriptor");
-        return;
+bool copyFile(const std::string& zip_path, int output_socket) {
+    android::base::unique_fd fd(TEMP_FAILURE_RETRY(open(zip_path.c_str(), O_RDONLY)));
+    if (fd == -1) {
+        ALOGE("Failed to open zip file %s.", zip_path.c_str());
+        return false;
     }
-    auto writer = std::make_unique<ZipWriter>(outfile.get());
-
-    int error = 0;
-    for (const auto& filepath : extra_files) {
-        const auto name = android::base::Basename(filepath);
+    if (!transferAll(fd, output_socket, zip_path.c_str())) {
+        ALOGE("Failed to copy zip file %s to the output_socket.", zip_path.c_str());
+        return false;
+    }
+    return true;
+}
 
-        error = writer->StartEntry(name.c_str(), 0);
-        if (error) {
-            ALOGE("Failed to start entry %s", writer->ErrorCodeString(error));
-            return;
-        }
-        android::base::unique_fd fd(TEMP_FAILURE_RETRY(open(filepath.c_str(), O_RDONLY)));
-        if (fd == -1) {
-            return;
-        }
-        while (1) {
-            char buffer[65536];
+// A command running in the background while the bugreport is taken.
+struct Command {
+    std::string name;
+    pid_t pid = -1;
+    // Readable once the command exits. Stays -1 on kernels without pidfd support, in which case
+    // the command is polled.
+    android::base::unique_fd pidfd;
+    bool running = false;
+    int status = -1;
+};
+
+int pidfdOpen(pid_t pid) {
+#ifdef __NR_pidfd_open
+    return syscall(__NR_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
 
-            ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, buffer, sizeof(buffer)));
-            if (bytes_read == 0) {
-                break;
-            }
-            if (bytes_read == -1) {
-                if (errno == EAGAIN) {
-                    ALOGE("timed out while reading %s", name.c_str());
-                } else {
-                    ALOGE("read terminated abnormally (%s)", strerror(errno));
-                }
-                // fail immediately
-                return;
-            }
-            error = writer->WriteBytes(buffer, bytes_read);
-            if (error) {
-                ALOGE("WriteBytes() failed %s", ZipWriter::ErrorCodeString(error));
-                // fail immediately
-                return;
-            }
-        }
+// Starts the given command in the background. Returns false if it could not be started.
+bool startCommand(const char* file, const std::vector<const char*>& args, Command* command) {
+    pid_t pid = fork();
 
-        error = writer->FinishEntry();
-        if (error) {
-            ALOGE("failed to finish entry %s", writer->ErrorCodeString(error));
-            continue;
-        }
-    }
-    error = writer->Finish();
-    if (error) {
-        ALOGE("failed to finish zip writer %s", writer->ErrorCodeString(error));
+    // handle error case
+    if (pid < 0) {
+        ALOGE("fork failed %s", strerror(errno));
+        return false;
     }
-}
 
-int copyTo(int fd_in, int fd_out, void* buffer, size_t buffer_len) {
-    ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd_in, buffer, buffer_len));
-    if (bytes_read == 0) {
-        return 0;
-    }
-    if (bytes_read == -1) {
-        // EAGAIN really means time out, so make that clear.
-        if (errno == EAGAIN) {
-            ALOGE("read timed out");
-        } else {
-            ALOGE("read terminated abnormally (%s)", strerror(errno));
-        }
-        return -1;
-    }
-    // copy all bytes to the output socket
-    if (!android::base::WriteFully(fd_out, buffer, bytes_read)) {
-        ALOGE("write failed");
-        return -1;
+    // handle child case
+    if (pid == 0) {
+        /* make sure the child dies when parent dies */
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+        /* just ignore SIGPIPE, will go down with parent's */
+        struct sigaction sigact;
+        memset(&sigact, 0, sizeof(sigact));
+        sigact.sa_handler = SIG_IGN;
+        sigaction(SIGPIPE, &sigact, nullptr);
+
+        execvp(file, (char**)args.data());
+        // execvp's result will be handled by reapCommand() below, but
+        // if it failed, it's safer to exit dumpstate.
+        ALOGE("execvp on command %s failed (error: %s)", file, strerror(errno));
+        _exit(EXIT_FAILURE);
     }
-    return bytes_read;
+
+    // handle parent case
+    command->pid = pid;
+    command->pidfd.reset(pidfdOpen(pid));
+    command->running = true;
+    return true;
 }
 
-bool copyFile(const std::string& zip_path, int output_socket) {
-    android::base::unique_fd fd(TEMP_FAILURE_RETRY(open(zip_path.c_str(), O_RDONLY)));
-    if (fd == -1) {
-        ALOGE("Failed to open zip file %s.", zip_path.c_str());
+// Collects the exit status of |command| if it is done. Returns true if it is not running
+// anymore.
+bool reapCommand(Command* command) {
+    if (!command->running) {
+        return true;
+    }
+    int status;
+    pid_t child_pid = TEMP_FAILURE_RETRY(waitpid(command->pid, &status, WNOHANG));
+    if (child_pid == 0) {
         return false;
     }
-    while (1) {
-        char buffer[65536];
-        int bytes_copied = copyTo(fd, output_socket, buffer, sizeof(buffer));
-        if (bytes_copied == 0) {
-            break;
-        }
-        if (bytes_copied == -1) {
-            ALOGE("Failed to copy zip file %s to the output_socket.", zip_path.c_str());
-            return false;
+    command->running = false;
+    command->pidfd.reset();
+    if (child_pid == -1) {
+        ALOGE("*** waitpid failed: %s\n", strerror(errno));
+    } else if (WIFSIGNALED(status)) {
+        ALOGE("command '%s' failed: killed by signal %d\n", command->name.c_str(),
+              WTERMSIG(status));
+    } else if (WIFEXITED(status)) {
+        command->status = WEXITSTATUS(status);
+        if (command->status > 0) {
+            ALOGE("command '%s' failed: exit code %d\n", command->name.c_str(), command->status);
         }
     }
     return true;
 }
 
-// Triggers a bugreport and waits until it is all collected.
-// returns false if error, true if success
-bool doBugreport(int progress_socket, size_t* out_bytes_written, std::string* zip_path) {
-    // Socket will not be available until service starts.
-    android::base::unique_fd s;
-    for (int i = 0; i < kMaxDumpstateConnectAttempts; i++) {
-        s.reset(socket_local_client("dumpstate", ANDROID_SOCKET_NAMESPACE_RESERVED, SOCK_STREAM));
-        if (s != -1) break;
-        sleep(kWaitTimeBetweenConnectAttemptsInSec);
+// Takes the bugreport: runs the screenshots next to dumpstate, relays the dumpstate progress to
+// the progress socket, and has |streamer| send the zip file as dumpstate writes it.
+//
+// Everything is driven from a single epoll loop, so the screenshots and dumpstate take as long
+// as the slowest of them rather than adding up. The time taken by each phase is reported in the
+// progress stream before the final line.
+class BugreportSession {
+public:
+    explicit BugreportSession(ZipStreamer* streamer) : mStreamer(streamer) {}
+
+    // Starts capturing the physical displays, one screencap per display, and adds the files
+    // they write to |extra_files|.
+    void startScreenshots(const char* tmp_dir, std::vector<std::string>* extra_files);
+
+    // Start the dumpstatez service.
+    void startDumpstate();
+
+    // Connects to dumpstate and waits until the bugreport is all collected and the screenshots
+    // are done, relaying the progress to |progress_socket|.
+    // returns false if error, true if success
+    bool run(int progress_socket, std::string* zip_path);
+
+    size_t bytesWritten() const { return mBytesWritten; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    bool watch(int fd, uint64_t key);
+    bool tryConnect(Clock::time_point now);
+    bool readDumpstate(Clock::time_point now);
+    bool handleLine(const std::string& line, bool terminated);
+    bool sendLine(const std::string& line);
+    bool reportPhase(const char* phase, Clock::time_point start, Clock::time_point end);
+    bool screenshotsRunning() const;
+    bool updateScreenshots(Clock::time_point now);
+    int nextTimeoutMs(Clock::time_point now) const;
+
+    ZipStreamer* const mStreamer;
+    int mProgressSocket = -1;
+    android::base::unique_fd mEpollFd;
+
+    // dumpstate
+    android::base::unique_fd mDumpstateSocket;
+    bool mDumpstateDone = false;
+    bool mFinalLineSent = false;
+    Clock::time_point mDumpstateStartTime;
+    Clock::time_point mConnectDeadline;
+    Clock::time_point mNextConnectAttempt;
+    std::chrono::milliseconds mConnectDelay = kConnectRetryInitialDelay;
+    Clock::time_point mLastReadTime;
+    std::string mLine;
+    std::string mLastNonemptyLine;
+    std::string* mZipPath = nullptr;
+    size_t mBytesWritten = 0;
+
+    // screenshots
+    std::vector<std::string> mScreenshotDisplays;
+    std::vector<Command> mScreenshots;
+    Clock::time_point mScreenshotStartTime;
+    Clock::time_point mScreenshotDeadline;
+    int mScreenshotKillSignal = SIGTERM;
+    bool mScreenshotsReported = false;
+};
+
+void BugreportSession::startScreenshots(const char* tmp_dir,
+                                        std::vector<std::string>* extra_files) {
+    mScreenshotStartTime = Clock::now();
+    mScreenshotDeadline = mScreenshotStartTime + std::chrono::seconds(kScreenshotTimeoutInSec);
+
+    std::vector<PhysicalDisplayId> ids = SurfaceComposerClient::getPhysicalDisplayIds();
+    for (PhysicalDisplayId id : ids) {
+        std::string id_as_string = std::to_string(id);
+        std::string filename = std::string(tmp_dir) + kScreenshotPrefix + id_as_string + ".png";
+        std::vector<const char*> args{"-p", "-d", id_as_string.c_str(), filename.c_str(),
+                                      nullptr};
+        ALOGI("capturing screen for display (%s) as %s", id_as_string.c_str(), filename.c_str());
+        Command command;
+        command.name = "/system/bin/screencap";
+        if (startCommand(command.name.c_str(), args, &command)) {
+            mScreenshotDisplays.push_back(id_as_string);
+            mScreenshots.push_back(std::move(command));
+        } else {
+            LOG(ERROR) << "Failed to take screenshot for display:" << id_as_string;
+        }
+        // add the file regardless of the exit status of the screencap util.
+        extra_files->push_back(filename);
     }
+}
 
-    if (s == -1) {
-        ALOGE("failed to connect to dumpstatez service");
+void BugreportSession::startDumpstate() {
+    mDumpstateStartTime = Clock::now();
+    android::base::SetProperty("ctl.start", "car-dumpstatez");
+}
+
+bool BugreportSession::run(int progress_socket, std::string* zip_path) {
+    mProgressSocket = progress_socket;
+    mZipPath = zip_path;
+    mEpollFd.reset(epoll_create1(EPOLL_CLOEXEC));
+    if (mEpollFd == -1) {
+        ALOGE("epoll_create1 failed (%s)", strerror(errno));
         return false;
     }
-
-    // Set a timeout so that if nothing is read by the timeout, stop reading and quit
-    struct timeval tv = {
-        .tv_sec = kDumpstateTimeoutInSec,
-        .tv_usec = 0,
-    };
-    if (setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0) {
-        ALOGW("Cannot set socket timeout (%s)", strerror(errno));
+    for (size_t i = 0; i < mScreenshots.size(); i++) {
+        if (mScreenshots[i].pidfd != -1 && !watch(mScreenshots[i].pidfd, i)) {
+            // Polled instead.
+            mScreenshots[i].pidfd.reset();
+        }
     }
 
-    std::string line;
-    std::string last_nonempty_line;
-    char buffer[65536];
-    while (true) {
-        ssize_t bytes_read = copyTo(s, progress_socket, buffer, sizeof(buffer));
-        if (bytes_read == 0) {
+    mConnectDeadline = Clock::now() + std::chrono::seconds(kDumpstateConnectTimeoutInSec);
+    mNextConnectAttempt = Clock::now();
+
+    bool success = true;
+    while (success && (!mDumpstateDone || screenshotsRunning())) {
+        struct epoll_event events[8];
+        int count = TEMP_FAILURE_RETRY(
+                epoll_wait(mEpollFd, events, arraysize(events), nextTimeoutMs(Clock::now())));
+        if (count == -1) {
+            ALOGE("epoll_wait failed (%s)", strerror(errno));
+            success = false;
             break;
         }
-        if (bytes_read == -1) {
-            ALOGE("Failed to copy progress to the progress_socket.");
-            return false;
-        }
-        // Process the buffer line by line. this is needed for the filename.
-        for (int i = 0; i < bytes_read; i++) {
-            char c = buffer[i];
-            if (c == '\n') {
-                processLine(line, zip_path, &last_nonempty_line);
-                line.clear();
-            } else {
-                line.append(1, c);
+
+        const Clock::time_point now = Clock::now();
+        for (int i = 0; i < count && success; i++) {
+            if (events[i].data.u64 == kDumpstateKey) {
+                success = readDumpstate(now);
             }
+            // Screenshots are all checked below.
         }
-        *out_bytes_written += bytes_read;
+        if (success && mDumpstateSocket == -1 && !mDumpstateDone && now >= mNextConnectAttempt) {
+            success = tryConnect(now);
+        }
+        if (success && !mDumpstateDone && mDumpstateSocket != -1 &&
+            now - mLastReadTime >= std::chrono::seconds(kDumpstateTimeoutInSec)) {
+            ALOGE("read timed out");
+            success = false;
+        }
+        if (!updateScreenshots(now)) {
+            success = false;
+        }
+    }
+    if (!success) {
+        return false;
     }
-    s.reset();
-    // Process final line, in case it didn't finish with newline.
-    processLine(line, zip_path, &last_nonempty_line);
     // if doBugReport finished successfully, zip path should be set.
     if (zip_path->empty()) {
         ALOGE("no zip file path was found in bugreportz progress data");
@@ -275,130 +402,191 @@ bool doBugreport(int progress_socket, size_t* out_bytes_written, std::string* zi
     return true;
 }
 
-bool waitpid_with_timeout(pid_t pid, int timeout_secs, int* status) {
-    sigset_t child_mask, old_mask;
-    sigemptyset(&child_mask);
-    sigaddset(&child_mask, SIGCHLD);
-
-    if (sigprocmask(SIG_BLOCK, &child_mask, &old_mask) == -1) {
-        ALOGE("*** sigprocmask failed: %s\n", strerror(errno));
+bool BugreportSession::watch(int fd, uint64_t key) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = key;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        ALOGE("epoll_ctl failed (%s)", strerror(errno));
         return false;
     }
+    return true;
+}
 
-    timespec ts = {.tv_sec = timeout_secs, .tv_nsec = 0};
-    int ret = TEMP_FAILURE_RETRY(sigtimedwait(&child_mask, nullptr, &ts));
-    int saved_errno = errno;
-
-    // Set the signals back the way they were.
-    if (sigprocmask(SIG_SETMASK, &old_mask, nullptr) == -1) {
-        ALOGE("*** sigprocmask failed: %s\n", strerror(errno));
-        if (ret == 0) {
+bool BugreportSession::tryConnect(Clock::time_point now) {
+    // Socket will not be available until service starts.
+    mDumpstateSocket.reset(
+            socket_local_client("dumpstate", ANDROID_SOCKET_NAMESPACE_RESERVED, SOCK_STREAM));
+    if (mDumpstateSocket == -1) {
+        if (now + mConnectDelay > mConnectDeadline) {
+            ALOGE("failed to connect to dumpstatez service");
             return false;
         }
+        mNextConnectAttempt = now + mConnectDelay;
+        mConnectDelay = std::min(mConnectDelay * 2, kConnectRetryMaxDelay);
+        return true;
     }
-    if (ret == -1) {
-        errno = saved_errno;
-        if (errno == EAGAIN) {
-            errno = ETIMEDOUT;
-        } else {
-            ALOGE("*** sigtimedwait failed: %s\n", strerror(errno));
-        }
+    if (!reportPhase("connect", mDumpstateStartTime, now)) {
         return false;
     }
+    mLastReadTime = now;
+    return watch(mDumpstateSocket, kDumpstateKey);
+}
 
-    pid_t child_pid = waitpid(pid, status, WNOHANG);
-    if (child_pid != pid) {
-        if (child_pid != -1) {
-            ALOGE("*** Waiting for pid %d, got pid %d instead\n", pid, child_pid);
+bool BugreportSession::readDumpstate(Clock::time_point now) {
+    char buffer[65536];
+    ssize_t bytes_read = TEMP_FAILURE_RETRY(read(mDumpstateSocket, buffer, sizeof(buffer)));
+    if (bytes_read == -1) {
+        ALOGE("read terminated abnormally (%s)", strerror(errno));
+        return false;
+    }
+    mLastReadTime = now;
+    if (bytes_read == 0) {
+        // Process final line, in case it didn't finish with newline.
+        bool sent = handleLine(mLine, false);
+        mLine.clear();
+        mDumpstateDone = true;
+        mDumpstateSocket.reset();
+        return sent;
+    }
+    // Process the buffer line by line. this is needed for the filename, and so that the timings
+    // only go in between lines.
+    for (int i = 0; i < bytes_read; i++) {
+        char c = buffer[i];
+        if (c == '\n') {
+            if (!handleLine(mLine, true)) {
+                return false;
+            }
+            mLine.clear();
         } else {
-            ALOGE("*** waitpid failed: %s\n", strerror(errno));
+            mLine.append(1, c);
         }
-        return false;
     }
     return true;
 }
 
-// Runs the given command. Kills the command if it does not finish by timeout.
-int runCommand(int timeout_secs, const char* file, std::vector<const char*> args) {
-    pid_t pid = fork();
-
-    // handle error case
-    if (pid < 0) {
-        ALOGE("fork failed %s", strerror(errno));
-        return pid;
+bool BugreportSession::handleLine(const std::string& line, bool terminated) {
+    processLine(line, mZipPath, &mLastNonemptyLine, mStreamer);
+    if (line.find(kOkPrefix) == 0 || line.find(kFailPrefix) == 0) {
+        if (!reportPhase("dumpstate", mDumpstateStartTime, Clock::now())) {
+            return false;
+        }
+        mFinalLineSent = true;
     }
+    if ((terminated || !line.empty()) && !sendLine(terminated ? line + "\n" : line)) {
+        ALOGE("Failed to copy progress to the progress_socket.");
+        return false;
+    }
+    return true;
+}
 
-    // handle child case
-    if (pid == 0) {
-        /* make sure the child dies when parent dies */
-        prctl(PR_SET_PDEATHSIG, SIGKILL);
-
-        /* just ignore SIGPIPE, will go down with parent's */
-        struct sigaction sigact;
-        memset(&sigact, 0, sizeof(sigact));
-        sigact.sa_handler = SIG_IGN;
-        sigaction(SIGPIPE, &sigact, nullptr);
+bool BugreportSession::sendLine(const std::string& line) {
+    // MSG_NOSIGNAL since the client may have stopped reading after the final line.
+    const char* data = line.data();
+    size_t left = line.size();
+    while (left > 0) {
+        ssize_t sent = TEMP_FAILURE_RETRY(send(mProgressSocket, data, left, MSG_NOSIGNAL));
+        if (sent == -1) {
+            ALOGE("write failed (%s)", strerror(errno));
+            return false;
+        }
+        data += sent;
+        left -= sent;
+    }
+    mBytesWritten += line.size();
+    return true;
+}
 
-        execvp(file, (char**)args.data());
-        // execvp's result will be handled after waitpid_with_timeout() below, but
-        // if it failed, it's safer to exit dumpstate.
-        ALOGE("execvp on command %s failed (error: %s)", file, strerror(errno));
-        _exit(EXIT_FAILURE);
+bool BugreportSession::reportPhase(const char* phase, Clock::time_point start,
+                                   Clock::time_point end) {
+    const double seconds =
+            std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    ALOGI("%s took %.03fs", phase, seconds);
+    // Nothing is read past the final line.
+    if (mFinalLineSent) {
+        return true;
     }
+    return sendLine(android::base::StringPrintf("%s%s:%.03f\n", kTimingPrefix, phase, seconds));
+}
 
-    // handle parent case
-    int status;
-    bool ret = waitpid_with_timeout(pid, timeout_secs, &status);
+bool BugreportSession::screenshotsRunning() const {
+    return std::any_of(mScreenshots.begin(), mScreenshots.end(),
+                       [](const Command& command) { return command.running; });
+}
 
-    if (!ret) {
-        if (errno == ETIMEDOUT) {
-            ALOGE("command %s timed out (killing pid %d)", file, pid);
-        } else {
-            ALOGE("command %s: Error (killing pid %d)\n", file, pid);
+// Returns false if the end of the screenshots could not be reported.
+bool BugreportSession::updateScreenshots(Clock::time_point now) {
+    for (size_t i = 0; i < mScreenshots.size(); i++) {
+        Command& command = mScreenshots[i];
+        if (!command.running || !reapCommand(&command)) {
+            continue;
         }
-        kill(pid, SIGTERM);
-        if (!waitpid_with_timeout(pid, 5, nullptr)) {
-            kill(pid, SIGKILL);
-            if (!waitpid_with_timeout(pid, 5, nullptr)) {
-                ALOGE("could not kill command '%s' (pid %d) even with SIGKILL.\n", file, pid);
-            }
+        if (command.status == 0) {
+            LOG(INFO) << "Screenshot saved for display:" << mScreenshotDisplays[i];
+        } else {
+            LOG(ERROR) << "Failed to take screenshot for display:" << mScreenshotDisplays[i];
         }
-        return -1;
     }
 
-    if (WIFSIGNALED(status)) {
-        ALOGE("command '%s' failed: killed by signal %d\n", file, WTERMSIG(status));
-    } else if (WIFEXITED(status) && WEXITSTATUS(status) > 0) {
-        status = WEXITSTATUS(status);
-        ALOGE("command '%s' failed: exit code %d\n", file, status);
+    if (!screenshotsRunning()) {
+        if (!mScreenshotsReported && !mScreenshots.empty()) {
+            mScreenshotsReported = true;
+            return reportPhase("screenshots", mScreenshotStartTime, now);
+        }
+        return true;
     }
-
-    return status;
-}
-
-void takeScreenshotForDisplayId(PhysicalDisplayId id, const char* tmp_dir,
-        std::vector<std::string>* extra_files) {
-    std::string id_as_string = std::to_string(id);
-    std::string filename = std::string(tmp_dir) + kScreenshotPrefix + id_as_string + ".png";
-    std::vector<const char*> args { "-p", "-d", id_as_string.c_str(), filename.c_str(), nullptr };
-    ALOGI("capturing screen for display (%s) as %s", id_as_string.c_str(), filename.c_str());
-    int status = runCommand(10, "/system/bin/screencap", args);
-    if (status == 0) {
-        LOG(INFO) << "Screenshot saved for display:" << id_as_string;
+    if (now < mScreenshotDeadline) {
+        return true;
     }
-    // add the file regardless of the exit status of the screencap util.
-    extra_files->push_back(filename);
 
-    LOG(ERROR) << "Failed to take screenshot for display:" << id_as_string;
+    // Asked nicely first, then SIGKILL, each time giving them 5s to go away.
+    for (Command& command : mScreenshots) {
+        if (!command.running) {
+            continue;
+        }
+        if (mScreenshotKillSignal == 0) {
+            ALOGE("could not kill command '%s' (pid %d) even with SIGKILL.\n",
+                  command.name.c_str(), command.pid);
+            command.running = false;
+            continue;
+        }
+        if (mScreenshotKillSignal == SIGTERM) {
+            ALOGE("command %s timed out (killing pid %d)", command.name.c_str(), command.pid);
+        }
+        kill(command.pid, mScreenshotKillSignal);
+    }
+    mScreenshotKillSignal = mScreenshotKillSignal == SIGTERM ? SIGKILL : 0;
+    mScreenshotDeadline = now + std::chrono::seconds(5);
+    return true;
 }
 
-void takeScreenshot(const char* tmp_dir, std::vector<std::string>* extra_files) {
-    // Now send the screencaptures
-    std::vector<PhysicalDisplayId> ids = SurfaceComposerClient::getPhysicalDisplayIds();
-
-    for (PhysicalDisplayId display_id : ids) {
-        takeScreenshotForDisplayId(display_id, tmp_dir, extra_files);
+int BugreportSession::nextTimeoutMs(Clock::time_point now) const {
+    Clock::time_point deadline = Clock::time_point::max();
+    if (!mDumpstateDone) {
+        deadline = mDumpstateSocket == -1
+                ? mNextConnectAttempt
+                : mLastReadTime + std::chrono::seconds(kDumpstateTimeoutInSec);
+    }
+    if (screenshotsRunning()) {
+        deadline = std::min(deadline, mScreenshotDeadline);
+        bool polled = std::any_of(mScreenshots.begin(), mScreenshots.end(),
+                                  [](const Command& command) {
+                                      return command.running && command.pidfd == -1;
+                                  });
+        if (polled) {
+            deadline = std::min(deadline, now + kCommandPollInterval);
+        }
     }
+    if (deadline == Clock::time_point::max()) {
+        return -1;
+    }
+    if (deadline <= now) {
+        return 0;
+    }
+    // Rounded up, so that the deadline has passed when epoll_wait() returns.
+    return std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now +
+                                                                 std::chrono::milliseconds(1))
+            .count();
 }
 
 bool recursiveRemoveDir(const std::string& path) {
@@ -451,38 +639,46 @@ int main(void) {
 
     auto t0 = std::chrono::steady_clock::now();
 
+    // The zip file is sent while dumpstate writes it, once it said where. If it never does,
+    // the whole file is copied once it is done.
+    int output_listen_socket = listenSocket(kCarBrOutputSocket);
+    ZipStreamer streamer(output_listen_socket);
+    BugreportSession session(&streamer);
+
     std::vector<std::string> extra_files;
     if (createTempDir(kTempDirectory) == OK) {
-        // take screenshots of the physical displays as early as possible
-        takeScreenshot(kTempDirectory, &extra_files);
+        // take screenshots of the physical displays as early as possible. They run next to
+        // dumpstate.
+        session.startScreenshots(kTempDirectory, &extra_files);
     }
+    session.startDumpstate();
 
-    // Start the dumpstatez service.
-    android::base::SetProperty("ctl.start", "car-dumpstatez");
-
-    size_t bytes_written = 0;
-
-    std::string zip_path;
     int progress_socket = openSocket(kCarBrProgressSocket);
     if (progress_socket < 0) {
         // early out. in this case we will not print the final message, but that is ok.
         android::base::SetProperty("ctl.stop", "car-dumpstatez");
         return EXIT_FAILURE;
     }
-    bool ret_val = doBugreport(progress_socket, &bytes_written, &zip_path);
+    std::string zip_path;
+    bool ret_val = session.run(progress_socket, &zip_path);
+    size_t bytes_written = session.bytesWritten();
     close(progress_socket);
 
-    if (ret_val) {
-        int output_socket = openSocket(kCarBrOutputSocket);
+    if (ret_val && streamer.isStarted()) {
+        ret_val = streamer.finish(zip_path);
+    } else if (ret_val) {
+        int output_socket = acceptSocket(output_listen_socket);
         if (output_socket != -1) {
             ret_val = copyFile(zip_path, output_socket);
             close(output_socket);
         }
+    } else {
+        streamer.abort();
     }
 
     int extra_output_socket = openSocket(kCarBrExtraOutputSocket);
     if (extra_output_socket != -1 && ret_val) {
-        zipFilesToFd(extra_files, extra_output_socket);
+        zipFiles(extra_files, extra_output_socket, std::thread::hardware_concurrency());
     }
     if (extra_output_socket != -1) {
         close(extra_output_socket);
@@ -498,7 +694,7 @@ int main(void) {
 
     recursiveRemoveDir(kTempDirectory);
 
-    // No matter how doBugreport() finished, let's try to explicitly stop
+    // No matter how the session finished, let's try to explicitly stop
     // car-dumpstatez in case it stalled.
     android::base::SetProperty("ctl.stop", "car-dumpstatez");
 
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FileTransfer.h"
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <future>
+#include <random>
+#include <string>
+
+namespace android {
+namespace car {
+namespace bugreport {
+
+namespace {
+
+using android::base::unique_fd;
+using android::base::WriteStringToFile;
+
+// Large enough to take several kernel chunks, and not a multiple of any buffer size.
+constexpr size_t kFileSize = 24 * 1024 * 1024 + 12345;
+
+std::string syntheticContents(size_t size) {
+    std::mt19937 generator(size);
+    std::string contents(size, '\0');
+    for (auto& c : contents) {
+        c = static_cast<char>(generator());
+    }
+    return contents;
+}
+
+// Drains |fd| on another thread, so that the writer never blocks on a full socket buffer.
+std::future<std::string> readAllAsync(unique_fd fd) {
+    return std::async(std::launch::async, [fd = std::move(fd)]() {
+        std::string received;
+        android::base::ReadFdToString(fd, &received);
+        return received;
+    });
+}
+
+class FileTransferTest : public ::testing::TestWithParam<TransferMethod> {
+protected:
+    void SetUp() override {
+        mContents = syntheticContents(kFileSize);
+        ASSERT_TRUE(WriteStringToFile(mContents, mFile.path));
+        int sockets[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets), 0);
+        mSender.reset(sockets[0]);
+        mReceiver.reset(sockets[1]);
+    }
+
+    std::string mContents;
+    TemporaryFile mFile;
+    unique_fd mSender;
+    unique_fd mReceiver;
+};
+
+}  // namespace
+
+TEST_P(FileTransferTest, TestCopiesFileToSocket) {
+    unique_fd in(open(mFile.path, O_RDONLY | O_CLOEXEC));
+    ASSERT_NE(in, -1);
+    auto received = readAllAsync(std::move(mReceiver));
+
+    TransferStats stats;
+    ASSERT_TRUE(transferAll(in, mSender, "test file", GetParam(), &stats));
+    mSender.reset();
+
+    EXPECT_EQ(stats.bytes, kFileSize);
+    EXPECT_EQ(stats.method, GetParam()) << "Files to sockets should never need a fallback";
+    EXPECT_TRUE(received.get() == mContents) << "Received bytes differ from the file";
+}
+
+TEST_P(FileTransferTest, TestContinuesFromCurrentOffset) {
+    constexpr size_t kSkipped = 4099;
+    unique_fd in(open(mFile.path, O_RDONLY | O_CLOEXEC));
+    ASSERT_NE(in, -1);
+    ASSERT_EQ(lseek(in, kSkipped, SEEK_SET), static_cast<off_t>(kSkipped));
+    auto received = readAllAsync(std::move(mReceiver));
+
+    TransferStats stats;
+    ASSERT_TRUE(transferAll(in, mSender, "test file", GetParam(), &stats));
+    mSender.reset();
+
+    EXPECT_EQ(stats.bytes, kFileSize - kSkipped);
+    EXPECT_TRUE(received.get() == mContents.substr(kSkipped));
+}
+
+TEST_P(FileTransferTest, TestFallsBackForSocketInput) {
+    // sendfile() can't read from a socket, so this has to fall back to a method that can.
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets), 0);
+    unique_fd source_writer(sockets[0]);
+    unique_fd source_reader(sockets[1]);
+    auto fed = std::async(std::launch::async, [this, fd = std::move(source_writer)]() mutable {
+        bool written = android::base::WriteStringToFd(mContents, fd);
+        // Signal EOF to the transfer.
+        fd.reset();
+        return written;
+    });
+    auto received = readAllAsync(std::move(mReceiver));
+
+    TransferStats stats;
+    ASSERT_TRUE(transferAll(source_reader, mSender, "test socket", GetParam(), &stats));
+    mSender.reset();
+
+    EXPECT_TRUE(fed.get());
+    EXPECT_EQ(stats.bytes, kFileSize);
+    EXPECT_NE(stats.method, TransferMethod::SENDFILE);
+    EXPECT_TRUE(received.get() == mContents) << "Received bytes differ from the source";
+}
+
+TEST_P(FileTransferTest, TestFailsOnClosedOutput) {
+    unique_fd in(open(mFile.path, O_RDONLY | O_CLOEXEC));
+    ASSERT_NE(in, -1);
+    mReceiver.reset();
+
+    // Don't die from SIGPIPE while writing to the closed socket.
+    signal(SIGPIPE, SIG_IGN);
+    EXPECT_FALSE(transferAll(in, mSender, "test file", GetParam()));
+}
+
+INSTANTIATE_TEST_SUITE_P(Methods, FileTransferTest,
+                         ::testing::Values(TransferMethod::SENDFILE, TransferMethod::SPLICE,
+                                           TransferMethod::BUFFERED),
+                         [](const ::testing::TestParamInfo<TransferMethod>& info) {
+                             return std::string(toString(info.param));
+                         });
+
+}  // namespace bugreport
+}  // namespace car
+}  // namespace android
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ZipArchiver.h"
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <ziparchive/zip_archive.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace car {
+namespace bugreport {
+
+namespace {
+
+using android::base::WriteStringToFile;
+
+// Returns |size| bytes that deflate can't shrink.
+std::string incompressibleData(size_t size) {
+    std::string data(size, '\0');
+    uint32_t state = 12345;
+    for (auto& c : data) {
+        state = state * 1103515245 + 12345;
+        c = static_cast<char>(state >> 24);
+    }
+    return data;
+}
+
+}  // namespace
+
+class ZipArchiverTest : public ::testing::Test {
+protected:
+    std::string writeFile(const std::string& name, const std::string& contents) {
+        std::string path = std::string(mDir.path) + "/" + name;
+        EXPECT_TRUE(WriteStringToFile(contents, path));
+        return path;
+    }
+
+    // Checks that the zip file holds |name| with |contents|, compressed with |method|.
+    void expectEntry(const std::string& name, const std::string& contents, uint16_t method) {
+        ZipEntry entry;
+        ASSERT_EQ(FindEntry(mArchive, name, &entry), 0) << name;
+        EXPECT_EQ(entry.method, method) << name;
+        ASSERT_EQ(entry.uncompressed_length, contents.size()) << name;
+        std::string extracted(contents.size(), '\0');
+        ASSERT_EQ(ExtractToMemory(mArchive, &entry, reinterpret_cast<uint8_t*>(&extracted[0]),
+                                  extracted.size()),
+                  0)
+                << name;
+        EXPECT_EQ(extracted, contents) << name;
+    }
+
+    void openArchive() {
+        ASSERT_EQ(lseek(mZipFile.fd, 0, SEEK_SET), 0);
+        ASSERT_EQ(OpenArchiveFd(mZipFile.fd, "extra files", &mArchive,
+                                /*assume_ownership=*/false),
+                  0);
+    }
+
+    void TearDown() override {
+        if (mArchive != nullptr) {
+            CloseArchive(mArchive);
+        }
+    }
+
+    TemporaryDir mDir;
+    TemporaryFile mZipFile;
+    ZipArchiveHandle mArchive = nullptr;
+};
+
+TEST_F(ZipArchiverTest, TestDeflatesOnlyUncompressedFormats) {
+    const std::string text(256 * 1024, 'a');
+    const std::string png = incompressibleData(64 * 1024);
+    const std::string log = "short log\n";
+    const std::vector<std::string> files = {
+            writeFile("dumpsys.txt", text),
+            writeFile("screenshot0.png", png),
+            writeFile("screenshot1.PNG", text),
+            writeFile("noise.bin", png),
+            writeFile("empty.txt", ""),
+            writeFile("log.txt", log),
+    };
+    ASSERT_TRUE(zipFiles(files, mZipFile.fd, /*num_threads=*/4));
+
+    openArchive();
+    expectEntry("dumpsys.txt", text, kCompressDeflated);
+    expectEntry("screenshot0.png", png, kCompressStored);
+    // Formats that are already compressed are stored as is, however well they would deflate.
+    expectEntry("screenshot1.PNG", text, kCompressStored);
+    // Data that doesn't shrink is stored.
+    expectEntry("noise.bin", png, kCompressStored);
+    expectEntry("empty.txt", "", kCompressStored);
+    expectEntry("log.txt", log, kCompressStored);
+}
+
+TEST_F(ZipArchiverTest, TestLeavesOutUnreadableFiles) {
+    const std::string text(4096, 'b');
+    const std::vector<std::string> files = {
+            std::string(mDir.path) + "/missing.txt",
+            writeFile("dumpsys.txt", text),
+    };
+    ASSERT_TRUE(zipFiles(files, mZipFile.fd, /*num_threads=*/1));
+
+    openArchive();
+    ZipEntry entry;
+    EXPECT_NE(FindEntry(mArchive, "missing.txt", &entry), 0);
+    expectEntry("dumpsys.txt", text, kCompressDeflated);
+}
+
+TEST_F(ZipArchiverTest, TestEmptyArchive) {
+    ASSERT_TRUE(zipFiles({}, mZipFile.fd, /*num_threads=*/4));
+
+    struct stat st;
+    ASSERT_EQ(fstat(mZipFile.fd, &st), 0);
+    // Just the end of central directory record.
+    EXPECT_EQ(st.st_size, 22);
+}
+
+}  // namespace bugreport
+}  // namespace car
+}  // namespace android
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ZipStreamer.h"
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace car {
+namespace bugreport {
+
+namespace {
+
+using android::base::unique_fd;
+using std::chrono::steady_clock;
+
+constexpr size_t kEntryCount = 8;
+constexpr size_t kEntrySize = 1024 * 1024 + 321;
+constexpr size_t kWriteSize = 64 * 1024;
+constexpr auto kWriteDelay = std::chrono::milliseconds(2);
+
+void putLe16(std::string* out, uint16_t value) {
+    out->push_back(static_cast<char>(value));
+    out->push_back(static_cast<char>(value >> 8));
+}
+
+void putLe32(std::string* out, uint32_t value) {
+    putLe16(out, static_cast<uint16_t>(value));
+    putLe16(out, static_cast<uint16_t>(value >> 16));
+}
+
+std::string localHeader(const std::string& name, uint16_t flags, uint32_t size) {
+    std::string header;
+    putLe32(&header, 0x04034b50);
+    putLe16(&header, 20);     // version needed
+    putLe16(&header, flags);
+    putLe16(&header, 0);      // stored
+    putLe32(&header, 0);      // time and date
+    putLe32(&header, 0);      // crc, never checked here
+    putLe32(&header, size);   // compressed size
+    putLe32(&header, size);   // uncompressed size
+    putLe16(&header, name.size());
+    putLe16(&header, 0);      // extra field length
+    return header + name;
+}
+
+// Writes a stored zip file the way a zip writer on a seekable file does: each local header
+// starts with zero sizes, and is filled in once the entry is done. Slowly, like dumpstate.
+// Keeps a copy of everything that was written, since the file itself may lose it.
+class FakeBugreportz {
+public:
+    explicit FakeBugreportz(const std::string& path) : mPath(path) {}
+
+    void write() {
+        unique_fd fd(open(mPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+        ASSERT_NE(fd, -1);
+        std::vector<uint64_t> offsets;
+        for (size_t i = 0; i < kEntryCount; i++) {
+            const std::string name = "entry" + std::to_string(i) + ".txt";
+            const std::string header = localHeader(name, 0, 0);
+            offsets.push_back(mContents.size());
+            append(fd, header);
+
+            std::string data(kEntrySize, static_cast<char>('a' + i));
+            for (size_t j = 0; j < data.size(); j += kWriteSize) {
+                append(fd, data.substr(j, kWriteSize));
+                std::this_thread::sleep_for(kWriteDelay);
+            }
+            patch(fd, offsets.back(), localHeader(name, 0, kEntrySize));
+        }
+
+        const uint64_t central_offset = mContents.size();
+        std::string central;
+        for (size_t i = 0; i < kEntryCount; i++) {
+            const std::string name = "entry" + std::to_string(i) + ".txt";
+            putLe32(&central, 0x02014b50);
+            central.append(24, '\0');
+            putLe16(&central, name.size());
+            central.append(12, '\0');
+            putLe32(&central, offsets[i]);
+            central += name;
+        }
+        const size_t central_size = central.size();
+        putLe32(&central, 0x06054b50);
+        central.append(4, '\0');
+        putLe16(&central, kEntryCount);
+        putLe16(&central, kEntryCount);
+        putLe32(&central, central_size);
+        putLe32(&central, central_offset);
+        putLe16(&central, 0);
+        append(fd, central);
+        mFinishTime = steady_clock::now();
+    }
+
+    const std::string& contents() const { return mContents; }
+    steady_clock::time_point finishTime() const { return mFinishTime; }
+
+private:
+    void append(int fd, const std::string& bytes) {
+        patch(fd, mContents.size(), bytes);
+    }
+
+    void patch(int fd, uint64_t offset, const std::string& bytes) {
+        ASSERT_EQ(pwrite(fd, bytes.data(), bytes.size(), offset),
+                  static_cast<ssize_t>(bytes.size()));
+        if (offset + bytes.size() > mContents.size()) {
+            mContents.resize(offset + bytes.size());
+        }
+        mContents.replace(offset, bytes.size(), bytes);
+    }
+
+    const std::string mPath;
+    std::string mContents;
+    steady_clock::time_point mFinishTime;
+};
+
+struct Received {
+    std::string contents;
+    steady_clock::time_point first_byte_time;
+};
+
+std::future<Received> readAllAsync(unique_fd fd) {
+    return std::async(std::launch::async, [fd = std::move(fd)]() {
+        Received received;
+        char buffer[65536];
+        ssize_t n;
+        while ((n = TEMP_FAILURE_RETRY(read(fd, buffer, sizeof(buffer)))) > 0) {
+            if (received.contents.empty()) {
+                received.first_byte_time = steady_clock::now();
+            }
+            received.contents.append(buffer, n);
+        }
+        return received;
+    });
+}
+
+class ZipStreamerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mTempPath = std::string(mDir.path) + "/bugreport.zip.tmp";
+        mFinalPath = std::string(mDir.path) + "/bugreport.zip";
+
+        // An abstract socket stands in for the init control socket.
+        mAddress.sun_family = AF_UNIX;
+        const std::string name = "car_bugreportd_test_" + std::to_string(getpid());
+        memcpy(mAddress.sun_path + 1, name.data(), name.size());
+        mAddressLength = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+        mListenFd.reset(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        ASSERT_NE(mListenFd, -1);
+        ASSERT_EQ(bind(mListenFd, reinterpret_cast<sockaddr*>(&mAddress), mAddressLength), 0);
+        ASSERT_EQ(listen(mListenFd, 4), 0);
+    }
+
+    unique_fd connectClient() {
+        unique_fd fd(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&mAddress), mAddressLength), 0);
+        return fd;
+    }
+
+    TemporaryDir mDir;
+    std::string mTempPath;
+    std::string mFinalPath;
+    sockaddr_un mAddress = {};
+    socklen_t mAddressLength = 0;
+    unique_fd mListenFd;
+};
+
+}  // namespace
+
+TEST_F(ZipStreamerTest, TestFindSafeOffset) {
+    unique_fd fd(open(mTempPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600));
+    ASSERT_NE(fd, -1);
+    const std::string first = localHeader("first", 0, 100);
+    const std::string second = localHeader("second", 0, 0);
+    std::string contents = localHeader("first", 0, 0) + std::string(100, 'x');
+    ASSERT_TRUE(android::base::WriteStringToFd(contents, fd));
+
+    // Sizes not filled in yet
+    EXPECT_EQ(findSafeOffset(fd, 0), 0u);
+    ASSERT_EQ(pwrite(fd, first.data(), first.size(), 0), static_cast<ssize_t>(first.size()));
+    // Sizes known, but nothing after the entry yet
+    EXPECT_EQ(findSafeOffset(fd, 0), 0u);
+    ASSERT_TRUE(android::base::WriteStringToFd(second, fd));
+    EXPECT_EQ(findSafeOffset(fd, 0), first.size() + 100);
+    EXPECT_EQ(findSafeOffset(fd, first.size() + 100), first.size() + 100);
+}
+
+TEST_F(ZipStreamerTest, TestFindSafeOffsetStopsAtDataDescriptor) {
+    unique_fd fd(open(mTempPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600));
+    ASSERT_NE(fd, -1);
+    const std::string contents = localHeader("first", 1 << 3, 10) + std::string(10, 'x') +
+            localHeader("second", 0, 0);
+    ASSERT_TRUE(android::base::WriteStringToFd(contents, fd));
+    EXPECT_EQ(findSafeOffset(fd, 0), 0u);
+}
+
+TEST_F(ZipStreamerTest, TestStreamsWhileWriting) {
+    FakeBugreportz bugreportz(mTempPath);
+    ZipStreamer streamer(mListenFd);
+    // Started before the file exists, as dumpstate prints BEGIN first.
+    ASSERT_TRUE(streamer.start(mTempPath));
+    auto received = readAllAsync(connectClient());
+
+    bugreportz.write();
+    ASSERT_EQ(rename(mTempPath.c_str(), mFinalPath.c_str()), 0);
+    // Sample the disk usage before finish() sends the rest.
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    struct stat st;
+    ASSERT_EQ(stat(mFinalPath.c_str(), &st), 0);
+
+    ASSERT_TRUE(streamer.finish(mFinalPath));
+    Received result = received.get();
+    ASSERT_EQ(result.contents.size(), bugreportz.contents().size());
+    EXPECT_TRUE(result.contents == bugreportz.contents());
+    EXPECT_LT(result.first_byte_time, bugreportz.finishTime());
+
+    ZipStreamer::Stats stats = streamer.getStats();
+    EXPECT_EQ(stats.bytes_sent, bugreportz.contents().size());
+    // Everything but the last entry and the central directory
+    EXPECT_GE(stats.bytes_streamed, (kEntryCount - 1) * kEntrySize);
+    EXPECT_LT(stats.seconds_to_first_byte, stats.seconds);
+    if (stats.bytes_released > 0) {
+        EXPECT_LT(static_cast<uint64_t>(st.st_blocks) * 512, bugreportz.contents().size());
+    }
+    printf("First byte after %.03fs, done after %.03fs, %.1f of %.1f MB released early\n",
+           stats.seconds_to_first_byte, stats.seconds, stats.bytes_released / 1048576.0,
+           bugreportz.contents().size() / 1048576.0);
+}
+
+TEST_F(ZipStreamerTest, TestClientConnectingAfterFinish) {
+    FakeBugreportz bugreportz(mTempPath);
+    ZipStreamer streamer(mListenFd);
+    ASSERT_TRUE(streamer.start(mTempPath));
+    bugreportz.write();
+
+    // Older clients only connect once they saw OK.
+    auto received = readAllAsync(connectClient());
+    ASSERT_TRUE(streamer.finish(mTempPath));
+    EXPECT_TRUE(received.get().contents == bugreportz.contents());
+    EXPECT_EQ(streamer.getStats().bytes_sent, bugreportz.contents().size());
+}
+
+TEST_F(ZipStreamerTest, TestAbortClosesClient) {
+    ZipStreamer streamer(mListenFd);
+    ASSERT_TRUE(streamer.start(mTempPath));
+    auto received = readAllAsync(connectClient());
+    ASSERT_TRUE(android::base::WriteStringToFile(localHeader("first", 0, 0), mTempPath));
+
+    streamer.abort();
+    EXPECT_FALSE(streamer.isStarted());
+    // In case the streamer did not get to accept the client
+    mListenFd.reset();
+    EXPECT_TRUE(received.get().contents.empty());
+}
+
+}  // namespace bugreport
+}  // namespace car
+}  // namespace android
@@ -16,11 +16,15 @@
 
 #define LOG_TAG "CarPowerManagerNative: "
 
+#include <android/os/IServiceManager.h>
 #include <binder/IServiceManager.h>
 #include <binder/IBinder.h>
 #include <binder/IInterface.h>
+#include <binder/ProcessState.h>
 #include <utils/Log.h>
 
+#include <future>
+
 #include "CarPowerManager.h"
 
 namespace android {
@@ -28,90 +32,258 @@ namespace car {
 namespace hardware {
 namespace power {
 
+namespace {
+
+// The AIDL interface of servicemanager, which can tell when a service is added.
+sp<os::IServiceManager> getServiceManager() {
+    return interface_cast<os::IServiceManager>(ProcessState::self()->getContextObject(nullptr));
+}
+
+}  // namespace
+
+CarPowerManager::CarPowerManager(const std::string& carServiceName) :
+        mCarServiceName(carServiceName),
+        mLink(std::make_shared<Link>(this)),
+        mServiceCallback(new ServiceCallback(mLink)),
+        mDeathRecipient(new DeathRecipient(mLink)),
+        mListenerToService(new CarPowerStateListener(mLink)),
+        mExecutor([this]() { executorLoop(); }) {}
+
+CarPowerManager::~CarPowerManager() {
+    // Clear the listener if one is set
+    clearListener();
+    mLink->detach();
+
+    if (mWatching) {
+        getServiceManager()->unregisterForNotifications(mCarServiceName, mServiceCallback);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mCarBinder != nullptr && mCarBinder->remoteBinder() != nullptr) {
+            mCarBinder->unlinkToDeath(mDeathRecipient);
+        }
+        mStopping = true;
+    }
+    mCondition.notify_all();
+    mExecutor.join();
+}
+
 // Public functions
 int CarPowerManager::clearListener() {
     int retVal = -1;
 
-    if (mIsConnected && (mListenerToService != nullptr)) {
-        mICarPower->unregisterListener(mListenerToService);
-        mListenerToService = nullptr;
-        retVal = 0;
-    }
+    runOnExecutor([this, &retVal]() {
+        if (mIsRegistered) {
+            mICarPower->unregisterListener(mListenerToService);
+            mIsRegistered = false;
+            retVal = 0;
+        }
+        mListener = nullptr;
+    });
     return retVal;
 }
 
 int CarPowerManager::requestShutdownOnNextSuspend() {
-    int retVal = -1;
-
-    if (connectToCarService()) {
-        mICarPower->requestShutdownOnNextSuspend();
-        retVal = 0;
+    sp<ICarPower> carPower;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        carPower = mICarPower;
     }
-    return retVal;
+    if (carPower == nullptr) {
+        // Not waiting for it, unlike the listener.
+        sp<IBinder> binder =
+                defaultServiceManager()->checkService(String16(mCarServiceName.c_str()));
+        if (binder == nullptr) {
+            ALOGE(LOG_TAG "Cannot get ICar");
+            return -1;
+        }
+        runOnExecutor([this, binder]() { connect(binder, std::chrono::steady_clock::now()); });
+        std::lock_guard<std::mutex> lock(mMutex);
+        carPower = mICarPower;
+    }
+    if (carPower == nullptr || !carPower->requestShutdownOnNextSuspend().isOk()) {
+        return -1;
+    }
+    return 0;
 }
 
 int CarPowerManager::setListener(Listener listener) {
-    int retVal = -1;
+    if (!startWatching()) {
+        return -1;
+    }
 
-    if (connectToCarService()) {
-        if (mListenerToService == nullptr) {
-            mListenerToService = new CarPowerStateListener(this);
-            mICarPower->registerListener(mListenerToService);
+    runOnExecutor([this, &listener]() {
+        mListener = std::move(listener);
+        if (mICarPower != nullptr && !mIsRegistered) {
+            registerListener();
         }
-
-        // Set the listener
-        mListener = listener;
-        retVal = 0;
-    }
-    return retVal;
+    });
+    return 0;
 }
 
 
 // Private functions
-bool CarPowerManager::connectToCarService() {
-    if (mIsConnected) {
-        // Service is already connected
+bool CarPowerManager::startWatching() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mWatching) {
         return true;
     }
 
-    const String16 ICarName("car_service");
-    const String16 ICarPowerName("power");
+    // Tells right away if CarService is already there.
+    Status status = getServiceManager()->registerForNotifications(mCarServiceName,
+                                                                  mServiceCallback);
+    if (!status.isOk()) {
+        ALOGE(LOG_TAG "Cannot watch for %s: %s", mCarServiceName.c_str(),
+              status.toString8().c_str());
+        return false;
+    }
+    mWatching = true;
+    return true;
+}
+
+void CarPowerManager::connect(const sp<IBinder>& carBinder,
+                              std::chrono::steady_clock::time_point available) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (carBinder == mCarBinder) {
+            // Service is already connected
+            return;
+        }
+    }
 
     ALOGI(LOG_TAG "Connecting to CarService");
 
-    // Get ICar
-    sp<IServiceManager> serviceManager = defaultServiceManager();
-    if (serviceManager == nullptr) {
-        ALOGE(LOG_TAG "Cannot get defaultServiceManager");
-        return(false);
+    // Get ICarPower
+    sp<ICar> iCar = interface_cast<ICar>(carBinder);
+    sp<IBinder> binder;
+    if (iCar == nullptr || !iCar->getCarService(String16("power"), &binder).isOk() ||
+        binder == nullptr) {
+        ALOGE(LOG_TAG "Cannot get ICarPower");
+        return;
+    }
+    if (carBinder->remoteBinder() != nullptr && carBinder->linkToDeath(mDeathRecipient) != OK) {
+        ALOGW(LOG_TAG "CarService died while connecting");
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCarBinder = carBinder;
+        mICarPower = interface_cast<ICarPower>(binder);
+    }
+    mIsRegistered = false;
+    if (mListener != nullptr) {
+        registerListener();
+        ALOGI(LOG_TAG "Listener registered %.1fms after CarService became available",
+              std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - available).count());
     }
+}
 
-    sp<IBinder> binder = (serviceManager->getService(ICarName));
-    if (binder == nullptr) {
-        ALOGE(LOG_TAG "Cannot get ICar");
-        return false;
+void CarPowerManager::disconnect(const wp<IBinder>& carBinder) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (carBinder.unsafe_get() != mCarBinder.get()) {
+            return;
+        }
+        mCarBinder = nullptr;
+        mICarPower = nullptr;
     }
+    mIsRegistered = false;
+    // servicemanager tells when it is back.
+    ALOGW(LOG_TAG "CarService died, waiting for it to come back");
+}
 
-    // Get ICarPower
-    sp<ICar> iCar = interface_cast<ICar>(binder);
-    if (iCar == nullptr) {
-        ALOGW(LOG_TAG "car service unavailable");
-        return false;
+void CarPowerManager::registerListener() {
+    Status status = mICarPower->registerListener(mListenerToService);
+    if (!status.isOk()) {
+        ALOGE(LOG_TAG "Cannot register listener: %s", status.toString8().c_str());
+        return;
     }
+    mIsRegistered = true;
+}
 
-    iCar->getCarService(ICarPowerName, &binder);
-    if (binder == nullptr) {
-        ALOGE(LOG_TAG "Cannot get ICarPower");
-        return false;
+void CarPowerManager::notifyListener(int state) {
+    if (mListener == nullptr) {
+        ALOGE(LOG_TAG "onStateChanged null pointer detected!");
+    } else if ((state < static_cast<int>(State::kFirst)) ||
+               (state > static_cast<int>(State::kLast)) )  {
+        ALOGE(LOG_TAG "onStateChanged unknown state: %d", state);
+    } else {
+        // Notify the listener of the state transition
+        mListener(static_cast<State>(state));
     }
+}
 
-    mICarPower = interface_cast<ICarPower>(binder);
-    if (mICarPower == nullptr) {
-        ALOGW(LOG_TAG "car power management service unavailable");
-        return false;
+void CarPowerManager::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mStopping) {
+            return;
+        }
+        mTasks.push_back(std::move(task));
     }
-    mIsConnected = true;
-    return true;
+    mCondition.notify_all();
+}
+
+void CarPowerManager::runOnExecutor(std::function<void()> task) {
+    if (std::this_thread::get_id() == mExecutor.get_id()) {
+        task();
+        return;
+    }
+    std::promise<void> done;
+    post([&task, &done]() {
+        task();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+void CarPowerManager::executorLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+            if (mTasks.empty()) {
+                return;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
+
+void CarPowerManager::Link::post(std::function<void(CarPowerManager*)> task) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mParent != nullptr) {
+        CarPowerManager* parent = mParent;
+        parent->post([parent, task = std::move(task)]() { task(parent); });
+    }
+}
+
+void CarPowerManager::Link::detach() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mParent = nullptr;
+}
+
+Status CarPowerManager::CarPowerStateListener::onStateChanged(int state) {
+    mLink->post([state](CarPowerManager* parent) { parent->notifyListener(state); });
+    return binder::Status::ok();
+}
+
+Status CarPowerManager::ServiceCallback::onRegistration(const std::string&,
+                                                        const sp<IBinder>& binder) {
+    auto available = std::chrono::steady_clock::now();
+    mLink->post([binder, available](CarPowerManager* parent) {
+        parent->connect(binder, available);
+    });
+    return binder::Status::ok();
+}
+
+void CarPowerManager::DeathRecipient::binderDied(const wp<IBinder>& who) {
+    mLink->post([who](CarPowerManager* parent) { parent->disconnect(who); });
 }
 
 
@@ -119,4 +291,3 @@ bool CarPowerManager::connectToCarService() {
 } // namespace hardware
 } // namespace car
 } // namespace android
-
@@ -17,9 +17,20 @@
 #ifndef CAR_LIB_NATIVE_INCLUDE_CARPOWERMANAGER_H_
 #define CAR_LIB_NATIVE_INCLUDE_CARPOWERMANAGER_H_
 
+#include <android/os/BnServiceCallback.h>
+#include <binder/IBinder.h>
 #include <binder/Status.h>
 #include <utils/RefBase.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
 #include "android/car/ICar.h"
 #include "android/car/hardware/power/BnCarPowerStateListener.h"
 #include "android/car/hardware/power/ICarPower.h"
@@ -32,6 +43,8 @@ namespace hardware {
 namespace power {
 
 
+// Connects to CarService in the background, as soon as servicemanager says it is there, and
+// again whenever it comes back after a restart, registering the listener each time.
 class CarPowerManager : public RefBase {
 public:
     // Enumeration of state change events
@@ -53,11 +66,11 @@ public:
 
     using Listener = std::function<void(State)>;
 
-    CarPowerManager() = default;
-    virtual ~CarPowerManager() {
-        // Clear the listener if one is set
-        clearListener();
-    }
+    static constexpr const char* kCarServiceName = "car_service";
+
+    // Only tests need to look for CarService under another name.
+    explicit CarPowerManager(const std::string& carServiceName = kCarServiceName);
+    virtual ~CarPowerManager();
 
     // Removes the listener and turns off callbacks
     //  Returns 0 on success
@@ -67,39 +80,83 @@ public:
     //  Returns 0 on success
     int requestShutdownOnNextSuspend();
 
-    // Set the callback function.  This will execute in the binder thread.
+    // Set the callback function.  This will execute on a thread of this manager, not a binder
+    // thread. The listener is registered once CarService is available, which need not be yet.
     //  Returns 0 on success
     int setListener(Listener listener);
 
 private:
+    // Forwards binder callbacks to the manager for as long as it exists.
+    class Link {
+    public:
+        explicit Link(CarPowerManager* parent) : mParent(parent) {}
+        void post(std::function<void(CarPowerManager*)> task);
+        void detach();
+
+    private:
+        std::mutex mMutex;
+        CarPowerManager* mParent;
+    };
+
     class CarPowerStateListener final : public BnCarPowerStateListener {
     public:
-        explicit CarPowerStateListener(CarPowerManager* parent) : mParent(parent) {}
-
-        Status onStateChanged(int state) override {
-            sp<CarPowerManager> parent = mParent;
-            if ((parent == nullptr) || (parent->mListener == nullptr)) {
-                ALOGE("CarPowerManagerNative: onStateChanged null pointer detected!");
-            } else if ((state < static_cast<int>(State::kFirst)) ||
-                       (state > static_cast<int>(State::kLast)) )  {
-                ALOGE("CarPowerManagerNative: onStateChanged unknown state: %d", state);
-            } else {
-                // Notify the listener of the state transition
-                parent->mListener(static_cast<State>(state));
-            }
-            return binder::Status::ok();
-        };
+        explicit CarPowerStateListener(std::shared_ptr<Link> link) : mLink(std::move(link)) {}
+        Status onStateChanged(int state) override;
+
+    private:
+        std::shared_ptr<Link> mLink;
+    };
+
+    class ServiceCallback final : public os::BnServiceCallback {
+    public:
+        explicit ServiceCallback(std::shared_ptr<Link> link) : mLink(std::move(link)) {}
+        Status onRegistration(const std::string& name, const sp<IBinder>& binder) override;
 
     private:
-        sp<CarPowerManager> mParent;
+        std::shared_ptr<Link> mLink;
     };
 
-    bool connectToCarService();
+    class DeathRecipient final : public IBinder::DeathRecipient {
+    public:
+        explicit DeathRecipient(std::shared_ptr<Link> link) : mLink(std::move(link)) {}
+        void binderDied(const wp<IBinder>& who) override;
 
+    private:
+        std::shared_ptr<Link> mLink;
+    };
+
+    // Everything below runs on the executor thread.
+    void connect(const sp<IBinder>& carBinder, std::chrono::steady_clock::time_point available);
+    void disconnect(const wp<IBinder>& carBinder);
+    void registerListener();
+    void notifyListener(int state);
+
+    // Runs |task| on the executor thread and waits for it, unless already on that thread.
+    void runOnExecutor(std::function<void()> task);
+    void post(std::function<void()> task);
+    void executorLoop();
+    bool startWatching();
+
+    const std::string mCarServiceName;
+    const std::shared_ptr<Link> mLink;
+    const sp<ServiceCallback> mServiceCallback;
+    const sp<DeathRecipient> mDeathRecipient;
+    const sp<CarPowerStateListener> mListenerToService;
+
+    // Guards the executor queue, and the connection for readers off the executor thread.
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::function<void()>> mTasks;
+    bool mStopping = false;
+    bool mWatching = false;
+    sp<IBinder> mCarBinder;
     sp<ICarPower> mICarPower;
-    bool mIsConnected;
+
+    // Only touched on the executor thread.
     Listener mListener;
-    sp<CarPowerStateListener> mListenerToService;
+    bool mIsRegistered = false;
+
+    std::thread mExecutor;
 };
 
 }  // namespace power
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CarPowerManager.h"
+
+#include <binder/IServiceManager.h>
+#include <binder/Parcel.h>
+#include <binder/ProcessState.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "android/car/hardware/power/BnCarPower.h"
+
+namespace android {
+namespace car {
+namespace hardware {
+namespace power {
+
+namespace {
+
+using std::chrono::steady_clock;
+
+constexpr auto kTimeout = std::chrono::seconds(5);
+// ICar.getCarService() is declared as transaction 11.
+constexpr uint32_t kGetCarServiceTransaction = IBinder::FIRST_CALL_TRANSACTION + 11;
+
+class FakeCarPower : public BnCarPower {
+public:
+    Status registerListener(const sp<ICarPowerStateListener>& listener) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mListener = listener;
+        mRegisteredTime = steady_clock::now();
+        mCondition.notify_all();
+        return Status::ok();
+    }
+    Status unregisterListener(const sp<ICarPowerStateListener>&) override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mListener = nullptr;
+        return Status::ok();
+    }
+    Status requestShutdownOnNextSuspend() override { return Status::ok(); }
+    Status finished(const sp<ICarPowerStateListener>&) override { return Status::ok(); }
+    Status scheduleNextWakeupTime(int32_t) override { return Status::ok(); }
+    Status registerListenerWithCompletion(const sp<ICarPowerStateListener>& listener) override {
+        return registerListener(listener);
+    }
+    Status getPowerState(int32_t* state) override {
+        *state = static_cast<int32_t>(CarPowerManager::State::kOn);
+        return Status::ok();
+    }
+
+    // Returns the registered listener, waiting for it up to kTimeout.
+    sp<ICarPowerStateListener> waitForListener(steady_clock::time_point* registeredTime) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait_for(lock, kTimeout, [this]() { return mListener != nullptr; });
+        *registeredTime = mRegisteredTime;
+        return mListener;
+    }
+
+    sp<ICarPowerStateListener> listener() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mListener;
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    sp<ICarPowerStateListener> mListener;
+    steady_clock::time_point mRegisteredTime;
+};
+
+// Answers getCarService() only, which is all CarPowerManager asks of ICar.
+class FakeCar : public BBinder {
+public:
+    explicit FakeCar(const sp<FakeCarPower>& power) : mPower(power) {}
+
+protected:
+    status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply,
+                        uint32_t flags) override {
+        if (code != kGetCarServiceTransaction) {
+            return BBinder::onTransact(code, data, reply, flags);
+        }
+        if (!data.enforceInterface(String16("android.car.ICar"))) {
+            return PERMISSION_DENIED;
+        }
+        reply->writeNoException();
+        reply->writeStrongBinder(data.readString16() == String16("power")
+                                 ? IInterface::asBinder(mPower) : nullptr);
+        return OK;
+    }
+
+private:
+    sp<FakeCarPower> mPower;
+};
+
+class CarPowerManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // servicemanager calls back on a binder thread.
+        ProcessState::self()->startThreadPool();
+        // A name of its own, so that the real CarService is left alone.
+        static int count = 0;
+        mServiceName = "car_service_test_" + std::to_string(getpid()) + "_" +
+                std::to_string(count++);
+        mPower = new FakeCarPower();
+        mCar = new FakeCar(mPower);
+    }
+
+    status_t addCarService() {
+        return defaultServiceManager()->addService(String16(mServiceName.c_str()), mCar);
+    }
+
+    std::string mServiceName;
+    sp<FakeCarPower> mPower;
+    sp<FakeCar> mCar;
+};
+
+double millisBetween(steady_clock::time_point start, steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+}  // namespace
+
+TEST_F(CarPowerManagerTest, RegistersListenerWhenCarServiceShowsUp) {
+    sp<CarPowerManager> manager = new CarPowerManager(mServiceName);
+    std::promise<std::thread::id> callbackThread;
+    ASSERT_EQ(0, manager->setListener([&callbackThread](CarPowerManager::State state) {
+        if (state == CarPowerManager::State::kOn) {
+            callbackThread.set_value(std::this_thread::get_id());
+        }
+    }));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(nullptr, mPower->listener());
+
+    auto available = steady_clock::now();
+    ASSERT_EQ(OK, addCarService());
+    steady_clock::time_point registered;
+    sp<ICarPowerStateListener> listener = mPower->waitForListener(&registered);
+    ASSERT_NE(nullptr, listener);
+    printf("listener registered %.2fms after the service was added\n",
+           millisBetween(available, registered));
+
+    // Delivered off the calling thread.
+    listener->onStateChanged(static_cast<int>(CarPowerManager::State::kOn));
+    auto future = callbackThread.get_future();
+    ASSERT_EQ(std::future_status::ready, future.wait_for(kTimeout));
+    EXPECT_NE(std::this_thread::get_id(), future.get());
+
+    EXPECT_EQ(0, manager->clearListener());
+    EXPECT_EQ(nullptr, mPower->listener());
+}
+
+TEST_F(CarPowerManagerTest, RegistersListenerWithCarServiceAlreadyUp) {
+    ASSERT_EQ(OK, addCarService());
+
+    sp<CarPowerManager> manager = new CarPowerManager(mServiceName);
+    auto start = steady_clock::now();
+    ASSERT_EQ(0, manager->setListener([](CarPowerManager::State) {}));
+    steady_clock::time_point registered;
+    ASSERT_NE(nullptr, mPower->waitForListener(&registered));
+    printf("listener registered %.2fms after setListener()\n", millisBetween(start, registered));
+}
+
+TEST_F(CarPowerManagerTest, ClearsListenerOnDestruction) {
+    ASSERT_EQ(OK, addCarService());
+    {
+        sp<CarPowerManager> manager = new CarPowerManager(mServiceName);
+        ASSERT_EQ(0, manager->setListener([](CarPowerManager::State) {}));
+        steady_clock::time_point registered;
+        ASSERT_NE(nullptr, mPower->waitForListener(&registered));
+    }
+    EXPECT_EQ(nullptr, mPower->listener());
+}
+
+}  // namespace power
+}  // namespace hardware
+}  // namespace car
+}  // namespace android
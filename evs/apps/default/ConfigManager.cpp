@@ -17,9 +17,14 @@
 
 #include "json/json.h"
 
-#include <fstream>
 #include <math.h>
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <type_traits>
 
 
 static const float kDegreesToRadians = M_PI / 180.0f;
@@ -31,6 +36,98 @@ static float normalizeToPlusMinus180degrees(float theta) {
 }
 
 
+// Binary cache of the parsed configuration.  Bump the version whenever the layout of the cache,
+// or the way the JSON file is interpreted, changes.
+static const char     kCacheMagic[4] = { 'E', 'V', 'S', 'C' };
+static const uint32_t kCacheVersion  = 1;
+
+
+static uint64_t hashContents(const std::string& contents) {
+    // 64 bit FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : contents) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+static bool readFile(const char* fileName, std::string* contents, struct stat* fileStat) {
+    FILE* file = fopen(fileName, "rbe");
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool success = fstat(fileno(file), fileStat) == 0;
+    if (success) {
+        contents->resize(fileStat->st_size);
+        success = fread(&(*contents)[0], 1, contents->size(), file) == contents->size();
+    }
+
+    fclose(file);
+    return success;
+}
+
+
+// Serializes plain values and strings into a byte buffer in host byte order; the cache never
+// leaves the device that wrote it.
+class CacheWriter {
+public:
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be cached");
+        mData.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void putString(const std::string& value) {
+        put(static_cast<uint32_t>(value.size()));
+        mData.append(value);
+    }
+
+    const std::string& data() const { return mData; }
+
+private:
+    std::string mData;
+};
+
+
+// Reads back what CacheWriter wrote.  Every read fails once the data runs out.
+class CacheReader {
+public:
+    explicit CacheReader(const std::string& data) :
+        mPos(data.data()),
+        mEnd(data.data() + data.size()) {}
+
+    template <typename T>
+    bool get(T* value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be cached");
+        if (static_cast<size_t>(mEnd - mPos) < sizeof(T)) {
+            return false;
+        }
+        memcpy(value, mPos, sizeof(T));
+        mPos += sizeof(T);
+        return true;
+    }
+
+    bool getString(std::string* value) {
+        uint32_t size = 0;
+        if (!get(&size) || static_cast<size_t>(mEnd - mPos) < size) {
+            return false;
+        }
+        value->assign(mPos, size);
+        mPos += size;
+        return true;
+    }
+
+    bool atEnd() const { return mPos == mEnd; }
+
+private:
+    const char* mPos;
+    const char* mEnd;
+};
+
+
 static bool readChildNodeAsFloat(const char* groupName,
                                  const Json::Value& parentNode,
                                  const char* childName,
@@ -49,17 +146,52 @@ static bool readChildNodeAsFloat(const char* groupName,
 }
 
 
-bool ConfigManager::initialize(const char* configFileName)
+bool ConfigManager::initialize(const char* configFileName, const char* cacheFileName)
 {
-    bool complete = true;
+    mLoadedFromCache = false;
+    mCameras.clear();
+    mDisplays.clear();
+
+    // The whole file is small, so we read it at once to validate the cache against its contents
+    std::string contents;
+    struct stat fileStat = {};
+    if (!readFile(configFileName, &contents, &fileStat)) {
+        printf("Failed to read configuration file %s\n", configFileName);
+        return false;
+    }
 
-    // Set up a stream to read in the input file
-    std::ifstream configStream(configFileName);
+    ConfigStamp stamp;
+    stamp.path    = configFileName;
+    stamp.mtimeNs = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000LL
+                  + fileStat.st_mtim.tv_nsec;
+    stamp.size    = contents.size();
+    stamp.hash    = hashContents(contents);
+
+    if (cacheFileName != nullptr && readCache(cacheFileName, stamp)) {
+        mLoadedFromCache = true;
+        return true;
+    }
+
+    if (!parseJson(configFileName, contents)) {
+        return false;
+    }
 
-    // Parse the stream into JSON objects
+    if (cacheFileName != nullptr) {
+        writeCache(cacheFileName, stamp);
+    }
+
+    return true;
+}
+
+
+bool ConfigManager::parseJson(const char* configFileName, const std::string& contents)
+{
+    bool complete = true;
+
+    // Parse the file contents into JSON objects
     Json::Reader reader;
     Json::Value rootNode;
-    bool parseOk = reader.parse(configStream, rootNode, false /* don't need comments */);
+    bool parseOk = reader.parse(contents, rootNode, false /* don't need comments */);
     if (!parseOk) {
         printf("Failed to read configuration file %s\n", configFileName);
         printf("%s\n", reader.getFormatedErrorMessages().c_str());
@@ -202,3 +334,135 @@ bool ConfigManager::initialize(const char* configFileName)
     // If we got this far, we were successful as long as we found all our child fields
     return complete;
 }
+
+
+bool ConfigManager::readCache(const char* cacheFileName, const ConfigStamp& stamp)
+{
+    std::string data;
+    struct stat cacheStat = {};
+    if (!readFile(cacheFileName, &data, &cacheStat)) {
+        // No cache yet
+        return false;
+    }
+
+    CacheReader reader(data);
+
+    // Reject caches written by another version of this code, or built from another version of
+    // the configuration file
+    char magic[sizeof(kCacheMagic)] = {};
+    uint32_t version = 0;
+    ConfigStamp cached;
+    if (!reader.get(&magic) || memcmp(magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+        !reader.get(&version) || version != kCacheVersion ||
+        !reader.getString(&cached.path) || cached.path != stamp.path ||
+        !reader.get(&cached.mtimeNs) || cached.mtimeNs != stamp.mtimeNs ||
+        !reader.get(&cached.size) || cached.size != stamp.size ||
+        !reader.get(&cached.hash) || cached.hash != stamp.hash) {
+        printf("Configuration cache %s is stale\n", cacheFileName);
+        return false;
+    }
+
+    bool ok = reader.get(&mCarWidth) &&
+              reader.get(&mWheelBase) &&
+              reader.get(&mFrontExtent) &&
+              reader.get(&mRearExtent) &&
+              reader.get(&mCarGraphicFrontPixel) &&
+              reader.get(&mCarGraphicRearPixel);
+
+    uint32_t count = 0;
+    ok = ok && reader.get(&count);
+    for (uint32_t i = 0; ok && i < count; ++i) {
+        DisplayInfo info;
+        ok = reader.get(&info.port) &&
+             reader.getString(&info.function) &&
+             reader.get(&info.frontRangeInCarSpace) &&
+             reader.get(&info.rearRangeInCarSpace);
+        if (ok) {
+            mDisplays.emplace_back(info);
+        }
+    }
+
+    ok = ok && reader.get(&count);
+    for (uint32_t i = 0; ok && i < count; ++i) {
+        CameraInfo info;
+        ok = reader.getString(&info.cameraId) &&
+             reader.getString(&info.function) &&
+             reader.get(&info.position) &&
+             reader.get(&info.yaw) &&
+             reader.get(&info.pitch) &&
+             reader.get(&info.roll) &&
+             reader.get(&info.hfov) &&
+             reader.get(&info.vfov) &&
+             reader.get(&info.hflip) &&
+             reader.get(&info.vflip);
+        if (ok) {
+            mCameras.emplace_back(info);
+        }
+    }
+
+    if (!ok || !reader.atEnd()) {
+        printf("Configuration cache %s is corrupted\n", cacheFileName);
+        mCameras.clear();
+        mDisplays.clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+void ConfigManager::writeCache(const char* cacheFileName, const ConfigStamp& stamp) const
+{
+    CacheWriter writer;
+    writer.put(kCacheMagic);
+    writer.put(kCacheVersion);
+    writer.putString(stamp.path);
+    writer.put(stamp.mtimeNs);
+    writer.put(stamp.size);
+    writer.put(stamp.hash);
+
+    writer.put(mCarWidth);
+    writer.put(mWheelBase);
+    writer.put(mFrontExtent);
+    writer.put(mRearExtent);
+    writer.put(mCarGraphicFrontPixel);
+    writer.put(mCarGraphicRearPixel);
+
+    writer.put(static_cast<uint32_t>(mDisplays.size()));
+    for (auto&& info : mDisplays) {
+        writer.put(info.port);
+        writer.putString(info.function);
+        writer.put(info.frontRangeInCarSpace);
+        writer.put(info.rearRangeInCarSpace);
+    }
+
+    writer.put(static_cast<uint32_t>(mCameras.size()));
+    for (auto&& info : mCameras) {
+        writer.putString(info.cameraId);
+        writer.putString(info.function);
+        writer.put(info.position);
+        writer.put(info.yaw);
+        writer.put(info.pitch);
+        writer.put(info.roll);
+        writer.put(info.hfov);
+        writer.put(info.vfov);
+        writer.put(info.hflip);
+        writer.put(info.vflip);
+    }
+
+    // Write to a temporary file first so a reader never sees a partial cache
+    const std::string tmpFileName = std::string(cacheFileName) + ".tmp";
+    FILE* file = fopen(tmpFileName.c_str(), "wbe");
+    if (file == nullptr) {
+        printf("Failed to create configuration cache %s\n", tmpFileName.c_str());
+        return;
+    }
+
+    const std::string& data = writer.data();
+    bool success = fwrite(data.data(), 1, data.size(), file) == data.size();
+    success &= fclose(file) == 0;
+    if (!success || rename(tmpFileName.c_str(), cacheFileName) != 0) {
+        printf("Failed to write configuration cache %s\n", cacheFileName);
+        unlink(tmpFileName.c_str());
+    }
+}
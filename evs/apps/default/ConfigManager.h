@@ -45,7 +45,13 @@ public:
         float rearRangeInCarSpace;  // How far the display extends behind the car
     };
 
-    bool initialize(const char* configFileName);
+    // Loads the configuration from the given JSON file.  If a cache file is given, the parsed
+    // configuration is read from there as long as it was built from the same version of the
+    // JSON file, and the cache is rebuilt otherwise.
+    bool initialize(const char* configFileName, const char* cacheFileName = nullptr);
+
+    // True if the last initialize() call was served from the binary cache
+    bool isLoadedFromCache() const { return mLoadedFromCache; }
 
     // World space dimensions of the car
     float getCarWidth() const   { return mCarWidth; };
@@ -118,6 +124,20 @@ public:
     int32_t getMockGearSignal() const { return mMockGearSignal; }
 
 private:
+    // Identifies the version of the JSON file a binary cache was built from
+    struct ConfigStamp {
+        std::string path;
+        int64_t     mtimeNs = 0;
+        uint64_t    size = 0;
+        uint64_t    hash = 0;
+    };
+
+    bool parseJson(const char* configFileName, const std::string& contents);
+    bool readCache(const char* cacheFileName, const ConfigStamp& stamp);
+    void writeCache(const char* cacheFileName, const ConfigStamp& stamp) const;
+
+    bool mLoadedFromCache = false;
+
     // Camera information
     std::vector<CameraInfo> mCameras;
 
@@ -19,12 +19,15 @@
 #include "RenderPixelCopy.h"
 #include "FormatConvert.h"
 
+#include <algorithm>
+
 #include <stdio.h>
 #include <string.h>
 
 #include <android-base/logging.h>
 #include <inttypes.h>
 #include <utils/SystemClock.h>
+#include <utils/Timers.h>
 #include <binder/IServiceManager.h>
 
 using ::android::hardware::automotive::evs::V1_0::EvsResult;
@@ -37,6 +40,13 @@ static bool isSfReady() {
     return android::defaultServiceManager()->checkService(serviceName) != nullptr;
 }
 
+// How long the render thread waits for a new camera frame before it goes back to check the
+// vehicle state and the command queue.
+static const std::chrono::milliseconds kFrameWaitTimeout(100);
+
+// Number of displayed frames between two frame pacing reports.
+static const uint64_t kFrameStatsInterval = 300;
+
 // TODO:  Seems like it'd be nice if the Vehicle HAL provided such helpers (but how & where?)
 inline constexpr VehiclePropertyType getPropType(VehicleProperty prop) {
     return static_cast<VehiclePropertyType>(
@@ -179,6 +189,13 @@ void EvsStateControl::updateLoop() {
 
         // If we have an active renderer, give it a chance to draw
         if (mCurrentRenderer) {
+            // Only draw when a camera delivered something new.  Otherwise, we would redraw the
+            // same imagery at the display's cadence, burning GPU and CPU time for nothing.
+            if (!mCurrentRenderer->waitForNewFrame(kFrameWaitTimeout)) {
+                mFrameStats.framesSkipped++;
+                continue;
+            }
+
             // Get the output buffer we'll use to display the imagery
             BufferDesc_1_0 tgtBuffer = {};
             mDisplay->getTargetBuffer([&tgtBuffer](const BufferDesc_1_0& buff) {
@@ -197,6 +214,7 @@ void EvsStateControl::updateLoop() {
 
                 // Send the finished image back for display
                 mDisplay->returnTargetBufferForDisplay(tgtBuffer);
+                recordDisplayedFrame(mCurrentRenderer->getLatchedFrameTimestamp());
             }
         } else if (run) {
             // No active renderer, so sleep until somebody wakes us with another command
@@ -218,6 +236,30 @@ void EvsStateControl::updateLoop() {
 }
 
 
+void EvsStateControl::recordDisplayedFrame(int64_t captureTimestampUs) {
+    mFrameStats.framesDisplayed++;
+    if (captureTimestampUs > 0) {
+        // V4L2 stamps the captured frames with CLOCK_MONOTONIC
+        const int64_t latencyUs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000 - captureTimestampUs;
+        mFrameStats.latencyCount++;
+        mFrameStats.totalLatencyUs += latencyUs;
+        mFrameStats.maxLatencyUs = std::max(mFrameStats.maxLatencyUs, latencyUs);
+    }
+
+    if (mFrameStats.framesDisplayed < kFrameStatsInterval) {
+        return;
+    }
+
+    const int64_t avgLatencyUs = mFrameStats.latencyCount > 0 ?
+            mFrameStats.totalLatencyUs / static_cast<int64_t>(mFrameStats.latencyCount) : 0;
+    LOG(INFO) << "Displayed " << mFrameStats.framesDisplayed << " frames, "
+              << mFrameStats.framesSkipped << " waits timed out; "
+              << "capture to display latency avg " << avgLatencyUs << " us, "
+              << "max " << mFrameStats.maxLatencyUs << " us";
+    mFrameStats = {};
+}
+
+
 bool EvsStateControl::selectStateForCurrentConditions() {
     static int32_t sDummyGear   = mConfig.getMockGearSignal();
     static int32_t sDummySignal = int32_t(VehicleTurnSignal::NONE);
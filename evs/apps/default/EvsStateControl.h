@@ -88,6 +88,9 @@ private:
     bool selectStateForCurrentConditions();
     bool configureEvsPipeline(State desiredState);  // Only call from one thread!
 
+    // Records the latency of a displayed frame and periodically reports the stats
+    void recordDisplayedFrame(int64_t captureTimestampUs);
+
     sp<IVehicle>                mVehicle;
     sp<IEvsEnumerator>          mEvs;
     sp<IEvsDisplay>             mDisplay;
@@ -108,6 +111,15 @@ private:
 
     std::thread                 mRenderThread;  // The thread that runs the main rendering loop
 
+    // Frame pacing stats, reset whenever they are reported.  Only touched by the render thread.
+    struct {
+        uint64_t    framesDisplayed = 0;
+        uint64_t    framesSkipped = 0;      // No new camera frame within kFrameWaitTimeout
+        uint64_t    latencyCount = 0;       // Displayed frames with a valid capture timestamp
+        int64_t     totalLatencyUs = 0;
+        int64_t     maxLatencyUs = 0;
+    } mFrameStats;
+
     // Other threads may want to spur us into action, so we provide a thread safe way to do that
     std::mutex                  mLock;
     std::condition_variable     mWakeSignal;
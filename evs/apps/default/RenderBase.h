@@ -26,6 +26,8 @@
 
 #include <android/hardware/automotive/evs/1.1/IEvsEnumerator.h>
 
+#include <chrono>
+
 using namespace ::android::hardware::automotive::evs::V1_1;
 using ::android::sp;
 
@@ -43,6 +45,15 @@ public:
 
     virtual bool drawFrame(const BufferDesc& tgtBuffer) = 0;
 
+    // Blocks until there is a camera frame that has not been drawn yet, or the timeout
+    // expires.  Returns false if nothing changed, so drawing can be skipped.  Each call to
+    // drawFrame() latches at most one new frame per camera.
+    virtual bool waitForNewFrame(std::chrono::nanoseconds /*timeout*/) { return true; }
+
+    // Capture time, in microseconds of CLOCK_MONOTONIC, of the oldest camera frame used by
+    // the last drawFrame() call; 0 if unknown.
+    virtual int64_t getLatchedFrameTimestamp() const { return 0; }
+
 protected:
     static bool prepareGL();
 
@@ -152,6 +152,21 @@ void RenderDirectView::deactivate() {
 }
 
 
+bool RenderDirectView::waitForNewFrame(std::chrono::nanoseconds timeout) {
+    if (!mTexture) {
+        // Nothing to wait for; keep drawing what we have
+        return true;
+    }
+
+    return mTexture->waitForNewFrame(timeout);
+}
+
+
+int64_t RenderDirectView::getLatchedFrameTimestamp() const {
+    return mTexture ? mTexture->getFrameTimestamp() : 0;
+}
+
+
 bool RenderDirectView::drawFrame(const BufferDesc& tgtBuffer) {
     // Tell GL to render to the given buffer
     if (!attachRenderTarget(tgtBuffer)) {
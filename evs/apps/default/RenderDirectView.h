@@ -42,6 +42,9 @@ public:
 
     virtual bool drawFrame(const BufferDesc& tgtBuffer);
 
+    virtual bool waitForNewFrame(std::chrono::nanoseconds timeout) override;
+    virtual int64_t getLatchedFrameTimestamp() const override;
+
 protected:
     sp<IEvsEnumerator>              mEnumerator;
     ConfigManager::CameraInfo       mCameraInfo;
@@ -15,9 +15,14 @@
  */
 
 #include "RenderPixelCopy.h"
-#include "FormatConvert.h"
 
 #include <android-base/logging.h>
+#include <formatconvert/FormatConvert.h>
+
+using ::android::automotive::evs::formatconvert::copyMatchedInterleavedFormats;
+using ::android::automotive::evs::formatconvert::copyNV21toRGB32;
+using ::android::automotive::evs::formatconvert::copyYUYVtoRGB32;
+using ::android::automotive::evs::formatconvert::copyYV12toRGB32;
 
 
 RenderPixelCopy::RenderPixelCopy(sp<IEvsEnumerator> enumerator,
@@ -62,6 +67,11 @@ void RenderPixelCopy::deactivate() {
 }
 
 
+bool RenderPixelCopy::waitForNewFrame(std::chrono::nanoseconds timeout) {
+    return mStreamHandler->waitForNewFrame(timeout);
+}
+
+
 bool RenderPixelCopy::drawFrame(const BufferDesc& tgtBuffer) {
     bool success = true;
     const AHardwareBuffer_Desc* pTgtDesc =
@@ -89,6 +99,7 @@ bool RenderPixelCopy::drawFrame(const BufferDesc& tgtBuffer) {
             // Make sure we have the latest frame data
             if (mStreamHandler->newFrameAvailable()) {
                 const BufferDesc& srcBuffer = mStreamHandler->getNewFrame();
+                mLatchedFrameTimestamp = srcBuffer.timestamp;
                 const AHardwareBuffer_Desc* pSrcDesc =
                     reinterpret_cast<const AHardwareBuffer_Desc *>(&srcBuffer.buffer.description);
 
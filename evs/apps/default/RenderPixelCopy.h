@@ -40,11 +40,18 @@ public:
 
     virtual bool drawFrame(const BufferDesc& tgtBuffer);
 
+    virtual bool waitForNewFrame(std::chrono::nanoseconds timeout) override;
+    virtual int64_t getLatchedFrameTimestamp() const override {
+        return mLatchedFrameTimestamp;
+    }
+
 protected:
     sp<IEvsEnumerator>              mEnumerator;
     ConfigManager::CameraInfo       mCameraInfo;
 
     sp<StreamHandler>               mStreamHandler;
+
+    int64_t                         mLatchedFrameTimestamp = 0;
 };
 
 
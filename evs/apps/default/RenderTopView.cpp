@@ -179,6 +179,56 @@ void RenderTopView::deactivate() {
 }
 
 
+bool RenderTopView::waitForNewFrame(std::chrono::nanoseconds timeout) {
+    // Every camera has its own stream, so we take turns waiting on each of them for a
+    // short while, and redraw as soon as any of them has something new.
+    static const std::chrono::milliseconds kWaitSlice(4);
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    bool hasCamera = false;
+    do {
+        for (auto&& cam: mActiveCameras) {
+            if (!cam.tex) {
+                continue;
+            }
+
+            hasCamera = true;
+            if (cam.tex->waitForNewFrame(std::chrono::nanoseconds::zero())) {
+                return true;
+            }
+        }
+
+        if (!hasCamera) {
+            // Nothing to wait for; keep drawing what we have
+            return true;
+        }
+
+        for (auto&& cam: mActiveCameras) {
+            if (cam.tex && cam.tex->waitForNewFrame(kWaitSlice)) {
+                return true;
+            }
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+
+    return false;
+}
+
+
+int64_t RenderTopView::getLatchedFrameTimestamp() const {
+    int64_t oldest = 0;
+    for (auto&& cam: mActiveCameras) {
+        if (cam.tex) {
+            const int64_t timestamp = cam.tex->getFrameTimestamp();
+            if (timestamp > 0 && (oldest == 0 || timestamp < oldest)) {
+                oldest = timestamp;
+            }
+        }
+    }
+
+    return oldest;
+}
+
+
 bool RenderTopView::drawFrame(const BufferDesc& tgtBuffer) {
     // Tell GL to render to the given buffer
     if (!attachRenderTarget(tgtBuffer)) {
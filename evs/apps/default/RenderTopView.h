@@ -44,6 +44,9 @@ public:
 
     virtual bool drawFrame(const BufferDesc& tgtBuffer);
 
+    virtual bool waitForNewFrame(std::chrono::nanoseconds timeout) override;
+    virtual int64_t getLatchedFrameTimestamp() const override;
+
 protected:
     struct ActiveCamera {
         const ConfigManager::CameraInfo&    info;
@@ -160,6 +160,19 @@ bool StreamHandler::newFrameAvailable() {
 }
 
 
+bool StreamHandler::waitForNewFrame(std::chrono::nanoseconds timeout) {
+    std::unique_lock<std::mutex> lock(mLock);
+    if (mRunning) {
+        mSignal.wait_for(lock, timeout, [this]() { return mReadyBuffer >= 0 || !mRunning; });
+    } else {
+        // A stopped stream won't deliver anything.  Sit out the whole timeout so the caller
+        // doesn't spin while polling; a restarted stream still wakes us with its first frame.
+        mSignal.wait_for(lock, timeout, [this]() { return mReadyBuffer >= 0; });
+    }
+    return (mReadyBuffer >= 0);
+}
+
+
 const BufferDesc_1_1& StreamHandler::getNewFrame() {
     std::unique_lock<std::mutex> lock(mLock);
 
@@ -267,6 +280,7 @@ Return<void> StreamHandler::notify(const EvsEventDesc& event) {
                 // Signal that the last frame has been received and the stream is stopped
                 mRunning = false;
             }
+            mSignal.notify_all();
             LOG(INFO) << "Received a STREAM_STOPPED event";
             break;
         }
@@ -17,6 +17,7 @@
 #ifndef EVS_VTS_STREAMHANDLER_H
 #define EVS_VTS_STREAMHANDLER_H
 
+#include <chrono>
 #include <queue>
 
 #include "ui/GraphicBuffer.h"
@@ -63,6 +64,12 @@ public:
     bool isRunning();
 
     bool newFrameAvailable();
+
+    // Blocks until a new frame is available, the stream stops, or the timeout
+    // expires.  When the stream is already stopped, waits for the whole timeout
+    // unless a frame arrives.  Returns true if a new frame is available.
+    bool waitForNewFrame(std::chrono::nanoseconds timeout);
+
     const BufferDesc_1_1& getNewFrame();
     void doneWithFrame(const BufferDesc_1_1& buffer);
 
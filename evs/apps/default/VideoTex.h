@@ -48,6 +48,18 @@ public:
 
     bool refresh();     // returns true if the texture contents were updated
 
+    // Blocks until the camera delivered a frame refresh() has not latched yet,
+    // or the timeout expires.
+    bool waitForNewFrame(std::chrono::nanoseconds timeout) {
+        return mStreamHandler->waitForNewFrame(timeout);
+    }
+
+    // Capture time of the latched frame in microseconds, or 0 if unknown
+    int64_t getFrameTimestamp() const {
+        return mImageBuffer.buffer.nativeHandle.getNativeHandle() != nullptr ?
+               mImageBuffer.timestamp : 0;
+    }
+
 private:
     VideoTex(sp<IEvsEnumerator> pEnum,
              sp<IEvsCamera> pCamera,
@@ -31,6 +31,7 @@
 #include <hwbinder/ProcessState.h>
 #include <utils/Errors.h>
 #include <utils/StrongPointer.h>
+#include <utils/SystemClock.h>
 #include <utils/Log.h>
 
 
@@ -44,6 +45,7 @@ namespace {
 
 const char* CONFIG_DEFAULT_PATH = "/system/etc/automotive/evs/config.json";
 const char* CONFIG_OVERRIDE_PATH = "/system/etc/automotive/evs/config_override.json";
+const char* CONFIG_CACHE_PATH = "/data/misc/evs_app/config.cache";
 
 android::sp<IEvsEnumerator> pEvs;
 android::sp<IEvsDisplay> pDisplay;
@@ -203,13 +205,17 @@ int main(int argc, char** argv)
     }
 
     // Load our configuration information
+    const int64_t configStartTime = android::elapsedRealtimeNano();
     ConfigManager config;
-    if (!config.initialize(CONFIG_OVERRIDE_PATH)) {
-        if (!config.initialize(CONFIG_DEFAULT_PATH)) {
+    if (!config.initialize(CONFIG_OVERRIDE_PATH, CONFIG_CACHE_PATH)) {
+        if (!config.initialize(CONFIG_DEFAULT_PATH, CONFIG_CACHE_PATH)) {
             LOG(ERROR) << "Missing or improper configuration for the EVS application.  Exiting.";
             return EXIT_FAILURE;
         }
     }
+    LOG(INFO) << "Configuration loaded in "
+              << (android::elapsedRealtimeNano() - configStartTime) / 1000 << " us"
+              << (config.isLoadedFromCache() ? " from the cache" : "");
 
     // Set thread pool size to one to avoid concurrent events from the HAL.
     // This pool will handle the EvsCameraStream callbacks.
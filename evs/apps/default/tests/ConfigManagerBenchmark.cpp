@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ConfigManager.h"
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace {
+
+using android::base::WriteStringToFile;
+
+constexpr char kConfig[] = R"({
+  "car" : { "width" : 76.7, "wheelBase" : 117.9, "frontExtent" : 44.7, "rearExtent" : 40 },
+  "displays" : [
+    { "displayPort" : 136, "function" : "main", "frontRange" : 100, "rearRange" : 100 }
+  ],
+  "graphic" : { "frontPixel" : -20, "rearPixel" : 260 },
+  "cameras" : [
+    {
+      "cameraId" : "/dev/video10", "function" : "reverse,park",
+      "x" : 0.0, "y" : 20.0, "z" : 48,
+      "yaw" : 180, "pitch" : -10, "roll" : 0, "hfov" : 115, "vfov" : 80,
+      "hflip" : true, "vflip" : false
+    },
+    {
+      "cameraId" : "/dev/video11", "function" : "front,park",
+      "x" : 0.0, "y" : 100.0, "z" : 48,
+      "yaw" : 0, "pitch" : 120, "roll" : 200, "hfov" : 190, "vfov" : 0.5,
+      "hflip" : false, "vflip" : true
+    }
+  ]
+})";
+
+// Loads the config from the JSON file, or from the binary cache when |useCache| is set.
+void loadConfig(benchmark::State& state, bool useCache) {
+    TemporaryDir dir;
+    const std::string configPath = std::string(dir.path) + "/config.json";
+    const std::string cachePath = std::string(dir.path) + "/config.cache";
+    if (!WriteStringToFile(kConfig, configPath)) {
+        state.SkipWithError("Failed to write the config file");
+        return;
+    }
+
+    // Build the cache before timing
+    ConfigManager first;
+    if (!first.initialize(configPath.c_str(), cachePath.c_str())) {
+        state.SkipWithError("Failed to load the config");
+        return;
+    }
+
+    const char* cacheFileName = useCache ? cachePath.c_str() : nullptr;
+    for (auto _ : state) {
+        ConfigManager config;
+        if (!config.initialize(configPath.c_str(), cacheFileName) ||
+            config.isLoadedFromCache() != useCache) {
+            state.SkipWithError("Failed to load the config from the expected source");
+            return;
+        }
+    }
+}
+
+void BM_LoadFromJson(benchmark::State& state) {
+    loadConfig(state, /*useCache=*/false);
+}
+
+void BM_LoadFromCache(benchmark::State& state) {
+    loadConfig(state, /*useCache=*/true);
+}
+
+}  // namespace
+
+BENCHMARK(BM_LoadFromJson);
+BENCHMARK(BM_LoadFromCache);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ConfigManager.h"
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+using android::base::ReadFileToString;
+using android::base::WriteStringToFile;
+
+constexpr char kConfig[] = R"({
+  "car" : { "width" : 76.7, "wheelBase" : 117.9, "frontExtent" : 44.7, "rearExtent" : 40 },
+  "displays" : [
+    { "displayPort" : 136, "function" : "main", "frontRange" : 100, "rearRange" : 100 },
+    { "displayPort" : 130, "frontRange" : 50, "rearRange" : 75.5 }
+  ],
+  "graphic" : { "frontPixel" : -20, "rearPixel" : 260 },
+  "cameras" : [
+    {
+      "cameraId" : "/dev/video10", "function" : "reverse,park",
+      "x" : 0.0, "y" : 20.0, "z" : 48,
+      "yaw" : 180, "pitch" : -10, "roll" : 0, "hfov" : 115, "vfov" : 80,
+      "hflip" : true, "vflip" : false
+    },
+    {
+      "cameraId" : "/dev/video11", "function" : "front,park",
+      "x" : 0.0, "y" : 100.0, "z" : 48,
+      "yaw" : 0, "pitch" : 120, "roll" : 200, "hfov" : 190, "vfov" : 0.5,
+      "hflip" : false, "vflip" : true
+    }
+  ]
+})";
+
+void expectSameConfig(const ConfigManager& expected, const ConfigManager& actual) {
+    EXPECT_EQ(expected.getCarWidth(), actual.getCarWidth());
+    EXPECT_EQ(expected.getCarLength(), actual.getCarLength());
+    EXPECT_EQ(expected.getWheelBase(), actual.getWheelBase());
+    EXPECT_EQ(expected.getFrontLocation(), actual.getFrontLocation());
+    EXPECT_EQ(expected.getRearLocation(), actual.getRearLocation());
+    EXPECT_EQ(expected.carGraphicFrontPixel(), actual.carGraphicFrontPixel());
+    EXPECT_EQ(expected.carGraphicRearPixel(), actual.carGraphicRearPixel());
+
+    ASSERT_EQ(expected.getDisplays().size(), actual.getDisplays().size());
+    for (size_t i = 0; i < expected.getDisplays().size(); ++i) {
+        const auto& e = expected.getDisplays()[i];
+        const auto& a = actual.getDisplays()[i];
+        EXPECT_EQ(e.port, a.port) << "display " << i;
+        EXPECT_EQ(e.function, a.function) << "display " << i;
+        EXPECT_EQ(e.frontRangeInCarSpace, a.frontRangeInCarSpace) << "display " << i;
+        EXPECT_EQ(e.rearRangeInCarSpace, a.rearRangeInCarSpace) << "display " << i;
+    }
+
+    ASSERT_EQ(expected.getCameras().size(), actual.getCameras().size());
+    for (size_t i = 0; i < expected.getCameras().size(); ++i) {
+        const auto& e = expected.getCameras()[i];
+        const auto& a = actual.getCameras()[i];
+        EXPECT_EQ(e.cameraId, a.cameraId) << "camera " << i;
+        EXPECT_EQ(e.function, a.function) << "camera " << i;
+        for (int j = 0; j < 3; ++j) {
+            EXPECT_EQ(e.position[j], a.position[j]) << "camera " << i;
+        }
+        EXPECT_EQ(e.yaw, a.yaw) << "camera " << i;
+        EXPECT_EQ(e.pitch, a.pitch) << "camera " << i;
+        EXPECT_EQ(e.roll, a.roll) << "camera " << i;
+        EXPECT_EQ(e.hfov, a.hfov) << "camera " << i;
+        EXPECT_EQ(e.vfov, a.vfov) << "camera " << i;
+        EXPECT_EQ(e.hflip, a.hflip) << "camera " << i;
+        EXPECT_EQ(e.vflip, a.vflip) << "camera " << i;
+    }
+}
+
+class ConfigManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mConfigPath = std::string(mDir.path) + "/config.json";
+        mCachePath = std::string(mDir.path) + "/config.cache";
+        ASSERT_TRUE(WriteStringToFile(kConfig, mConfigPath));
+    }
+
+    TemporaryDir mDir;
+    std::string mConfigPath;
+    std::string mCachePath;
+};
+
+}  // namespace
+
+TEST_F(ConfigManagerTest, TestCacheMatchesJson) {
+    ConfigManager fromJson;
+    ASSERT_TRUE(fromJson.initialize(mConfigPath.c_str()));
+    EXPECT_FALSE(fromJson.isLoadedFromCache());
+
+    // The first load with a cache file parses the JSON file and builds the cache
+    ConfigManager first;
+    ASSERT_TRUE(first.initialize(mConfigPath.c_str(), mCachePath.c_str()));
+    EXPECT_FALSE(first.isLoadedFromCache());
+    expectSameConfig(fromJson, first);
+
+    ConfigManager cached;
+    ASSERT_TRUE(cached.initialize(mConfigPath.c_str(), mCachePath.c_str()));
+    EXPECT_TRUE(cached.isLoadedFromCache());
+    expectSameConfig(fromJson, cached);
+}
+
+TEST_F(ConfigManagerTest, TestChangedJsonInvalidatesCache) {
+    ConfigManager first;
+    ASSERT_TRUE(first.initialize(mConfigPath.c_str(), mCachePath.c_str()));
+
+    // Same size, different contents
+    std::string changed = kConfig;
+    changed.replace(changed.find("76.7"), 4, "80.1");
+    ASSERT_TRUE(WriteStringToFile(changed, mConfigPath));
+
+    ConfigManager reloaded;
+    ASSERT_TRUE(reloaded.initialize(mConfigPath.c_str(), mCachePath.c_str()));
+    EXPECT_FALSE(reloaded.isLoadedFromCache());
+    EXPECT_FLOAT_EQ(reloaded.getCarWidth(), 80.1f);
+
+    ConfigManager cached;
+    ASSERT_TRUE(cached.initialize(mConfigPath.c_str(), mCachePath.c_str()));
+    EXPECT_TRUE(cached.isLoadedFromCache());
+    expectSameConfig(reloaded, cached);
+}
+
+TEST_F(ConfigManagerTest, TestCorruptedCacheFallsBackToJson) {
+    ConfigManager fromJson;
+    ASSERT_TRUE(fromJson.initialize(mConfigPath.c_str(), mCachePath.c_str()));
+
+    std::string cache;
+    ASSERT_TRUE(ReadFileToString(mCachePath, &cache));
+    for (size_t size : {cache.size() - 1, static_cast<size_t>(10), static_cast<size_t>(0)}) {
+        ASSERT_TRUE(WriteStringToFile(cache.substr(0, size), mCachePath));
+
+        ConfigManager config;
+        ASSERT_TRUE(config.initialize(mConfigPath.c_str(), mCachePath.c_str()))
+                << "cache truncated to " << size;
+        EXPECT_FALSE(config.isLoadedFromCache()) << "cache truncated to " << size;
+        expectSameConfig(fromJson, config);
+    }
+}
+
+TEST_F(ConfigManagerTest, TestMissingConfigIgnoresCache) {
+    ConfigManager first;
+    ASSERT_TRUE(first.initialize(mConfigPath.c_str(), mCachePath.c_str()));
+    ASSERT_EQ(unlink(mConfigPath.c_str()), 0);
+
+    ConfigManager config;
+    EXPECT_FALSE(config.initialize(mConfigPath.c_str(), mCachePath.c_str()));
+}
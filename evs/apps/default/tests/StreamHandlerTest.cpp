@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StreamHandler.h"
+
+#include <cutils/native_handle.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+using ::android::hardware::hidl_string;
+using ::android::hardware::automotive::evs::V1_0::EvsResult;
+using IEvsCameraStream_1_0 = ::android::hardware::automotive::evs::V1_0::IEvsCameraStream;
+using IEvsDisplay_1_0 = ::android::hardware::automotive::evs::V1_0::IEvsDisplay;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+constexpr milliseconds kWaitTimeout(100);
+
+// Camera that only accepts the stream and the returned buffers.  The tests deliver the frames
+// and the stream events themselves.
+class FakeEvsCamera : public IEvsCamera {
+public:
+    // v1.0 methods
+    Return<void> getCameraInfo(getCameraInfo_cb) override { return {}; }
+    Return<EvsResult> setMaxFramesInFlight(uint32_t) override { return EvsResult::OK; }
+    Return<EvsResult> startVideoStream(const sp<IEvsCameraStream_1_0>&) override {
+        return EvsResult::OK;
+    }
+    Return<void> doneWithFrame(const BufferDesc_1_0&) override { return {}; }
+    Return<void> stopVideoStream() override { return {}; }
+    Return<int32_t> getExtendedInfo(uint32_t) override { return 0; }
+    Return<EvsResult> setExtendedInfo(uint32_t, int32_t) override { return EvsResult::OK; }
+
+    // v1.1 methods
+    Return<void> getCameraInfo_1_1(getCameraInfo_1_1_cb) override { return {}; }
+    Return<void> getPhysicalCameraInfo(const hidl_string&, getPhysicalCameraInfo_cb) override {
+        return {};
+    }
+    Return<EvsResult> pauseVideoStream() override { return EvsResult::OK; }
+    Return<EvsResult> resumeVideoStream() override { return EvsResult::OK; }
+    Return<EvsResult> doneWithFrame_1_1(const hidl_vec<BufferDesc_1_1>&) override {
+        return EvsResult::OK;
+    }
+    Return<EvsResult> setMaster() override { return EvsResult::OK; }
+    Return<EvsResult> forceMaster(const sp<IEvsDisplay_1_0>&) override { return EvsResult::OK; }
+    Return<EvsResult> unsetMaster() override { return EvsResult::OK; }
+    Return<void> getParameterList(getParameterList_cb) override { return {}; }
+    Return<void> getIntParameterRange(CameraParam, getIntParameterRange_cb) override {
+        return {};
+    }
+    Return<void> setIntParameter(CameraParam, int32_t, setIntParameter_cb) override { return {}; }
+    Return<void> getIntParameter(CameraParam, getIntParameter_cb) override { return {}; }
+    Return<void> getExtendedInfo_1_1(uint32_t, getExtendedInfo_1_1_cb) override { return {}; }
+    Return<EvsResult> setExtendedInfo_1_1(uint32_t, const hidl_vec<uint8_t>&) override {
+        return EvsResult::OK;
+    }
+    Return<void> importExternalBuffers(const hidl_vec<BufferDesc_1_1>&,
+                                       importExternalBuffers_cb) override {
+        return {};
+    }
+};
+
+void stopStream(const sp<IEvsCameraStream>& stream) {
+    EvsEventDesc event;
+    event.aType = EvsEventType::STREAM_STOPPED;
+    stream->notify(event);
+}
+
+milliseconds timeWaitForNewFrame(const sp<StreamHandler>& handler, bool* gotFrame) {
+    const auto start = steady_clock::now();
+    *gotFrame = handler->waitForNewFrame(kWaitTimeout);
+    return std::chrono::duration_cast<milliseconds>(steady_clock::now() - start);
+}
+
+}  // namespace
+
+TEST(StreamHandlerTest, TestWaitsForTimeoutWhenStreamIsStopped) {
+    sp<StreamHandler> handler = new StreamHandler(new FakeEvsCamera());
+    bool gotFrame = true;
+
+    // Never started.  Without the full wait, a polling caller spins at 100% CPU.
+    EXPECT_GE(timeWaitForNewFrame(handler, &gotFrame), kWaitTimeout);
+    EXPECT_FALSE(gotFrame);
+
+    ASSERT_TRUE(handler->startStream());
+    stopStream(handler);
+    EXPECT_GE(timeWaitForNewFrame(handler, &gotFrame), kWaitTimeout);
+    EXPECT_FALSE(gotFrame);
+}
+
+TEST(StreamHandlerTest, TestWaitReturnsWhenStreamStops) {
+    sp<StreamHandler> handler = new StreamHandler(new FakeEvsCamera());
+    ASSERT_TRUE(handler->startStream());
+
+    std::thread stopper([handler]() {
+        std::this_thread::sleep_for(milliseconds(10));
+        stopStream(handler);
+    });
+    bool gotFrame = true;
+    const auto elapsed = timeWaitForNewFrame(handler, &gotFrame);
+    stopper.join();
+
+    EXPECT_LT(elapsed, kWaitTimeout);
+    EXPECT_FALSE(gotFrame);
+}
+
+TEST(StreamHandlerTest, TestWaitReturnsOnNewFrame) {
+    sp<StreamHandler> handler = new StreamHandler(new FakeEvsCamera());
+    ASSERT_TRUE(handler->startStream());
+
+    native_handle_t* nativeHandle = native_handle_create(/*numFds=*/0, /*numInts=*/0);
+    hidl_vec<BufferDesc_1_1> frames;
+    frames.resize(1);
+    frames[0].buffer.nativeHandle = nativeHandle;
+    frames[0].bufferId = 1;
+    sp<IEvsCameraStream> stream = handler;
+    stream->deliverFrame_1_1(frames);
+
+    bool gotFrame = false;
+    EXPECT_LT(timeWaitForNewFrame(handler, &gotFrame), kWaitTimeout);
+    EXPECT_TRUE(gotFrame);
+
+    handler->doneWithFrame(handler->getNewFrame());
+    stopStream(handler);
+    native_handle_delete(nativeHandle);
+}
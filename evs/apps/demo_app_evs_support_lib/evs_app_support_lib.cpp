@@ -68,6 +68,11 @@ class SimpleAnalyzeCallback : public BaseAnalyzeCallback {
         ALOGD("SimpleAnalyzerCallback: sleep for one second");
         std::this_thread::sleep_for(std::chrono::seconds(1));
     };
+
+    // The frame is only looked at, so it does not need a private copy.
+    bool isReadOnly() const override {
+        return true;
+    }
 };
 
 // Main entry point
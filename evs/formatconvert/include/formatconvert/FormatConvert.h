@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2017 The Android Open Source Project
+ * Copyright (C) 2020 The Android Open Source Project
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -14,16 +14,40 @@
  * limitations under the License.
  */
 
-#ifndef EVS_VTS_FORMATCONVERT_H
-#define EVS_VTS_FORMATCONVERT_H
+#ifndef EVS_FORMATCONVERT_FORMATCONVERT_H
+#define EVS_FORMATCONVERT_FORMATCONVERT_H
 
-#include <queue>
 #include <stdint.h>
 
 namespace android {
 namespace automotive {
 namespace evs {
-namespace support {
+namespace formatconvert {
+
+// Pixel conversion back-ends.  AUTO picks the fastest one the running CPU supports.
+enum class Implementation {
+    AUTO,
+    SCALAR,
+    NEON,
+    SSE2,
+};
+
+// Selects the conversion back-end used by the copy functions below.  Returns false, and keeps the
+// current selection, if the requested back-end is not available on this device.
+bool setImplementation(Implementation impl);
+
+// Returns the back-end currently in use; never returns AUTO.
+Implementation getImplementation();
+
+// Returns true if the given back-end was compiled in and is supported by the running CPU.
+bool isImplementationSupported(Implementation impl);
+
+// Splits each conversion into horizontal bands of rows converted concurrently by up to the given
+// number of threads, including the calling one.  The default, 1, converts on the caller's thread
+// only.  Small images are always converted on the caller's thread.
+void setNumThreads(unsigned numThreads);
+unsigned getNumThreads();
+
 
 // Given an image buffer in NV21 format (HAL_PIXEL_FORMAT_YCRCB_420_SP), output 32bit RGBx values.
 // The NV21 format provides a Y array of 8bit values, followed by a 1/2 x 1/2 interleaved
@@ -45,12 +69,11 @@ void copyYV12toRGB32(unsigned width, unsigned height,
 
 
 // Given an image buffer in YUYV format (HAL_PIXEL_FORMAT_YCBCR_422_I), output 32bit RGBx values.
-// The NV21 format provides a Y array of 8bit values, followed by a 1/2 x 1/2 interleaved
-// U/V array.  It assumes an even width and height for the overall image, and a horizontal
-// stride that is an even multiple of 16 bytes for both the Y and UV arrays.
+// The YUYV format provides a single interleaved Y0/U/Y1/V array, with one U/V pair shared by
+// each horizontal pair of pixels.  Both strides are in units of pixels.
 void copyYUYVtoRGB32(unsigned width, unsigned height,
-                     uint8_t* src, unsigned srcStrideBytes,
-                     uint32_t* dst, unsigned dstStrideBytes);
+                     uint8_t* src, unsigned srcStridePixels,
+                     uint32_t* dst, unsigned dstStridePixels);
 
 
 // Given an simple rectangular image buffer with an integer number of bytes per pixel,
@@ -61,9 +84,28 @@ void copyMatchedInterleavedFormats(unsigned width, unsigned height,
                                    void* dst, unsigned dstStridePixels,
                                    unsigned pixelSize);
 
-}  // namespace support
+
+// Single-threaded scalar reference versions of the converters above.  The vectorized back-ends
+// produce bit-identical results; these exist so that can be verified.
+namespace scalar {
+
+void copyNV21toRGB32(unsigned width, unsigned height,
+                     uint8_t* src,
+                     uint32_t* dst, unsigned dstStridePixels);
+
+void copyYV12toRGB32(unsigned width, unsigned height,
+                     uint8_t* src,
+                     uint32_t* dst, unsigned dstStridePixels);
+
+void copyYUYVtoRGB32(unsigned width, unsigned height,
+                     uint8_t* src, unsigned srcStridePixels,
+                     uint32_t* dst, unsigned dstStridePixels);
+
+}  // namespace scalar
+
+}  // namespace formatconvert
 }  // namespace evs
 }  // namespace automotive
 }  // namespace android
 
-#endif // EVS_VTS_FORMATCONVERT_H
+#endif  // EVS_FORMATCONVERT_FORMATCONVERT_H
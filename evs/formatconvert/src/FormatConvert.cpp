@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "formatconvert/FormatConvert.h"
+#include "FormatConvertInternal.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__arm__) && defined(__ARM_NEON)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace formatconvert {
+
+using internal::RowConverters;
+
+namespace {
+
+// Images shorter than this many rows per thread are not worth splitting into bands.
+constexpr unsigned kMinRowsPerBand = 64;
+
+// Round up to the nearest multiple of the given alignment value
+template<unsigned alignment>
+int align(int value) {
+    static_assert((alignment && !(alignment & (alignment - 1))),
+                  "alignment must be a power of 2");
+
+    unsigned mask = alignment - 1;
+    return (value + mask) & ~mask;
+}
+
+using BandFunction = std::function<void(unsigned rowBegin, unsigned rowEnd)>;
+
+// A fixed set of worker threads that each convert one horizontal band of an image, while the
+// calling thread converts the first band.  Only one image is converted at a time.
+class RowBandPool {
+public:
+    explicit RowBandPool(unsigned numWorkers) {
+        for (unsigned i = 0; i < numWorkers; i++) {
+            mWorkers.emplace_back([this, i]() { workerLoop(i + 1); });
+        }
+    }
+
+    ~RowBandPool() {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mQuit = true;
+        }
+        mWorkReady.notify_all();
+        for (auto&& worker : mWorkers) {
+            worker.join();
+        }
+    }
+
+    unsigned numBands() const {
+        return mWorkers.size() + 1;
+    }
+
+    void run(unsigned height, const BandFunction& fn) {
+        std::lock_guard<std::mutex> runLock(mRunLock);
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mJob = &fn;
+            mHeight = height;
+            mPending = mWorkers.size();
+            mGeneration++;
+        }
+        mWorkReady.notify_all();
+
+        fn(0, bandBoundary(1));
+
+        std::unique_lock<std::mutex> lock(mLock);
+        mWorkDone.wait(lock, [this]() { return mPending == 0; });
+        mJob = nullptr;
+    }
+
+private:
+    unsigned bandBoundary(unsigned band) const {
+        return static_cast<uint64_t>(mHeight) * band / numBands();
+    }
+
+    void workerLoop(unsigned band) {
+        uint64_t lastGeneration = 0;
+        std::unique_lock<std::mutex> lock(mLock);
+        while (true) {
+            mWorkReady.wait(lock, [&]() { return mQuit || mGeneration != lastGeneration; });
+            if (mQuit) {
+                return;
+            }
+            lastGeneration = mGeneration;
+
+            const BandFunction* job = mJob;
+            const unsigned rowBegin = bandBoundary(band);
+            const unsigned rowEnd = bandBoundary(band + 1);
+            lock.unlock();
+            (*job)(rowBegin, rowEnd);
+            lock.lock();
+
+            if (--mPending == 0) {
+                mWorkDone.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread>    mWorkers;
+
+    std::mutex                  mRunLock;   // Serializes concurrent conversions
+    std::mutex                  mLock;      // Protects the job state below
+    std::condition_variable     mWorkReady;
+    std::condition_variable     mWorkDone;
+    const BandFunction*         mJob = nullptr;
+    unsigned                    mHeight = 0;
+    unsigned                    mPending = 0;
+    uint64_t                    mGeneration = 0;
+    bool                        mQuit = false;
+};
+
+std::mutex sPoolLock;
+std::shared_ptr<RowBandPool> sPool;  // Guarded by sPoolLock; null when single threaded
+unsigned sNumThreads = 1;            // Guarded by sPoolLock
+
+const RowConverters* getConverters(Implementation impl) {
+    switch (impl) {
+        case Implementation::SCALAR:
+            return &internal::getScalarConverters();
+        case Implementation::NEON:
+#if defined(__ARM_NEON)
+#if defined(__arm__)
+            // NEON is optional on 32 bit ARM, so check the running CPU as well
+            if (!(getauxval(AT_HWCAP) & HWCAP_NEON)) {
+                return nullptr;
+            }
+#endif
+            return &internal::getNeonConverters();
+#else
+            return nullptr;
+#endif
+        case Implementation::SSE2:
+#if defined(__SSE2__)
+            return &internal::getSseConverters();
+#else
+            return nullptr;
+#endif
+        case Implementation::AUTO:
+            for (auto candidate : {Implementation::NEON, Implementation::SSE2}) {
+                const RowConverters* converters = getConverters(candidate);
+                if (converters != nullptr) {
+                    return converters;
+                }
+            }
+            return &internal::getScalarConverters();
+    }
+    return nullptr;
+}
+
+Implementation identify(const RowConverters* converters) {
+    for (auto impl : {Implementation::NEON, Implementation::SSE2}) {
+        if (converters == getConverters(impl)) {
+            return impl;
+        }
+    }
+    return Implementation::SCALAR;
+}
+
+std::atomic<const RowConverters*> sConverters(getConverters(Implementation::AUTO));
+
+// Runs the given function over the rows [0, height), split across the conversion threads if
+// there are enough rows to make that worthwhile.
+void forEachRowBand(bool allowThreads, unsigned height, const BandFunction& fn) {
+    std::shared_ptr<RowBandPool> pool;
+    if (allowThreads) {
+        std::lock_guard<std::mutex> lock(sPoolLock);
+        pool = sPool;
+    }
+
+    if (pool == nullptr || height < kMinRowsPerBand * pool->numBands()) {
+        fn(0, height);
+    } else {
+        pool->run(height, fn);
+    }
+}
+
+void convertNV21(const RowConverters& converters, bool allowThreads,
+                 unsigned width, unsigned height,
+                 const uint8_t* src,
+                 uint32_t* dst, unsigned dstStridePixels) {
+    // The NV21 format provides a Y array of 8bit values, followed by a 1/2 x 1/2 interleaved
+    // U/V array.  It assumes an even width and height for the overall image, and a horizontal
+    // stride that is an even multiple of 16 bytes for both the Y and UV arrays.
+    const unsigned strideLum = align<16>(width);
+    const unsigned sizeY = strideLum * height;
+    const unsigned strideColor = strideLum;   // 1/2 the samples, but two interleaved channels
+    const unsigned offsetUV = sizeY;
+
+    const uint8_t* srcY = src;
+    const uint8_t* srcUV = src + offsetUV;
+
+    forEachRowBand(allowThreads, height, [&](unsigned rowBegin, unsigned rowEnd) {
+        for (unsigned r = rowBegin; r < rowEnd; r++) {
+            // Note that we're walking the same UV row twice for even/odd luminance rows
+            converters.nv21(0, width,
+                            srcY + r * strideLum,
+                            srcUV + (r / 2 * strideColor),
+                            dst + r * dstStridePixels);
+        }
+    });
+}
+
+void convertYV12(const RowConverters& converters, bool allowThreads,
+                 unsigned width, unsigned height,
+                 const uint8_t* src,
+                 uint32_t* dst, unsigned dstStridePixels) {
+    // The YV12 format provides a Y array of 8bit values, followed by a 1/2 x 1/2 U array, followed
+    // by another 1/2 x 1/2 V array.  It assumes an even width and height for the overall image,
+    // and a horizontal stride that is an even multiple of 16 bytes for each of the Y, U,
+    // and V arrays.
+    const unsigned strideLum = align<16>(width);
+    const unsigned sizeY = strideLum * height;
+    const unsigned strideColor = align<16>(strideLum / 2);
+    const unsigned sizeColor = strideColor * height / 2;
+    const unsigned offsetU = sizeY;
+    const unsigned offsetV = sizeY + sizeColor;
+
+    const uint8_t* srcY = src;
+    const uint8_t* srcU = src + offsetU;
+    const uint8_t* srcV = src + offsetV;
+
+    forEachRowBand(allowThreads, height, [&](unsigned rowBegin, unsigned rowEnd) {
+        for (unsigned r = rowBegin; r < rowEnd; r++) {
+            // Note that we're walking the same U and V rows twice for even/odd luminance rows
+            converters.yv12(0, width,
+                            srcY + r * strideLum,
+                            srcU + (r / 2 * strideColor),
+                            srcV + (r / 2 * strideColor),
+                            dst + r * dstStridePixels);
+        }
+    });
+}
+
+void convertYUYV(const RowConverters& converters, bool allowThreads,
+                 unsigned width, unsigned height,
+                 const uint8_t* src, unsigned srcStridePixels,
+                 uint32_t* dst, unsigned dstStridePixels) {
+    // 2 bytes per source pixel, 4 bytes per destination pixel
+    forEachRowBand(allowThreads, height, [&](unsigned rowBegin, unsigned rowEnd) {
+        for (unsigned r = rowBegin; r < rowEnd; r++) {
+            converters.yuyv(0, width,
+                            src + r * srcStridePixels * 2,
+                            dst + r * dstStridePixels);
+        }
+    });
+}
+
+}  // namespace
+
+
+bool isImplementationSupported(Implementation impl) {
+    return getConverters(impl) != nullptr;
+}
+
+bool setImplementation(Implementation impl) {
+    const RowConverters* converters = getConverters(impl);
+    if (converters == nullptr) {
+        return false;
+    }
+
+    sConverters = converters;
+    return true;
+}
+
+Implementation getImplementation() {
+    return identify(sConverters);
+}
+
+void setNumThreads(unsigned numThreads) {
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+
+    std::shared_ptr<RowBandPool> oldPool;
+    {
+        std::lock_guard<std::mutex> lock(sPoolLock);
+        if (numThreads == sNumThreads) {
+            return;
+        }
+
+        // Conversions in flight keep their own reference to the old pool, so it is only torn
+        // down once they finish.
+        oldPool = std::move(sPool);
+        if (numThreads > 1) {
+            sPool = std::make_shared<RowBandPool>(numThreads - 1);
+        }
+        sNumThreads = numThreads;
+    }
+}
+
+unsigned getNumThreads() {
+    std::lock_guard<std::mutex> lock(sPoolLock);
+    return sNumThreads;
+}
+
+
+void copyNV21toRGB32(unsigned width, unsigned height,
+                     uint8_t* src,
+                     uint32_t* dst, unsigned dstStridePixels) {
+    convertNV21(*sConverters, true, width, height, src, dst, dstStridePixels);
+}
+
+
+void copyYV12toRGB32(unsigned width, unsigned height,
+                     uint8_t* src,
+                     uint32_t* dst, unsigned dstStridePixels) {
+    convertYV12(*sConverters, true, width, height, src, dst, dstStridePixels);
+}
+
+
+void copyYUYVtoRGB32(unsigned width, unsigned height,
+                     uint8_t* src, unsigned srcStridePixels,
+                     uint32_t* dst, unsigned dstStridePixels) {
+    convertYUYV(*sConverters, true, width, height, src, srcStridePixels, dst, dstStridePixels);
+}
+
+
+void copyMatchedInterleavedFormats(unsigned width, unsigned height,
+                                   void* src, unsigned srcStridePixels,
+                                   void* dst, unsigned dstStridePixels,
+                                   unsigned pixelSize) {
+    // memcpy is already vectorized by libc, so the best we can do is to hand it the biggest
+    // possible spans.
+    if (srcStridePixels == width && dstStridePixels == width) {
+        memcpy(dst, src, static_cast<size_t>(width) * height * pixelSize);
+        return;
+    }
+
+    for (unsigned row = 0; row < height; row++) {
+        // Copy the entire row of pixel data
+        memcpy(dst, src, width * pixelSize);
+
+        // Advance to the next row (keeping in mind that stride here is in units of pixels)
+        src = (uint8_t*)src + srcStridePixels * pixelSize;
+        dst = (uint8_t*)dst + dstStridePixels * pixelSize;
+    }
+}
+
+
+namespace scalar {
+
+void copyNV21toRGB32(unsigned width, unsigned height,
+                     uint8_t* src,
+                     uint32_t* dst, unsigned dstStridePixels) {
+    convertNV21(internal::getScalarConverters(), false,
+                width, height, src, dst, dstStridePixels);
+}
+
+void copyYV12toRGB32(unsigned width, unsigned height,
+                     uint8_t* src,
+                     uint32_t* dst, unsigned dstStridePixels) {
+    convertYV12(internal::getScalarConverters(), false,
+                width, height, src, dst, dstStridePixels);
+}
+
+void copyYUYVtoRGB32(unsigned width, unsigned height,
+                     uint8_t* src, unsigned srcStridePixels,
+                     uint32_t* dst, unsigned dstStridePixels) {
+    convertYUYV(internal::getScalarConverters(), false,
+                width, height, src, srcStridePixels, dst, dstStridePixels);
+}
+
+}  // namespace scalar
+
+}  // namespace formatconvert
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
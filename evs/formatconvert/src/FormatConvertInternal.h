@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EVS_FORMATCONVERT_FORMATCONVERTINTERNAL_H
+#define EVS_FORMATCONVERT_FORMATCONVERTINTERNAL_H
+
+#include <stdint.h>
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace formatconvert {
+namespace internal {
+
+// YUV to RGB coefficients in Q6 fixed point.  Every back-end evaluates the chroma terms below in
+// 16 bit signed arithmetic, rounding before the shift, and then adds them to Y with saturation.
+// Keeping the intermediate values within int16_t is what lets the vectorized back-ends be exact.
+//   R = Y + ((73 * V + 32) >> 6)                 ~ Y + 1.140 * V
+//   G = Y - ((25 * U + 37 * V + 32) >> 6)        ~ Y - 0.395 * U - 0.581 * V
+//   B = Y + ((130 * U + 32) >> 6)                ~ Y + 2.032 * U
+constexpr int kCoeffRV = 73;
+constexpr int kCoeffGU = 25;
+constexpr int kCoeffGV = 37;
+constexpr int kCoeffBU = 130;
+constexpr int kFixedPointShift = 6;
+constexpr int kFixedPointRounding = 1 << (kFixedPointShift - 1);
+
+static inline uint8_t clampToByte(int v) {
+    if (v < 0) return 0;
+    if (v > 255) return 255;
+    return static_cast<uint8_t>(v);
+}
+
+static inline uint32_t yuvToRgbx(const uint8_t Y, const uint8_t Uin, const uint8_t Vin) {
+    const int U = Uin - 128;
+    const int V = Vin - 128;
+
+    const int R = Y + ((kCoeffRV * V + kFixedPointRounding) >> kFixedPointShift);
+    const int G = Y - ((kCoeffGU * U + kCoeffGV * V + kFixedPointRounding) >> kFixedPointShift);
+    const int B = Y + ((kCoeffBU * U + kFixedPointRounding) >> kFixedPointShift);
+
+    return (clampToByte(R)      ) |
+           (clampToByte(G) <<  8) |
+           (clampToByte(B) << 16) |
+           0xFF000000;  // Fill the alpha channel with ones
+}
+
+// Row converters.  Each one converts the pixels in columns [first, width) of a single row.
+// Vectorized back-ends handle the bulk of the row and call the scalar versions for the tail.
+struct RowConverters {
+    // Converts one row of NV21 luma, using the given (shared) row of interleaved chroma.
+    void (*nv21)(unsigned first, unsigned width,
+                 const uint8_t* rowY, const uint8_t* rowUV, uint32_t* dst);
+
+    // Converts one row of YV12 luma, using the given (shared) rows of planar chroma.
+    void (*yv12)(unsigned first, unsigned width,
+                 const uint8_t* rowY, const uint8_t* rowU, const uint8_t* rowV, uint32_t* dst);
+
+    // Converts one row of YUYV pixels; first must be even.
+    void (*yuyv)(unsigned first, unsigned width, const uint8_t* src, uint32_t* dst);
+};
+
+void convertNV21RowScalar(unsigned first, unsigned width,
+                          const uint8_t* rowY, const uint8_t* rowUV, uint32_t* dst);
+void convertYV12RowScalar(unsigned first, unsigned width,
+                          const uint8_t* rowY, const uint8_t* rowU, const uint8_t* rowV,
+                          uint32_t* dst);
+void convertYUYVRowScalar(unsigned first, unsigned width, const uint8_t* src, uint32_t* dst);
+
+const RowConverters& getScalarConverters();
+
+#if defined(__ARM_NEON)
+const RowConverters& getNeonConverters();
+#endif
+
+#if defined(__SSE2__)
+const RowConverters& getSseConverters();
+#endif
+
+}  // namespace internal
+}  // namespace formatconvert
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
+
+#endif  // EVS_FORMATCONVERT_FORMATCONVERTINTERNAL_H
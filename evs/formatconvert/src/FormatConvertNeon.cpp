@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FormatConvertInternal.h"
+
+#if defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace formatconvert {
+namespace internal {
+
+namespace {
+
+// Pixels converted per loop iteration
+constexpr unsigned kBlockSize = 16;
+
+struct ChromaTerms {
+    int16x8_t r;
+    int16x8_t g;
+    int16x8_t b;
+};
+
+// Computes the per-channel chroma terms for eight U/V pairs.
+inline ChromaTerms computeChromaTerms(uint8x8_t u8, uint8x8_t v8) {
+    const int16x8_t bias = vdupq_n_s16(128);
+    const int16x8_t rounding = vdupq_n_s16(kFixedPointRounding);
+    const int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), bias);
+    const int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), bias);
+
+    ChromaTerms terms;
+    terms.r = vshrq_n_s16(vmlaq_n_s16(rounding, v, kCoeffRV), kFixedPointShift);
+    terms.g = vshrq_n_s16(vmlaq_n_s16(vmlaq_n_s16(rounding, u, kCoeffGU), v, kCoeffGV),
+                          kFixedPointShift);
+    terms.b = vshrq_n_s16(vmlaq_n_s16(rounding, u, kCoeffBU), kFixedPointShift);
+    return terms;
+}
+
+// Applies the chroma terms to eight luma values and saturates the result to bytes.
+inline uint8x8x4_t applyChroma(uint8x8_t y8, int16x8_t r, int16x8_t g, int16x8_t b) {
+    const int16x8_t y = vreinterpretq_s16_u16(vmovl_u8(y8));
+    uint8x8x4_t rgbx;
+    rgbx.val[0] = vqmovun_s16(vaddq_s16(y, r));
+    rgbx.val[1] = vqmovun_s16(vsubq_s16(y, g));
+    rgbx.val[2] = vqmovun_s16(vaddq_s16(y, b));
+    rgbx.val[3] = vdup_n_u8(0xFF);
+    return rgbx;
+}
+
+// Converts 16 luma values sharing eight horizontally subsampled chroma pairs.
+inline void convertBlock(uint8x16_t y, const ChromaTerms& terms, uint32_t* dst) {
+    const int16x8x2_t r = vzipq_s16(terms.r, terms.r);
+    const int16x8x2_t g = vzipq_s16(terms.g, terms.g);
+    const int16x8x2_t b = vzipq_s16(terms.b, terms.b);
+
+    uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+    vst4_u8(out, applyChroma(vget_low_u8(y), r.val[0], g.val[0], b.val[0]));
+    vst4_u8(out + 32, applyChroma(vget_high_u8(y), r.val[1], g.val[1], b.val[1]));
+}
+
+void convertNV21RowNeon(unsigned first, unsigned width,
+                        const uint8_t* rowY, const uint8_t* rowUV, uint32_t* dst) {
+    unsigned c = first;
+    for (; c + kBlockSize <= width; c += kBlockSize) {
+        const uint8x16_t y = vld1q_u8(rowY + c);
+        const uint8x8x2_t uv = vld2_u8(rowUV + c);
+        convertBlock(y, computeChromaTerms(uv.val[0], uv.val[1]), dst + c);
+    }
+    convertNV21RowScalar(c, width, rowY, rowUV, dst);
+}
+
+void convertYV12RowNeon(unsigned first, unsigned width,
+                        const uint8_t* rowY, const uint8_t* rowU, const uint8_t* rowV,
+                        uint32_t* dst) {
+    unsigned c = first;
+    for (; c + kBlockSize <= width; c += kBlockSize) {
+        const uint8x16_t y = vld1q_u8(rowY + c);
+        convertBlock(y, computeChromaTerms(vld1_u8(rowU + c / 2), vld1_u8(rowV + c / 2)),
+                     dst + c);
+    }
+    convertYV12RowScalar(c, width, rowY, rowU, rowV, dst);
+}
+
+void convertYUYVRowNeon(unsigned first, unsigned width, const uint8_t* src, uint32_t* dst) {
+    unsigned c = first;
+    for (; c + kBlockSize <= width; c += kBlockSize) {
+        // val[0] = even Y, val[1] = U, val[2] = odd Y, val[3] = V
+        const uint8x8x4_t yuyv = vld4_u8(src + c * 2);
+        const ChromaTerms terms = computeChromaTerms(yuyv.val[1], yuyv.val[3]);
+        const uint8x8x4_t even = applyChroma(yuyv.val[0], terms.r, terms.g, terms.b);
+        const uint8x8x4_t odd = applyChroma(yuyv.val[2], terms.r, terms.g, terms.b);
+
+        const uint8x8x2_t r = vzip_u8(even.val[0], odd.val[0]);
+        const uint8x8x2_t g = vzip_u8(even.val[1], odd.val[1]);
+        const uint8x8x2_t b = vzip_u8(even.val[2], odd.val[2]);
+
+        uint8_t* out = reinterpret_cast<uint8_t*>(dst + c);
+        uint8x8x4_t rgbx = even;
+        for (int half = 0; half < 2; half++) {
+            rgbx.val[0] = r.val[half];
+            rgbx.val[1] = g.val[half];
+            rgbx.val[2] = b.val[half];
+            vst4_u8(out + half * 32, rgbx);
+        }
+    }
+    convertYUYVRowScalar(c, width, src, dst);
+}
+
+}  // namespace
+
+const RowConverters& getNeonConverters() {
+    static const RowConverters kConverters = {
+        .nv21 = convertNV21RowNeon,
+        .yv12 = convertYV12RowNeon,
+        .yuyv = convertYUYVRowNeon,
+    };
+    return kConverters;
+}
+
+}  // namespace internal
+}  // namespace formatconvert
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
+
+#endif  // __ARM_NEON
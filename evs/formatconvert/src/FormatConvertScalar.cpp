@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FormatConvertInternal.h"
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace formatconvert {
+namespace internal {
+
+void convertNV21RowScalar(unsigned first, unsigned width,
+                          const uint8_t* rowY, const uint8_t* rowUV, uint32_t* dst) {
+    for (unsigned c = first; c < width; c++) {
+        unsigned uCol = (c & ~1);   // uCol is always even and repeats 1:2 with Y values
+        unsigned vCol = uCol | 1;   // vCol is always odd
+        dst[c] = yuvToRgbx(rowY[c], rowUV[uCol], rowUV[vCol]);
+    }
+}
+
+void convertYV12RowScalar(unsigned first, unsigned width,
+                          const uint8_t* rowY, const uint8_t* rowU, const uint8_t* rowV,
+                          uint32_t* dst) {
+    for (unsigned c = first; c < width; c++) {
+        // Chroma is subsampled horizontally as well, so each U/V sample covers two pixels
+        dst[c] = yuvToRgbx(rowY[c], rowU[c / 2], rowV[c / 2]);
+    }
+}
+
+void convertYUYVRowScalar(unsigned first, unsigned width, const uint8_t* src, uint32_t* dst) {
+    for (unsigned c = first / 2; c < width / 2; c++) {
+        // Note:  we're walking two pixels at a time here (even/odd)
+        const uint8_t* srcPixel = src + c * 4;
+        const uint8_t Y1 = srcPixel[0];
+        const uint8_t U  = srcPixel[1];
+        const uint8_t Y2 = srcPixel[2];
+        const uint8_t V  = srcPixel[3];
+
+        // On the RGB output, we're writing one pixel at a time
+        dst[c * 2 + 0] = yuvToRgbx(Y1, U, V);
+        dst[c * 2 + 1] = yuvToRgbx(Y2, U, V);
+    }
+}
+
+const RowConverters& getScalarConverters() {
+    static const RowConverters kConverters = {
+        .nv21 = convertNV21RowScalar,
+        .yv12 = convertYV12RowScalar,
+        .yuyv = convertYUYVRowScalar,
+    };
+    return kConverters;
+}
+
+}  // namespace internal
+}  // namespace formatconvert
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
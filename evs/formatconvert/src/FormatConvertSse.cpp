@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FormatConvertInternal.h"
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace formatconvert {
+namespace internal {
+
+namespace {
+
+// Pixels converted per loop iteration
+constexpr unsigned kBlockSize = 16;
+
+struct ChromaTerms {
+    __m128i r;
+    __m128i g;
+    __m128i b;
+};
+
+// Computes the per-channel chroma terms for eight U/V pairs held as 16 bit unsigned lanes.
+inline ChromaTerms computeChromaTerms(__m128i u16, __m128i v16) {
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i rounding = _mm_set1_epi16(kFixedPointRounding);
+    const __m128i u = _mm_sub_epi16(u16, bias);
+    const __m128i v = _mm_sub_epi16(v16, bias);
+
+    ChromaTerms terms;
+    terms.r = _mm_srai_epi16(
+            _mm_add_epi16(_mm_mullo_epi16(v, _mm_set1_epi16(kCoeffRV)), rounding),
+            kFixedPointShift);
+    terms.g = _mm_srai_epi16(
+            _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(u, _mm_set1_epi16(kCoeffGU)),
+                                        _mm_mullo_epi16(v, _mm_set1_epi16(kCoeffGV))),
+                          rounding),
+            kFixedPointShift);
+    terms.b = _mm_srai_epi16(
+            _mm_add_epi16(_mm_mullo_epi16(u, _mm_set1_epi16(kCoeffBU)), rounding),
+            kFixedPointShift);
+    return terms;
+}
+
+// Applies the chroma terms to eight luma values held as 16 bit lanes.
+struct Channels16 {
+    __m128i r;
+    __m128i g;
+    __m128i b;
+};
+
+inline Channels16 applyChroma(__m128i y16, const ChromaTerms& terms) {
+    Channels16 out;
+    out.r = _mm_add_epi16(y16, terms.r);
+    out.g = _mm_sub_epi16(y16, terms.g);
+    out.b = _mm_add_epi16(y16, terms.b);
+    return out;
+}
+
+// Saturates two sets of eight pixels to bytes and stores them as 16 RGBx pixels.
+inline void storeRgbx(const Channels16& lo, const Channels16& hi, uint32_t* dst) {
+    const __m128i r = _mm_packus_epi16(lo.r, hi.r);
+    const __m128i g = _mm_packus_epi16(lo.g, hi.g);
+    const __m128i b = _mm_packus_epi16(lo.b, hi.b);
+    const __m128i a = _mm_set1_epi8(static_cast<char>(0xFF));
+
+    const __m128i rgLo = _mm_unpacklo_epi8(r, g);
+    const __m128i rgHi = _mm_unpackhi_epi8(r, g);
+    const __m128i baLo = _mm_unpacklo_epi8(b, a);
+    const __m128i baHi = _mm_unpackhi_epi8(b, a);
+
+    __m128i* out = reinterpret_cast<__m128i*>(dst);
+    _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(rgLo, baLo));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rgLo, baLo));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rgHi, baHi));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rgHi, baHi));
+}
+
+// Expands eight chroma terms so each one covers a horizontal pair of pixels.
+inline void duplicateTerms(const ChromaTerms& terms, ChromaTerms* lo, ChromaTerms* hi) {
+    lo->r = _mm_unpacklo_epi16(terms.r, terms.r);
+    hi->r = _mm_unpackhi_epi16(terms.r, terms.r);
+    lo->g = _mm_unpacklo_epi16(terms.g, terms.g);
+    hi->g = _mm_unpackhi_epi16(terms.g, terms.g);
+    lo->b = _mm_unpacklo_epi16(terms.b, terms.b);
+    hi->b = _mm_unpackhi_epi16(terms.b, terms.b);
+}
+
+inline void convertBlock(__m128i y, const ChromaTerms& terms, uint32_t* dst) {
+    const __m128i zero = _mm_setzero_si128();
+    ChromaTerms lo, hi;
+    duplicateTerms(terms, &lo, &hi);
+    storeRgbx(applyChroma(_mm_unpacklo_epi8(y, zero), lo),
+              applyChroma(_mm_unpackhi_epi8(y, zero), hi),
+              dst);
+}
+
+void convertNV21RowSse(unsigned first, unsigned width,
+                       const uint8_t* rowY, const uint8_t* rowUV, uint32_t* dst) {
+    const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+    unsigned c = first;
+    for (; c + kBlockSize <= width; c += kBlockSize) {
+        const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowY + c));
+        const __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowUV + c));
+        convertBlock(y,
+                     computeChromaTerms(_mm_and_si128(uv, lowBytes), _mm_srli_epi16(uv, 8)),
+                     dst + c);
+    }
+    convertNV21RowScalar(c, width, rowY, rowUV, dst);
+}
+
+void convertYV12RowSse(unsigned first, unsigned width,
+                       const uint8_t* rowY, const uint8_t* rowU, const uint8_t* rowV,
+                       uint32_t* dst) {
+    const __m128i zero = _mm_setzero_si128();
+    unsigned c = first;
+    for (; c + kBlockSize <= width; c += kBlockSize) {
+        const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowY + c));
+        const __m128i u = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rowU + c / 2));
+        const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rowV + c / 2));
+        convertBlock(y,
+                     computeChromaTerms(_mm_unpacklo_epi8(u, zero), _mm_unpacklo_epi8(v, zero)),
+                     dst + c);
+    }
+    convertYV12RowScalar(c, width, rowY, rowU, rowV, dst);
+}
+
+// Converts eight YUYV pixels (16 bytes) into 16 bit channel values.
+inline Channels16 convertYUYV8(__m128i src) {
+    const __m128i y = _mm_and_si128(src, _mm_set1_epi16(0x00FF));
+    const __m128i uv = _mm_srli_epi16(src, 8);
+
+    // U sits in the even 16 bit lanes and V in the odd ones; spread each over its pixel pair.
+    const __m128i u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)),
+                                          _MM_SHUFFLE(2, 2, 0, 0));
+    const __m128i v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)),
+                                          _MM_SHUFFLE(3, 3, 1, 1));
+    return applyChroma(y, computeChromaTerms(u, v));
+}
+
+void convertYUYVRowSse(unsigned first, unsigned width, const uint8_t* src, uint32_t* dst) {
+    unsigned c = first;
+    for (; c + kBlockSize <= width; c += kBlockSize) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(src + c * 2);
+        storeRgbx(convertYUYV8(_mm_loadu_si128(in)),
+                  convertYUYV8(_mm_loadu_si128(in + 1)),
+                  dst + c);
+    }
+    convertYUYVRowScalar(c, width, src, dst);
+}
+
+}  // namespace
+
+const RowConverters& getSseConverters() {
+    static const RowConverters kConverters = {
+        .nv21 = convertNV21RowSse,
+        .yv12 = convertYV12RowSse,
+        .yuyv = convertYUYVRowSse,
+    };
+    return kConverters;
+}
+
+}  // namespace internal
+}  // namespace formatconvert
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
+
+#endif  // __SSE2__
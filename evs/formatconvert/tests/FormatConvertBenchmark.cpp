@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "formatconvert/FormatConvert.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace formatconvert {
+
+namespace {
+
+enum class Format {
+    NV21,
+    YV12,
+    YUYV,
+    RGBA,
+};
+
+// Benchmark arguments: {width, height, implementation, threads}
+void applyArguments(benchmark::internal::Benchmark* b) {
+    for (auto size : {std::make_pair(1280, 720), std::make_pair(1920, 1080)}) {
+        for (auto impl : {Implementation::SCALAR, Implementation::NEON, Implementation::SSE2}) {
+            if (!isImplementationSupported(impl)) {
+                continue;
+            }
+            for (int threads : {1, 2, 4}) {
+                b->Args({size.first, size.second, static_cast<int>(impl), threads});
+            }
+        }
+    }
+    b->ArgNames({"width", "height", "impl", "threads"});
+    b->UseRealTime();
+}
+
+template <Format format>
+void BM_Convert(benchmark::State& state) {
+    const unsigned width = state.range(0);
+    const unsigned height = state.range(1);
+    if (!setImplementation(static_cast<Implementation>(state.range(2)))) {
+        state.SkipWithError("Implementation is not supported");
+        return;
+    }
+    setNumThreads(state.range(3));
+
+    const unsigned stride = (width + 15) & ~15;
+    std::vector<uint8_t> src(stride * height * 4, 0x80);
+    std::vector<uint32_t> dst(stride * height);
+
+    for (auto _ : state) {
+        switch (format) {
+            case Format::NV21:
+                copyNV21toRGB32(width, height, src.data(), dst.data(), stride);
+                break;
+            case Format::YV12:
+                copyYV12toRGB32(width, height, src.data(), dst.data(), stride);
+                break;
+            case Format::YUYV:
+                copyYUYVtoRGB32(width, height, src.data(), stride, dst.data(), stride);
+                break;
+            case Format::RGBA:
+                copyMatchedInterleavedFormats(width, height, src.data(), stride,
+                                              dst.data(), stride, sizeof(uint32_t));
+                break;
+        }
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * width * height);
+
+    setImplementation(Implementation::AUTO);
+    setNumThreads(1);
+}
+
+BENCHMARK_TEMPLATE(BM_Convert, Format::NV21)->Apply(applyArguments);
+BENCHMARK_TEMPLATE(BM_Convert, Format::YV12)->Apply(applyArguments);
+BENCHMARK_TEMPLATE(BM_Convert, Format::YUYV)->Apply(applyArguments);
+BENCHMARK_TEMPLATE(BM_Convert, Format::RGBA)->Apply(applyArguments);
+
+}  // namespace
+
+}  // namespace formatconvert
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
+
+BENCHMARK_MAIN();
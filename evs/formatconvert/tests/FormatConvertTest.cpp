@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "formatconvert/FormatConvert.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace formatconvert {
+
+namespace {
+
+constexpr uint32_t kUnwritten = 0x12345678;
+
+struct FrameSize {
+    unsigned width;
+    unsigned height;
+};
+
+// Includes widths that are not a multiple of the vector block size to exercise the scalar tails,
+// and a frame tall enough to be split into bands.
+const FrameSize kFrameSizes[] = {
+    {2, 2}, {16, 2}, {18, 4}, {46, 6}, {64, 8}, {102, 10}, {320, 512},
+};
+
+unsigned align16(unsigned value) {
+    return (value + 15) & ~15;
+}
+
+std::vector<uint8_t> randomBytes(size_t size, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    std::vector<uint8_t> bytes(size);
+    for (auto& byte : bytes) {
+        byte = static_cast<uint8_t>(distribution(generator));
+    }
+    return bytes;
+}
+
+size_t nv21Size(const FrameSize& size) {
+    return align16(size.width) * size.height * 3 / 2;
+}
+
+size_t yv12Size(const FrameSize& size) {
+    return align16(size.width) * size.height + align16(align16(size.width) / 2) * size.height;
+}
+
+std::vector<Implementation> supportedImplementations() {
+    std::vector<Implementation> impls;
+    for (auto impl : {Implementation::SCALAR, Implementation::NEON, Implementation::SSE2}) {
+        if (isImplementationSupported(impl)) {
+            impls.push_back(impl);
+        }
+    }
+    return impls;
+}
+
+class FormatConvertThreadedTest : public ::testing::TestWithParam<unsigned> {
+protected:
+    void SetUp() override {
+        setNumThreads(GetParam());
+    }
+
+    void TearDown() override {
+        setImplementation(Implementation::AUTO);
+        setNumThreads(1);
+    }
+};
+
+}  // namespace
+
+TEST(FormatConvertTest, TestAutoSelectsSupportedImplementation) {
+    ASSERT_TRUE(setImplementation(Implementation::AUTO));
+    const Implementation impl = getImplementation();
+    EXPECT_NE(impl, Implementation::AUTO);
+    EXPECT_TRUE(isImplementationSupported(impl));
+    EXPECT_TRUE(isImplementationSupported(Implementation::SCALAR));
+}
+
+TEST(FormatConvertTest, TestScalarReferenceValues) {
+    // Y, U and V planes of a 2x2 NV21 image; the UV row is padded to the 16 byte stride.
+    std::vector<uint8_t> src(align16(2) * 3, 0);
+    src[0] = 128; src[1] = 0; src[16] = 255; src[17] = 76;
+    src[32] = 128; src[33] = 128;  // Neutral chroma
+
+    uint32_t dst[4] = {};
+    scalar::copyNV21toRGB32(2, 2, src.data(), dst, 2);
+    EXPECT_EQ(dst[0], 0xFF808080u);
+    EXPECT_EQ(dst[1], 0xFF000000u);
+    EXPECT_EQ(dst[2], 0xFFFFFFFFu);
+    EXPECT_EQ(dst[3], 0xFF4C4C4Cu);
+
+    // Saturated chroma has to clamp rather than wrap around.
+    src[32] = 255; src[33] = 255;
+    scalar::copyNV21toRGB32(2, 2, src.data(), dst, 2);
+    EXPECT_EQ(dst[2] & 0x00FF00FF, 0x00FF00FFu);
+    src[32] = 0; src[33] = 0;
+    scalar::copyNV21toRGB32(2, 2, src.data(), dst, 2);
+    EXPECT_EQ(dst[1] & 0x00FF00FF, 0u);
+}
+
+TEST_P(FormatConvertThreadedTest, TestNV21MatchesScalarReference) {
+    for (auto impl : supportedImplementations()) {
+        ASSERT_TRUE(setImplementation(impl));
+        for (const auto& size : kFrameSizes) {
+            SCOPED_TRACE(::testing::Message() << "impl " << static_cast<int>(impl) << ", "
+                         << size.width << "x" << size.height);
+            std::vector<uint8_t> src = randomBytes(nv21Size(size), size.width);
+            const unsigned dstStride = size.width + 3;
+            std::vector<uint32_t> expected(dstStride * size.height, kUnwritten);
+            std::vector<uint32_t> actual(dstStride * size.height, kUnwritten);
+
+            scalar::copyNV21toRGB32(size.width, size.height, src.data(),
+                                    expected.data(), dstStride);
+            copyNV21toRGB32(size.width, size.height, src.data(), actual.data(), dstStride);
+            ASSERT_EQ(expected, actual);
+        }
+    }
+}
+
+TEST_P(FormatConvertThreadedTest, TestYV12MatchesScalarReference) {
+    for (auto impl : supportedImplementations()) {
+        ASSERT_TRUE(setImplementation(impl));
+        for (const auto& size : kFrameSizes) {
+            SCOPED_TRACE(::testing::Message() << "impl " << static_cast<int>(impl) << ", "
+                         << size.width << "x" << size.height);
+            std::vector<uint8_t> src = randomBytes(yv12Size(size), size.height);
+            const unsigned dstStride = align16(size.width);
+            std::vector<uint32_t> expected(dstStride * size.height, kUnwritten);
+            std::vector<uint32_t> actual(dstStride * size.height, kUnwritten);
+
+            scalar::copyYV12toRGB32(size.width, size.height, src.data(),
+                                    expected.data(), dstStride);
+            copyYV12toRGB32(size.width, size.height, src.data(), actual.data(), dstStride);
+            ASSERT_EQ(expected, actual);
+        }
+    }
+}
+
+TEST_P(FormatConvertThreadedTest, TestYUYVMatchesScalarReference) {
+    for (auto impl : supportedImplementations()) {
+        ASSERT_TRUE(setImplementation(impl));
+        for (const auto& size : kFrameSizes) {
+            SCOPED_TRACE(::testing::Message() << "impl " << static_cast<int>(impl) << ", "
+                         << size.width << "x" << size.height);
+            const unsigned srcStride = size.width + 8;
+            std::vector<uint8_t> src = randomBytes(srcStride * 2 * size.height, size.width + 1);
+            const unsigned dstStride = size.width;
+            std::vector<uint32_t> expected(dstStride * size.height, kUnwritten);
+            std::vector<uint32_t> actual(dstStride * size.height, kUnwritten);
+
+            scalar::copyYUYVtoRGB32(size.width, size.height, src.data(), srcStride,
+                                    expected.data(), dstStride);
+            copyYUYVtoRGB32(size.width, size.height, src.data(), srcStride,
+                            actual.data(), dstStride);
+            ASSERT_EQ(expected, actual);
+        }
+    }
+}
+
+TEST_P(FormatConvertThreadedTest, TestMatchedInterleavedFormats) {
+    for (const auto& size : kFrameSizes) {
+        for (unsigned dstStride : {size.width, size.width + 5}) {
+            std::vector<uint8_t> src = randomBytes(size.width * size.height * 4, 7);
+            std::vector<uint32_t> dst(dstStride * size.height, kUnwritten);
+            copyMatchedInterleavedFormats(size.width, size.height,
+                                          src.data(), size.width,
+                                          dst.data(), dstStride, 4);
+
+            for (unsigned r = 0; r < size.height; r++) {
+                ASSERT_EQ(memcmp(&dst[r * dstStride], &src[r * size.width * 4], size.width * 4), 0)
+                        << "row " << r;
+                for (unsigned c = size.width; c < dstStride; c++) {
+                    ASSERT_EQ(dst[r * dstStride + c], kUnwritten);
+                }
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Threads, FormatConvertThreadedTest, ::testing::Values(1u, 3u));
+
+}  // namespace formatconvert
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
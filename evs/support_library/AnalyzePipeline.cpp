@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AnalyzePipeline.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+
+#include <log/log.h>
+#include <ui/GraphicBuffer.h>
+#include <ui/GraphicBufferMapper.h>
+
+#include <formatconvert/FormatConvert.h>
+
+#include "BufferUtils.h"
+#include "Frame.h"
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace support {
+
+using ::android::automotive::evs::formatconvert::copyMatchedInterleavedFormats;
+using ::std::lock_guard;
+using ::std::unique_lock;
+
+namespace {
+
+// The analyze callbacks are handed 32bit RGBA frames.
+constexpr unsigned kBytesPerPixel = 4;
+
+// Unlike isSameFormat(), ignores the stride, which the allocator is free to
+// pick for the analysis buffers.
+bool canHoldCopyOf(const BufferDesc& buffer, const BufferDesc& input) {
+    return buffer.memHandle.getNativeHandle() != nullptr
+        && buffer.width == input.width
+        && buffer.height == input.height
+        && buffer.format == input.format
+        && buffer.usage == input.usage;
+}
+
+sp<GraphicBuffer> wrapCameraBuffer(const BufferDesc& input) {
+    return new GraphicBuffer(
+        input.memHandle, GraphicBuffer::CLONE_HANDLE, input.width,
+        input.height, input.format, 1,  // layer count
+        GRALLOC_USAGE_HW_TEXTURE, input.stride);
+}
+
+AnalyzeOptions sanitize(AnalyzeOptions options) {
+    options.numThreads = std::max(options.numThreads, 1u);
+    options.maxWaitingFrames = std::max(options.maxWaitingFrames, 1u);
+    return options;
+}
+
+}  // namespace
+
+AnalyzePipeline::AnalyzePipeline(BaseAnalyzeCallback* callback,
+                                 const AnalyzeOptions& options) :
+    mCallback(callback),
+    mReadOnly(callback->isReadOnly()),
+    mOptions(sanitize(options)),
+    mBufferPool(mReadOnly ? 0 : mOptions.numThreads)
+{
+    ALOGD("AnalyzePipeline: starting %u analyze thread(s), %s", mOptions.numThreads,
+          mReadOnly ? "zero-copy" : "copying");
+    for (unsigned i = 0; i < mOptions.numThreads; i++) {
+        mWorkers.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+AnalyzePipeline::~AnalyzePipeline() {
+    stop();
+}
+
+void AnalyzePipeline::submit(const SharedFrameHandle& frame) {
+    // Dropped frames are released outside of mLock, when this goes away.
+    SharedFrameHandle dropped;
+    {
+        lock_guard<std::mutex> lock(mLock);
+        if (mStopping) {
+            return;
+        }
+
+        mStats.framesSubmitted++;
+        if (mWaitingFrames.size() < mOptions.maxWaitingFrames) {
+            mWaitingFrames.push_back(frame);
+        } else {
+            // Every worker is busy and the queue is full.
+            mStats.framesDropped++;
+            if (mOptions.dropPolicy == DropPolicy::DROP_NEWEST) {
+                return;
+            }
+            dropped = std::move(mWaitingFrames.front());
+            mWaitingFrames.pop_front();
+            mWaitingFrames.push_back(frame);
+        }
+    }
+
+    mSignal.notify_one();
+}
+
+void AnalyzePipeline::stop() {
+    std::deque<SharedFrameHandle> dropped;
+    {
+        lock_guard<std::mutex> lock(mLock);
+        if (mStopping) {
+            return;
+        }
+        mStopping = true;
+        dropped.swap(mWaitingFrames);
+    }
+    mSignal.notify_all();
+    dropped.clear();
+
+    for (auto&& worker : mWorkers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    mWorkers.clear();
+
+    for (auto&& buffer : mBufferPool) {
+        release(buffer);
+    }
+
+    Stats stats = getStats();
+    ALOGD("AnalyzePipeline: stopped. %" PRIu64 " frames submitted, %" PRIu64 " analyzed, "
+          "%" PRIu64 " dropped, %" PRIu64 " failed; held frames for %" PRId64 "us on average, "
+          "%" PRId64 "us at most", stats.framesSubmitted, stats.framesAnalyzed,
+          stats.framesDropped, stats.framesFailed, stats.holdTime.averageNs() / 1000,
+          stats.holdTime.maxNs / 1000);
+}
+
+AnalyzePipeline::Stats AnalyzePipeline::getStats() {
+    lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+void AnalyzePipeline::workerLoop(unsigned index) {
+    ALOGD("AnalyzePipeline: Analyze Thread %u starts", index);
+
+    while (true) {
+        SharedFrameHandle frame;
+        {
+            unique_lock<std::mutex> lock(mLock);
+            mSignal.wait(lock, [this]() { return mStopping || !mWaitingFrames.empty(); });
+            if (mStopping) {
+                break;
+            }
+
+            frame = std::move(mWaitingFrames.front());
+            mWaitingFrames.pop_front();
+        }
+
+        bool success = mReadOnly ? analyzeInPlace(std::move(frame))
+                                 : copyAndAnalyze(std::move(frame), mBufferPool[index]);
+
+        lock_guard<std::mutex> lock(mLock);
+        if (success) {
+            mStats.framesAnalyzed++;
+        } else {
+            mStats.framesFailed++;
+        }
+    }
+
+    ALOGD("AnalyzePipeline: Analyze Thread %u ends", index);
+}
+
+bool AnalyzePipeline::analyzeInPlace(SharedFrameHandle frame) {
+    const BufferDesc& input = frame->getBuffer();
+    sp<GraphicBuffer> inputBuffer = wrapCameraBuffer(input);
+    if (inputBuffer.get() == nullptr) {
+        ALOGE("Failed to allocate GraphicBuffer to wrap image handle");
+        releaseFrame(frame);
+        return false;
+    }
+
+    void* inputDataPtr = nullptr;
+    inputBuffer->lock(
+        GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_NEVER,
+        &inputDataPtr);
+    if (!inputDataPtr) {
+        ALOGE("Failed to gain read access to image buffer for analyzing");
+        inputBuffer->unlock();
+        releaseFrame(frame);
+        return false;
+    }
+
+    Frame analyzeFrame = {
+        .width = input.width,
+        .height = input.height,
+        .stride = input.stride,
+        .data = (uint8_t*)inputDataPtr,
+    };
+    mCallback->analyze(analyzeFrame);
+
+    inputBuffer->unlock();
+    releaseFrame(frame);
+    return true;
+}
+
+bool AnalyzePipeline::copyAndAnalyze(SharedFrameHandle frame, BufferDesc& copy) {
+    const BufferDesc& input = frame->getBuffer();
+    if (!canHoldCopyOf(copy, input)) {
+        // Only happens for the first frame, or when the stream format changes.
+        release(copy);
+        copy.width = input.width;
+        copy.height = input.height;
+        copy.format = input.format;
+        copy.usage = input.usage;
+        copy.pixelSize = input.pixelSize;
+        if (!allocate(copy)) {
+            ALOGE("Error allocating analysis buffer");
+            releaseFrame(frame);
+            return false;
+        }
+    }
+    copy.bufferId = input.bufferId;
+
+    sp<GraphicBuffer> inputBuffer = wrapCameraBuffer(input);
+    if (inputBuffer.get() == nullptr) {
+        ALOGE("Failed to allocate GraphicBuffer to wrap image handle");
+        releaseFrame(frame);
+        return false;
+    }
+
+    void* inputDataPtr = nullptr;
+    inputBuffer->lock(
+        GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_NEVER,
+        &inputDataPtr);
+    if (!inputDataPtr) {
+        ALOGE("Failed to gain read access to image buffer for analyzing");
+        inputBuffer->unlock();
+        releaseFrame(frame);
+        return false;
+    }
+
+    void* analyzeDataPtr = nullptr;
+    android::GraphicBufferMapper& mapper = android::GraphicBufferMapper::get();
+    mapper.lock(copy.memHandle,
+                GRALLOC_USAGE_SW_WRITE_OFTEN | GRALLOC_USAGE_SW_READ_OFTEN,
+                android::Rect(copy.width, copy.height),
+                (void**)&analyzeDataPtr);
+    if (!analyzeDataPtr) {
+        ALOGE("Camera failed to gain access to image buffer for analyzing");
+        inputBuffer->unlock();
+        mapper.unlock(copy.memHandle);
+        releaseFrame(frame);
+        return false;
+    }
+
+    copyMatchedInterleavedFormats(input.width, input.height,
+                                  inputDataPtr, input.stride,
+                                  analyzeDataPtr, copy.stride,
+                                  kBytesPerPixel);
+
+    // The camera frame can go back as soon as we have our own copy.
+    inputBuffer->unlock();
+    releaseFrame(frame);
+
+    Frame analyzeFrame = {
+        .width = copy.width,
+        .height = copy.height,
+        .stride = copy.stride,
+        .data = (uint8_t*)analyzeDataPtr,
+    };
+    mCallback->analyze(analyzeFrame);
+
+    mapper.unlock(copy.memHandle);
+    return true;
+}
+
+void AnalyzePipeline::releaseFrame(SharedFrameHandle& frame) {
+    const int64_t holdTimeNs = frame->getAgeNs();
+    frame.reset();
+
+    lock_guard<std::mutex> lock(mLock);
+    mStats.holdTime.record(holdTimeNs);
+}
+
+}  // namespace support
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
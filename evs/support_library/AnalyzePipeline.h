@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAR_LIB_EVS_SUPPORT_ANALYZE_PIPELINE_H
+#define CAR_LIB_EVS_SUPPORT_ANALYZE_PIPELINE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <android/hardware/automotive/evs/1.0/types.h>
+
+#include "BaseAnalyzeCallback.h"
+#include "SharedFrame.h"
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace support {
+
+using ::android::hardware::automotive::evs::V1_0::BufferDesc;
+
+/*
+ * What to do with a new frame when an analyzer still has the maximum number
+ * of frames waiting for a free analyze thread.
+ */
+enum class DropPolicy {
+    // Drop the oldest waiting frame; with one waiting frame at most, the
+    // analyzer always gets the latest frame.
+    DROP_OLDEST,
+
+    // Drop the new frame, keeping the waiting ones in order.
+    DROP_NEWEST,
+};
+
+struct AnalyzeOptions {
+    // Number of threads running the analyze callback.
+    unsigned numThreads = 1;
+
+    // Number of frames that may wait for a free analyze thread.
+    unsigned maxWaitingFrames = 1;
+
+    DropPolicy dropPolicy = DropPolicy::DROP_OLDEST;
+};
+
+/*
+ * AnalyzePipeline:
+ * Runs an analyze callback on a fixed set of worker threads.
+ *
+ * Camera frames are handed over with submit() and wait in a bounded queue
+ * until a worker is free. When the queue is full, a frame is dropped
+ * according to the drop policy and counted in the stats. By default only one
+ * frame waits, and newer frames replace it (latest frame wins).
+ *
+ * Read-only analyzers are run directly on the shared camera frame. Other
+ * analyzers run on a private copy: every worker owns one buffer of a fixed
+ * pool, which is only reallocated when the stream format changes, and the
+ * camera frame is released as soon as it is copied.
+ */
+class AnalyzePipeline {
+public:
+    struct Stats {
+        uint64_t framesSubmitted = 0;
+        uint64_t framesAnalyzed = 0;
+        uint64_t framesDropped = 0;   // Dropped while waiting, per the drop policy
+        uint64_t framesFailed = 0;    // Could not be mapped or copied
+
+        // From camera delivery until the pipeline released the camera frame
+        HoldTimeStats holdTime;
+    };
+
+    AnalyzePipeline(BaseAnalyzeCallback* callback, const AnalyzeOptions& options);
+    ~AnalyzePipeline();
+
+    /*
+     * Queues a camera frame for analysis. The pipeline keeps its reference
+     * only until the frame is analyzed or copied, or dropped.
+     */
+    void submit(const SharedFrameHandle& frame);
+
+    /*
+     * Stops accepting frames, releases the waiting frames, and blocks until
+     * the frames being analyzed are done. It is safe to call this more than
+     * once.
+     */
+    void stop();
+
+    Stats getStats();
+
+    BaseAnalyzeCallback* getCallback() const {
+        return mCallback;
+    }
+
+    // Most camera frames the pipeline may hold at the same time.
+    unsigned getMaxHeldFrames() const {
+        return mOptions.numThreads + mOptions.maxWaitingFrames;
+    }
+
+    bool isZeroCopy() const {
+        return mReadOnly;
+    }
+
+private:
+    void workerLoop(unsigned index);
+
+    // Both drop the frame reference before returning.
+    bool analyzeInPlace(SharedFrameHandle frame);
+    bool copyAndAnalyze(SharedFrameHandle frame, BufferDesc& copy);
+    void releaseFrame(SharedFrameHandle& frame);
+
+    BaseAnalyzeCallback* const  mCallback;
+    const bool                  mReadOnly;
+    const AnalyzeOptions        mOptions;
+
+    std::mutex                      mLock;
+    std::condition_variable         mSignal;
+    bool                            mStopping = false;
+    std::deque<SharedFrameHandle>   mWaitingFrames;
+    Stats                           mStats;
+
+    std::vector<std::thread>    mWorkers;
+
+    // Analysis buffers; each one is only touched by the worker of the same
+    // index, and by stop() once the workers are gone.
+    std::vector<BufferDesc>     mBufferPool;
+};
+
+}  // namespace support
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
+
+#endif  // CAR_LIB_EVS_SUPPORT_ANALYZE_PIPELINE_H
@@ -28,9 +28,11 @@ namespace automotive {
 namespace evs {
 namespace support {
 
-AnalyzeUseCase::AnalyzeUseCase(string cameraId, BaseAnalyzeCallback* callback)
+AnalyzeUseCase::AnalyzeUseCase(string cameraId, BaseAnalyzeCallback* callback,
+                               const AnalyzeOptions& options)
               : BaseUseCase(vector<string>(1, cameraId)),
-                mAnalyzeCallback(callback) {}
+                mAnalyzeCallback(callback),
+                mAnalyzeOptions(options) {}
 
 AnalyzeUseCase::~AnalyzeUseCase() {}
 
@@ -86,7 +88,7 @@ bool AnalyzeUseCase::startVideoStream() {
 
     ALOGD("Attach callback to StreamHandler");
     if (mAnalyzeCallback != nullptr) {
-        mStreamHandler->attachAnalyzeCallback(mAnalyzeCallback);
+        mStreamHandler->attachAnalyzeCallback(mAnalyzeCallback, mAnalyzeOptions);
     }
 
     mStreamHandler->startStream();
@@ -104,7 +106,7 @@ void AnalyzeUseCase::stopVideoStream() {
         // we want to finish the remaining logic of this method to try to
         // release other resources.
     } else {
-        mStreamHandler->detachAnalyzeCallback();
+        mStreamHandler->detachAnalyzeCallback(mAnalyzeCallback);
     }
 
     if (mResourceManager == nullptr) {
@@ -129,8 +131,8 @@ void AnalyzeUseCase::stopVideoStream() {
 // TODO(b/130246434): For both Analyze use case and Display use case, return a
 // pointer instead of an object.
 AnalyzeUseCase AnalyzeUseCase::createDefaultUseCase(
-    string cameraId, BaseAnalyzeCallback* callback) {
-    return AnalyzeUseCase(cameraId, callback);
+    string cameraId, BaseAnalyzeCallback* callback, const AnalyzeOptions& options) {
+    return AnalyzeUseCase(cameraId, callback, options);
 }
 
 }  // namespace support
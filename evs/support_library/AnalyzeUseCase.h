@@ -34,19 +34,22 @@ namespace support {
 
 class AnalyzeUseCase : public BaseUseCase {
 public:
-    AnalyzeUseCase(string cameraId, BaseAnalyzeCallback* analyzeCallback);
+    AnalyzeUseCase(string cameraId, BaseAnalyzeCallback* analyzeCallback,
+                   const AnalyzeOptions& options = AnalyzeOptions());
     virtual ~AnalyzeUseCase();
     virtual bool startVideoStream() override;
     virtual void stopVideoStream() override;
 
     static AnalyzeUseCase createDefaultUseCase(string cameraId,
-                                               BaseAnalyzeCallback* cb = nullptr);
+                                               BaseAnalyzeCallback* cb = nullptr,
+                                               const AnalyzeOptions& options = AnalyzeOptions());
 
 private:
     bool initialize();
 
     bool mIsInitialized = false;
     BaseAnalyzeCallback* mAnalyzeCallback = nullptr;
+    AnalyzeOptions mAnalyzeOptions;
 
     sp<StreamHandler>           mStreamHandler;
     sp<ResourceManager>         mResourceManager;
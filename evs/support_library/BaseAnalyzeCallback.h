@@ -26,7 +26,24 @@ namespace support {
 
 class BaseAnalyzeCallback{
     public:
+        /*
+         * Analyzes a single camera frame.
+         *
+         * When the analyzer is attached with more than one analyze thread,
+         * this method is called concurrently for different frames, and frames
+         * may finish out of order.
+         */
         virtual void analyze(const Frame&) = 0;
+
+        /*
+         * Returns true if analyze() never writes to the frame data.
+         *
+         * Read-only analyzers are handed the camera buffer itself, which is
+         * held back from the camera until analyze() returns. Other analyzers
+         * get a private copy of the frame.
+         */
+        virtual bool isReadOnly() const { return false; }
+
         virtual ~BaseAnalyzeCallback() {};
 };
 
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BufferUtils.h"
+
+#include <log/log.h>
+#include <ui/GraphicBufferAllocator.h>
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace support {
+
+using ::android::hardware::hidl_handle;
+
+bool isSameFormat(const BufferDesc& input, const BufferDesc& output) {
+    return input.width == output.width
+        && input.height == output.height
+        && input.format == output.format
+        && input.usage == output.usage
+        && input.stride == output.stride
+        && input.pixelSize == output.pixelSize;
+}
+
+bool allocate(BufferDesc& buffer) {
+    ALOGD("allocate");
+    buffer_handle_t handle;
+    android::GraphicBufferAllocator& alloc(android::GraphicBufferAllocator::get());
+    android::status_t result = alloc.allocate(
+        buffer.width, buffer.height, buffer.format, 1, buffer.usage,
+        &handle, &buffer.stride, 0, "EvsDisplay");
+    if (result != android::NO_ERROR) {
+        ALOGE("Error %d allocating %d x %d graphics buffer", result, buffer.width,
+              buffer.height);
+        return false;
+    }
+
+    // The reason that we have to check null for "handle" is because that the
+    // above "result" might not cover all the failure scenarios.
+    // By looking into Gralloc4.cpp (and 3, 2, as well), it turned out that if
+    // there is anything that goes wrong in the process of buffer importing (see
+    // Ln 385 in Gralloc4.cpp), the error won't be covered by the above "result"
+    // we got from "allocate" method. In other words, it means that there is
+    // still a chance that the "result" is "NO_ERROR" but the handle is nullptr
+    // (that means buffer importing failed).
+    if (!handle) {
+        ALOGE("We didn't get a buffer handle back from the allocator");
+        return false;
+    }
+
+    buffer.memHandle = hidl_handle(handle);
+    return true;
+}
+
+void release(BufferDesc& buffer) {
+    if (buffer.memHandle.getNativeHandle() != nullptr) {
+        android::GraphicBufferAllocator::get().free(buffer.memHandle);
+        buffer.memHandle = nullptr;
+    }
+}
+
+}  // namespace support
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAR_LIB_EVS_SUPPORT_BUFFER_UTILS_H
+#define CAR_LIB_EVS_SUPPORT_BUFFER_UTILS_H
+
+#include <android/hardware/automotive/evs/1.0/types.h>
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace support {
+
+using ::android::hardware::automotive::evs::V1_0::BufferDesc;
+
+/*
+ * Returns true if both buffers have the same dimensions, format, usage and
+ * layout, so the contents of one can be copied into the other as is.
+ */
+bool isSameFormat(const BufferDesc& input, const BufferDesc& output);
+
+/*
+ * Allocates a graphic buffer matching the width, height, format and usage of
+ * the given description, and stores its handle and stride in it.
+ *
+ * Returns false if the allocation failed.
+ */
+bool allocate(BufferDesc& buffer);
+
+/*
+ * Frees a graphic buffer previously allocated by allocate(), if any, and
+ * clears its handle.
+ */
+void release(BufferDesc& buffer);
+
+}  // namespace support
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
+
+#endif  // CAR_LIB_EVS_SUPPORT_BUFFER_UTILS_H
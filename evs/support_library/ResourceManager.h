@@ -59,6 +59,10 @@ public:
      * decreased to zero, the stream handler will be shut down and the evs
      * camera instance will be closed.
      *
+     * All the use cases of a camera share the same stream handler, and so the
+     * same evs stream. Every frame is delivered to all of them without being
+     * copied, and is returned to the camera once the last one is done with it.
+     *
      * The method will block other stream handler related calls. For example,
      * method releaseStreamHandler.
      *
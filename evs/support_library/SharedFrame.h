@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAR_LIB_EVS_SUPPORT_SHARED_FRAME_H
+#define CAR_LIB_EVS_SUPPORT_SHARED_FRAME_H
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include <android/hardware/automotive/evs/1.0/types.h>
+#include <utils/SystemClock.h>
+
+namespace android {
+namespace automotive {
+namespace evs {
+namespace support {
+
+using ::android::hardware::automotive::evs::V1_0::BufferDesc;
+
+/*
+ * SharedFrame:
+ * A camera frame shared, read-only, by every consumer of a camera stream.
+ *
+ * Consumers hold on to the frame through SharedFrameHandle references. The
+ * release callback runs, and the buffer goes back to the camera, once the
+ * last reference is dropped.
+ */
+class SharedFrame {
+public:
+    using ReleaseCallback = std::function<void(const BufferDesc&)>;
+
+    SharedFrame(const BufferDesc& buffer, ReleaseCallback releaseCallback) :
+        mBuffer(buffer),
+        mReleaseCallback(std::move(releaseCallback)),
+        mDeliveryTimeNs(android::elapsedRealtimeNano()) {}
+
+    ~SharedFrame() {
+        if (mReleaseCallback) {
+            mReleaseCallback(mBuffer);
+        }
+    }
+
+    SharedFrame(const SharedFrame&) = delete;
+    SharedFrame& operator=(const SharedFrame&) = delete;
+
+    const BufferDesc& getBuffer() const {
+        return mBuffer;
+    }
+
+    // Time the frame was delivered by the camera, in elapsedRealtimeNano().
+    int64_t getDeliveryTimeNs() const {
+        return mDeliveryTimeNs;
+    }
+
+    // Nanoseconds since the frame was delivered by the camera.
+    int64_t getAgeNs() const {
+        return android::elapsedRealtimeNano() - mDeliveryTimeNs;
+    }
+
+private:
+    const BufferDesc        mBuffer;
+    const ReleaseCallback   mReleaseCallback;
+    const int64_t           mDeliveryTimeNs;
+};
+
+using SharedFrameHandle = std::shared_ptr<const SharedFrame>;
+
+/*
+ * How long a consumer kept frames, from camera delivery until it released
+ * them.
+ */
+struct HoldTimeStats {
+    uint64_t count = 0;
+    int64_t totalNs = 0;
+    int64_t maxNs = 0;
+
+    void record(int64_t holdTimeNs) {
+        count++;
+        totalNs += holdTimeNs;
+        maxNs = std::max(maxNs, holdTimeNs);
+    }
+
+    int64_t averageNs() const {
+        return count > 0 ? totalNs / static_cast<int64_t>(count) : 0;
+    }
+};
+
+}  // namespace support
+}  // namespace evs
+}  // namespace automotive
+}  // namespace android
+
+#endif  // CAR_LIB_EVS_SUPPORT_SHARED_FRAME_H
@@ -25,6 +25,7 @@
 #include <ui/GraphicBufferAllocator.h>
 #include <ui/GraphicBufferMapper.h>
 
+#include "BufferUtils.h"
 #include "Frame.h"
 #include "ResourceManager.h"
 
@@ -36,20 +37,27 @@ namespace support {
 using ::std::lock_guard;
 using ::std::unique_lock;
 
+namespace {
+
+// We rely on the camera having at least two buffers available since we'll hold one and
+// expect the camera to be able to capture a new image in the background.
+constexpr unsigned kDisplayFramesInFlight = 2;
+
+}  // namespace
+
 StreamHandler::StreamHandler(android::sp <IEvsCamera> pCamera) :
-    mCamera(pCamera),
-    mAnalyzeCallback(nullptr),
-    mAnalyzerRunning(false)
+    mCamera(pCamera)
 {
-    // We rely on the camera having at least two buffers available since we'll hold one and
-    // expect the camera to be able to capture a new image in the background.
-    pCamera->setMaxFramesInFlight(2);
+    pCamera->setMaxFramesInFlight(kDisplayFramesInFlight);
 }
 
 // TODO(b/130246343): investigate further to make sure the resources are cleaned
 // up properly in the shutdown logic.
 void StreamHandler::shutdown()
 {
+    // Make sure no analyze thread still holds on to a camera frame
+    detachAllAnalyzeCallbacks();
+
     // Tell the camera to stop streaming.
     // This will result in a null frame being delivered when the stream actually stops.
     mCamera->stopVideoStream();
@@ -127,8 +135,13 @@ void StreamHandler::doneWithFrame(const BufferDesc& buffer) {
         return;
     }
 
-    // Send the buffer back to the underlying camera
-    mCamera->doneWithFrame(mOriginalBuffers[mHeldBuffer]);
+    // Drop the display reference; the buffer goes back to the underlying
+    // camera once no analyze callback holds it either. The slot is empty when
+    // the frame was delivered through the fallback path of getNewDisplayFrame()
+    if (mDisplayFrames[mHeldBuffer]) {
+        mDisplayHoldTime.record(mDisplayFrames[mHeldBuffer]->getAgeNs());
+    }
+    mDisplayFrames[mHeldBuffer].reset();
 
     // Clear the held position
     mHeldBuffer = -1;
@@ -139,6 +152,10 @@ Return<void> StreamHandler::deliverFrame(const BufferDesc& buffer) {
     ALOGD("Received a frame from the camera. NativeHandle:%p, buffer id:%d",
           buffer.memHandle.getNativeHandle(), buffer.bufferId);
 
+    // Hold off detaching analyze callbacks until the frame is submitted
+    std::shared_lock<std::shared_mutex> analyzerLock(mAnalyzerLock);
+    SharedFrameHandle frame;
+
     // Take the lock to protect our frame slots and running state variable
     {
         lock_guard <mutex> lock(mLock);
@@ -147,10 +164,17 @@ Return<void> StreamHandler::deliverFrame(const BufferDesc& buffer) {
             // Signal that the last frame has been received and the stream is stopped
             mRunning = false;
         } else {
+            // The frame goes back to the camera once the display path and all
+            // the analyze callbacks dropped their references. Holding on to
+            // the camera here keeps that working after shutdown().
+            frame = std::make_shared<SharedFrame>(
+                buffer, [camera = mCamera](const BufferDesc& b) { camera->doneWithFrame(b); });
+            mFramesDelivered++;
+
             // Do we already have a "ready" frame?
             if (mReadyBuffer >= 0) {
-                // Send the previously saved buffer back to the camera unused
-                mCamera->doneWithFrame(mOriginalBuffers[mReadyBuffer]);
+                // Drop the previously saved buffer unused
+                mDisplayFrames[mReadyBuffer].reset();
 
                 // We'll reuse the same ready buffer index
             } else if (mHeldBuffer >= 0) {
@@ -163,6 +187,7 @@ Return<void> StreamHandler::deliverFrame(const BufferDesc& buffer) {
 
             // Save this frame until our client is interested in it
             mOriginalBuffers[mReadyBuffer] = buffer;
+            mDisplayFrames[mReadyBuffer] = frame;
 
             // If render callback is not null, process the frame with render
             // callback.
@@ -172,16 +197,14 @@ Return<void> StreamHandler::deliverFrame(const BufferDesc& buffer) {
             } else {
                 ALOGI("Render callback is null in deliverFrame.");
             }
+        }
+    }
 
-            // If analyze callback is not null and the analyze thread is
-            // available, copy the frame and run the analyze callback in
-            // analyze thread.
-            {
-                std::shared_lock<std::shared_mutex> analyzerLock(mAnalyzerLock);
-                if (mAnalyzeCallback != nullptr && !mAnalyzerRunning) {
-                    copyAndAnalyzeFrame(mOriginalBuffers[mReadyBuffer]);
-                }
-            }
+    // Fan the frame out to the analyze threads outside of mLock, since a
+    // pipeline may drop a waiting frame, and so return it, right away.
+    if (frame != nullptr) {
+        for (auto&& pipeline : mAnalyzePipelines) {
+            pipeline->submit(frame);
         }
     }
 
@@ -211,69 +234,95 @@ void StreamHandler::detachRenderCallback() {
     mRenderCallback = nullptr;
 }
 
-void StreamHandler::attachAnalyzeCallback(BaseAnalyzeCallback* callback) {
+void StreamHandler::attachAnalyzeCallback(BaseAnalyzeCallback* callback,
+                                          const AnalyzeOptions& options) {
     ALOGD("StreamHandler::attachAnalyzeCallback");
 
-    if (mAnalyzeCallback != nullptr) {
-        ALOGW("Ignored! There should only be one analyze callcack");
-        return;
+    lock_guard<std::shared_mutex> lock(mAnalyzerLock);
+    for (auto&& pipeline : mAnalyzePipelines) {
+        if (pipeline->getCallback() == callback) {
+            ALOGW("Ignored! The analyze callback is already attached");
+            return;
+        }
     }
 
-    {
-        lock_guard<std::shared_mutex> lock(mAnalyzerLock);
-        mAnalyzeCallback = callback;
-    }
+    mAnalyzePipelines.push_back(std::make_unique<AnalyzePipeline>(callback, options));
+    updateMaxFramesInFlight();
 }
 
-void StreamHandler::detachAnalyzeCallback() {
+void StreamHandler::detachAnalyzeCallback(BaseAnalyzeCallback* callback) {
     ALOGD("StreamHandler::detachAnalyzeCallback");
 
+    std::unique_ptr<AnalyzePipeline> pipeline;
     {
-        std::unique_lock<std::shared_mutex> lock(mAnalyzerLock);
+        lock_guard<std::shared_mutex> lock(mAnalyzerLock);
+        for (auto it = mAnalyzePipelines.begin(); it != mAnalyzePipelines.end(); ++it) {
+            if ((*it)->getCallback() == callback) {
+                pipeline = std::move(*it);
+                mAnalyzePipelines.erase(it);
+                break;
+            }
+        }
 
-        // Wait until current running analyzer ends
-        mAnalyzerSignal.wait(lock, [this] { return !mAnalyzerRunning; });
-        mAnalyzeCallback = nullptr;
+        if (pipeline == nullptr) {
+            return;
+        }
+        updateMaxFramesInFlight();
     }
+
+    // Wait until current running analyzers end. This must happen without
+    // mAnalyzerLock, so that deliverFrame() is not held up meanwhile.
+    pipeline->stop();
 }
 
-bool isSameFormat(const BufferDesc& input, const BufferDesc& output) {
-    return input.width == output.width
-        && input.height == output.height
-        && input.format == output.format
-        && input.usage == output.usage
-        && input.stride == output.stride
-        && input.pixelSize == output.pixelSize;
+void StreamHandler::detachAllAnalyzeCallbacks() {
+    std::vector<std::unique_ptr<AnalyzePipeline>> pipelines;
+    {
+        lock_guard<std::shared_mutex> lock(mAnalyzerLock);
+        pipelines.swap(mAnalyzePipelines);
+    }
+
+    for (auto&& pipeline : pipelines) {
+        pipeline->stop();
+    }
 }
 
-bool allocate(BufferDesc& buffer) {
-    ALOGD("StreamHandler::allocate");
-    buffer_handle_t handle;
-    android::GraphicBufferAllocator& alloc(android::GraphicBufferAllocator::get());
-    android::status_t result = alloc.allocate(
-        buffer.width, buffer.height, buffer.format, 1, buffer.usage,
-        &handle, &buffer.stride, 0, "EvsDisplay");
-    if (result != android::NO_ERROR) {
-        ALOGE("Error %d allocating %d x %d graphics buffer", result, buffer.width,
-              buffer.height);
-        return false;
+void StreamHandler::updateMaxFramesInFlight() {
+    // shutdown() drops the camera under mLock
+    android::sp<IEvsCamera> camera;
+    {
+        lock_guard<mutex> lock(mLock);
+        camera = mCamera;
+    }
+    if (camera == nullptr) {
+        return;
     }
 
-    // The reason that we have to check null for "handle" is because that the
-    // above "result" might not cover all the failure scenarios.
-    // By looking into Gralloc4.cpp (and 3, 2, as well), it turned out that if
-    // there is anything that goes wrong in the process of buffer importing (see
-    // Ln 385 in Gralloc4.cpp), the error won't be covered by the above "result"
-    // we got from "allocate" method. In other words, it means that there is
-    // still a chance that the "result" is "NO_ERROR" but the handle is nullptr
-    // (that means buffer importing failed).
-    if (!handle) {
-        ALOGE("We didn't get a buffer handle back from the allocator");
-        return false;
+    unsigned framesInFlight = kDisplayFramesInFlight;
+    for (auto&& pipeline : mAnalyzePipelines) {
+        framesInFlight += pipeline->getMaxHeldFrames();
     }
 
-    buffer.memHandle = hidl_handle(handle);
-    return true;
+    Return<EvsResult> result = camera->setMaxFramesInFlight(framesInFlight);
+    if (!result.isOk() || result != EvsResult::OK) {
+        ALOGW("Failed to set frames in flight to %u; "
+              "analyzing may hold back the display", framesInFlight);
+    }
+}
+
+StreamHandler::Stats StreamHandler::getStats() {
+    Stats stats;
+    {
+        std::shared_lock<std::shared_mutex> analyzerLock(mAnalyzerLock);
+        for (auto&& pipeline : mAnalyzePipelines) {
+            stats.analyzers.push_back(pipeline->getStats());
+        }
+    }
+
+    lock_guard<mutex> lock(mLock);
+    stats.framesDelivered = mFramesDelivered;
+    stats.displayHoldTime = mDisplayHoldTime;
+    return stats;
 }
 
 bool StreamHandler::processFrame(const BufferDesc& input,
@@ -380,103 +429,6 @@ bool StreamHandler::processFrame(const BufferDesc& input,
     return true;
 }
 
-bool StreamHandler::copyAndAnalyzeFrame(const BufferDesc& input) {
-    ALOGD("StreamHandler::copyAndAnalyzeFrame");
-
-    // TODO(b/130246434): make the following into a method. Some lines are
-    // duplicated with processFrame, move them into new methods as well.
-    if (!isSameFormat(input, mAnalyzeBuffer)
-        || mAnalyzeBuffer.memHandle.getNativeHandle() == nullptr) {
-        mAnalyzeBuffer.width = input.width;
-        mAnalyzeBuffer.height = input.height;
-        mAnalyzeBuffer.format = input.format;
-        mAnalyzeBuffer.usage = input.usage;
-        mAnalyzeBuffer.stride = input.stride;
-        mAnalyzeBuffer.pixelSize = input.pixelSize;
-        mAnalyzeBuffer.bufferId = input.bufferId;
-
-        // free the allocated output frame handle if it is not null
-        if (mAnalyzeBuffer.memHandle.getNativeHandle() != nullptr) {
-            GraphicBufferAllocator::get().free(mAnalyzeBuffer.memHandle);
-        }
-
-        if (!allocate(mAnalyzeBuffer)) {
-            ALOGE("Error allocating buffer");
-            return false;
-        }
-    }
-
-    // create a GraphicBuffer from the existing handle
-    sp<GraphicBuffer> inputBuffer = new GraphicBuffer(
-        input.memHandle, GraphicBuffer::CLONE_HANDLE, input.width,
-        input.height, input.format, 1,  // layer count
-        GRALLOC_USAGE_HW_TEXTURE, input.stride);
-
-    if (inputBuffer.get() == nullptr) {
-        ALOGE("Failed to allocate GraphicBuffer to wrap image handle");
-        // Returning "true" in this error condition because we already released the
-        // previous image (if any) and so the texture may change in unpredictable
-        // ways now!
-        return false;
-    }
-
-    // Lock the input GraphicBuffer and map it to a pointer.  If we failed to
-    // lock, return false.
-    void* inputDataPtr;
-    inputBuffer->lock(
-        GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_NEVER,
-        &inputDataPtr);
-    if (!inputDataPtr) {
-        ALOGE("Failed to gain read access to imageGraphicBuffer");
-        inputBuffer->unlock();
-        return false;
-    }
-
-    // Lock the allocated buffer in output BufferDesc and map it to a pointer
-    void* analyzeDataPtr = nullptr;
-    android::GraphicBufferMapper::get().lock(
-        mAnalyzeBuffer.memHandle,
-        GRALLOC_USAGE_SW_WRITE_OFTEN | GRALLOC_USAGE_SW_READ_NEVER,
-        android::Rect(mAnalyzeBuffer.width, mAnalyzeBuffer.height),
-        (void**)&analyzeDataPtr);
-
-    // If we failed to lock the pixel buffer, return false, and unlock both
-    // input and output buffers.
-    if (!analyzeDataPtr) {
-        ALOGE("Camera failed to gain access to image buffer for analyzing");
-        return false;
-    }
-
-    // Wrap the raw data and copied data, and pass them to the callback.
-    Frame analyzeFrame = {
-        .width = mAnalyzeBuffer.width,
-        .height = mAnalyzeBuffer.height,
-        .stride = mAnalyzeBuffer.stride,
-        .data = (uint8_t*)analyzeDataPtr,
-    };
-
-    memcpy(analyzeDataPtr, inputDataPtr, mAnalyzeBuffer.stride * mAnalyzeBuffer.height * 4);
-
-    // Unlock the buffers after all changes to the buffer are completed.
-    inputBuffer->unlock();
-
-    mAnalyzerRunning = true;
-    std::thread([this, analyzeFrame]() {
-        ALOGD("StreamHandler: Analyze Thread starts");
-
-        std::shared_lock<std::shared_mutex> lock(mAnalyzerLock);
-        if (this->mAnalyzeCallback != nullptr) {
-            this->mAnalyzeCallback->analyze(analyzeFrame);
-            android::GraphicBufferMapper::get().unlock(this->mAnalyzeBuffer.memHandle);
-        }
-        this->mAnalyzerRunning = false;
-        mAnalyzerSignal.notify_one();
-        ALOGD("StreamHandler: Analyze Thread ends");
-    }).detach();
-
-    return true;
-}
-
 }  // namespace support
 }  // namespace evs
 }  // namespace automotive
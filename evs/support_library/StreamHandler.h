@@ -18,16 +18,20 @@
 #define EVS_VTS_STREAMHANDLER_H
 
 #include <condition_variable>
+#include <memory>
 #include <queue>
 #include <thread>
 #include <shared_mutex>
+#include <vector>
 #include <ui/GraphicBuffer.h>
 #include <android/hardware/automotive/evs/1.0/IEvsCameraStream.h>
 #include <android/hardware/automotive/evs/1.0/IEvsCamera.h>
 #include <android/hardware/automotive/evs/1.0/IEvsDisplay.h>
 
+#include "AnalyzePipeline.h"
 #include "BaseRenderCallback.h"
 #include "BaseAnalyzeCallback.h"
+#include "SharedFrame.h"
 
 namespace android {
 namespace automotive {
@@ -48,6 +52,10 @@ using ::android::sp;
  * hold onto the most recent image buffer, returning older ones.
  * Note that the video frames are delivered on a background thread, while the control interface
  * is actuated from the applications foreground thread.
+ *
+ * Every frame is fanned out, without copying, to the display path and to all the attached
+ * analyze callbacks as a reference counted SharedFrame. The buffer goes back to the camera once
+ * all of them are done with it.
  */
 class StreamHandler : public IEvsCameraStream {
 public:
@@ -98,41 +106,61 @@ public:
     /*
      * Attaches an analyze callback to the StreamHandler.
      *
-     * When there is a valid analyze callback attached, a thread dedicated for
-     * the analyze callback will be allocated. When the thread is not busy, the
-     * next available evs frame will be copied (now happens in binder thread).
-     * And the copy will be passed into the analyze thread, and be processed by
-     * the analyze callback.
+     * When there is a valid analyze callback attached, the threads dedicated
+     * for the analyze callback will be started. Every new evs frame is
+     * offered to them; frames wait in a small queue while all of them are
+     * busy, and the drop policy picks which frame to give up when the queue
+     * is full. By default, only the latest frame is kept waiting. Read-only
+     * analyze callbacks work on the shared evs frame itself. Other callbacks
+     * get a copy of the frame, made on the analyze thread into a
+     * preallocated buffer.
      *
-     * Since there is only one AnalyzeUseCase allowed at the same time, at most
-     * only one analyze callback can be attached. The current analyze callback
-     * needs to be detached first (by method detachAnalyzeCallback()), before a
-     * new callback can be attached. In other words, the call will be ignored
-     * if the current analyze callback is not null.
+     * With more than one analyze thread, the callback has to be thread-safe.
+     *
+     * Any number of analyze callbacks can be attached at the same time, all
+     * sharing the same evs stream. Attaching the same callback twice is
+     * ignored.
      *
-     * @see detachAnalyzeCallback()
+     * @see detachAnalyzeCallback(BaseAnalyzeCallback*)
+     * @see BaseAnalyzeCallback::isReadOnly()
      */
-    // TODO(b/130246434): now only one analyze use case is supported, so one
-    // analyze thread id good enough. But we should be able to support several
-    // analyze use cases running at the same time, so we should probably use a
-    // thread pool to handle the cases.
-    void attachAnalyzeCallback(BaseAnalyzeCallback*);
+    void attachAnalyzeCallback(BaseAnalyzeCallback*,
+                               const AnalyzeOptions& options = AnalyzeOptions());
 
     /*
-     * Detaches the current analyze callback.
+     * Detaches the given analyze callback.
      *
-     * If no analyze callback is attached, this call will be ignored.
+     * Blocks until the frames it is analyzing are done. If the callback is
+     * not attached, this call will be ignored.
      *
-     * @see attachAnalyzeCallback(BaseAnalyzeCallback*)
+     * @see attachAnalyzeCallback(BaseAnalyzeCallback*, const AnalyzeOptions&)
      */
-    void detachAnalyzeCallback();
+    void detachAnalyzeCallback(BaseAnalyzeCallback*);
+
+    struct Stats {
+        uint64_t framesDelivered = 0;
+
+        // From camera delivery until the display client is done with a frame
+        HoldTimeStats displayHoldTime;
+
+        // One entry per attached analyze callback, in the order attached
+        std::vector<AnalyzePipeline::Stats> analyzers;
+    };
+
+    Stats getStats();
 
 private:
     // Implementation for ::android::hardware::automotive::evs::V1_0::ICarCameraStream
     Return<void> deliverFrame(const BufferDesc& buffer)  override;
 
     bool processFrame(const BufferDesc&, BufferDesc&);
-    bool copyAndAnalyzeFrame(const BufferDesc&);
+
+    void detachAllAnalyzeCallbacks();
+
+    // Sets the number of frames the camera may have in flight to cover the
+    // frames held by the display path and every analyze callback. Requires
+    // mAnalyzerLock to be held exclusively and mLock not to be held.
+    void updateMaxFramesInFlight();
 
     // Values initialized as startup
     android::sp <IEvsCamera>    mCamera;
@@ -146,18 +174,21 @@ private:
     bool                        mRunning = false;
 
     BufferDesc                  mOriginalBuffers[2];
+    SharedFrameHandle           mDisplayFrames[2];  // References backing mOriginalBuffers
     int                         mHeldBuffer = -1;   // Index of the one currently held by the client
     int                         mReadyBuffer = -1;  // Index of the newest available buffer
 
     BufferDesc                  mProcessedBuffers[2];
-    BufferDesc                  mAnalyzeBuffer GUARDED_BY(mAnalyzerLock);
+
+    uint64_t                    mFramesDelivered = 0;
+    HoldTimeStats               mDisplayHoldTime;
 
     BaseRenderCallback*         mRenderCallback = nullptr;
 
-    BaseAnalyzeCallback*        mAnalyzeCallback GUARDED_BY(mAnalyzerLock);
-    std::atomic<bool>           mAnalyzerRunning;
+    // Frames are submitted under a shared lock; pipelines are added and
+    // removed under an exclusive one. Never acquire this while holding mLock.
     std::shared_mutex           mAnalyzerLock;
-    std::condition_variable_any mAnalyzerSignal;
+    std::vector<std::unique_ptr<AnalyzePipeline>> mAnalyzePipelines GUARDED_BY(mAnalyzerLock);
 };
 
 }  // namespace support
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.android.car.procfsinspector;
+
+import android.os.Parcel;
+import android.os.Parcelable;
+import java.util.List;
+
+/**
+ * Changes of the process table between two of its generations.
+ */
+public class ProcessTableDelta implements Parcelable {
+    public static final Parcelable.Creator<ProcessTableDelta> CREATOR =
+        new Parcelable.Creator<ProcessTableDelta>() {
+            public ProcessTableDelta createFromParcel(Parcel in) {
+                return new ProcessTableDelta(in);
+            }
+
+            public ProcessTableDelta[] newArray(int size) {
+                return new ProcessTableDelta[size];
+            }
+        };
+
+    /** Generation of the table once the changes are applied. */
+    public final long generation;
+    /** If true, {@link #added} is the whole table and anything known before must be dropped. */
+    public final boolean fullSnapshot;
+    /** Processes that showed up or changed owner. */
+    public final List<ProcessInfo> added;
+    /** Pids of the processes that went away. */
+    public final int[] removed;
+
+    public ProcessTableDelta(long generation, boolean fullSnapshot, List<ProcessInfo> added,
+            int[] removed) {
+        this.generation = generation;
+        this.fullSnapshot = fullSnapshot;
+        this.added = added;
+        this.removed = removed;
+    }
+
+    public ProcessTableDelta(Parcel in) {
+        this.generation = in.readLong();
+        this.fullSnapshot = in.readInt() != 0;
+        this.added = in.createTypedArrayList(ProcessInfo.CREATOR);
+        this.removed = in.createIntArray();
+    }
+
+    @Override
+    public int describeContents() {
+        return 0;
+    }
+
+    @Override
+    public void writeToParcel(Parcel dest, int flags) {
+        dest.writeLong(generation);
+        dest.writeInt(fullSnapshot ? 1 : 0);
+        dest.writeTypedList(added);
+        dest.writeIntArray(removed);
+    }
+
+    @Override
+    public String toString() {
+        return String.format("generation = %d, fullSnapshot = %b, added = %d, removed = %d",
+                generation, fullSnapshot, added.size(), removed.length);
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.android.car.procfsinspector;
+
+import android.util.SparseArray;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
+
+/**
+ * Keeps a copy of the process table up to date by asking procfs-inspector only for what
+ * changed since the last call.
+ */
+public final class ProcessTableTracker {
+    private final Object mLock = new Object();
+
+    // Both guarded by mLock.
+    private final SparseArray<ProcessInfo> mProcesses = new SparseArray<>();
+    private long mGeneration;
+
+    /**
+     * Returns the current process table, ordered by pid, or an empty list if procfs-inspector
+     * cannot be reached.
+     */
+    public List<ProcessInfo> getProcessTable() {
+        synchronized (mLock) {
+            ProcessTableDelta delta = ProcfsInspector.readProcessTableChanges(mGeneration);
+            if (delta == null) {
+                mProcesses.clear();
+                mGeneration = 0;
+                return Collections.emptyList();
+            }
+            if (delta.fullSnapshot) {
+                mProcesses.clear();
+            }
+            for (int pid : delta.removed) {
+                mProcesses.remove(pid);
+            }
+            for (ProcessInfo process : delta.added) {
+                mProcesses.put(process.pid, process);
+            }
+            mGeneration = delta.generation;
+
+            List<ProcessInfo> processes = new ArrayList<>(mProcesses.size());
+            for (int i = 0; i < mProcesses.size(); i++) {
+                processes.add(mProcesses.valueAt(i));
+            }
+            return processes;
+        }
+    }
+}
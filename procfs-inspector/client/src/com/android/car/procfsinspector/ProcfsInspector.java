@@ -51,4 +51,22 @@ public final class ProcfsInspector {
 
         return Collections.emptyList();
     }
+
+    /**
+     * Returns what changed in the process table since the given generation, or null if the
+     * service cannot be reached.
+     */
+    @Nullable
+    public static ProcessTableDelta readProcessTableChanges(long generation) {
+        IProcfsInspector procfsInspector = tryGet();
+        if (procfsInspector != null) {
+            try {
+                return procfsInspector.readProcessTableChanges(generation);
+            } catch (RemoteException e) {
+                Log.w(TAG, "caught RemoteException", e);
+            }
+        }
+
+        return null;
+    }
 }
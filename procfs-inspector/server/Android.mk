@@ -23,8 +23,12 @@ LOCAL_SRC_FILES := \
     server.cpp \
     impl.cpp \
     process.cpp \
+    process_table.cpp \
     directory.cpp
 
+LOCAL_STATIC_LIBRARIES := \
+    libprocfsinspector_dirscanner
+
 LOCAL_SHARED_LIBRARIES := \
     libbinder \
     liblog \
@@ -56,10 +56,10 @@ uid_t procfsinspector::Directory::Entry::getOwnerUserId() {
 
 procfsinspector::Directory::Entry procfsinspector::Directory::next(unsigned char type) {
     if (auto dir = mDirectory.get()) {
-        dirent *entry = readdir(dir);
-        if (entry) {
+        while (dirent *entry = readdir(dir)) {
             // only return entries of the right type (regular file, directory, ...)
             // but always return UNKNOWN entries as it is an allowed wildcard entry
+            // skipped entries must not end the iteration, which an empty Entry does
             if (entry->d_type == DT_UNKNOWN ||
                 type == DT_UNKNOWN ||
                 entry->d_type == type) {
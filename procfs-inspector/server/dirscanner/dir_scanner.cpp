@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dir_scanner.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Called directly, as not every libc has a wrapper for it.
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Longer names could overflow, and are not pids anyway.
+static constexpr size_t kMaxDigits = 18;
+
+static int64_t asNumber(const char* s) {
+    int64_t v = 0;
+    size_t digits = 0;
+    for (; *s; ++s, ++digits) {
+        if (*s < '0' || *s > '9' || digits == kMaxDigits) {
+            return -1;
+        }
+        v = v * 10 + (*s - '0');
+    }
+    return digits ? v : -1;
+}
+
+constexpr size_t procfsinspector::DirScanner::kBufferSize;
+
+procfsinspector::DirScanner::DirScanner(const char* path) {
+    open(path);
+}
+
+procfsinspector::DirScanner::~DirScanner() {
+    if (mFd != -1) ::close(mFd);
+}
+
+bool procfsinspector::DirScanner::open(const char* path) {
+    if (mFd != -1) {
+        ::close(mFd);
+    }
+    mFd = TEMP_FAILURE_RETRY(::open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    mSize = mOffset = 0;
+    mEnd = false;
+    mError = mFd == -1;
+    if (mFd != -1 && !mBuffer) {
+        mBuffer.reset(new char[kBufferSize]);
+    }
+    return mFd != -1;
+}
+
+bool procfsinspector::DirScanner::rewind() {
+    mSize = mOffset = 0;
+    mEnd = false;
+    mError = mFd == -1 || lseek(mFd, 0, SEEK_SET) == -1;
+    return !mError;
+}
+
+bool procfsinspector::DirScanner::fill() {
+    if (mEnd || mError) {
+        return false;
+    }
+    if (mFd == -1) {
+        errno = EBADF;
+        mError = true;
+        return false;
+    }
+    long size = syscall(SYS_getdents64, mFd, mBuffer.get(), kBufferSize);
+    if (size <= 0) {
+        mEnd = true;
+        mError = size < 0;
+        return false;
+    }
+    mSize = size;
+    mOffset = 0;
+    return true;
+}
+
+bool procfsinspector::DirScanner::next(Entry* entry, unsigned char type) {
+    while (mOffset < mSize || fill()) {
+        auto child = reinterpret_cast<const linux_dirent64*>(mBuffer.get() + mOffset);
+        mOffset += child->d_reclen;
+
+        // only return entries of the right type (regular file, directory, ...)
+        // but always return UNKNOWN entries as it is an allowed wildcard entry
+        if (child->d_type == DT_UNKNOWN || type == DT_UNKNOWN || child->d_type == type) {
+            *entry = Entry{static_cast<ino_t>(child->d_ino), child->d_type, child->d_name,
+                           asNumber(child->d_name)};
+            return true;
+        }
+    }
+    return false;
+}
+
+bool procfsinspector::DirScanner::nextNumbered(Entry* entry, unsigned char type) {
+    while (next(entry, type)) {
+        if (entry->number >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
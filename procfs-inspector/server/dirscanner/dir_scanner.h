@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAR_PROCFS_DIR_SCANNER
+#define CAR_PROCFS_DIR_SCANNER
+
+#include <dirent.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <memory>
+
+namespace procfsinspector {
+
+// Reads a directory with getdents64(), many entries per call, into a buffer that is reused
+// across calls and rewinds. Entries point into that buffer, so scanning does not allocate;
+// this matters for directories like /proc that are read over and over.
+class DirScanner {
+public:
+    struct Entry {
+        ino_t inode;
+        unsigned char type;
+        // Valid until the next call on the scanner.
+        const char* name;
+        // The name as a decimal number, or -1 if it is not one.
+        int64_t number;
+    };
+
+    DirScanner() = default;
+    explicit DirScanner(const char* path);
+    ~DirScanner();
+
+    DirScanner(const DirScanner&) = delete;
+    DirScanner& operator=(const DirScanner&) = delete;
+
+    // Opens |path|, closing whatever was open. Returns false and sets errno on failure.
+    bool open(const char* path);
+    bool isOpen() const { return mFd != -1; }
+    // For looking entries up with the *at() calls.
+    int fd() const { return mFd; }
+
+    // Starts over from the first entry. Returns false and sets errno on failure.
+    bool rewind();
+
+    // Stores the next entry of the given type in |entry|. Entries of unknown type are returned
+    // for any type, since not every file system reports it. Returns false at the end of the
+    // directory, or on error, in which case errno is set and error() returns true.
+    bool next(Entry* entry, unsigned char type = DT_UNKNOWN);
+
+    // Like next(), but skips entries whose name is not a number, e.g. "self" in /proc.
+    bool nextNumbered(Entry* entry, unsigned char type = DT_UNKNOWN);
+
+    bool error() const { return mError; }
+
+    static constexpr size_t kBufferSize = 32 * 1024;
+
+private:
+    bool fill();
+
+    int mFd = -1;
+    std::unique_ptr<char[]> mBuffer;
+    size_t mSize = 0;
+    size_t mOffset = 0;
+    bool mEnd = false;
+    bool mError = false;
+};
+
+}
+
+#endif // CAR_PROCFS_DIR_SCANNER
@@ -14,35 +14,19 @@
  * limitations under the License.
  */
 
-#include "directory.h"
 #include "server.h"
 
-template<typename IntTy>
-static bool asNumber(const std::string& s, IntTy *value) {
-    IntTy v = 0;
-    for (auto&& c : s) {
-        if (c < '0' || c > '9') {
-            return false;
-        } else {
-            v = v * 10 + (c - '0');
-        }
-    }
-
-    if (value) *value = v;
-
-    return true;
-}
-
 std::vector<procfsinspector::ProcessInfo> procfsinspector::Impl::readProcessTable() {
-    std::vector<procfsinspector::ProcessInfo> processes;
-
-    Directory dir("/proc");
-    while (auto entry = dir.next()) {
-        pid_t pid;
-        if (asNumber(entry.getChild(), &pid)) {
-            processes.push_back(ProcessInfo{pid, entry.getOwnerUserId()});
-        }
+    auto snapshot = mProcessTable.get();
+    std::vector<ProcessInfo> processes;
+    processes.reserve(snapshot->size());
+    for (auto&& process : *snapshot) {
+        processes.push_back(ProcessInfo{process.pid, process.uid});
     }
-
     return processes;
 }
+
+procfsinspector::ProcessTable::Changes procfsinspector::Impl::readProcessTableChanges(
+        uint64_t generation) {
+    return mProcessTable.getChangesSince(generation);
+}
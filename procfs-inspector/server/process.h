@@ -26,8 +26,8 @@ using namespace android;
 namespace procfsinspector {
     class ProcessInfo : public Parcelable {
     public:
-        pid_t getPid() { return mPid; }
-        uid_t getUid() { return mUid; }
+        pid_t getPid() const { return mPid; }
+        uid_t getUid() const { return mUid; }
 
         // default initialize to invalid values
         ProcessInfo(pid_t pid = -1, uid_t uid = -1) : mPid(pid), mUid(uid) {}
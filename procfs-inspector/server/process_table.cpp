@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "com.android.car.procfsinspector"
+
+#include "process_table.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <random>
+
+#include <private/android_filesystem_config.h>
+#include <utils/Log.h>
+
+constexpr std::chrono::milliseconds procfsinspector::ProcessTable::kDefaultMaxStaleness;
+constexpr std::chrono::seconds procfsinspector::ProcessTable::kRevalidateInterval;
+constexpr size_t procfsinspector::ProcessTable::kHistorySize;
+
+// Kept to 31 bits, so that generations stay positive in Java.
+static uint64_t makeEpoch() {
+    std::random_device random;
+    return static_cast<uint64_t>(random() & 0x7fffffff) << 32;
+}
+
+procfsinspector::ProcessTable::ProcessTable(const char* procPath,
+                                            std::chrono::milliseconds maxStaleness) :
+    mPath(procPath), mMaxStaleness(maxStaleness), mEpoch(makeEpoch()),
+    mSnapshot(std::make_shared<std::vector<Process>>()), mGeneration(mEpoch | 1) {}
+
+procfsinspector::ProcessTable::Snapshot procfsinspector::ProcessTable::get(uint64_t* generation) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    updateLocked();
+    if (generation) *generation = mGeneration;
+    return mSnapshot;
+}
+
+procfsinspector::ProcessTable::Changes procfsinspector::ProcessTable::getChangesSince(
+        uint64_t generation) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    updateLocked();
+    Changes changes;
+    changes.generation = mGeneration;
+    if (generation == mGeneration) {
+        return changes;
+    }
+
+    // Generations within an epoch go up by one, so the history covers |generation| if it
+    // still holds the change made right after it.
+    bool known = (generation & ~0xffffffffULL) == mEpoch && generation < mGeneration &&
+            !mHistory.empty() && mHistory.front().generation <= generation + 1;
+    std::vector<pid_t> pids;
+    if (known) {
+        for (auto it = mHistory.rbegin(); it != mHistory.rend() && it->generation > generation;
+             ++it) {
+            pids.insert(pids.end(), it->pids.begin(), it->pids.end());
+        }
+        std::sort(pids.begin(), pids.end());
+        pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+    }
+    if (!known || pids.size() >= mSnapshot->size()) {
+        changes.fullSnapshot = true;
+        changes.added = *mSnapshot;
+        return changes;
+    }
+
+    for (pid_t pid : pids) {
+        auto it = mEntries.find(pid);
+        if (it == mEntries.end()) {
+            changes.removed.push_back(pid);
+        } else {
+            changes.added.push_back(Process{pid, it->second.uid});
+        }
+    }
+    return changes;
+}
+
+void procfsinspector::ProcessTable::updateLocked() {
+    const auto now = Clock::now();
+    if (mScan != 0 && now - mLastScanTime < mMaxStaleness) {
+        return;
+    }
+
+    std::vector<pid_t> pids;
+    refreshLocked(now, &pids);
+    mLastScanTime = now;
+    if (pids.empty()) {
+        return;
+    }
+
+    auto processes = std::make_shared<std::vector<Process>>();
+    processes->reserve(mEntries.size());
+    for (auto&& entry : mEntries) {
+        processes->push_back(Process{entry.first, entry.second.uid});
+    }
+    mSnapshot = std::move(processes);
+
+    ++mGeneration;
+    if (mHistory.size() == kHistorySize) {
+        mHistory.pop_front();
+    }
+    mHistory.push_back(Change{mGeneration, std::move(pids)});
+}
+
+void procfsinspector::ProcessTable::refreshLocked(Clock::time_point now,
+                                                  std::vector<pid_t>* pids) {
+    if (!mDirectory.isOpen() || !mDirectory.rewind()) {
+        if (!mDirectory.open(mPath.c_str())) {
+            ALOGE("failed to open %s: %s", mPath.c_str(), strerror(errno));
+            for (auto&& entry : mEntries) {
+                pids->push_back(entry.first);
+            }
+            mEntries.clear();
+            return;
+        }
+    }
+
+    const int dirFd = mDirectory.fd();
+    const uint32_t scan = ++mScan;
+    DirScanner::Entry child;
+    while (mDirectory.nextNumbered(&child)) {
+        const pid_t pid = child.number;
+        auto it = mEntries.find(pid);
+        if (it != mEntries.end() && it->second.inode == child.inode &&
+            it->second.uid != AID_ROOT && now - it->second.lookupTime < kRevalidateInterval) {
+            it->second.lastScan = scan;
+            continue;
+        }
+
+        struct stat buf;
+        // record an invalid UID if the process went away in the meantime, like before
+        uid_t uid = fstatat(dirFd, child.name, &buf, 0) ? -1 : buf.st_uid;
+        if (it == mEntries.end()) {
+            mEntries.emplace(pid, Entry{child.inode, uid, now, scan});
+            pids->push_back(pid);
+        } else {
+            if (it->second.uid != uid) {
+                pids->push_back(pid);
+            }
+            it->second = Entry{child.inode, uid, now, scan};
+        }
+    }
+    if (mDirectory.error()) {
+        // Entries not reached yet would be taken for gone; leave them for the next scan.
+        ALOGE("failed to read %s: %s", mPath.c_str(), strerror(errno));
+        mDirectory.open(mPath.c_str());
+        return;
+    }
+
+    for (auto it = mEntries.begin(); it != mEntries.end();) {
+        if (it->second.lastScan != scan) {
+            pids->push_back(it->first);
+            it = mEntries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAR_PROCFS_PROCESS_TABLE
+#define CAR_PROCFS_PROCESS_TABLE
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dir_scanner.h"
+
+namespace procfsinspector {
+
+// The process table read from /proc, kept between calls and refreshed incrementally.
+//
+// The owner of /proc/<pid> is only looked up for processes the table has not seen before. The
+// kernel gives each process its own inode under /proc, so a pid reused by a new process comes
+// back from the directory with a different inode number, which plays the part of the start time.
+// A process can still change owner while it runs: forked by zygote, or while it is not
+// dumpable, it is owned by root before settling on its own uid. So root-owned entries are
+// looked up every time, and all others again after kRevalidateInterval.
+//
+// Each change of the table bumps its generation. The pids touched by the last kHistorySize
+// changes are kept, so that a client can be told only what changed since the generation it
+// last saw.
+class ProcessTable {
+public:
+    struct Process {
+        pid_t pid;
+        uid_t uid;
+    };
+
+    using Snapshot = std::shared_ptr<const std::vector<Process>>;
+
+    struct Changes {
+        uint64_t generation = 0;
+        // If set, |added| is the whole table and the client must drop what it had.
+        bool fullSnapshot = false;
+        // Processes that showed up or changed owner, ordered by pid.
+        std::vector<Process> added;
+        // Processes that went away, ordered by pid. May name processes that came and went
+        // without the client ever seeing them.
+        std::vector<pid_t> removed;
+    };
+
+    // Calls within |maxStaleness| of the last scan of |procPath| reuse its result.
+    ProcessTable(const char* procPath = "/proc",
+                 std::chrono::milliseconds maxStaleness = kDefaultMaxStaleness);
+
+    // Returns the current process table, and stores its generation in |generation| if given.
+    // The same snapshot is returned for as long as nothing changes.
+    Snapshot get(uint64_t* generation = nullptr);
+
+    // Returns what changed since |generation|. The whole table is returned instead if that
+    // generation is no longer in the history, was not handed out by this table (e.g. 0, or
+    // one from before a restart), or if the changes would not be any smaller.
+    Changes getChangesSince(uint64_t generation);
+
+    static constexpr std::chrono::milliseconds kDefaultMaxStaleness{500};
+    static constexpr std::chrono::seconds kRevalidateInterval{10};
+    static constexpr size_t kHistorySize = 32;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        ino_t inode;
+        uid_t uid;
+        Clock::time_point lookupTime;
+        uint32_t lastScan;
+    };
+
+    struct Change {
+        uint64_t generation;
+        std::vector<pid_t> pids;
+    };
+
+    void updateLocked();
+    // Adds the pids of the processes that showed up, went away or changed owner to |pids|.
+    void refreshLocked(Clock::time_point now, std::vector<pid_t>* pids);
+
+    const std::string mPath;
+    const std::chrono::milliseconds mMaxStaleness;
+    // The top half of every generation, so that one from another instance is not taken for ours.
+    const uint64_t mEpoch;
+
+    std::mutex mLock;
+    // Held open, so that entries are looked up relative to it.
+    DirScanner mDirectory;
+    // Ordered by pid, like /proc itself.
+    std::map<pid_t, Entry> mEntries;
+    uint32_t mScan = 0;
+    Clock::time_point mLastScanTime;
+    Snapshot mSnapshot;
+    uint64_t mGeneration;
+    // The most recent changes, oldest first.
+    std::deque<Change> mHistory;
+};
+
+}
+
+#endif // CAR_PROCFS_PROCESS_TABLE
@@ -35,6 +35,26 @@ static bool isSystemUser() {
     return false;
 }
 
+// Writes |processes| the way writeParcelableVector() writes the matching ProcessInfo objects.
+static void writeProcesses(Parcel* parcel,
+                           const std::vector<procfsinspector::ProcessTable::Process>& processes) {
+    parcel->writeInt32(processes.size());
+    for (auto&& process : processes) {
+        parcel->writeInt32(1);
+        parcel->writeUint32(process.pid);
+        parcel->writeUint32(process.uid);
+    }
+}
+
+// Laid out as the ProcessTableDelta parcelable of the client library.
+static void writeChanges(Parcel* parcel, const procfsinspector::ProcessTable::Changes& changes) {
+    parcel->writeInt32(1);
+    parcel->writeInt64(changes.generation);
+    parcel->writeInt32(changes.fullSnapshot ? 1 : 0);
+    writeProcesses(parcel, changes.added);
+    parcel->writeInt32Vector(changes.removed);
+}
+
 namespace procfsinspector {
 class BpProcfsInspector: public BpInterface<IProcfsInspector> {
     public:
@@ -49,6 +69,27 @@ class BpProcfsInspector: public BpInterface<IProcfsInspector> {
             return result;
         }
 
+        virtual ProcessTable::Changes readProcessTableChanges(uint64_t generation) override {
+            Parcel data, reply;
+            data.writeInterfaceToken(IProcfsInspector::getInterfaceDescriptor());
+            data.writeInt64(generation);
+            remote()->transact((uint32_t)IProcfsInspector::Call::READ_PROCESS_TABLE_CHANGES,
+                               data, &reply);
+
+            ProcessTable::Changes changes;
+            if (reply.readExceptionCode() != 0 || reply.readInt32() == 0) {
+                return changes;
+            }
+            changes.generation = reply.readInt64();
+            changes.fullSnapshot = reply.readInt32() != 0;
+            std::vector<ProcessInfo> added;
+            reply.readParcelableVector(&added);
+            for (auto&& process : added) {
+                changes.added.push_back(ProcessTable::Process{process.getPid(), process.getUid()});
+            }
+            reply.readInt32Vector(&changes.removed);
+            return changes;
+        }
 };
 
 IMPLEMENT_META_INTERFACE(ProcfsInspector, "com.android.car.procfsinspector.IProcfsInspector");
@@ -60,7 +101,20 @@ status_t Impl::onTransact(uint32_t code,
         CHECK_INTERFACE(IProcfsInspector, data, reply);
         if (isSystemUser()) {
             reply->writeNoException();
-            reply->writeParcelableVector(readProcessTable());
+            // Written straight from the cached table, without copying it.
+            writeProcesses(reply, *mProcessTable.get());
+            return NO_ERROR;
+        } else {
+            return PERMISSION_DENIED;
+        }
+    }
+
+    if (code == (uint32_t)IProcfsInspector::Call::READ_PROCESS_TABLE_CHANGES) {
+        CHECK_INTERFACE(IProcfsInspector, data, reply);
+        if (isSystemUser()) {
+            uint64_t generation = data.readInt64();
+            reply->writeNoException();
+            writeChanges(reply, mProcessTable.getChangesSince(generation));
             return NO_ERROR;
         } else {
             return PERMISSION_DENIED;
@@ -33,6 +33,7 @@
 #include <utils/String16.h>
 
 #include "process.h"
+#include "process_table.h"
 
 using namespace android;
 
@@ -43,10 +44,13 @@ namespace procfsinspector {
 
         enum class Call : uint32_t {
             READ_PROCESS_TABLE = IBinder::FIRST_CALL_TRANSACTION,
+            READ_PROCESS_TABLE_CHANGES,
         };
 
         // API declarations start here
         virtual std::vector<ProcessInfo> readProcessTable() = 0;
+        // Returns what changed since the table of the given generation.
+        virtual ProcessTable::Changes readProcessTableChanges(uint64_t generation) = 0;
     };
 
     class Impl : public BnInterface<IProcfsInspector> {
@@ -56,6 +60,11 @@ namespace procfsinspector {
             Parcel *reply,
             uint32_t flags) override;
         virtual std::vector<ProcessInfo> readProcessTable() override;
+        virtual ProcessTable::Changes readProcessTableChanges(uint64_t generation) override;
+
+    private:
+        // Shared by all binder threads.
+        ProcessTable mProcessTable;
     };
 }
 
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dir_scanner.h"
+#include "directory.h"
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace procfsinspector {
+
+namespace {
+
+// A directory laid out like /proc, with |count| numbered directories and a few others.
+class FakeProc {
+public:
+    explicit FakeProc(int count) : mCount(count) {
+        for (int i = 1; i <= mCount; i++) {
+            mkdir(path(std::to_string(i)).c_str(), 0755);
+        }
+        for (const char* name : {"self", "thread-self", "sys", "net"}) {
+            mkdir(path(name).c_str(), 0755);
+        }
+    }
+
+    ~FakeProc() {
+        for (int i = 1; i <= mCount; i++) {
+            rmdir(path(std::to_string(i)).c_str());
+        }
+        for (const char* name : {"self", "thread-self", "sys", "net"}) {
+            rmdir(path(name).c_str());
+        }
+    }
+
+    const char* root() const { return mDir.path; }
+
+private:
+    std::string path(const std::string& name) { return std::string(mDir.path) + "/" + name; }
+
+    TemporaryDir mDir;
+    const int mCount;
+};
+
+// Benchmark arguments: {entries}
+void applyArguments(benchmark::internal::Benchmark* b) {
+    for (int entries : {1000, 10000, 50000}) {
+        b->Arg(entries);
+    }
+    b->ArgNames({"entries"});
+}
+
+// How ProcessTable read /proc before: a fresh Directory and a string per entry.
+void BM_Directory(benchmark::State& state) {
+    FakeProc proc(state.range(0));
+    int64_t found = 0;
+    for (auto _ : state) {
+        Directory dir(proc.root());
+        while (auto entry = dir.next(DT_DIR)) {
+            found += atoi(entry.getChild().c_str()) > 0;
+        }
+    }
+    benchmark::DoNotOptimize(found);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_DirScanner(benchmark::State& state) {
+    FakeProc proc(state.range(0));
+    DirScanner scanner(proc.root());
+    int64_t found = 0;
+    for (auto _ : state) {
+        scanner.rewind();
+        DirScanner::Entry entry;
+        while (scanner.nextNumbered(&entry, DT_DIR)) {
+            found++;
+        }
+    }
+    benchmark::DoNotOptimize(found);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_Directory)->Apply(applyArguments);
+BENCHMARK(BM_DirScanner)->Apply(applyArguments);
+
+}  // namespace
+
+}  // namespace procfsinspector
+
+BENCHMARK_MAIN();
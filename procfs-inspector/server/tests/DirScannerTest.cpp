@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dir_scanner.h"
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <set>
+#include <string>
+
+namespace procfsinspector {
+
+namespace {
+
+// More than fit in one buffer.
+constexpr int kEntryCount = 5000;
+
+class DirScannerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        for (int i = 0; i < kEntryCount; i++) {
+            ASSERT_EQ(0, mkdir(path(std::to_string(i)).c_str(), 0755));
+        }
+        ASSERT_EQ(0, mkdir(path("self").c_str(), 0755));
+        ASSERT_EQ(0, mkdir(path("12x").c_str(), 0755));
+        // Files interleaved with the directories, to be skipped by type.
+        for (int i = 0; i < kEntryCount; i += 10) {
+            ASSERT_TRUE(android::base::WriteStringToFile("", path("file" + std::to_string(i))));
+        }
+    }
+
+    void TearDown() override {
+        DirScanner scanner(mDir.path);
+        DirScanner::Entry entry;
+        while (scanner.next(&entry)) {
+            std::string name = entry.name;
+            if (name != "." && name != "..") {
+                (entry.type == DT_DIR ? rmdir : unlink)(path(name).c_str());
+            }
+        }
+    }
+
+    std::string path(const std::string& name) { return std::string(mDir.path) + "/" + name; }
+
+    TemporaryDir mDir;
+};
+
+}  // namespace
+
+TEST_F(DirScannerTest, ReturnsAllEntries) {
+    DirScanner scanner(mDir.path);
+    ASSERT_TRUE(scanner.isOpen());
+
+    std::set<std::string> names;
+    DirScanner::Entry entry;
+    while (scanner.next(&entry)) {
+        EXPECT_TRUE(names.insert(entry.name).second) << entry.name;
+    }
+    EXPECT_FALSE(scanner.error());
+    // ".", "..", the numbers, "self", "12x" and the files.
+    EXPECT_EQ(2u + kEntryCount + 2 + kEntryCount / 10, names.size());
+}
+
+TEST_F(DirScannerTest, SkipsEntriesOfOtherTypes) {
+    DirScanner scanner(mDir.path);
+    size_t files = 0;
+    DirScanner::Entry entry;
+    while (scanner.next(&entry, DT_REG)) {
+        EXPECT_EQ(0, strncmp(entry.name, "file", 4)) << entry.name;
+        files++;
+    }
+    EXPECT_EQ(static_cast<size_t>(kEntryCount / 10), files);
+}
+
+TEST_F(DirScannerTest, ParsesNumberedEntries) {
+    DirScanner scanner(mDir.path);
+    std::set<int64_t> numbers;
+    DirScanner::Entry entry;
+    while (scanner.nextNumbered(&entry, DT_DIR)) {
+        EXPECT_EQ(std::to_string(entry.number), entry.name);
+        numbers.insert(entry.number);
+    }
+    ASSERT_EQ(static_cast<size_t>(kEntryCount), numbers.size());
+    EXPECT_EQ(0, *numbers.begin());
+    EXPECT_EQ(kEntryCount - 1, *numbers.rbegin());
+}
+
+TEST_F(DirScannerTest, RewindStartsOver) {
+    DirScanner scanner(mDir.path);
+    DirScanner::Entry entry;
+    size_t first = 0;
+    while (scanner.nextNumbered(&entry)) {
+        first++;
+    }
+    ASSERT_TRUE(scanner.rewind());
+    ASSERT_EQ(0, rmdir(path("0").c_str()));
+    size_t second = 0;
+    while (scanner.nextNumbered(&entry)) {
+        second++;
+    }
+    EXPECT_EQ(first - 1, second);
+}
+
+TEST(DirScannerErrorTest, MissingDirectory) {
+    DirScanner scanner("/nonexistent/directory");
+    EXPECT_FALSE(scanner.isOpen());
+    EXPECT_TRUE(scanner.error());
+    DirScanner::Entry entry;
+    EXPECT_FALSE(scanner.next(&entry));
+}
+
+}  // namespace procfsinspector
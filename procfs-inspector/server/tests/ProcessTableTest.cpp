@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "process_table.h"
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+
+namespace procfsinspector {
+
+namespace {
+
+using std::chrono::steady_clock;
+
+// Large enough for the cost of the whole table to show.
+constexpr pid_t kProcessCount = 20000;
+// Processes started and stopped between two reads.
+constexpr pid_t kChurn = 50;
+
+using Table = std::map<pid_t, uid_t>;
+
+// Bytes a reply takes on binder, laid out as server.cpp writes it.
+size_t fullPayloadSize(size_t processes) {
+    return 4 + 4 + 12 * processes;
+}
+
+size_t deltaPayloadSize(const ProcessTable::Changes& changes) {
+    return 4 + 4 + 8 + 4 + 4 + 12 * changes.added.size() + 4 + 4 * changes.removed.size();
+}
+
+double microsSince(steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(
+            steady_clock::now() - start).count();
+}
+
+class ProcessTableTest : public ::testing::Test {
+protected:
+    void addProcess(pid_t pid) {
+        ASSERT_EQ(0, mkdir(path(pid).c_str(), 0755)) << path(pid);
+    }
+
+    void removeProcess(pid_t pid) {
+        ASSERT_EQ(0, rmdir(path(pid).c_str())) << path(pid);
+    }
+
+    void SetUp() override {
+        for (pid_t pid = 1; pid <= kProcessCount; pid++) {
+            addProcess(pid);
+        }
+        // Entries that are not processes are skipped.
+        ASSERT_EQ(0, mkdir((std::string(mProc.path) + "/self").c_str(), 0755));
+        ASSERT_TRUE(android::base::WriteStringToFile("", std::string(mProc.path) + "/meminfo"));
+    }
+
+    void TearDown() override {
+        // TemporaryDir only removes an empty directory.
+        for (auto&& entry : scan()) {
+            rmdir(path(entry.first).c_str());
+        }
+        rmdir((std::string(mProc.path) + "/self").c_str());
+        unlink((std::string(mProc.path) + "/meminfo").c_str());
+    }
+
+    // Stops the first |count| processes and starts as many new ones after the last.
+    void churn(pid_t count) {
+        for (pid_t i = 0; i < count; i++) {
+            removeProcess(mFirst++);
+            addProcess(++mLast);
+        }
+    }
+
+    Table scan() {
+        Table table;
+        for (pid_t pid = mFirst; pid <= mLast; pid++) {
+            table[pid] = getuid();
+        }
+        return table;
+    }
+
+    std::string path(pid_t pid) { return std::string(mProc.path) + "/" + std::to_string(pid); }
+
+    static void apply(const ProcessTable::Changes& changes, Table* table) {
+        if (changes.fullSnapshot) {
+            table->clear();
+        }
+        for (pid_t pid : changes.removed) {
+            table->erase(pid);
+        }
+        for (auto&& process : changes.added) {
+            (*table)[process.pid] = process.uid;
+        }
+    }
+
+    TemporaryDir mProc;
+    pid_t mFirst = 1;
+    pid_t mLast = kProcessCount;
+};
+
+}  // namespace
+
+TEST_F(ProcessTableTest, ReadsAllProcesses) {
+    ProcessTable processTable(mProc.path, std::chrono::milliseconds(0));
+    auto snapshot = processTable.get();
+
+    Table table;
+    for (auto&& process : *snapshot) {
+        table[process.pid] = process.uid;
+    }
+    EXPECT_EQ(scan(), table);
+}
+
+TEST_F(ProcessTableTest, ReturnsSameSnapshotWhileUnchanged) {
+    ProcessTable processTable(mProc.path, std::chrono::milliseconds(0));
+    uint64_t generation1, generation2;
+    auto snapshot1 = processTable.get(&generation1);
+    auto snapshot2 = processTable.get(&generation2);
+
+    EXPECT_EQ(snapshot1, snapshot2);
+    EXPECT_EQ(generation1, generation2);
+
+    auto changes = processTable.getChangesSince(generation2);
+    EXPECT_FALSE(changes.fullSnapshot);
+    EXPECT_EQ(generation2, changes.generation);
+    EXPECT_TRUE(changes.added.empty());
+    EXPECT_TRUE(changes.removed.empty());
+}
+
+TEST_F(ProcessTableTest, UnknownGenerationGetsFullSnapshot) {
+    ProcessTable processTable(mProc.path, std::chrono::milliseconds(0));
+    ProcessTable otherTable(mProc.path, std::chrono::milliseconds(0));
+    uint64_t otherGeneration;
+    otherTable.get(&otherGeneration);
+
+    for (uint64_t generation : {uint64_t{0}, otherGeneration, UINT64_MAX}) {
+        auto changes = processTable.getChangesSince(generation);
+        EXPECT_TRUE(changes.fullSnapshot) << generation;
+        EXPECT_TRUE(changes.removed.empty());
+
+        Table table;
+        apply(changes, &table);
+        EXPECT_EQ(scan(), table);
+    }
+}
+
+TEST_F(ProcessTableTest, DeltasFollowChanges) {
+    ProcessTable processTable(mProc.path, std::chrono::milliseconds(0));
+    Table table;
+    auto changes = processTable.getChangesSince(0);
+    apply(changes, &table);
+    uint64_t generation = changes.generation;
+
+    // Several changes between two reads are merged.
+    for (int round = 0; round < 3; round++) {
+        churn(kChurn);
+        processTable.get();
+    }
+    changes = processTable.getChangesSince(generation);
+    EXPECT_FALSE(changes.fullSnapshot);
+    EXPECT_EQ(3u * kChurn, changes.added.size());
+    EXPECT_EQ(3u * kChurn, changes.removed.size());
+    apply(changes, &table);
+    EXPECT_EQ(scan(), table);
+    generation = changes.generation;
+
+    churn(kChurn);
+    changes = processTable.getChangesSince(generation);
+    EXPECT_FALSE(changes.fullSnapshot);
+    apply(changes, &table);
+    EXPECT_EQ(scan(), table);
+}
+
+TEST_F(ProcessTableTest, ExhaustedHistoryGetsFullSnapshot) {
+    ProcessTable processTable(mProc.path, std::chrono::milliseconds(0));
+    uint64_t generation;
+    processTable.get(&generation);
+
+    for (size_t round = 0; round <= ProcessTable::kHistorySize; round++) {
+        churn(1);
+        processTable.get();
+    }
+    auto changes = processTable.getChangesSince(generation);
+    EXPECT_TRUE(changes.fullSnapshot);
+
+    Table table;
+    apply(changes, &table);
+    EXPECT_EQ(scan(), table);
+}
+
+TEST_F(ProcessTableTest, DeltaIsSmallerThanFullTable) {
+    ProcessTable processTable(mProc.path, std::chrono::milliseconds(0));
+    uint64_t generation;
+    processTable.get(&generation);
+    churn(kChurn);
+    processTable.get();
+
+    // Every call rescans the tree, so the difference is what building the reply costs.
+    constexpr int kRounds = 20;
+    ProcessTable::Changes full, changes;
+    double fullMicros = 0, deltaMicros = 0;
+    for (int round = 0; round < kRounds; round++) {
+        auto start = steady_clock::now();
+        full = processTable.getChangesSince(0);
+        fullMicros += microsSince(start);
+
+        start = steady_clock::now();
+        changes = processTable.getChangesSince(generation);
+        deltaMicros += microsSince(start);
+    }
+
+    ASSERT_TRUE(full.fullSnapshot);
+    ASSERT_FALSE(changes.fullSnapshot);
+    const size_t fullBytes = fullPayloadSize(full.added.size());
+    const size_t deltaBytes = deltaPayloadSize(changes);
+    printf("%d processes, %d replaced: full table %zu bytes in %.1fus, delta %zu bytes in "
+           "%.1fus\n", kProcessCount, kChurn, fullBytes, fullMicros / kRounds, deltaBytes,
+           deltaMicros / kRounds);
+    EXPECT_LT(deltaBytes * 10, fullBytes);
+}
+
+}  // namespace procfsinspector
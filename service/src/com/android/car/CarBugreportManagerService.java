@@ -51,6 +51,8 @@ import java.io.InputStream;
 import java.io.InputStreamReader;
 import java.io.OutputStream;
 import java.io.PrintWriter;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.FutureTask;
 import java.util.concurrent.atomic.AtomicBoolean;
 
 /**
@@ -71,6 +73,12 @@ public class CarBugreportManagerService extends ICarBugreportService.Stub implem
     private static final String OK_PREFIX = "OK:";
     private static final String FAIL_PREFIX = "FAIL:";
 
+    /**
+     * Added by {@code car-bugreportd} to the {@code dumpstate} progress, as
+     * {@code TIMING:phase:seconds}, before the final line.
+     */
+    private static final String TIMING_PREFIX = "TIMING:";
+
     /**
      * The services are defined in {@code packages/services/Car/car-bugreportd/car-bugreportd.rc}.
      */
@@ -86,6 +94,8 @@ public class CarBugreportManagerService extends ICarBugreportService.Stub implem
     private static final int SOCKET_CONNECTION_MAX_RETRY = 10;
     private static final int SOCKET_CONNECTION_RETRY_DELAY_IN_MS = 5000;
 
+    private static final int NO_ERROR = 0;
+
     private final Context mContext;
     private final Object mLock = new Object();
 
@@ -244,12 +254,38 @@ public class CarBugreportManagerService extends ICarBugreportService.Stub implem
         }
     }
 
+    /**
+     * Starts copying the zipped bugreport on a separate thread, as {@code car-bugreportd} sends it
+     * while {@code dumpstate} is still writing it. The task returns the error to report, if any,
+     * which is only reported if the bugreport itself succeeds.
+     */
+    private FutureTask<Integer> startOutputCopy(ParcelFileDescriptor output) {
+        FutureTask<Integer> outputCopy = new FutureTask<>(
+                () -> copySocketToPfdOrError(output, BUGREPORT_OUTPUT_SOCKET));
+        new Thread(outputCopy, TAG + "-output").start();
+        return outputCopy;
+    }
+
     private void handleFinished(ParcelFileDescriptor output, ParcelFileDescriptor extraOutput,
-            ICarBugreportCallback callback) {
+            ICarBugreportCallback callback, @Nullable FutureTask<Integer> outputCopy) {
         Slog.i(TAG, "Finished reading bugreport");
-        // copysockettopfd calls callback.onError on error
-        if (!copySocketToPfd(output, BUGREPORT_OUTPUT_SOCKET, callback)) {
-            return;
+        if (outputCopy == null) {
+            // copysockettopfd calls callback.onError on error
+            if (!copySocketToPfd(output, BUGREPORT_OUTPUT_SOCKET, callback)) {
+                return;
+            }
+        } else {
+            int error;
+            try {
+                error = outputCopy.get();
+            } catch (InterruptedException | ExecutionException e) {
+                Slog.e(TAG, "Failed to wait for the bugreport copy", e);
+                error = CAR_BUGREPORT_DUMPSTATE_FAILED;
+            }
+            if (error != NO_ERROR) {
+                reportError(callback, error);
+                return;
+            }
         }
         if (!copySocketToPfd(extraOutput, BUGREPORT_EXTRA_OUTPUT_SOCKET, callback)) {
             return;
@@ -267,6 +303,9 @@ public class CarBugreportManagerService extends ICarBugreportService.Stub implem
      * <p>dumpstate prints {@code BEGIN:} right away, then prints {@code PROGRESS:} as it
      * progresses. When it finishes or fails it prints {@code OK:pathToTheZipFile} or
      * {@code FAIL:message} accordingly.
+     *
+     * <p>The zipped bugreport is read from {@code BEGIN:} on, since {@code car-bugreportd} sends
+     * it as it is written.
      */
     private void processBugreportSockets(
             ParcelFileDescriptor output, ParcelFileDescriptor extraOutput,
@@ -276,6 +315,7 @@ public class CarBugreportManagerService extends ICarBugreportService.Stub implem
             reportError(callback, CAR_BUGREPORT_DUMPSTATE_CONNECTION_FAILED);
             return;
         }
+        FutureTask<Integer> outputCopy = null;
         try (BufferedReader reader =
                 new BufferedReader(new InputStreamReader(localSocket.getInputStream()))) {
             String line;
@@ -288,9 +328,16 @@ public class CarBugreportManagerService extends ICarBugreportService.Stub implem
                     reportError(callback, CAR_BUGREPORT_DUMPSTATE_FAILED);
                     return;
                 } else if (line.startsWith(OK_PREFIX)) {
-                    handleFinished(output, extraOutput, callback);
+                    handleFinished(output, extraOutput, callback, outputCopy);
                     return;
-                } else if (!line.startsWith(BEGIN_PREFIX)) {
+                } else if (line.startsWith(BEGIN_PREFIX)) {
+                    if (outputCopy == null) {
+                        outputCopy = startOutputCopy(output);
+                    }
+                } else if (line.startsWith(TIMING_PREFIX)) {
+                    Slog.i(TAG, "Bugreport phase timing: "
+                            + line.substring(TIMING_PREFIX.length()));
+                } else {
                     Slog.w(TAG, "Received unknown progress line from dumpstate: " + line);
                 }
             }
@@ -304,10 +351,19 @@ public class CarBugreportManagerService extends ICarBugreportService.Stub implem
 
     private boolean copySocketToPfd(
             ParcelFileDescriptor pfd, String remoteSocket, ICarBugreportCallback callback) {
+        int error = copySocketToPfdOrError(pfd, remoteSocket);
+        if (error != NO_ERROR) {
+            reportError(callback, error);
+            return false;
+        }
+        return true;
+    }
+
+    /** Returns {@link #NO_ERROR} on success, or the error to report. */
+    private int copySocketToPfdOrError(ParcelFileDescriptor pfd, String remoteSocket) {
         LocalSocket localSocket = connectSocket(remoteSocket);
         if (localSocket == null) {
-            reportError(callback, CAR_BUGREPORT_DUMPSTATE_CONNECTION_FAILED);
-            return false;
+            return CAR_BUGREPORT_DUMPSTATE_CONNECTION_FAILED;
         }
 
         try (
@@ -318,10 +374,9 @@ public class CarBugreportManagerService extends ICarBugreportService.Stub implem
             rawCopyStream(out, in);
         } catch (IOException | RuntimeException e) {
             Slog.e(TAG, "Failed to grab dump state from " + BUGREPORT_OUTPUT_SOCKET, e);
-            reportError(callback, CAR_BUGREPORT_DUMPSTATE_FAILED);
-            return false;
+            return CAR_BUGREPORT_DUMPSTATE_FAILED;
         }
-        return true;
+        return NO_ERROR;
     }
 
     private void reportError(ICarBugreportCallback callback, int errorCode) {
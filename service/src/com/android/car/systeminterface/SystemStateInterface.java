@@ -26,6 +26,7 @@ import android.util.Log;
 import android.util.Pair;
 
 import com.android.car.procfsinspector.ProcessInfo;
+import com.android.car.procfsinspector.ProcessTableTracker;
 import com.android.car.procfsinspector.ProcfsInspector;
 import com.android.internal.annotations.VisibleForTesting;
 import com.android.internal.car.ICarServiceHelper;
@@ -85,6 +86,7 @@ public interface SystemStateInterface {
         private final CountDownLatch mHelperLatch = new CountDownLatch(1);
         private final Context mContext;
         private final PowerManager mPowerManager;
+        private final ProcessTableTracker mProcessTable = new ProcessTableTracker();
         private List<Pair<Runnable, Duration>> mActionsList = new ArrayList<>();
         private ScheduledExecutorService mExecutorService;
         private final BroadcastReceiver mBroadcastReceiver = new BroadcastReceiver() {
@@ -169,6 +171,12 @@ public interface SystemStateInterface {
             mActionsList.add(Pair.create(action, delay));
         }
 
+        @Override
+        public List<ProcessInfo> getRunningProcesses() {
+            // Only the changes since the last call cross binder.
+            return mProcessTable.getProcessTable();
+        }
+
         @Override
         public void setCarServiceHelper(ICarServiceHelper helper) {
             mICarServiceHelper = helper;
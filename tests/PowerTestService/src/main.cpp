@@ -19,6 +19,9 @@
 #include <signal.h>
 #include <utils/Log.h>
 
+#include <condition_variable>
+#include <mutex>
+
 #include <binder/IPCThreadState.h>
 #include <binder/ProcessState.h>
 #include <binder/IServiceManager.h>
@@ -34,13 +37,17 @@ using namespace android::binder;
 using namespace android::car;
 using namespace android::car::hardware::power;
 
-static std::atomic_bool run(true);
+static std::mutex lock;
+static std::condition_variable stopped;
+static bool run = true;
 
 void onStateChanged(CarPowerManager::State state) {
     ALOGI(LOG_TAG "onStateChanged callback = %d", state);
     if (state == CarPowerManager::State::kShutdownPrepare) {
-        // Stop the loop
+        // Stop waiting
+        std::lock_guard<std::mutex> guard(lock);
         run = false;
+        stopped.notify_all();
     }
 }
 
@@ -54,14 +61,18 @@ int main(int, char**)
 
     std::unique_ptr<CarPowerManager> carPowerManager(new CarPowerManager());
 
-    do {
-        retVal = carPowerManager->setListener(onStateChanged);
-    } while (retVal != 0);
+    // Registered once CarService is up, and again if it restarts.
+    retVal = carPowerManager->setListener(onStateChanged);
+    if (retVal != 0) {
+        ALOGE(LOG_TAG "Cannot set listener");
+        return retVal;
+    }
 
-    do {
-        ALOGI(LOG_TAG "Waiting for CarPowerManager listener to initiate SHUTDOWN_PREPARE...");
-        sleep(5);
-    } while (run);
+    ALOGI(LOG_TAG "Waiting for CarPowerManager listener to initiate SHUTDOWN_PREPARE...");
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        stopped.wait(guard, []() { return !run; });
+    }
 
     ALOGI(LOG_TAG "Exited loop, shutting down");
 
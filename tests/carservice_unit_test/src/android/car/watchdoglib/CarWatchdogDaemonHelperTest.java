@@ -27,6 +27,7 @@ import static org.testng.Assert.assertThrows;
 import android.automotive.watchdog.ICarWatchdog;
 import android.automotive.watchdog.ICarWatchdogClient;
 import android.automotive.watchdog.ICarWatchdogMonitor;
+import android.automotive.watchdog.IIoOveruseListener;
 import android.automotive.watchdog.PowerCycle;
 import android.automotive.watchdog.StateType;
 import android.os.Binder;
@@ -119,6 +120,15 @@ public class CarWatchdogDaemonHelperTest {
         verify(mFakeCarWatchdog).unregisterMonitor(monitor);
     }
 
+    @Test
+    public void testIndirectCall_RegisterUnregisterIoOveruseListener() throws Exception {
+        IIoOveruseListener listener = new IIoOveruseListener.Default();
+        mCarWatchdogDaemonHelper.registerIoOveruseListener(listener);
+        verify(mFakeCarWatchdog).registerIoOveruseListener(listener);
+        mCarWatchdogDaemonHelper.unregisterIoOveruseListener(listener);
+        verify(mFakeCarWatchdog).unregisterIoOveruseListener(listener);
+    }
+
     @Test
     public void testIndirectCall_TellClientAlive() throws Exception {
         ICarWatchdogClient client = new ICarWatchdogClient.Default();
@@ -17,47 +17,95 @@
 #include "defines.h"
 #include <utils/Log.h>
 
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
 using namespace com::android::car::keventreader;
 
-EventGatherer::EventGatherer(int argc, const char** argv) {
+constexpr int EventGatherer::kMaxReadyDevices;
+
+EventGatherer::EventGatherer() : mEpollFd(epoll_create1(EPOLL_CLOEXEC)) {
+    if (mEpollFd < 0) {
+        ALOGE("epoll_create1 failed: %s", strerror(errno));
+    }
+}
+
+EventGatherer::EventGatherer(int argc, const char** argv) : EventGatherer() {
     for (auto i = 1; i < argc; ++i) {
-        auto dev = std::make_unique<InputSource>(argv[i]);
-        if (dev && *dev) {
-            ALOGD("opened input source file %s", argv[i]);
-            mFds.push_back({dev->descriptor(), POLLIN, 0});
-            mDevices.emplace(dev->descriptor(), std::move(dev));
-        } else {
-            ALOGW("failed to open input source file %s", argv[i]);
+        addDevice(argv[i]);
+    }
+}
+
+EventGatherer::~EventGatherer() {
+    if (mEpollFd >= 0) close(mEpollFd);
+}
+
+bool EventGatherer::addDevice(const char* path) {
+    auto dev = std::make_unique<InputSource>(path);
+    if (!*dev) {
+        ALOGW("failed to open input source file %s", path);
+        return false;
+    }
+
+    std::scoped_lock lock(mMutex);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = dev->descriptor();
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, dev->descriptor(), &event) < 0) {
+        ALOGW("failed to watch input source file %s: %s", path, strerror(errno));
+        return false;
+    }
+    ALOGD("opened input source file %s", path);
+    mDevices.emplace(dev->descriptor(), std::move(dev));
+    return true;
+}
+
+bool EventGatherer::removeDevice(const char* path) {
+    std::scoped_lock lock(mMutex);
+    for (auto it = mDevices.begin(); it != mDevices.end(); ++it) {
+        if (it->second->path() == path) {
+            removeLocked(it);
+            return true;
         }
     }
+    return false;
+}
+
+void EventGatherer::removeLocked(std::map<int, std::unique_ptr<InputSource>>::iterator it) {
+    ALOGD("closing input source file %s", it->second->path().c_str());
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, it->first, nullptr);
+    mDevices.erase(it);
 }
 
 size_t EventGatherer::size() const {
+    std::scoped_lock lock(mMutex);
     return mDevices.size();
 }
 
-std::vector<com::android::car::keventreader::KeypressEvent> EventGatherer::read() {
-    constexpr int FOREVER = -1;
+std::vector<com::android::car::keventreader::KeypressEvent> EventGatherer::read(int timeoutMs) {
     std::vector<com::android::car::keventreader::KeypressEvent> result;
 
-    int count = poll(&mFds[0], mFds.size(), FOREVER);
+    epoll_event ready[kMaxReadyDevices];
+    int count = TEMP_FAILURE_RETRY(epoll_wait(mEpollFd, ready, kMaxReadyDevices, timeoutMs));
     if (count < 0) {
-        ALOGE("poll failed: errno = %d", errno);
+        ALOGE("epoll_wait failed: %s", strerror(errno));
         return result;
     }
 
-    for (auto& fd : mFds) {
-        if (fd.revents != 0) {
-            if (fd.revents == POLLIN) {
-                if (auto dev = mDevices[fd.fd].get()) {
-                    while(auto evt = dev->read()) {
-                        result.push_back(*evt);
-                    }
-                    --count; // found one source of events we care abour
-                }
-            }
-            fd.revents = 0;
-            if (count == 0) break; // if we read all events, no point in continuing the scan
+    std::scoped_lock lock(mMutex);
+    for (int i = 0; i < count; ++i) {
+        // removed in the meantime
+        auto it = mDevices.find(ready[i].data.fd);
+        if (it == mDevices.end()) {
+            continue;
+        }
+        // read what is left even after a hangup
+        bool alive = it->second->read(&result);
+        if (!alive || (ready[i].events & (EPOLLHUP | EPOLLERR)) != 0) {
+            ALOGW("input source file %s went away", it->second->path().c_str());
+            removeLocked(it);
         }
     }
 
@@ -21,20 +21,37 @@
 
 #include <map>
 #include <memory>
-#include <poll.h>
+#include <mutex>
 #include <vector>
 
 namespace com::android::car::keventreader {
     class EventGatherer {
     public:
+        EventGatherer();
         EventGatherer(int argc, const char** argv);
+        ~EventGatherer();
+
+        EventGatherer(const EventGatherer&) = delete;
+        EventGatherer& operator=(const EventGatherer&) = delete;
+
+        // Devices can be added and removed while another thread is in read().
+        bool addDevice(const char* path);
+        bool removeDevice(const char* path);
 
         size_t size() const;
 
-        std::vector<com::android::car::keventreader::KeypressEvent> read();
+        // Waits up to |timeoutMs|, forever if negative, for input, then drains every device
+        // that has some. Devices that went away are dropped.
+        std::vector<com::android::car::keventreader::KeypressEvent> read(int timeoutMs = -1);
+
+        // Devices served per epoll_wait().
+        static constexpr int kMaxReadyDevices = 16;
     private:
+        void removeLocked(std::map<int, std::unique_ptr<InputSource>>::iterator it);
+
+        int mEpollFd;
+        mutable std::mutex mMutex;
         std::map<int, std::unique_ptr<InputSource>> mDevices;
-        std::vector<pollfd> mFds;
     };
 }
 
@@ -16,37 +16,139 @@
 #include "defines.h"
 #include "eventprovider.h"
 #include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <utils/Log.h>
 
 using namespace com::android::car::keventreader;
 
-EventProviderImpl::EventProviderImpl(EventGatherer&& g) : mGatherer(std::move(g)) {}
+constexpr size_t EventProviderImpl::kMaxQueuedEvents;
+constexpr size_t EventProviderImpl::kMaxBatchSize;
+
+EventProviderImpl::EventProviderImpl(std::unique_ptr<EventGatherer> gatherer) :
+    mGatherer(std::move(gatherer)), mClients(std::make_shared<ClientList>()) {}
 
 std::thread EventProviderImpl::startLoop() {
+    mDispatcher = std::thread([this] () -> void { dispatchLoop(); });
     auto t = std::thread( [this] () -> void {
         while(true) {
-            auto events = mGatherer.read();
-            {
-                std::scoped_lock lock(mMutex);
-                for (auto&& cb : mCallbacks) {
-                    for (const auto& event : events) {
-                        cb->onEvent(event);
-                    }
-                }
+            auto events = mGatherer->read();
+            if (!events.empty()) {
+                enqueue(events);
             }
         }
     });
     return t;
 }
 
+std::shared_ptr<const EventProviderImpl::ClientList> EventProviderImpl::clients() const {
+    return std::atomic_load(&mClients);
+}
+
+void EventProviderImpl::enqueue(const std::vector<KeypressEvent>& events) {
+    auto clients = this->clients();
+    if (clients->empty()) {
+        return;
+    }
+
+    {
+        std::scoped_lock lock(mQueueMutex);
+        for (auto&& client : *clients) {
+            auto& queue = client->queue;
+            queue.insert(queue.end(), events.begin(), events.end());
+            if (queue.size() > kMaxQueuedEvents) {
+                // once per overflow, so that a stalled callback does not flood the log
+                if (client->dropped == 0) {
+                    ALOGW("callback is not keeping up, dropping the oldest events");
+                }
+                client->dropped += queue.size() - kMaxQueuedEvents;
+                queue.erase(queue.begin(), queue.end() - kMaxQueuedEvents);
+            }
+        }
+        mPending = true;
+    }
+    mQueueCondition.notify_one();
+}
+
+void EventProviderImpl::dispatchLoop() {
+    while (true) {
+        std::vector<std::pair<std::shared_ptr<Client>, std::vector<KeypressEvent>>> batches;
+        {
+            std::unique_lock lock(mQueueMutex);
+            mQueueCondition.wait(lock, [this] () { return mPending; });
+            mPending = false;
+            for (auto&& client : *clients()) {
+                auto& queue = client->queue;
+                if (queue.empty()) {
+                    continue;
+                }
+                auto end = queue.begin() + std::min(queue.size(), kMaxBatchSize);
+                batches.emplace_back(client, std::vector<KeypressEvent>(queue.begin(), end));
+                queue.erase(queue.begin(), end);
+                if (queue.empty() && client->dropped > 0) {
+                    ALOGW("callback caught up after %zu events were dropped", client->dropped);
+                    client->dropped = 0;
+                }
+                // come back for the rest once everybody got a batch
+                mPending |= !queue.empty();
+            }
+        }
+
+        // one oneway transaction per callback, outside of any lock
+        for (auto&& [client, batch] : batches) {
+            auto status = client->callback->onEvents(batch);
+            if (!status.isOk() && status.transactionError() == DEAD_OBJECT) {
+                removeClient(IInterface::asBinder(client->callback).get());
+            }
+        }
+    }
+}
+
 Status EventProviderImpl::registerCallback(const sp<IEventCallback>& cb) {
+    auto binder = IInterface::asBinder(cb);
     std::scoped_lock lock(mMutex);
-    mCallbacks.push_back(cb);
+    auto clients = this->clients();
+    for (auto&& client : *clients) {
+        if (IInterface::asBinder(client->callback) == binder) {
+            return Status::ok();
+        }
+    }
+
+    if (binder->remoteBinder() != nullptr && binder->linkToDeath(this) != OK) {
+        ALOGW("callback died before it could be registered");
+        return Status::ok();
+    }
+    auto newClients = std::make_shared<ClientList>(*clients);
+    newClients->push_back(std::make_shared<Client>(cb));
+    std::atomic_store(&mClients, std::shared_ptr<const ClientList>(std::move(newClients)));
     return Status::ok();
 }
 
 Status EventProviderImpl::unregisterCallback(const sp<IEventCallback>& cb) {
-    std::scoped_lock lock(mMutex);
-    std::remove(mCallbacks.begin(), mCallbacks.end(), cb);
+    auto binder = IInterface::asBinder(cb);
+    if (removeClient(binder.get()) && binder->remoteBinder() != nullptr) {
+        binder->unlinkToDeath(this);
+    }
     return Status::ok();
 }
+
+void EventProviderImpl::binderDied(const wp<IBinder>& who) {
+    ALOGI("callback died, removing it");
+    removeClient(who.unsafe_get());
+}
+
+bool EventProviderImpl::removeClient(const IBinder* binder) {
+    std::scoped_lock lock(mMutex);
+    auto clients = this->clients();
+    // proxies for the same callback are different objects, but share their binder
+    auto newClients = std::make_shared<ClientList>();
+    std::copy_if(clients->begin(), clients->end(), std::back_inserter(*newClients),
+                 [binder] (const auto& client) {
+                     return IInterface::asBinder(client->callback).get() != binder;
+                 });
+    if (newClients->size() == clients->size()) {
+        return false;
+    }
+    std::atomic_store(&mClients, std::shared_ptr<const ClientList>(std::move(newClients)));
+    return true;
+}
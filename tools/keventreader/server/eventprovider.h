@@ -20,6 +20,9 @@
 #include "com/android/car/keventreader/BnEventProvider.h"
 #include <binder/Binder.h>
 #include "eventgatherer.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -28,17 +31,52 @@ using namespace android;
 using namespace android::binder;
 
 namespace com::android::car::keventreader {
-    class EventProviderImpl : public BnEventProvider {
+    // Gathers events on one thread and hands them to the callbacks on another, so that a slow
+    // callback holds back neither the gathering nor the other callbacks.
+    class EventProviderImpl : public BnEventProvider, public IBinder::DeathRecipient {
     public:
-        EventProviderImpl(EventGatherer&&);
+        explicit EventProviderImpl(std::unique_ptr<EventGatherer> gatherer);
         std::thread startLoop();
 
         virtual Status registerCallback(const sp<IEventCallback>& callback) override;
         virtual Status unregisterCallback(const sp<IEventCallback>& callback) override;
+
+        virtual void binderDied(const wp<IBinder>& who) override;
+
+        // Events queued for a callback that does not keep up; the oldest go first.
+        static constexpr size_t kMaxQueuedEvents = 256;
+        // Events per onEvents() call.
+        static constexpr size_t kMaxBatchSize = 64;
     private:
-        EventGatherer mGatherer;
+        struct Client {
+            explicit Client(const sp<IEventCallback>& cb) : callback(cb) {}
+
+            const sp<IEventCallback> callback;
+            // guarded by mQueueMutex
+            std::deque<KeypressEvent> queue;
+            // Events dropped since the queue last overflowed, logged once it drains.
+            // guarded by mQueueMutex
+            size_t dropped = 0;
+        };
+        // Replaced as a whole on every change, so that readers never wait for writers.
+        using ClientList = std::vector<std::shared_ptr<Client>>;
+
+        std::shared_ptr<const ClientList> clients() const;
+        // Returns true if the list changed.
+        bool removeClient(const IBinder* binder);
+
+        void enqueue(const std::vector<KeypressEvent>& events);
+        void dispatchLoop();
+
+        std::unique_ptr<EventGatherer> mGatherer;
+        // Serializes changes of the client list.
         std::mutex mMutex;
-        std::vector<sp<IEventCallback>> mCallbacks;
+        std::shared_ptr<const ClientList> mClients;
+
+        std::mutex mQueueMutex;
+        std::condition_variable mQueueCondition;
+        bool mPending = false;
+        std::thread mDispatcher;
     };
 }
 
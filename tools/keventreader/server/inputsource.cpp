@@ -17,30 +17,18 @@
 #include "defines.h"
 #include <utils/Log.h>
 
+#include <errno.h>
 #include <fcntl.h>
-#include <sstream>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
 using namespace com::android::car::keventreader;
 
-InputSource::kevent::kevent() {
-    bzero(this, sizeof(*this));
-}
-
-bool InputSource::kevent::isKeypress() const {
-    return type == EV_KEY;
-}
-
-bool InputSource::kevent::isKeydown() const {
-    return isKeypress() && (value == 1);
-}
-
-bool InputSource::kevent::isKeyup() const {
-    return isKeypress() && (value == 0);
-}
+constexpr size_t InputSource::kReadBatchSize;
 
-InputSource::InputSource(const char* file) : mFilePath(file), mDescriptor(open(file, O_RDONLY)) {}
+InputSource::InputSource(const char* file) : mFilePath(file),
+    mDescriptor(open(file, O_RDONLY | O_NONBLOCK | O_CLOEXEC)) {}
 
 InputSource::operator bool() const {
     return descriptor() >= 0;
@@ -50,24 +38,73 @@ int InputSource::descriptor() const {
     return mDescriptor;
 }
 
-std::optional<com::android::car::keventreader::KeypressEvent> InputSource::read() const {
-    kevent evt;
+const std::string& InputSource::path() const {
+    return mFilePath;
+}
+
+bool InputSource::read(std::vector<com::android::car::keventreader::KeypressEvent>* events) {
+    ::input_event buffer[kReadBatchSize];
+    while (true) {
+        auto cnt = TEMP_FAILURE_RETRY(::read(mDescriptor, buffer, sizeof(buffer)));
+        if (cnt < 0) {
+            // ENODEV once the device is unplugged
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (cnt == 0) {
+            return false;
+        }
 
-    auto cnt = ::read(mDescriptor, &evt, sizeof(evt));
+        // the kernel guarantees that we will always be able to read a whole number of events
+        auto count = static_cast<size_t>(cnt) / sizeof(buffer[0]);
+        for (size_t i = 0; i < count; ++i) {
+            handle(buffer[i], events);
+        }
+        if (count < kReadBatchSize) {
+            return true;
+        }
+    }
+}
 
-    // the kernel guarantees that we will always be able to read a whole number of events
-    if (cnt < static_cast<decltype(cnt)>(sizeof(evt))) {
-        return std::nullopt;
+void InputSource::handle(const ::input_event& evt,
+                         std::vector<com::android::car::keventreader::KeypressEvent>* events) {
+    if (evt.type == EV_SYN) {
+        if (evt.code == SYN_DROPPED) {
+            ALOGW("input source %s dropped events", mFilePath.c_str());
+            mDropping = true;
+        } else if (evt.code == SYN_REPORT && mDropping) {
+            mDropping = false;
+            resync(events);
+        }
+        return;
+    }
+    if (mDropping || evt.type != EV_KEY) {
+        return;
     }
-    if (!evt.isKeypress()) {
-        return std::nullopt;
+
+    // autorepeat (value 2) leaves the key down
+    if (evt.code < KEY_CNT && evt.value != 2) {
+        mKeysDown.set(evt.code, evt.value == 1);
     }
+    ALOGV("input source %s generated code %u (down = %s)",
+      mFilePath.c_str(), evt.code, evt.value == 1 ? "true" : "false");
+    events->emplace_back(mFilePath, evt.code, evt.value == 1);
+}
 
-    ALOGD("input source %s generated code %u (down = %s)",
-      mFilePath.c_str(), evt.code, evt.isKeydown() ? "true" : "false");
-    return com::android::car::keventreader::KeypressEvent(mFilePath, evt.code, evt.isKeydown());
+void InputSource::resync(std::vector<com::android::car::keventreader::KeypressEvent>* events) {
+    uint8_t keys[(KEY_CNT + 7) / 8] = {};
+    if (ioctl(mDescriptor, EVIOCGKEY(sizeof(keys)), keys) < 0) {
+        ALOGW("cannot read key state of %s: %s", mFilePath.c_str(), strerror(errno));
+        return;
+    }
+    for (size_t code = 0; code < KEY_CNT; ++code) {
+        bool down = keys[code / 8] & (1 << (code % 8));
+        if (down != mKeysDown.test(code)) {
+            mKeysDown.set(code, down);
+            events->emplace_back(mFilePath, code, down);
+        }
+    }
 }
 
 InputSource::~InputSource() {
-    if (mDescriptor) ::close(mDescriptor);
+    if (mDescriptor >= 0) ::close(mDescriptor);
 }
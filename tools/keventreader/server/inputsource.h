@@ -17,8 +17,9 @@
 #define CAR_KEVENTREADER_INPUTSOURCE
 
 #include <linux/input.h>
-#include <optional>
+#include <bitset>
 #include <string>
+#include <vector>
 #include "event.h"
 
 namespace com::android::car::keventreader {
@@ -30,20 +31,28 @@ namespace com::android::car::keventreader {
 
         int descriptor() const;
 
-        std::optional<com::android::car::keventreader::KeypressEvent> read() const;
+        const std::string& path() const;
+
+        // Reads every event queued on the device, appending its keypresses to |events|.
+        // Returns false if the device is gone.
+        bool read(std::vector<com::android::car::keventreader::KeypressEvent>* events);
 
         virtual ~InputSource();
+
+        // Events read per syscall.
+        static constexpr size_t kReadBatchSize = 64;
     private:
-        struct kevent : public ::input_event {
-            kevent();
-            bool isKeypress() const;
-            bool isKeydown() const;
-            bool isKeyup() const;
-        };
-        static_assert(sizeof(kevent) == sizeof(::input_event), "do not add data to input_event");
+        void handle(const ::input_event& evt,
+                    std::vector<com::android::car::keventreader::KeypressEvent>* events);
+        // Reports the keys whose state changed while events were being dropped.
+        void resync(std::vector<com::android::car::keventreader::KeypressEvent>* events);
 
         std::string mFilePath;
         int mDescriptor;
+        // Keys currently held down, as far as the events read so far tell.
+        std::bitset<KEY_CNT> mKeysDown;
+        // Set from SYN_DROPPED up to the next SYN_REPORT, whose events are incomplete.
+        bool mDropping = false;
     };
 }
 
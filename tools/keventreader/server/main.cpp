@@ -49,8 +49,8 @@ int main(int argc, const char** argv) {
         error(1);
     }
 
-    EventGatherer gatherer(argc, argv);
-    if (0 == gatherer.size()) {
+    auto gatherer = std::make_unique<EventGatherer>(argc, argv);
+    if (0 == gatherer->size()) {
         error(2);
     }
 
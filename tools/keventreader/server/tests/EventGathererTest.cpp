@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "eventgatherer.h"
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using android::base::unique_fd;
+using namespace com::android::car::keventreader;
+
+namespace {
+
+constexpr int kTimeoutMs = 1000;
+
+// A FIFO standing in for /dev/input/eventN.
+class FakeDevice {
+public:
+    explicit FakeDevice(const std::string& path) : mPath(path) {
+        mkfifo(mPath.c_str(), 0600);
+    }
+
+    ~FakeDevice() {
+        unlink(mPath.c_str());
+    }
+
+    // Opens the writing end, once the gatherer has the reading end open.
+    bool connect() {
+        mFd.reset(open(mPath.c_str(), O_WRONLY | O_CLOEXEC));
+        return mFd != -1;
+    }
+
+    void disconnect() { mFd.reset(); }
+
+    void write(const std::vector<input_event>& events) {
+        ASSERT_TRUE(android::base::WriteFully(mFd, events.data(),
+                                              events.size() * sizeof(input_event)));
+    }
+
+    const char* path() const { return mPath.c_str(); }
+
+private:
+    std::string mPath;
+    unique_fd mFd;
+};
+
+input_event key(uint16_t code, int32_t value) {
+    input_event event = {};
+    event.type = EV_KEY;
+    event.code = code;
+    event.value = value;
+    return event;
+}
+
+input_event syn(uint16_t code = SYN_REPORT) {
+    input_event event = {};
+    event.type = EV_SYN;
+    event.code = code;
+    return event;
+}
+
+input_event misc() {
+    input_event event = {};
+    event.type = EV_MSC;
+    event.code = MSC_SCAN;
+    return event;
+}
+
+// Reads until |count| keypresses came in, or a read comes back empty.
+std::vector<KeypressEvent> readEvents(EventGatherer* gatherer, size_t count) {
+    std::vector<KeypressEvent> events;
+    while (events.size() < count) {
+        auto more = gatherer->read(kTimeoutMs);
+        if (more.empty()) {
+            break;
+        }
+        events.insert(events.end(), more.begin(), more.end());
+    }
+    return events;
+}
+
+class EventGathererTest : public ::testing::Test {
+protected:
+    std::string path(const char* name) { return std::string(mDir.path) + "/" + name; }
+
+    TemporaryDir mDir;
+};
+
+}  // namespace
+
+TEST_F(EventGathererTest, ReadsKeysPastOtherEvents) {
+    FakeDevice device(path("event0"));
+    EventGatherer gatherer;
+    ASSERT_TRUE(gatherer.addDevice(device.path()));
+    ASSERT_TRUE(device.connect());
+
+    // Keys behind a scancode and a report used to wait for the next poll.
+    device.write({misc(), key(KEY_A, 1), syn(), misc(), key(KEY_A, 0), syn(),
+                  key(KEY_B, 1), syn()});
+    auto events = readEvents(&gatherer, 3);
+    ASSERT_EQ(3u, events.size());
+    EXPECT_EQ(KEY_A, events[0].keycode);
+    EXPECT_TRUE(events[0].keydown);
+    EXPECT_EQ(KEY_A, events[1].keycode);
+    EXPECT_FALSE(events[1].keydown);
+    EXPECT_EQ(KEY_B, events[2].keycode);
+    EXPECT_EQ(device.path(), events[2].source);
+}
+
+TEST_F(EventGathererTest, DrainsMoreThanOneBatch) {
+    FakeDevice device(path("event0"));
+    EventGatherer gatherer;
+    ASSERT_TRUE(gatherer.addDevice(device.path()));
+    ASSERT_TRUE(device.connect());
+
+    constexpr size_t kKeys = InputSource::kReadBatchSize * 3;
+    std::vector<input_event> input;
+    for (size_t i = 0; i < kKeys; i++) {
+        input.push_back(key(KEY_1 + i % 10, 1));
+        input.push_back(key(KEY_1 + i % 10, 0));
+    }
+    device.write(input);
+
+    // All of it in one go, since it was all queued.
+    auto events = gatherer.read(kTimeoutMs);
+    EXPECT_EQ(kKeys * 2, events.size());
+}
+
+TEST_F(EventGathererTest, DropsEventsUpToReportAfterSynDropped) {
+    FakeDevice device(path("event0"));
+    EventGatherer gatherer;
+    ASSERT_TRUE(gatherer.addDevice(device.path()));
+    ASSERT_TRUE(device.connect());
+
+    // The key state of a FIFO cannot be read, so nothing is made up for the dropped ones.
+    device.write({key(KEY_A, 1), syn(), syn(SYN_DROPPED), key(KEY_A, 0), key(KEY_C, 1), syn(),
+                  key(KEY_B, 1), syn()});
+    auto events = readEvents(&gatherer, 2);
+    ASSERT_EQ(2u, events.size());
+    EXPECT_EQ(KEY_A, events[0].keycode);
+    EXPECT_EQ(KEY_B, events[1].keycode);
+}
+
+TEST_F(EventGathererTest, AddsAndRemovesDevicesWhileReading) {
+    FakeDevice first(path("event0"));
+    FakeDevice second(path("event1"));
+    EventGatherer gatherer;
+    ASSERT_TRUE(gatherer.addDevice(first.path()));
+    ASSERT_TRUE(first.connect());
+
+    std::vector<KeypressEvent> events;
+    std::thread reader([&]() { events = readEvents(&gatherer, 2); });
+    ASSERT_TRUE(gatherer.addDevice(second.path()));
+    ASSERT_TRUE(second.connect());
+    EXPECT_EQ(2u, gatherer.size());
+    first.write({key(KEY_A, 1), syn()});
+    second.write({key(KEY_B, 1), syn()});
+    reader.join();
+    ASSERT_EQ(2u, events.size());
+
+    EXPECT_TRUE(gatherer.removeDevice(first.path()));
+    EXPECT_FALSE(gatherer.removeDevice(first.path()));
+    EXPECT_EQ(1u, gatherer.size());
+    second.write({key(KEY_C, 1), syn()});
+    events = readEvents(&gatherer, 1);
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(second.path(), events[0].source);
+}
+
+TEST_F(EventGathererTest, DropsDevicesThatGoAway) {
+    FakeDevice device(path("event0"));
+    EventGatherer gatherer;
+    ASSERT_TRUE(gatherer.addDevice(device.path()));
+    ASSERT_TRUE(device.connect());
+
+    // What was queued is still delivered.
+    device.write({key(KEY_A, 1), syn()});
+    device.disconnect();
+    auto events = readEvents(&gatherer, 1);
+    EXPECT_EQ(1u, events.size());
+    EXPECT_EQ(0u, gatherer.size());
+}
+
+TEST_F(EventGathererTest, SkipsMissingDevices) {
+    const char* argv[] = {"keventreader", "/nonexistent/event0"};
+    EventGatherer gatherer(2, argv);
+    EXPECT_EQ(0u, gatherer.size());
+}
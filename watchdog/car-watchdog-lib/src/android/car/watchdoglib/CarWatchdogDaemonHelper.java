@@ -23,6 +23,7 @@ import android.annotation.Nullable;
 import android.automotive.watchdog.ICarWatchdog;
 import android.automotive.watchdog.ICarWatchdogClient;
 import android.automotive.watchdog.ICarWatchdogMonitor;
+import android.automotive.watchdog.IIoOveruseListener;
 import android.os.Handler;
 import android.os.IBinder;
 import android.os.Looper;
@@ -283,6 +284,31 @@ public final class CarWatchdogDaemonHelper {
         invokeDaemonMethod((daemon) -> daemon.notifySystemStateChange(type, arg1, arg2));
     }
 
+    /**
+     * Registers the listener notified when a package exceeds its I/O write budget. Replaces the
+     * previously registered listener.
+     *
+     * @param listener I/O overuse listener to be registered.
+     * @throws IllegalArgumentException If the listener is null.
+     * @throws IllegalStateException If car watchdog daemon is not connected.
+     * @throws RemoteException
+     */
+    public void registerIoOveruseListener(IIoOveruseListener listener) throws RemoteException {
+        invokeDaemonMethod((daemon) -> daemon.registerIoOveruseListener(listener));
+    }
+
+    /**
+     * Unregisters the I/O overuse listener.
+     *
+     * @param listener I/O overuse listener to be unregistered.
+     * @throws IllegalArgumentException If the listener is not registered.
+     * @throws IllegalStateException If car watchdog daemon is not connected.
+     * @throws RemoteException
+     */
+    public void unregisterIoOveruseListener(IIoOveruseListener listener) throws RemoteException {
+        invokeDaemonMethod((daemon) -> daemon.unregisterIoOveruseListener(listener));
+    }
+
     private void invokeDaemonMethod(Invokable r) throws RemoteException {
         ICarWatchdog daemon;
         synchronized (mLock) {
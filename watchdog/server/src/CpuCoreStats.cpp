@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "carwatchdogd"
+
+#include "CpuCoreStats.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+#include <ctype.h>
+#include <log/log.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+using android::base::Error;
+using android::base::ParseUint;
+using android::base::ReadFileToString;
+using android::base::Result;
+using android::base::Split;
+using android::base::StringPrintf;
+
+namespace {
+
+bool parseCpuCoreStats(const std::string& data, CpuCoreUsage* usage) {
+    std::vector<std::string> fields = Split(data, " ");
+    CpuStats* cpuStats = &usage->cpuStats;
+    if (fields.size() != 11 || !ParseUint(fields[0].substr(3), &usage->cpu) ||
+        !ParseUint(fields[1], &cpuStats->userTime) || !ParseUint(fields[2], &cpuStats->niceTime) ||
+        !ParseUint(fields[3], &cpuStats->sysTime) || !ParseUint(fields[4], &cpuStats->idleTime) ||
+        !ParseUint(fields[5], &cpuStats->ioWaitTime) || !ParseUint(fields[6], &cpuStats->irqTime) ||
+        !ParseUint(fields[7], &cpuStats->softIrqTime) ||
+        !ParseUint(fields[8], &cpuStats->stealTime) ||
+        !ParseUint(fields[9], &cpuStats->guestTime) ||
+        !ParseUint(fields[10], &cpuStats->guestNiceTime)) {
+        ALOGW("Invalid cpu line: \"%s\"", data.c_str());
+        return false;
+    }
+    return true;
+}
+
+Result<std::map<uint32_t, uint64_t>> readTimeInState(const std::string& path) {
+    std::string buffer;
+    if (!ReadFileToString(path, &buffer)) {
+        return Error() << "ReadFileToString failed for " << path;
+    }
+    std::map<uint32_t, uint64_t> timeInState;
+    for (const auto& line : Split(buffer, "\n")) {
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields = Split(line, " ");
+        uint32_t frequency;
+        uint64_t time;
+        if (fields.size() != 2 || !ParseUint(fields[0], &frequency) ||
+            !ParseUint(fields[1], &time)) {
+            return Error() << "Invalid line \"" << line << "\" in " << path;
+        }
+        timeInState[frequency] = time;
+    }
+    return timeInState;
+}
+
+// The counters of a core may restart from zero when it is brought back online. Report the new
+// value as-is instead of wrapping around.
+uint64_t diff(uint64_t current, uint64_t last) {
+    return current >= last ? current - last : current;
+}
+
+}  // namespace
+
+Result<std::vector<CpuCoreUsage>> CpuCoreStats::collect() {
+    if (!kEnabled) {
+        return Error() << "Can not access " << kPath;
+    }
+    std::string buffer;
+    if (!ReadFileToString(kPath, &buffer)) {
+        return Error() << "ReadFileToString failed for " << kPath;
+    }
+    return collectFrom(buffer);
+}
+
+Result<std::vector<CpuCoreUsage>> CpuCoreStats::collectFrom(const std::string& procStatContents) {
+    Mutex::Autolock lock(mMutex);
+    const auto& usages = getCpuCoreUsageLocked(procStatContents);
+    if (!usages) {
+        return Error() << "Failed to get per-core usage: " << usages.error();
+    }
+
+    std::vector<CpuCoreUsage> deltas;
+    for (const auto& usage : *usages) {
+        const CpuCoreUsage& last = mLastCpuCoreUsage[usage.cpu];
+        CpuCoreUsage delta = {.cpu = usage.cpu};
+        const CpuStats& cur = usage.cpuStats;
+        delta.cpuStats.userTime = diff(cur.userTime, last.cpuStats.userTime);
+        delta.cpuStats.niceTime = diff(cur.niceTime, last.cpuStats.niceTime);
+        delta.cpuStats.sysTime = diff(cur.sysTime, last.cpuStats.sysTime);
+        delta.cpuStats.idleTime = diff(cur.idleTime, last.cpuStats.idleTime);
+        delta.cpuStats.ioWaitTime = diff(cur.ioWaitTime, last.cpuStats.ioWaitTime);
+        delta.cpuStats.irqTime = diff(cur.irqTime, last.cpuStats.irqTime);
+        delta.cpuStats.softIrqTime = diff(cur.softIrqTime, last.cpuStats.softIrqTime);
+        delta.cpuStats.stealTime = diff(cur.stealTime, last.cpuStats.stealTime);
+        delta.cpuStats.guestTime = diff(cur.guestTime, last.cpuStats.guestTime);
+        delta.cpuStats.guestNiceTime = diff(cur.guestNiceTime, last.cpuStats.guestNiceTime);
+        for (const auto& it : usage.timeInState) {
+            const auto& lastIt = last.timeInState.find(it.first);
+            delta.timeInState[it.first] =
+                    diff(it.second, lastIt == last.timeInState.end() ? 0 : lastIt->second);
+        }
+        deltas.emplace_back(delta);
+        mLastCpuCoreUsage[usage.cpu] = usage;
+    }
+    return deltas;
+}
+
+Result<std::vector<CpuCoreUsage>> CpuCoreStats::getCpuCoreUsageLocked(
+        const std::string& procStatContents) const {
+    std::vector<CpuCoreUsage> usages;
+    for (const auto& line : Split(procStatContents, "\n")) {
+        // Per-core lines come right after the aggregated `cpu ` line, so stop at the first line
+        // that is neither.
+        if (line.compare(0, 3, "cpu")) {
+            break;
+        }
+        if (line.size() < 4 || !isdigit(line[3])) {
+            continue;
+        }
+        CpuCoreUsage usage;
+        if (!parseCpuCoreStats(line, &usage)) {
+            return Error() << "Failed to parse `cpuN .*` line in " << kPath;
+        }
+        if (!usages.empty() && usages.back().cpu >= usage.cpu) {
+            return Error() << "Duplicate or out of order `cpu" << usage.cpu << " .*` line in "
+                           << kPath;
+        }
+        usages.emplace_back(usage);
+    }
+    if (usages.empty()) {
+        return Error() << kPath << " has no `cpuN .*` lines";
+    }
+
+    for (auto& usage : usages) {
+        // Cores without a cpufreq driver or with cpufreq stats disabled don't have this file.
+        std::string path = StringPrintf((kCpuPath + kTimeInStateFileFormat).c_str(), usage.cpu);
+        if (access(path.c_str(), R_OK)) {
+            continue;
+        }
+        const auto& timeInState = readTimeInState(path);
+        if (!timeInState) {
+            return Error() << "Failed to read time in state: " << timeInState.error();
+        }
+        usage.timeInState = *timeInState;
+    }
+    return usages;
+}
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WATCHDOG_SERVER_SRC_CPUCORESTATS_H_
+#define WATCHDOG_SERVER_SRC_CPUCORESTATS_H_
+
+#include <android-base/result.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ProcStat.h"
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+constexpr const char* kCpuDirPath = "/sys/devices/system/cpu";
+constexpr const char* kTimeInStateFileFormat = "/cpu%" PRIu32 "/cpufreq/stats/time_in_state";
+
+struct CpuCoreUsage {
+    uint32_t cpu = 0;
+    CpuStats cpuStats = {};
+    // Time spent at each frequency, in 10ms units, keyed by the frequency in kHz. Empty when the
+    // core doesn't export cpufreq stats.
+    std::map<uint32_t, uint64_t> timeInState = {};
+
+    uint64_t totalCpuTime() const {
+        return cpuStats.userTime + cpuStats.niceTime + cpuStats.sysTime + cpuStats.idleTime +
+                cpuStats.ioWaitTime + cpuStats.irqTime + cpuStats.softIrqTime + cpuStats.stealTime +
+                cpuStats.guestTime + cpuStats.guestNiceTime;
+    }
+    // Time spent on anything but the idle task.
+    uint64_t busyTime() const { return totalCpuTime() - cpuStats.idleTime - cpuStats.ioWaitTime; }
+    bool operator==(const CpuCoreUsage& usage) const {
+        return cpu == usage.cpu && memcmp(&cpuStats, &usage.cpuStats, sizeof(cpuStats)) == 0 &&
+                timeInState == usage.timeInState;
+    }
+};
+
+// Collector/parser for the per-CPU `cpuN` lines of the `/proc/stat` file and the
+// `/sys/devices/system/cpu/cpuN/cpufreq/stats/time_in_state` files.
+class CpuCoreStats : public RefBase {
+public:
+    explicit CpuCoreStats(const std::string& procStatPath = kProcStatPath,
+                          const std::string& cpuDirPath = kCpuDirPath) :
+          kEnabled(!access(procStatPath.c_str(), R_OK)),
+          kPath(procStatPath),
+          kCpuPath(cpuDirPath) {}
+
+    virtual ~CpuCoreStats() {}
+
+    // Collects the per-core usage since the last collection, ordered by CPU number. Offline cores
+    // are not listed by the kernel and thus are left out.
+    virtual android::base::Result<std::vector<CpuCoreUsage>> collect();
+
+    // Same as |collect| but parses the `cpuN` lines from |procStatContents| instead of reading the
+    // proc stat file. Lets the caller share a single read of the file with ProcStat.
+    virtual android::base::Result<std::vector<CpuCoreUsage>> collectFrom(
+            const std::string& procStatContents);
+
+    // Returns true when the proc stat file is accessible. Otherwise, returns false.
+    // Called by IoPerfCollection and tests.
+    virtual bool enabled() { return kEnabled; }
+
+    virtual std::string filePath() { return kPath; }
+
+private:
+    // Parses the `cpuN` lines of |procStatContents| and reads the time_in_state files under
+    // |kCpuPath|.
+    android::base::Result<std::vector<CpuCoreUsage>> getCpuCoreUsageLocked(
+            const std::string& procStatContents) const;
+
+    // Makes sure only one collection is running at any given time.
+    Mutex mMutex;
+
+    // Last dump of the per-core usage, keyed by CPU number.
+    std::unordered_map<uint32_t, CpuCoreUsage> mLastCpuCoreUsage GUARDED_BY(mMutex);
+
+    // True if |kPath| is accessible.
+    const bool kEnabled;
+
+    // Path to proc stat file. Default path is |kProcStatPath|.
+    const std::string kPath;
+
+    // Path to the sysfs CPU directory. Default path is |kCpuDirPath|.
+    const std::string kCpuPath;
+};
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
+
+#endif  //  WATCHDOG_SERVER_SRC_CPUCORESTATS_H_
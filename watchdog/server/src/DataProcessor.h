@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WATCHDOG_SERVER_SRC_DATAPROCESSOR_H_
+#define WATCHDOG_SERVER_SRC_DATAPROCESSOR_H_
+
+#include <android-base/result.h>
+#include <time.h>
+#include <utils/RefBase.h>
+#include <utils/Timers.h>
+
+#include <bitset>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CpuCoreStats.h"
+#include "DiskStats.h"
+#include "ProcMemInfo.h"
+#include "ProcPidMem.h"
+#include "ProcPidStat.h"
+#include "ProcStat.h"
+#include "UidIoStats.h"
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+// Data sources sampled by IoPerfCollection on each collection.
+enum DataSource {
+    UID_IO_STATS = 0,  // `/proc/uid_io/stats`
+    PROC_STAT,         // `/proc/stat`
+    PROC_PID_STAT,     // `/proc/[pid]/stat` and `/proc/[pid]/task/[tid]/stat`
+    CPU_CORE_STATS,    // Per-CPU lines of `/proc/stat` and cpufreq time_in_state files
+    DISK_STATS,        // `/proc/diskstats`
+    PROC_MEM_INFO,     // `/proc/meminfo`
+    PROC_PID_MEM,      // `/proc/[pid]/status`
+    NUM_DATA_SOURCES,
+};
+
+using DataSourceSet = std::bitset<DataSource::NUM_DATA_SOURCES>;
+
+// Data sampled from the data sources on a single collection. Each source is read at most once per
+// collection and the snapshot is shared read-only by all the data processors. A source is unset
+// when it is disabled or wasn't requested for the collection.
+struct CollectorSnapshot {
+    nsecs_t uptime = 0;  // Uptime at which the snapshot was sampled.
+    time_t time = 0;     // Wall clock time at which the snapshot was sampled.
+    std::optional<std::unordered_map<uint32_t, UidIoUsage>> uidIoUsages;
+    std::optional<ProcStatInfo> procStatInfo;
+    std::optional<std::vector<ProcessStats>> processStats;
+    std::optional<std::vector<CpuCoreUsage>> cpuCoreUsages;
+    std::optional<std::vector<DiskUsage>> diskUsages;
+    std::optional<MemInfo> memInfo;
+    std::optional<std::vector<ProcessMemStats>> processMemStats;
+    // Package names of the UIDs in |uidIoUsages|, |processStats| and |processMemStats|, when they
+    // could be resolved.
+    std::unordered_map<uint32_t, std::string> packageNames;
+};
+
+// DataProcessor derives its own data from the snapshots sampled by IoPerfCollection. Processors
+// are registered with IoPerfCollection and are called on the collection thread for every
+// boot-time, periodic, resume and custom collection.
+class DataProcessor : public virtual RefBase {
+public:
+    virtual ~DataProcessor() {}
+
+    // Name of the processor. Used in logs and dumps.
+    virtual std::string name() = 0;
+
+    // Returns the data sources read by |onSnapshot|. Requesting a source that is already sampled
+    // for another processor doesn't cost another read.
+    virtual DataSourceSet dataSources() = 0;
+
+    // Processes the snapshot. Returning an error terminates the collection.
+    virtual android::base::Result<void> onSnapshot(const CollectorSnapshot& snapshot) = 0;
+
+    // Called instead of |onSnapshot| with the snapshot that re-baselines the cumulative collectors
+    // on resume. Its deltas span the suspend rather than a collection interval, so they shouldn't
+    // be reported as such, though processors that keep their own running totals should still
+    // account for them. Returning an error terminates the collection.
+    virtual android::base::Result<void> onRebaseline(const CollectorSnapshot& /*snapshot*/) {
+        return {};
+    }
+
+    // Dumps the processed data.
+    virtual android::base::Result<void> onDump(int fd) = 0;
+};
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
+
+#endif  //  WATCHDOG_SERVER_SRC_DATAPROCESSOR_H_
@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "carwatchdogd"
+
+#include "DiskStats.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/utsname.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+using android::base::Error;
+using android::base::ParseUint;
+using android::base::ReadFileToString;
+using android::base::Result;
+using android::base::Split;
+
+namespace {
+
+// /proc/diskstats format:
+// <major> <minor> <device name> <reads completed> <reads merged> <sectors read>
+// <time spent reading (ms)> <writes completed> <writes merged> <sectors written>
+// <time spent writing (ms)> <I/Os in progress> <time spent doing I/Os (ms)>
+// <weighted time spent doing I/Os (ms)> <discards completed> <discards merged>
+// <sectors discarded> <time spent discarding (ms)> <flush requests completed>
+// <time spent flushing (ms)>
+// The discard fields are available since kernel 4.18 and the flush fields since kernel 5.5. Fields
+// added by newer kernels are ignored.
+// Example line: 179 0 mmcblk0 12000 1200 2400000 30000 8000 900 1600000 50000 0 40000 80000 ...
+bool parseDiskStatsLine(const std::string& line, DiskUsage* usage) {
+    std::vector<std::string> fields = Split(line, " ");
+    // Fields are right-aligned with leading spaces, which result in empty fields.
+    fields.erase(std::remove(fields.begin(), fields.end(), ""), fields.end());
+    DiskIoStats* stats = &usage->stats;
+    if (fields.size() < 14 ||
+        !ParseUint(fields[3], &stats->readsCompleted) ||
+        !ParseUint(fields[5], &stats->sectorsRead) ||
+        !ParseUint(fields[6], &stats->readTimeMillis) ||
+        !ParseUint(fields[7], &stats->writesCompleted) ||
+        !ParseUint(fields[9], &stats->sectorsWritten) ||
+        !ParseUint(fields[10], &stats->writeTimeMillis) ||
+        !ParseUint(fields[11], &stats->ioInProgress) ||
+        !ParseUint(fields[12], &stats->ioTimeMillis) ||
+        !ParseUint(fields[13], &stats->weightedIoTimeMillis)) {
+        ALOGW("Invalid diskstats line: \"%s\"", line.c_str());
+        return false;
+    }
+    if (fields.size() >= 18 &&
+        (!ParseUint(fields[14], &stats->discardsCompleted) ||
+         !ParseUint(fields[16], &stats->sectorsDiscarded) ||
+         !ParseUint(fields[17], &stats->discardTimeMillis))) {
+        ALOGW("Invalid discard fields in diskstats line: \"%s\"", line.c_str());
+        return false;
+    }
+    usage->name = fields[2];
+    return true;
+}
+
+// Largest delta taken as a wrap around of a 32-bit counter, i.e., the last value must have been
+// within this distance of 2^32.
+constexpr uint32_t kMaxWrapAroundDelta = 1u << 31;
+
+// Returns the delta of a counter that is |is32Bit| in the kernel. A 32-bit counter wraps around
+// at 2^32. Any other decrease (e.g., a device reset) can't be accounted for, so report no activity
+// instead of a bogus delta.
+uint64_t diff(uint64_t current, uint64_t last, bool is32Bit) {
+    if (current >= last) {
+        return current - last;
+    }
+    if (is32Bit && last <= std::numeric_limits<uint32_t>::max()) {
+        uint32_t delta = static_cast<uint32_t>(current - last);
+        if (delta <= kMaxWrapAroundDelta) {
+            return delta;
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+Result<std::vector<DiskUsage>> DiskStats::collect() {
+    if (!kEnabled) {
+        return Error() << "Can not access " << kPath;
+    }
+
+    Mutex::Autolock lock(mMutex);
+    const auto& usages = getDiskUsageLocked();
+    if (!usages) {
+        return Error() << "Failed to get disk usage: " << usages.error();
+    }
+
+    std::vector<DiskUsage> deltas;
+    std::unordered_map<std::string, DiskIoStats> lastDiskIoStats;
+    for (const auto& usage : *usages) {
+        // Disks that showed up since the last collection have no last stats and thus report the
+        // stats since they were added.
+        const DiskIoStats& last = mLastDiskIoStats[usage.name];
+        const DiskIoStats& cur = usage.stats;
+        DiskUsage delta = {.name = usage.name};
+        // The request and sector counters are unsigned longs in the kernel, while the times are
+        // printed as unsigned ints on every kernel.
+        delta.stats.readsCompleted =
+                diff(cur.readsCompleted, last.readsCompleted, kIs32BitKernel);
+        delta.stats.sectorsRead = diff(cur.sectorsRead, last.sectorsRead, kIs32BitKernel);
+        delta.stats.readTimeMillis = diff(cur.readTimeMillis, last.readTimeMillis, true);
+        delta.stats.writesCompleted =
+                diff(cur.writesCompleted, last.writesCompleted, kIs32BitKernel);
+        delta.stats.sectorsWritten = diff(cur.sectorsWritten, last.sectorsWritten, kIs32BitKernel);
+        delta.stats.writeTimeMillis = diff(cur.writeTimeMillis, last.writeTimeMillis, true);
+        delta.stats.ioInProgress = cur.ioInProgress;
+        delta.stats.ioTimeMillis = diff(cur.ioTimeMillis, last.ioTimeMillis, true);
+        delta.stats.weightedIoTimeMillis =
+                diff(cur.weightedIoTimeMillis, last.weightedIoTimeMillis, true);
+        delta.stats.discardsCompleted =
+                diff(cur.discardsCompleted, last.discardsCompleted, kIs32BitKernel);
+        delta.stats.sectorsDiscarded =
+                diff(cur.sectorsDiscarded, last.sectorsDiscarded, kIs32BitKernel);
+        delta.stats.discardTimeMillis = diff(cur.discardTimeMillis, last.discardTimeMillis, true);
+        deltas.emplace_back(delta);
+        lastDiskIoStats[usage.name] = cur;
+    }
+    // Replace instead of update the cache so removed disks are forgotten.
+    mLastDiskIoStats = lastDiskIoStats;
+    return deltas;
+}
+
+bool DiskStats::is32BitKernel() {
+    // A 32-bit process may run on a 64-bit kernel, so ask the kernel.
+    struct utsname name;
+    return uname(&name) == 0 && strstr(name.machine, "64") == nullptr;
+}
+
+Result<std::vector<DiskUsage>> DiskStats::getDiskUsageLocked() const {
+    std::string buffer;
+    if (!ReadFileToString(kPath, &buffer)) {
+        return Error() << "ReadFileToString failed for " << kPath;
+    }
+
+    std::vector<DiskUsage> usages;
+    std::unordered_set<std::string> names;
+    for (const auto& line : Split(buffer, "\n")) {
+        if (line.empty()) {
+            continue;
+        }
+        DiskUsage usage;
+        if (!parseDiskStatsLine(line, &usage)) {
+            return Error() << "Failed to parse the contents of " << kPath;
+        }
+        if (names.find(usage.name) != names.end()) {
+            return Error() << "Duplicate device " << usage.name << " in " << kPath;
+        }
+        names.insert(usage.name);
+        // Partitions are listed under their disk's directory instead of the top-level directory.
+        if (access((kSysBlockPath + "/" + usage.name).c_str(), F_OK)) {
+            continue;
+        }
+        usages.emplace_back(usage);
+    }
+    return usages;
+}
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
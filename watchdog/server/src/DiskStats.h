@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WATCHDOG_SERVER_SRC_DISKSTATS_H_
+#define WATCHDOG_SERVER_SRC_DISKSTATS_H_
+
+#include <android-base/result.h>
+#include <stdint.h>
+#include <utils/Mutex.h>
+#include <utils/RefBase.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+constexpr const char* kDiskStatsPath = "/proc/diskstats";
+constexpr const char* kSysBlockDirPath = "/sys/block";
+
+struct DiskIoStats {
+    uint64_t readsCompleted = 0;        // Read requests completed.
+    uint64_t sectorsRead = 0;           // 512-byte sectors read.
+    uint64_t readTimeMillis = 0;        // Time spent by all read requests.
+    uint64_t writesCompleted = 0;       // Write requests completed.
+    uint64_t sectorsWritten = 0;        // 512-byte sectors written.
+    uint64_t writeTimeMillis = 0;       // Time spent by all write requests.
+    uint64_t ioInProgress = 0;          // Requests in flight. Not a counter.
+    uint64_t ioTimeMillis = 0;          // Time the device had requests in flight.
+    uint64_t weightedIoTimeMillis = 0;  // |ioTimeMillis| weighted by the requests in flight.
+    uint64_t discardsCompleted = 0;     // Discard requests completed. Kernel 4.18+.
+    uint64_t sectorsDiscarded = 0;      // 512-byte sectors discarded. Kernel 4.18+.
+    uint64_t discardTimeMillis = 0;     // Time spent by all discard requests. Kernel 4.18+.
+};
+
+struct DiskUsage {
+    std::string name;
+    DiskIoStats stats = {};
+
+    bool operator==(const DiskUsage& usage) const {
+        return name == usage.name && memcmp(&stats, &usage.stats, sizeof(stats)) == 0;
+    }
+};
+
+// Collector/parser for `/proc/diskstats` file. Only whole disks, i.e. the devices listed under
+// `/sys/block`, are collected so partitions don't double count the disk activity.
+class DiskStats : public RefBase {
+public:
+    explicit DiskStats(const std::string& diskStatsPath = kDiskStatsPath,
+                       const std::string& sysBlockDirPath = kSysBlockDirPath) :
+          kEnabled(!access(diskStatsPath.c_str(), R_OK)),
+          kIs32BitKernel(is32BitKernel()),
+          kPath(diskStatsPath),
+          kSysBlockPath(sysBlockDirPath) {}
+
+    virtual ~DiskStats() {}
+
+    // Collects the per-disk I/O stats delta since the last collection, in the order listed by
+    // the kernel. |DiskIoStats::ioInProgress| holds the current value instead of a delta.
+    virtual android::base::Result<std::vector<DiskUsage>> collect();
+
+    // Returns true when the diskstats file is accessible. Otherwise, returns false.
+    // Called by IoPerfCollection and tests.
+    virtual bool enabled() { return kEnabled; }
+
+    virtual std::string filePath() { return kPath; }
+
+private:
+    // Returns true when the kernel's unsigned longs, and thus the request and sector counters,
+    // are 32-bit.
+    static bool is32BitKernel();
+
+    // Reads the whole disk lines of |kPath|.
+    android::base::Result<std::vector<DiskUsage>> getDiskUsageLocked() const;
+
+    // Makes sure only one collection is running at any given time.
+    Mutex mMutex;
+
+    // Last dump of the per-disk stats, keyed by device name.
+    std::unordered_map<std::string, DiskIoStats> mLastDiskIoStats GUARDED_BY(mMutex);
+
+    // True if |kPath| is accessible.
+    const bool kEnabled;
+
+    // True if the request and sector counters wrap around at 2^32.
+    const bool kIs32BitKernel;
+
+    // Path to diskstats file. Default path is |kDiskStatsPath|.
+    const std::string kPath;
+
+    // Path to the sysfs block directory. Default path is |kSysBlockDirPath|.
+    const std::string kSysBlockPath;
+};
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
+
+#endif  //  WATCHDOG_SERVER_SRC_DISKSTATS_H_
@@ -0,0 +1,520 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "carwatchdogd"
+
+#include "IoOveruseMonitor.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+#include <android-base/unique_fd.h>
+#include <cutils/android_filesystem_config.h>
+#include <cutils/multiuser.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <log/log.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+using android::base::Dirname;
+using android::base::ErrnoError;
+using android::base::Error;
+using android::base::ParseInt;
+using android::base::ParseUint;
+using android::base::ReadFileToString;
+using android::base::Result;
+using android::base::Split;
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+using android::base::Trim;
+using android::base::unique_fd;
+using android::base::WriteStringToFd;
+
+namespace {
+
+// Number of buckets the budget window is split into. The window slides by one bucket at a time.
+const time_t kNumWindowBuckets = 24;
+
+PackageCategory getPackageCategory(uint32_t uid) {
+    return multiuser_get_app_id(uid) >= AID_APP_START ? PackageCategory::APPLICATION
+                                                      : PackageCategory::SYSTEM;
+}
+
+Result<IoOveruseBudget> parseBudget(const std::string& foregroundBytes,
+                                    const std::string& backgroundBytes) {
+    IoOveruseBudget budget;
+    if (!ParseUint(foregroundBytes, &budget.foregroundWriteBytes) ||
+        !ParseUint(backgroundBytes, &budget.backgroundWriteBytes)) {
+        return Error() << "Invalid write budget";
+    }
+    return budget;
+}
+
+Result<IoOveruseConfig> parseConfig(const std::string& contents) {
+    IoOveruseConfig config;
+    int lineNumber = 0;
+    for (const auto& rawLine : Split(contents, "\n")) {
+        ++lineNumber;
+        std::string line = Trim(rawLine);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::vector<std::string> fields = Split(line, " ");
+        fields.erase(std::remove(fields.begin(), fields.end(), ""), fields.end());
+        if (fields[0] == "window" && fields.size() == 2) {
+            uint32_t seconds;
+            if (!ParseUint(fields[1], &seconds) || seconds == 0) {
+                return Error() << "Invalid window duration at line " << lineNumber;
+            }
+            config.windowDuration = std::chrono::seconds(seconds);
+        } else if (fields[0] == "category" && fields.size() == 4) {
+            PackageCategory category;
+            if (fields[1] == "system") {
+                category = PackageCategory::SYSTEM;
+            } else if (fields[1] == "application") {
+                category = PackageCategory::APPLICATION;
+            } else {
+                return Error() << "Unknown category \"" << fields[1] << "\" at line "
+                               << lineNumber;
+            }
+            const auto& budget = parseBudget(fields[2], fields[3]);
+            if (!budget) {
+                return Error() << budget.error() << " at line " << lineNumber;
+            }
+            config.categoryBudgets[category] = *budget;
+        } else if (fields[0] == "package" && fields.size() == 4) {
+            const auto& budget = parseBudget(fields[2], fields[3]);
+            if (!budget) {
+                return Error() << budget.error() << " at line " << lineNumber;
+            }
+            config.packageBudgets[fields[1]] = *budget;
+        } else {
+            return Error() << "Invalid entry at line " << lineNumber << ": \"" << line << "\"";
+        }
+    }
+    return config;
+}
+
+bool exceedsBudget(uint64_t writeBytes, uint64_t budgetBytes) {
+    return budgetBytes != 0 && writeBytes > budgetBytes;
+}
+
+// Returns the bytes written on top of |accountedBytes|. The kernel counter restarts from zero when
+// its UID is removed, so a counter lower than the accounted bytes is all new writes.
+uint64_t unaccountedBytes(uint64_t totalBytes, uint64_t accountedBytes) {
+    return totalBytes >= accountedBytes ? totalBytes - accountedBytes : totalBytes;
+}
+
+}  // namespace
+
+Result<void> IoOveruseMonitor::init() {
+    std::string bootId;
+    if (!ReadFileToString(kBootIdPath, &bootId)) {
+        ALOGW("Failed to read %s. The I/O overuse state is not restored within the same boot",
+              kBootIdPath.c_str());
+    }
+    {
+        Mutex::Autolock lock(mMutex);
+        mBootId = Trim(bootId);
+    }
+    std::string contents;
+    if (!ReadFileToString(kConfigPath, &contents)) {
+        ALOGW("Failed to read %s. No I/O overuse budget is enforced", kConfigPath.c_str());
+        return {};
+    }
+    const auto& config = parseConfig(contents);
+    if (!config) {
+        return Error() << "Failed to parse " << kConfigPath << ": " << config.error();
+    }
+    Mutex::Autolock lock(mMutex);
+    mConfig = *config;
+    return {};
+}
+
+Result<void> IoOveruseMonitor::onSnapshot(const CollectorSnapshot& snapshot) {
+    if (!snapshot.uidIoUsages) {
+        return {};
+    }
+    std::vector<Notification> notifications;
+    sp<IIoOveruseListener> listener;
+    int64_t windowSeconds;
+    {
+        Mutex::Autolock lock(mMutex);
+        if (!mStateLoaded) {
+            loadStateLocked();
+        }
+        const time_t now = snapshot.time;
+        const time_t bucketStart = now - now % bucketDurationLocked();
+        windowSeconds = mConfig.windowDuration.count();
+        expireBucketsLocked(now);
+        for (const auto& it : *snapshot.uidIoUsages) {
+            const IoUsage& usage = it.second.ios;
+            uint64_t foregroundWriteBytes = usage.metrics[WRITE_BYTES][FOREGROUND];
+            uint64_t backgroundWriteBytes = usage.metrics[WRITE_BYTES][BACKGROUND];
+            if (foregroundWriteBytes == 0 && backgroundWriteBytes == 0) {
+                continue;
+            }
+            UidWriteTotals& totals = mWriteTotals[it.first];
+            totals.foregroundWriteBytes += foregroundWriteBytes;
+            totals.backgroundWriteBytes += backgroundWriteBytes;
+            const auto& restoredIt = mRestoredWriteTotals.find(it.first);
+            if (restoredIt != mRestoredWriteTotals.end()) {
+                foregroundWriteBytes = unaccountedBytes(foregroundWriteBytes,
+                                                        restoredIt->second.foregroundWriteBytes);
+                backgroundWriteBytes = unaccountedBytes(backgroundWriteBytes,
+                                                        restoredIt->second.backgroundWriteBytes);
+                if (foregroundWriteBytes == 0 && backgroundWriteBytes == 0) {
+                    continue;
+                }
+            }
+            UidIoAccount& account = mAccounts[it.first];
+            addWritesLocked(&account, bucketStart, foregroundWriteBytes, backgroundWriteBytes);
+
+            const auto& nameIt = snapshot.packageNames.find(it.first);
+            std::string packageName = nameIt == snapshot.packageNames.end() ? "" : nameIt->second;
+            if (!packageName.empty()) {
+                mPackageNames[it.first] = packageName;
+            }
+            const IoOveruseBudget& budget = budgetLocked(it.first, packageName);
+            if (!exceedsBudget(account.foregroundWriteBytes, budget.foregroundWriteBytes) &&
+                !exceedsBudget(account.backgroundWriteBytes, budget.backgroundWriteBytes)) {
+                continue;
+            }
+            // Threshold crossings are reported once per window.
+            if (account.lastNotificationTime != 0 &&
+                now < account.lastNotificationTime + windowSeconds) {
+                continue;
+            }
+            account.lastNotificationTime = now;
+            notifications.push_back({
+                    .uid = it.first,
+                    .packageName = packageName,
+                    .foregroundWriteBytes = account.foregroundWriteBytes,
+                    .backgroundWriteBytes = account.backgroundWriteBytes,
+            });
+        }
+        mRestoredWriteTotals.clear();
+        mSnapshotAccounted = true;
+        mNumNotifications += notifications.size();
+        if (bucketStart != mLastPersistedBucketStart || !notifications.empty()) {
+            const auto& ret = persistStateLocked();
+            if (!ret) {
+                ALOGW("Failed to persist the I/O overuse state: %s",
+                      ret.error().message().c_str());
+            } else {
+                mLastPersistedBucketStart = bucketStart;
+            }
+        }
+        listener = mListener;
+    }
+    for (const auto& notification : notifications) {
+        ALOGI("UID %" PRIu32 " (%s) exceeded its I/O write budget: %" PRIu64
+              " foreground and %" PRIu64 " background bytes written within %" PRId64 " seconds",
+              notification.uid, notification.packageName.c_str(), notification.foregroundWriteBytes,
+              notification.backgroundWriteBytes, windowSeconds);
+        if (listener == nullptr) {
+            continue;
+        }
+        const auto& status =
+                listener->onIoOveruse(static_cast<int32_t>(notification.uid),
+                                      String16(notification.packageName.c_str()),
+                                      static_cast<int64_t>(notification.foregroundWriteBytes),
+                                      static_cast<int64_t>(notification.backgroundWriteBytes),
+                                      windowSeconds);
+        if (!status.isOk()) {
+            ALOGW("Failed to notify the I/O overuse listener: %s",
+                  status.exceptionMessage().c_str());
+        }
+    }
+    return {};
+}
+
+Result<void> IoOveruseMonitor::onDump(int fd) {
+    Mutex::Autolock lock(mMutex);
+    std::string buffer =
+            StringPrintf("Budget window: %" PRId64 " seconds\nListener registered: %s\n"
+                         "Notifications sent: %" PRIu64 "\n",
+                         static_cast<int64_t>(mConfig.windowDuration.count()),
+                         mListener == nullptr ? "false" : "true", mNumNotifications);
+    std::vector<uint32_t> overusingUids;
+    for (const auto& it : mAccounts) {
+        const auto& nameIt = mPackageNames.find(it.first);
+        const IoOveruseBudget& budget =
+                budgetLocked(it.first, nameIt == mPackageNames.end() ? "" : nameIt->second);
+        if (exceedsBudget(it.second.foregroundWriteBytes, budget.foregroundWriteBytes) ||
+            exceedsBudget(it.second.backgroundWriteBytes, budget.backgroundWriteBytes)) {
+            overusingUids.push_back(it.first);
+        }
+    }
+    std::sort(overusingUids.begin(), overusingUids.end());
+    StringAppendF(&buffer, "UIDs over their write budget: %s\n",
+                  overusingUids.empty() ? "none" : "");
+    for (const auto& uid : overusingUids) {
+        const UidIoAccount& account = mAccounts[uid];
+        const auto& nameIt = mPackageNames.find(uid);
+        std::string packageName = nameIt == mPackageNames.end() ? "" : nameIt->second;
+        const IoOveruseBudget& budget = budgetLocked(uid, packageName);
+        StringAppendF(&buffer,
+                      "\tUID %" PRIu32 " (%s): foreground %" PRIu64 "/%" PRIu64
+                      " bytes, background %" PRIu64 "/%" PRIu64 " bytes\n",
+                      uid, packageName.empty() ? "unknown" : packageName.c_str(),
+                      account.foregroundWriteBytes, budget.foregroundWriteBytes,
+                      account.backgroundWriteBytes, budget.backgroundWriteBytes);
+    }
+    if (!WriteStringToFd(buffer, fd)) {
+        return Error(FAILED_TRANSACTION) << "Failed to dump the I/O overuse report";
+    }
+    return {};
+}
+
+Result<void> IoOveruseMonitor::registerListener(const sp<IIoOveruseListener>& listener) {
+    if (listener == nullptr) {
+        return Error(BAD_VALUE) << "Must provide a valid listener";
+    }
+    Mutex::Autolock lock(mMutex);
+    sp<IBinder> binder = IInterface::asBinder(listener);
+    if (mListener != nullptr) {
+        if (binder == IInterface::asBinder(mListener)) {
+            return {};
+        }
+        IInterface::asBinder(mListener)->unlinkToDeath(this);
+    }
+    status_t status = binder->linkToDeath(this);
+    if (status != OK) {
+        return Error(DEAD_OBJECT) << "The listener is dead";
+    }
+    mListener = listener;
+    return {};
+}
+
+Result<void> IoOveruseMonitor::unregisterListener(const sp<IIoOveruseListener>& listener) {
+    Mutex::Autolock lock(mMutex);
+    if (mListener == nullptr || listener == nullptr ||
+        IInterface::asBinder(listener) != IInterface::asBinder(mListener)) {
+        return Error(BAD_VALUE) << "The listener has not been registered";
+    }
+    IInterface::asBinder(mListener)->unlinkToDeath(this);
+    mListener = nullptr;
+    return {};
+}
+
+void IoOveruseMonitor::binderDied(const wp<IBinder>& who) {
+    Mutex::Autolock lock(mMutex);
+    if (mListener != nullptr && IInterface::asBinder(mListener) == who.unsafe_get()) {
+        ALOGW("The I/O overuse listener has died");
+        mListener = nullptr;
+    }
+}
+
+time_t IoOveruseMonitor::bucketDurationLocked() const {
+    return std::max(static_cast<time_t>(mConfig.windowDuration.count()) / kNumWindowBuckets,
+                    static_cast<time_t>(1));
+}
+
+void IoOveruseMonitor::addWritesLocked(UidIoAccount* account, time_t bucketStart,
+                                       uint64_t foregroundWriteBytes,
+                                       uint64_t backgroundWriteBytes) {
+    // Writes are usually added to the latest bucket. Restored state and wall clock changes may
+    // add writes to older buckets.
+    auto it = std::lower_bound(account->buckets.begin(), account->buckets.end(), bucketStart,
+                               [](const Bucket& bucket, time_t startTime) {
+                                   return bucket.startTime < startTime;
+                               });
+    if (it == account->buckets.end() || it->startTime != bucketStart) {
+        it = account->buckets.insert(it, {bucketStart, 0, 0});
+    }
+    it->foregroundWriteBytes += foregroundWriteBytes;
+    it->backgroundWriteBytes += backgroundWriteBytes;
+    account->foregroundWriteBytes += foregroundWriteBytes;
+    account->backgroundWriteBytes += backgroundWriteBytes;
+}
+
+void IoOveruseMonitor::expireBucketsLocked(time_t now) {
+    const time_t windowSeconds = mConfig.windowDuration.count();
+    const time_t bucketSeconds = bucketDurationLocked();
+    for (auto it = mAccounts.begin(); it != mAccounts.end();) {
+        UidIoAccount& account = it->second;
+        while (!account.buckets.empty() &&
+               account.buckets.front().startTime + bucketSeconds <= now - windowSeconds) {
+            account.foregroundWriteBytes -= account.buckets.front().foregroundWriteBytes;
+            account.backgroundWriteBytes -= account.buckets.front().backgroundWriteBytes;
+            account.buckets.pop_front();
+        }
+        // Keep the account while its last notification still suppresses new notifications.
+        if (account.buckets.empty() &&
+            (account.lastNotificationTime == 0 ||
+             now >= account.lastNotificationTime + windowSeconds)) {
+            mPackageNames.erase(it->first);
+            it = mAccounts.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
+
+const IoOveruseBudget& IoOveruseMonitor::budgetLocked(uint32_t uid,
+                                                      const std::string& packageName) const {
+    const auto& it = mConfig.packageBudgets.find(packageName);
+    if (!packageName.empty() && it != mConfig.packageBudgets.end()) {
+        return it->second;
+    }
+    return mConfig.categoryBudgets[getPackageCategory(uid)];
+}
+
+// The state file has the following lines:
+//   boot_id <boot ID>                                 Boot in which the state was persisted.
+//   total <uid> <fg bytes> <bg bytes>                 Writes by the UID since boot.
+//   <uid> <last notification time> [<bucket start time> <fg bytes> <bg bytes>]...
+//                                                     Writes by the UID within the window.
+void IoOveruseMonitor::loadStateLocked() {
+    if (access(Dirname(kStatePath).c_str(), W_OK) != 0) {
+        // The data partition is not mounted yet. Retry on the next snapshot.
+        return;
+    }
+    mStateLoaded = true;
+    std::string contents;
+    if (!ReadFileToString(kStatePath, &contents)) {
+        return;
+    }
+    std::unordered_map<uint32_t, UidIoAccount> accounts;
+    std::unordered_map<uint32_t, UidWriteTotals> writeTotals;
+    std::string bootId;
+    for (const auto& line : Split(contents, "\n")) {
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields = Split(line, " ");
+        if (fields[0] == "boot_id" && fields.size() == 2) {
+            bootId = fields[1];
+            continue;
+        }
+        uint32_t uid;
+        if (fields[0] == "total") {
+            UidWriteTotals totals;
+            if (fields.size() != 4 || !ParseUint(fields[1], &uid) ||
+                !ParseUint(fields[2], &totals.foregroundWriteBytes) ||
+                !ParseUint(fields[3], &totals.backgroundWriteBytes)) {
+                ALOGW("Discarding the I/O overuse state: Invalid line \"%s\" in %s",
+                      line.c_str(), kStatePath.c_str());
+                return;
+            }
+            writeTotals[uid] = totals;
+            continue;
+        }
+        int64_t lastNotificationTime;
+        if (fields.size() < 2 || (fields.size() - 2) % 3 != 0 || !ParseUint(fields[0], &uid) ||
+            !ParseInt(fields[1], &lastNotificationTime)) {
+            ALOGW("Discarding the I/O overuse state: Invalid line \"%s\" in %s", line.c_str(),
+                  kStatePath.c_str());
+            return;
+        }
+        UidIoAccount& account = accounts[uid];
+        account.lastNotificationTime = static_cast<time_t>(lastNotificationTime);
+        for (size_t i = 2; i < fields.size(); i += 3) {
+            int64_t startTime;
+            uint64_t foregroundWriteBytes, backgroundWriteBytes;
+            if (!ParseInt(fields[i], &startTime) ||
+                !ParseUint(fields[i + 1], &foregroundWriteBytes) ||
+                !ParseUint(fields[i + 2], &backgroundWriteBytes)) {
+                ALOGW("Discarding the I/O overuse state: Invalid line \"%s\" in %s",
+                      line.c_str(), kStatePath.c_str());
+                return;
+            }
+            addWritesLocked(&account, static_cast<time_t>(startTime), foregroundWriteBytes,
+                            backgroundWriteBytes);
+        }
+    }
+    // The counters restart on reboot. When the state is loaded only after some snapshots were
+    // accounted, the snapshots no longer report the writes since boot.
+    if (!mBootId.empty() && bootId == mBootId && !mSnapshotAccounted) {
+        mRestoredWriteTotals = writeTotals;
+    }
+    // Merge with the writes accounted before the state could be loaded.
+    for (auto& it : accounts) {
+        UidIoAccount& account = mAccounts[it.first];
+        account.lastNotificationTime =
+                std::max(account.lastNotificationTime, it.second.lastNotificationTime);
+        for (const auto& bucket : it.second.buckets) {
+            addWritesLocked(&account, bucket.startTime, bucket.foregroundWriteBytes,
+                            bucket.backgroundWriteBytes);
+        }
+    }
+}
+
+Result<void> IoOveruseMonitor::persistStateLocked() {
+    if (!mStateLoaded) {
+        // Don't overwrite the persisted state before it is loaded.
+        return {};
+    }
+    std::string contents;
+    if (!mBootId.empty()) {
+        StringAppendF(&contents, "boot_id %s\n", mBootId.c_str());
+    }
+    for (const auto& it : mWriteTotals) {
+        StringAppendF(&contents, "total %" PRIu32 " %" PRIu64 " %" PRIu64 "\n", it.first,
+                      it.second.foregroundWriteBytes, it.second.backgroundWriteBytes);
+    }
+    for (const auto& it : mAccounts) {
+        StringAppendF(&contents, "%" PRIu32 " %" PRId64, it.first,
+                      static_cast<int64_t>(it.second.lastNotificationTime));
+        for (const auto& bucket : it.second.buckets) {
+            StringAppendF(&contents, " %" PRId64 " %" PRIu64 " %" PRIu64,
+                          static_cast<int64_t>(bucket.startTime), bucket.foregroundWriteBytes,
+                          bucket.backgroundWriteBytes);
+        }
+        contents += "\n";
+    }
+    // Write to a temporary file and rename it, so a crash never leaves a partial state file. The
+    // file is synced before the rename and the directory after it, so a power loss doesn't leave
+    // an empty state file or lose the rename.
+    std::string tempPath = kStatePath + ".tmp";
+    {
+        unique_fd fd(TEMP_FAILURE_RETRY(
+                open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)));
+        if (fd.get() < 0) {
+            return ErrnoError() << "Failed to open " << tempPath;
+        }
+        if (!WriteStringToFd(contents, fd.get())) {
+            return ErrnoError() << "Failed to write " << tempPath;
+        }
+        if (fsync(fd.get()) != 0) {
+            return ErrnoError() << "Failed to sync " << tempPath;
+        }
+    }
+    if (rename(tempPath.c_str(), kStatePath.c_str()) != 0) {
+        return ErrnoError() << "Failed to rename " << tempPath << " to " << kStatePath;
+    }
+    std::string dirPath = Dirname(kStatePath);
+    unique_fd dirFd(TEMP_FAILURE_RETRY(open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+    if (dirFd.get() < 0 || fsync(dirFd.get()) != 0) {
+        return ErrnoError() << "Failed to sync " << dirPath;
+    }
+    return {};
+}
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
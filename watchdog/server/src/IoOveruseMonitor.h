@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WATCHDOG_SERVER_SRC_IOOVERUSEMONITOR_H_
+#define WATCHDOG_SERVER_SRC_IOOVERUSEMONITOR_H_
+
+#include <android-base/result.h>
+#include <android/automotive/watchdog/IIoOveruseListener.h>
+#include <binder/IBinder.h>
+#include <gtest/gtest_prod.h>
+#include <time.h>
+#include <utils/Mutex.h>
+#include <utils/StrongPointer.h>
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+#include "DataProcessor.h"
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+constexpr const char* kIoOveruseConfigPath = "/system/etc/carwatchdog/io_overuse_config.txt";
+constexpr const char* kIoOveruseStatePath = "/data/misc/carwatchdog/io_overuse_state.txt";
+constexpr const char* kKernelBootIdPath = "/proc/sys/kernel/random/boot_id";
+constexpr std::chrono::seconds kDefaultIoOveruseWindowDuration = std::chrono::hours(24);
+
+enum PackageCategory {
+    SYSTEM = 0,   // Native and system UIDs.
+    APPLICATION,  // Application UIDs.
+    NUM_PACKAGE_CATEGORIES,
+};
+
+// Bytes a package may write within the budget window. Zero bytes means unlimited.
+struct IoOveruseBudget {
+    uint64_t foregroundWriteBytes = 0;
+    uint64_t backgroundWriteBytes = 0;
+};
+
+// Write budgets read from the config file. The file has one entry per line:
+//   window <seconds>                                  Duration of the budget window.
+//   category <system|application> <fg bytes> <bg bytes>  Default budget of the category.
+//   package <package name> <fg bytes> <bg bytes>      Budget of the package.
+// Lines starting with '#' are ignored. A package budget overrides the budget of its category.
+struct IoOveruseConfig {
+    std::chrono::seconds windowDuration = kDefaultIoOveruseWindowDuration;
+    IoOveruseBudget categoryBudgets[NUM_PACKAGE_CATEGORIES];
+    std::unordered_map<std::string, IoOveruseBudget> packageBudgets;
+};
+
+// IoOveruseMonitor accounts the bytes written by each UID over a sliding window and notifies the
+// registered listener when a UID writes more than its budget, at most once per window.
+//
+// The window is split into fixed buckets aligned to the wall clock time, so the accounting is
+// persisted to |statePath| and restored after restarts. The state is written whenever a new
+// bucket begins or a listener is notified, so at most one bucket of writes is lost on a crash.
+// carwatchdogd starts before /data is mounted, so the state is loaded on the first snapshot after
+// the state directory becomes available.
+//
+// The first snapshot of a new process reports the writes since boot, because the kernel counters
+// are cumulative. Thus the state also holds the boot ID and the cumulative writes accounted so
+// far. After a restart within the same boot, the first snapshot accounts only the writes on top of
+// the persisted cumulative writes, which also recovers the writes lost since the last persist.
+class IoOveruseMonitor : public DataProcessor, public IBinder::DeathRecipient {
+public:
+    explicit IoOveruseMonitor(const std::string& configPath = kIoOveruseConfigPath,
+                              const std::string& statePath = kIoOveruseStatePath,
+                              const std::string& bootIdPath = kKernelBootIdPath) :
+          kConfigPath(configPath),
+          kStatePath(statePath),
+          kBootIdPath(bootIdPath),
+          mStateLoaded(false),
+          mSnapshotAccounted(false),
+          mLastPersistedBucketStart(0),
+          mNumNotifications(0) {}
+
+    virtual ~IoOveruseMonitor() {}
+
+    // Reads the boot ID and the write budgets from the config file. When the config file is
+    // missing, no budget is enforced.
+    android::base::Result<void> init();
+
+    std::string name() override { return "I/O overuse monitor"; }
+    DataSourceSet dataSources() override {
+        return DataSourceSet().set(DataSource::UID_IO_STATS);
+    }
+    android::base::Result<void> onSnapshot(const CollectorSnapshot& snapshot) override;
+    // The writes accumulated across suspend are real writes, so they are accounted like the writes
+    // of any other snapshot. Otherwise, the persisted totals fall behind the kernel counters and
+    // the missed writes are charged again after a restart within the same boot.
+    android::base::Result<void> onRebaseline(const CollectorSnapshot& snapshot) override {
+        return onSnapshot(snapshot);
+    }
+    android::base::Result<void> onDump(int fd) override;
+
+    // Registers the listener notified on I/O overuse. Replaces the previously registered listener.
+    virtual android::base::Result<void> registerListener(
+            const android::sp<IIoOveruseListener>& listener);
+    virtual android::base::Result<void> unregisterListener(
+            const android::sp<IIoOveruseListener>& listener);
+
+private:
+    struct Bucket {
+        time_t startTime;
+        uint64_t foregroundWriteBytes;
+        uint64_t backgroundWriteBytes;
+    };
+
+    // Writes by a UID within the current window.
+    struct UidIoAccount {
+        std::deque<Bucket> buckets;  // Sorted by |startTime|.
+        uint64_t foregroundWriteBytes = 0;
+        uint64_t backgroundWriteBytes = 0;
+        time_t lastNotificationTime = 0;
+    };
+
+    // Writes by a UID since boot, as reported by the kernel counters.
+    struct UidWriteTotals {
+        uint64_t foregroundWriteBytes = 0;
+        uint64_t backgroundWriteBytes = 0;
+    };
+
+    struct Notification {
+        uint32_t uid;
+        std::string packageName;
+        uint64_t foregroundWriteBytes;
+        uint64_t backgroundWriteBytes;
+    };
+
+    void binderDied(const android::wp<IBinder>& who) override;
+
+    time_t bucketDurationLocked() const;
+    void addWritesLocked(UidIoAccount* account, time_t bucketStart, uint64_t foregroundWriteBytes,
+                         uint64_t backgroundWriteBytes);
+    void expireBucketsLocked(time_t now);
+    const IoOveruseBudget& budgetLocked(uint32_t uid, const std::string& packageName) const;
+    void loadStateLocked();
+    android::base::Result<void> persistStateLocked();
+
+    const std::string kConfigPath;
+    const std::string kStatePath;
+    const std::string kBootIdPath;
+
+    Mutex mMutex;
+    IoOveruseConfig mConfig GUARDED_BY(mMutex);
+    std::unordered_map<uint32_t, UidIoAccount> mAccounts GUARDED_BY(mMutex);
+    // Last known package names of the UIDs in |mAccounts|. Used only in the dump.
+    std::unordered_map<uint32_t, std::string> mPackageNames GUARDED_BY(mMutex);
+    // Empty when the boot ID is unknown.
+    std::string mBootId GUARDED_BY(mMutex);
+    std::unordered_map<uint32_t, UidWriteTotals> mWriteTotals GUARDED_BY(mMutex);
+    // Write totals persisted by the previous process in the same boot. Only the first snapshot is
+    // accounted against them.
+    std::unordered_map<uint32_t, UidWriteTotals> mRestoredWriteTotals GUARDED_BY(mMutex);
+    bool mStateLoaded GUARDED_BY(mMutex);
+    bool mSnapshotAccounted GUARDED_BY(mMutex);
+    time_t mLastPersistedBucketStart GUARDED_BY(mMutex);
+    uint64_t mNumNotifications GUARDED_BY(mMutex);
+    android::sp<IIoOveruseListener> mListener GUARDED_BY(mMutex);
+
+    FRIEND_TEST(IoOveruseMonitorTest, TestParsesConfig);
+};
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
+
+#endif  //  WATCHDOG_SERVER_SRC_IOOVERUSEMONITOR_H_
@@ -30,6 +30,7 @@
 #include <processgroup/sched_policy.h>
 #include <pthread.h>
 #include <pwd.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <iomanip>
@@ -52,6 +53,7 @@ using android::sp;
 using android::String16;
 using android::base::Error;
 using android::base::ParseUint;
+using android::base::ReadFileToString;
 using android::base::Result;
 using android::base::Split;
 using android::base::StringAppendF;
@@ -67,6 +69,8 @@ const std::chrono::seconds kDefaultBoottimeCollectionInterval = 1s;
 const std::chrono::seconds kDefaultPeriodicCollectionInterval = 10s;
 // Number of periodic collection perf data snapshots to cache in memory.
 const int32_t kDefaultPeriodicCollectionBufferSize = 180;
+// Resume collection is disabled by default.
+const std::chrono::seconds kDefaultResumeCollectionDuration = 0s;
 
 // Minimum collection interval between subsequent collections.
 const std::chrono::nanoseconds kMinCollectionInterval = 1s;
@@ -77,6 +81,14 @@ const std::chrono::nanoseconds kCustomCollectionDuration = 30min;
 
 const std::string kDumpMajorDelimiter = std::string(100, '-') + "\n";
 
+// Memory usage changes slowly and reading every process's status file is costly. Thus the
+// boot-time and periodic collections sample the memory usage at most once per this interval.
+// Custom collections sample it on every collection.
+const std::chrono::nanoseconds kMemoryCollectionInterval = 1min;
+
+// Unit of the CPU times in the `/proc/[pid]/stat` files.
+const int64_t kClockTicksPerSecond = sysconf(_SC_CLK_TCK);
+
 constexpr const char* kHelpText =
         "\nCustom I/O performance data collection dump options:\n"
         "%s: Starts custom I/O performance data collection. Customize the collection behavior with "
@@ -99,6 +111,14 @@ double percentage(uint64_t numer, uint64_t denom) {
     return denom == 0 ? 0.0 : (static_cast<double>(numer) / static_cast<double>(denom)) * 100.0;
 }
 
+double ratio(uint64_t numer, uint64_t denom) {
+    return denom == 0 ? 0.0 : static_cast<double>(numer) / static_cast<double>(denom);
+}
+
+double perSecond(uint64_t count, uint64_t durationMillis) {
+    return ratio(count * 1000, durationMillis);
+}
+
 struct UidProcessStats {
     struct ProcessInfo {
         std::string comm = "";
@@ -108,8 +128,10 @@ struct UidProcessStats {
     uint32_t ioBlockedTasksCnt = 0;
     uint32_t totalTasksCnt = 0;
     uint64_t majorFaults = 0;
+    uint64_t cpuTimeMillis = 0;
     std::vector<ProcessInfo> topNIoBlockedProcesses = {};
     std::vector<ProcessInfo> topNMajorFaultProcesses = {};
+    std::vector<ProcessInfo> topNCpuTimeProcesses = {};
 };
 
 std::unique_ptr<std::unordered_map<uint32_t, UidProcessStats>> getUidProcessStats(
@@ -130,12 +152,18 @@ std::unique_ptr<std::unordered_map<uint32_t, UidProcessStats>> getUidProcessStat
                     .topNMajorFaultProcesses = std::vector<
                             UidProcessStats::ProcessInfo>(topNStatsPerSubCategory,
                                                           UidProcessStats::ProcessInfo{}),
+                    .topNCpuTimeProcesses = std::vector<
+                            UidProcessStats::ProcessInfo>(topNStatsPerSubCategory,
+                                                          UidProcessStats::ProcessInfo{}),
             };
         }
         auto& curUidProcessStats = (*uidProcessStats)[uid];
         // Top-level process stats has the aggregated major page faults count and this should be
         // persistent across thread creation/termination. Thus use the value from this field.
         curUidProcessStats.majorFaults += stats.process.majorFaults;
+        // Likewise, the top-level process stats has the CPU time of the terminated threads too.
+        uint64_t cpuTimeMillis = (stats.process.cpuTime * 1000) / kClockTicksPerSecond;
+        curUidProcessStats.cpuTimeMillis += cpuTimeMillis;
         curUidProcessStats.totalTasksCnt += stats.threads.size();
         // The process state is the same as the main thread state. Thus to avoid double counting
         // ignore the process state.
@@ -170,10 +198,66 @@ std::unique_ptr<std::unordered_map<uint32_t, UidProcessStats>> getUidProcessStat
                 break;
             }
         }
+        for (auto it = curUidProcessStats.topNCpuTimeProcesses.begin();
+             it != curUidProcessStats.topNCpuTimeProcesses.end(); ++it) {
+            if (it->count < cpuTimeMillis) {
+                curUidProcessStats.topNCpuTimeProcesses
+                        .emplace(it,
+                                 UidProcessStats::ProcessInfo{
+                                         .comm = stats.process.comm,
+                                         .count = cpuTimeMillis,
+                                 });
+                curUidProcessStats.topNCpuTimeProcesses.pop_back();
+                break;
+            }
+        }
     }
     return uidProcessStats;
 }
 
+struct UidMemStats {
+    uint32_t uid = 0;
+    uint64_t rssKb = 0;
+    uint64_t swapKb = 0;
+    std::vector<MemoryPerfData::UidStats::ProcessStats> topNProcesses = {};
+};
+
+std::unique_ptr<std::unordered_map<uint32_t, UidMemStats>> getUidMemStats(
+        const std::vector<ProcessMemStats>& processMemStats, int topNStatsPerSubCategory) {
+    std::unique_ptr<std::unordered_map<uint32_t, UidMemStats>> uidMemStats(
+            new std::unordered_map<uint32_t, UidMemStats>());
+    for (const auto& stats : processMemStats) {
+        if (stats.uid < 0) {
+            continue;
+        }
+        uint32_t uid = static_cast<uint32_t>(stats.uid);
+        if (uidMemStats->find(uid) == uidMemStats->end()) {
+            (*uidMemStats)[uid] = UidMemStats{
+                    .uid = uid,
+                    .topNProcesses = std::vector<MemoryPerfData::UidStats::ProcessStats>(
+                            topNStatsPerSubCategory, MemoryPerfData::UidStats::ProcessStats{}),
+            };
+        }
+        auto& curUidMemStats = (*uidMemStats)[uid];
+        curUidMemStats.rssKb += stats.rssKb;
+        curUidMemStats.swapKb += stats.swapKb;
+        for (auto it = curUidMemStats.topNProcesses.begin();
+             it != curUidMemStats.topNProcesses.end(); ++it) {
+            if (it->rssKb < stats.rssKb) {
+                curUidMemStats.topNProcesses.emplace(it,
+                                                     MemoryPerfData::UidStats::ProcessStats{
+                                                             .comm = stats.comm,
+                                                             .rssKb = stats.rssKb,
+                                                             .swapKb = stats.swapKb,
+                                                     });
+                curUidMemStats.topNProcesses.pop_back();
+                break;
+            }
+        }
+    }
+    return uidMemStats;
+}
+
 Result<std::chrono::seconds> parseSecondsFlag(Vector<String16> args, size_t pos) {
     if (args.size() < pos) {
         return Error() << "Value not provided";
@@ -261,6 +345,25 @@ std::string toString(const ProcessIoPerfData& data) {
                           procStats.count, percentage(procStats.count, uidStats.count));
         }
     }
+    StringAppendF(&buffer,
+                  "Total CPU time of all processes since last collection: %" PRIu64 " ms\n",
+                  data.totalCpuTimeMillis);
+    if (data.topNCpuTimeUids.size() > 0) {
+        StringAppendF(&buffer, "\nTop N CPU time:\n%s\n", std::string(15, '-').c_str());
+        StringAppendF(&buffer,
+                      "Android User ID, Package Name, CPU time (ms), Percentage of total CPU "
+                      "time\n");
+        StringAppendF(&buffer, "\tCommand, CPU time (ms), Percentage of UID's CPU time\n");
+    }
+    for (const auto& uidStats : data.topNCpuTimeUids) {
+        StringAppendF(&buffer, "%" PRIu32 ", %s, %" PRIu64 ", %.2f%%\n", uidStats.userId,
+                      uidStats.packageName.c_str(), uidStats.count,
+                      percentage(uidStats.count, data.totalCpuTimeMillis));
+        for (const auto& procStats : uidStats.topNProcesses) {
+            StringAppendF(&buffer, "\t%s, %" PRIu64 ", %.2f%%\n", procStats.comm.c_str(),
+                          procStats.count, percentage(procStats.count, uidStats.count));
+        }
+    }
     if (data.topNIoBlockedUids.size() > 0) {
         StringAppendF(&buffer, "\nTop N I/O waiting UIDs:\n%s\n", std::string(23, '-').c_str());
         StringAppendF(&buffer,
@@ -283,10 +386,109 @@ std::string toString(const ProcessIoPerfData& data) {
     return buffer;
 }
 
+std::string toString(const DiskIoPerfData& data) {
+    std::string buffer;
+    if (data.devices.size() > 0) {
+        StringAppendF(&buffer, "\nBlock device I/O:\n%s\n", std::string(17, '-').c_str());
+        StringAppendF(&buffer,
+                      "Device, Reads/s, Read kB/s, Writes/s, Write kB/s, Discards/s, Discard kB/s, "
+                      "Avg I/O latency (ms), Avg service time (ms), Utilization %%, "
+                      "Avg queue depth, In-flight I/Os\n");
+    }
+    for (const auto& device : data.devices) {
+        uint64_t ios = device.reads + device.writes + device.discards;
+        StringAppendF(&buffer,
+                      "%s, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f, %.2f%%, %.2f, %" PRIu64
+                      "\n",
+                      device.name.c_str(), perSecond(device.reads, data.durationMillis),
+                      perSecond(device.readKb, data.durationMillis),
+                      perSecond(device.writes, data.durationMillis),
+                      perSecond(device.writeKb, data.durationMillis),
+                      perSecond(device.discards, data.durationMillis),
+                      perSecond(device.discardKb, data.durationMillis),
+                      ratio(device.waitTimeMillis, ios), ratio(device.ioTimeMillis, ios),
+                      percentage(device.ioTimeMillis, data.durationMillis),
+                      ratio(device.weightedIoTimeMillis, data.durationMillis),
+                      device.ioInProgress);
+    }
+    return buffer;
+}
+
+std::string toString(const CpuCorePerfData& data) {
+    std::string buffer;
+    if (data.cores.size() > 0) {
+        StringAppendF(&buffer, "\nPer-core CPU usage:\n%s\n", std::string(19, '-').c_str());
+        StringAppendF(&buffer,
+                      "CPU, Busy time, Busy time %%, I/O wait time, I/O wait time %%\n");
+        StringAppendF(&buffer, "\tFrequency (kHz), Time at frequency, Percentage of time\n");
+    }
+    for (const auto& core : data.cores) {
+        StringAppendF(&buffer, "cpu%" PRIu32 ", %" PRIu64 ", %.2f%%, %" PRIu64 ", %.2f%%\n",
+                      core.cpu, core.busyTime, percentage(core.busyTime, core.totalCpuTime),
+                      core.ioWaitTime, percentage(core.ioWaitTime, core.totalCpuTime));
+        uint64_t totalTimeInState = 0;
+        for (const auto& it : core.timeInState) {
+            totalTimeInState += it.second;
+        }
+        for (const auto& it : core.timeInState) {
+            StringAppendF(&buffer, "\t%" PRIu32 ", %" PRIu64 ", %.2f%%\n", it.first, it.second,
+                          percentage(it.second, totalTimeInState));
+        }
+    }
+    return buffer;
+}
+
+std::string toString(const MemoryPerfData& data) {
+    std::string buffer;
+    if (data.memInfo.memTotalKb > 0) {
+        const MemInfo& info = data.memInfo;
+        StringAppendF(&buffer, "\nSystem memory usage:\n%s\n", std::string(20, '-').c_str());
+        StringAppendF(&buffer,
+                      "Total memory: %" PRIu64 " kB\nAvailable memory: %" PRIu64
+                      " kB, %.2f%% (%+" PRId64 " kB since last memory collection)\n",
+                      info.memTotalKb, info.memAvailableKb,
+                      percentage(info.memAvailableKb, info.memTotalKb), data.memAvailableDeltaKb);
+        StringAppendF(&buffer,
+                      "Free memory: %" PRIu64 " kB\nBuffers: %" PRIu64 " kB\nCached: %" PRIu64
+                      " kB\n",
+                      info.memFreeKb, info.buffersKb, info.cachedKb);
+        StringAppendF(&buffer, "Used swap: %" PRIu64 " kB of %" PRIu64 " kB\n",
+                      info.swapTotalKb - std::min(info.swapFreeKb, info.swapTotalKb),
+                      info.swapTotalKb);
+    }
+    if (data.topNRssUids.size() > 0) {
+        StringAppendF(&buffer,
+                      "Total RSS of all processes: %" PRIu64 " kB\nTotal swap of all processes: "
+                      "%" PRIu64 " kB\n",
+                      data.totalRssKb, data.totalSwapKb);
+        StringAppendF(&buffer, "\nTop N memory consumers:\n%s\n", std::string(23, '-').c_str());
+        StringAppendF(&buffer,
+                      "Android User ID, Package Name, RSS (kB), Percentage of total RSS, RSS "
+                      "change since last memory collection (kB), Swap (kB)\n");
+        StringAppendF(&buffer, "\tCommand, RSS (kB), Percentage of UID's RSS, Swap (kB)\n");
+    }
+    for (const auto& uidStats : data.topNRssUids) {
+        StringAppendF(&buffer,
+                      "%" PRIu32 ", %s, %" PRIu64 ", %.2f%%, %+" PRId64 ", %" PRIu64 "\n",
+                      uidStats.userId, uidStats.packageName.c_str(), uidStats.rssKb,
+                      percentage(uidStats.rssKb, data.totalRssKb), uidStats.rssDeltaKb,
+                      uidStats.swapKb);
+        for (const auto& procStats : uidStats.topNProcesses) {
+            StringAppendF(&buffer, "\t%s, %" PRIu64 ", %.2f%%, %" PRIu64 "\n",
+                          procStats.comm.c_str(), procStats.rssKb,
+                          percentage(procStats.rssKb, uidStats.rssKb), procStats.swapKb);
+        }
+    }
+    return buffer;
+}
+
 std::string toString(const IoPerfRecord& record) {
     std::string buffer;
-    StringAppendF(&buffer, "%s%s%s", toString(record.systemIoPerfData).c_str(),
+    StringAppendF(&buffer, "%s%s%s%s%s%s", toString(record.systemIoPerfData).c_str(),
+                  toString(record.diskIoPerfData).c_str(),
+                  toString(record.cpuCorePerfData).c_str(),
                   toString(record.processIoPerfData).c_str(),
+                  toString(record.memoryPerfData).c_str(),
                   toString(record.uidIoPerfData).c_str());
     return buffer;
 }
@@ -330,6 +532,9 @@ Result<void> IoPerfCollection::start() {
         size_t periodicCollectionBufferSize =
                 static_cast<size_t>(sysprop::periodicCollectionBufferSize().value_or(
                         kDefaultPeriodicCollectionBufferSize));
+        mResumeCollectionDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::seconds(sysprop::resumeCollectionDuration().value_or(
+                        kDefaultResumeCollectionDuration.count())));
         mBoottimeCollection = {
                 .interval = boottimeCollectionInterval,
                 .maxCacheSize = std::numeric_limits<std::size_t>::max(),
@@ -342,6 +547,12 @@ Result<void> IoPerfCollection::start() {
                 .lastCollectionUptime = 0,
                 .records = {},
         };
+        mResumeCollection = {
+                .interval = boottimeCollectionInterval,
+                .maxCacheSize = std::numeric_limits<std::size_t>::max(),
+                .lastCollectionUptime = 0,
+                .records = {},
+        };
     }
 
     mCollectionThread = std::thread([&]() {
@@ -396,6 +607,20 @@ void IoPerfCollection::terminate() {
     }
 }
 
+Result<void> IoPerfCollection::registerDataProcessor(const sp<DataProcessor>& processor) {
+    if (processor == nullptr) {
+        return Error(BAD_VALUE) << "Must provide a valid data processor";
+    }
+    Mutex::Autolock lock(mMutex);
+    if (std::find(mDataProcessors.begin(), mDataProcessors.end(), processor) !=
+        mDataProcessors.end()) {
+        return Error(INVALID_OPERATION)
+                << "Data processor " << processor->name() << " is already registered";
+    }
+    mDataProcessors.push_back(processor);
+    return {};
+}
+
 Result<void> IoPerfCollection::onBootFinished() {
     Mutex::Autolock lock(mMutex);
     if (mCurrCollectionEvent != CollectionEvent::BOOT_TIME) {
@@ -414,6 +639,39 @@ Result<void> IoPerfCollection::onBootFinished() {
     return {};
 }
 
+Result<void> IoPerfCollection::onSuspend() {
+    Mutex::Autolock lock(mMutex);
+    if (mCurrCollectionEvent == CollectionEvent::SUSPENDED) {
+        // A resume that wasn't handled yet leaves the collection suspended until its message is
+        // processed. Drop the message so this suspend isn't undone by it.
+        mHandlerLooper->removeMessages(this);
+        return {};
+    }
+    if (mCurrCollectionEvent != CollectionEvent::PERIODIC &&
+        mCurrCollectionEvent != CollectionEvent::RESUME) {
+        // The boot-time and custom collections are short-lived and explicitly requested, so let
+        // them run until they end. Don't return error as this will lead to runtime exception.
+        ALOGW("Skipping suspend on I/O performance data collection event %s",
+              toString(mCurrCollectionEvent).c_str());
+        return {};
+    }
+    mHandlerLooper->removeMessages(this);
+    mCurrCollectionEvent = CollectionEvent::SUSPENDED;
+    return {};
+}
+
+Result<void> IoPerfCollection::onResume() {
+    Mutex::Autolock lock(mMutex);
+    if (mCurrCollectionEvent != CollectionEvent::SUSPENDED) {
+        ALOGW("Skipping resume on I/O performance data collection event %s",
+              toString(mCurrCollectionEvent).c_str());
+        return {};
+    }
+    mHandlerLooper->removeMessages(this);
+    mHandlerLooper->sendMessage(this, SwitchEvent::END_SUSPEND);
+    return {};
+}
+
 Result<void> IoPerfCollection::onCustomCollection(int fd, const Vector<String16>& args) {
     if (args.empty()) {
         return Error(BAD_VALUE) << "No I/O perf collection dump arguments";
@@ -515,9 +773,29 @@ Result<void> IoPerfCollection::onDump(int fd) {
                                       std::string(75, '-').c_str(), std::string(27, '=').c_str()),
                          fd) ||
         !WriteStringToFd(toString(mPeriodicCollection), fd) ||
+        !WriteStringToFd(StringPrintf("%s\nResume collection report:\n%s\n",
+                                      std::string(75, '-').c_str(), std::string(25, '=').c_str()),
+                         fd) ||
+        !WriteStringToFd(toString(mResumeCollection), fd) ||
         !WriteStringToFd(kDumpMajorDelimiter, fd)) {
         return Error(FAILED_TRANSACTION)
-                << "Failed to dump the boot-time and periodic collection reports.";
+                << "Failed to dump the boot-time, periodic and resume collection reports.";
+    }
+    for (const auto& processor : mDataProcessors) {
+        std::string title = processor->name() + " data processor report:";
+        if (!WriteStringToFd(StringPrintf("%s\n%s\n", title.c_str(),
+                                          std::string(title.size(), '=').c_str()),
+                             fd)) {
+            return Error(FAILED_TRANSACTION) << "Failed to dump the data processor reports.";
+        }
+        const auto& ret = processor->onDump(fd);
+        if (!ret) {
+            return Error(FAILED_TRANSACTION)
+                    << "Failed to dump " << processor->name() << " data processor: " << ret.error();
+        }
+        if (!WriteStringToFd(kDumpMajorDelimiter, fd)) {
+            return Error(FAILED_TRANSACTION) << "Failed to dump the data processor reports.";
+        }
     }
     return {};
 }
@@ -560,6 +838,30 @@ Result<void> IoPerfCollection::dumpCollectorsStatusLocked(int fd) {
                          fd)) {
         return Error() << "Failed to write ProcPidStat collector status";
     }
+    if (!mCpuCoreStats->enabled() &&
+        !WriteStringToFd(StringPrintf("CpuCoreStats collector failed to access the file %s",
+                                      mCpuCoreStats->filePath().c_str()),
+                         fd)) {
+        return Error() << "Failed to write CpuCoreStats collector status";
+    }
+    if (!mDiskStats->enabled() &&
+        !WriteStringToFd(StringPrintf("DiskStats collector failed to access the file %s",
+                                      mDiskStats->filePath().c_str()),
+                         fd)) {
+        return Error() << "Failed to write DiskStats collector status";
+    }
+    if (!mProcMemInfo->enabled() &&
+        !WriteStringToFd(StringPrintf("ProcMemInfo collector failed to access the file %s",
+                                      mProcMemInfo->filePath().c_str()),
+                         fd)) {
+        return Error() << "Failed to write ProcMemInfo collector status";
+    }
+    if (!mProcPidMem->enabled() &&
+        !WriteStringToFd(StringPrintf("ProcPidMem collector failed to access the directory %s",
+                                      mProcPidMem->dirPath().c_str()),
+                         fd)) {
+        return Error() << "Failed to write ProcPidMem collector status";
+    }
     return {};
 }
 
@@ -661,6 +963,32 @@ void IoPerfCollection::handleMessage(const Message& message) {
             mHandlerLooper->sendMessage(this, CollectionEvent::PERIODIC);
             return;
         }
+        case static_cast<int>(SwitchEvent::END_SUSPEND):
+            result = resumeCollection();
+            break;
+        case static_cast<int>(CollectionEvent::RESUME):
+            result = processCollectionEvent(CollectionEvent::RESUME, &mResumeCollection);
+            break;
+        case static_cast<int>(SwitchEvent::END_RESUME_COLLECTION): {
+            result = processCollectionEvent(CollectionEvent::RESUME, &mResumeCollection);
+            if (!result.ok()) {
+                break;
+            }
+            Mutex::Autolock lock(mMutex);
+            if (mCurrCollectionEvent != CollectionEvent::RESUME) {
+                ALOGW("Skipping END_RESUME_COLLECTION message as the current collection %s != %s",
+                      toString(mCurrCollectionEvent).c_str(),
+                      toString(CollectionEvent::RESUME).c_str());
+                return;
+            }
+            mHandlerLooper->removeMessages(this);
+            mCurrCollectionEvent = CollectionEvent::PERIODIC;
+            mPeriodicCollection.lastCollectionUptime =
+                    mHandlerLooper->now() + mPeriodicCollection.interval.count();
+            mHandlerLooper->sendMessageAtTime(mPeriodicCollection.lastCollectionUptime, this,
+                                              CollectionEvent::PERIODIC);
+            return;
+        }
         default:
             result = Error() << "Unknown message: " << message.what;
     }
@@ -676,6 +1004,70 @@ void IoPerfCollection::handleMessage(const Message& message) {
     }
 }
 
+Result<void> IoPerfCollection::resumeCollection() {
+    Mutex::Autolock lock(mMutex);
+    if (mCurrCollectionEvent != CollectionEvent::SUSPENDED) {
+        ALOGW("Skipping END_SUSPEND message as the current collection %s != %s",
+              toString(mCurrCollectionEvent).c_str(), toString(CollectionEvent::SUSPENDED).c_str());
+        return {};
+    }
+    auto ret = rebaselineCollectorsLocked();
+    if (!ret) {
+        return Error() << "Failed to re-baseline the collectors on resume: " << ret.error();
+    }
+    nsecs_t now = mHandlerLooper->now();
+    if (mResumeCollectionDuration.count() == 0) {
+        mCurrCollectionEvent = CollectionEvent::PERIODIC;
+        mPeriodicCollection.lastCollectionUptime = now + mPeriodicCollection.interval.count();
+        mHandlerLooper->sendMessageAtTime(mPeriodicCollection.lastCollectionUptime, this,
+                                          CollectionEvent::PERIODIC);
+        return {};
+    }
+    mCurrCollectionEvent = CollectionEvent::RESUME;
+    mResumeCollection.records.clear();
+    mResumeCollection.lastCollectionUptime = now + mResumeCollection.interval.count();
+    mHandlerLooper->sendMessageAtTime(mResumeCollection.lastCollectionUptime, this,
+                                      CollectionEvent::RESUME);
+    mHandlerLooper->sendMessageAtTime(now + mResumeCollectionDuration.count(), this,
+                                      SwitchEvent::END_RESUME_COLLECTION);
+    return {};
+}
+
+Result<void> IoPerfCollection::rebaselineCollectorsLocked() {
+    // The cumulative counters keep counting across suspend, so the deltas of the first collection
+    // after resume would otherwise include the usage since the last collection before suspend.
+    // The memory usage isn't cumulative so it needs no re-baseline.
+    DataSourceSet dataSources;
+    dataSources.set();
+    dataSources.reset(DataSource::PROC_MEM_INFO);
+    dataSources.reset(DataSource::PROC_PID_MEM);
+    auto snapshot = sampleLocked(dataSources);
+    if (!snapshot) {
+        return Error() << snapshot.error();
+    }
+    Result<void> ret;
+    for (const auto& processor : mIoPerfRecordProcessors) {
+        ret = processor->onRebaseline(*snapshot);
+        if (!ret) {
+            return Error() << processor->name() << " data processor failed: " << ret.error();
+        }
+    }
+    if (!mDataProcessors.empty()) {
+        // Registered processors may keep their own running totals, which need the usage
+        // accumulated across suspend.
+        resolvePackageNamesLocked(&*snapshot);
+    }
+    for (const auto& processor : mDataProcessors) {
+        ret = processor->onRebaseline(*snapshot);
+        if (!ret) {
+            return Error() << processor->name() << " data processor failed: " << ret.error();
+        }
+    }
+    // Sample the memory usage on the first collection after resume.
+    mNextMemoryCollectionUptime = 0;
+    return {};
+}
+
 Result<void> IoPerfCollection::processCollectionEvent(CollectionEvent event, CollectionInfo* info) {
     Mutex::Autolock lock(mMutex);
     // Messages sent to the looper are intrinsically racy such that a message from the previous
@@ -707,23 +1099,51 @@ Result<void> IoPerfCollection::processCollectionEvent(CollectionEvent event, Col
 }
 
 Result<void> IoPerfCollection::collectLocked(CollectionInfo* collectionInfo) {
-    if (!mUidIoStats->enabled() && !mProcStat->enabled() && !mProcPidStat->enabled()) {
+    if (!mUidIoStats->enabled() && !mProcStat->enabled() && !mProcPidStat->enabled() &&
+        !mCpuCoreStats->enabled() && !mDiskStats->enabled() && !mProcMemInfo->enabled() &&
+        !mProcPidMem->enabled()) {
         return Error() << "No collectors enabled";
     }
+    bool shouldProcessMemory = mCurrCollectionEvent == CollectionEvent::CUSTOM ||
+            mHandlerLooper->now() >= mNextMemoryCollectionUptime;
+    DataSourceSet recordDataSources;
+    recordDataSources.set();
+    if (!shouldProcessMemory) {
+        recordDataSources.reset(DataSource::PROC_MEM_INFO);
+        recordDataSources.reset(DataSource::PROC_PID_MEM);
+    }
+    DataSourceSet dataSources = recordDataSources;
+    for (const auto& processor : mDataProcessors) {
+        dataSources |= processor->dataSources();
+    }
+    auto snapshot = sampleLocked(dataSources);
+    if (!snapshot) {
+        return Error() << snapshot.error();
+    }
+    resolvePackageNamesLocked(&*snapshot);
     IoPerfRecord record{
-            .time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()),
+            .time = snapshot->time,
     };
-    auto ret = collectSystemIoPerfDataLocked(&record.systemIoPerfData);
-    if (!ret) {
-        return ret;
+    Result<void> ret;
+    for (const auto& processor : mIoPerfRecordProcessors) {
+        // Skip the processors whose data isn't due on this collection, even when a registered
+        // processor requested it.
+        if ((processor->dataSources() & recordDataSources).none()) {
+            continue;
+        }
+        ret = processRecordLocked(processor, *collectionInfo, *snapshot, &record);
+        if (!ret) {
+            return ret;
+        }
     }
-    ret = collectProcessIoPerfDataLocked(*collectionInfo, &record.processIoPerfData);
-    if (!ret) {
-        return ret;
+    if (shouldProcessMemory) {
+        mNextMemoryCollectionUptime = snapshot->uptime + kMemoryCollectionInterval.count();
     }
-    ret = collectUidIoPerfDataLocked(*collectionInfo, &record.uidIoPerfData);
-    if (!ret) {
-        return ret;
+    for (const auto& processor : mDataProcessors) {
+        ret = processor->onSnapshot(*snapshot);
+        if (!ret) {
+            return Error() << processor->name() << " data processor failed: " << ret.error();
+        }
     }
     if (collectionInfo->records.size() > collectionInfo->maxCacheSize) {
         collectionInfo->records.erase(collectionInfo->records.begin());  // Erase the oldest record.
@@ -732,51 +1152,167 @@ Result<void> IoPerfCollection::collectLocked(CollectionInfo* collectionInfo) {
     return {};
 }
 
-Result<void> IoPerfCollection::collectUidIoPerfDataLocked(const CollectionInfo& collectionInfo,
-                                                          UidIoPerfData* uidIoPerfData) {
-    if (!mUidIoStats->enabled()) {
-        // Don't return an error to avoid pre-mature termination. Instead, fetch data from other
+Result<void> IoPerfCollection::processRecordLocked(const sp<IoPerfRecordProcessor>& processor,
+                                                   const CollectionInfo& collectionInfo,
+                                                   const CollectorSnapshot& snapshot,
+                                                   IoPerfRecord* record) {
+    processor->setOptions({
+            .topNStatsPerCategory = mTopNStatsPerCategory,
+            .topNStatsPerSubcategory = mTopNStatsPerSubcategory,
+            .filterPackages = collectionInfo.filterPackages,
+    });
+    const auto& ret = processor->onSnapshot(snapshot);
+    if (!ret) {
+        return Error() << processor->name() << " data processor failed: " << ret.error();
+    }
+    processor->fillRecord(record);
+    return {};
+}
+
+Result<CollectorSnapshot> IoPerfCollection::sampleLocked(const DataSourceSet& dataSources) {
+    CollectorSnapshot snapshot = {
+            .uptime = mHandlerLooper->now(),
+            .time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()),
+    };
+    if (dataSources[DataSource::UID_IO_STATS] && mUidIoStats->enabled()) {
+        const auto& usages = mUidIoStats->collect();
+        if (!usages) {
+            return Error() << "Failed to collect uid I/O usage: " << usages.error();
+        }
+        snapshot.uidIoUsages = *usages;
+    }
+    // The aggregate and the per-core CPU usage both come from `/proc/stat`, so the file is read
+    // once for both.
+    bool shouldSampleProcStat = dataSources[DataSource::PROC_STAT] && mProcStat->enabled();
+    bool shouldSampleCpuCoreStats =
+            dataSources[DataSource::CPU_CORE_STATS] && mCpuCoreStats->enabled();
+    std::string procStatContents;
+    if (shouldSampleProcStat || shouldSampleCpuCoreStats) {
+        std::string path =
+                shouldSampleProcStat ? mProcStat->filePath() : mCpuCoreStats->filePath();
+        if (!ReadFileToString(path, &procStatContents)) {
+            return Error() << "ReadFileToString failed for " << path;
+        }
+    }
+    if (shouldSampleProcStat) {
+        const auto& procStatInfo = mProcStat->collectFrom(procStatContents);
+        if (!procStatInfo) {
+            return Error() << "Failed to collect proc stats: " << procStatInfo.error();
+        }
+        snapshot.procStatInfo = *procStatInfo;
+    }
+    if (dataSources[DataSource::PROC_PID_STAT] && mProcPidStat->enabled()) {
+        const auto& processStats = mProcPidStat->collect();
+        if (!processStats) {
+            return Error() << "Failed to collect process stats: " << processStats.error();
+        }
+        snapshot.processStats = *processStats;
+    }
+    if (shouldSampleCpuCoreStats) {
+        const auto& usages = mCpuCoreStats->collectFrom(procStatContents);
+        if (!usages) {
+            return Error() << "Failed to collect per-core CPU stats: " << usages.error();
+        }
+        snapshot.cpuCoreUsages = *usages;
+    }
+    if (dataSources[DataSource::DISK_STATS] && mDiskStats->enabled()) {
+        const auto& usages = mDiskStats->collect();
+        if (!usages) {
+            return Error() << "Failed to collect disk stats: " << usages.error();
+        }
+        snapshot.diskUsages = *usages;
+    }
+    if (dataSources[DataSource::PROC_MEM_INFO] && mProcMemInfo->enabled()) {
+        const auto& memInfo = mProcMemInfo->collect();
+        if (!memInfo) {
+            return Error() << "Failed to collect memory info: " << memInfo.error();
+        }
+        snapshot.memInfo = *memInfo;
+    }
+    if (dataSources[DataSource::PROC_PID_MEM] && mProcPidMem->enabled()) {
+        const auto& processMemStats = mProcPidMem->collect();
+        if (!processMemStats) {
+            return Error() << "Failed to collect process memory stats: "
+                           << processMemStats.error();
+        }
+        snapshot.processMemStats = *processMemStats;
+    }
+    return snapshot;
+}
+
+void IoPerfCollection::resolvePackageNamesLocked(CollectorSnapshot* snapshot) {
+    std::unordered_set<uint32_t> uids;
+    if (snapshot->uidIoUsages) {
+        for (const auto& it : *snapshot->uidIoUsages) {
+            if (!it.second.ios.isZero()) {
+                uids.insert(it.first);
+            }
+        }
+    }
+    if (snapshot->processStats) {
+        for (const auto& stats : *snapshot->processStats) {
+            if (stats.uid >= 0) {
+                uids.insert(static_cast<uint32_t>(stats.uid));
+            }
+        }
+    }
+    if (snapshot->processMemStats) {
+        for (const auto& stats : *snapshot->processMemStats) {
+            if (stats.uid >= 0) {
+                uids.insert(static_cast<uint32_t>(stats.uid));
+            }
+        }
+    }
+    std::unordered_set<uint32_t> unmappedUids;
+    for (const auto& uid : uids) {
+        if (mUidToPackageNameMapping.find(uid) == mUidToPackageNameMapping.end()) {
+            unmappedUids.insert(uid);
+        }
+    }
+    const auto& ret = updateUidToPackageNameMapping(unmappedUids);
+    if (!ret) {
+        ALOGW("%s", ret.error().message().c_str());
+    }
+    for (const auto& uid : uids) {
+        const auto& nameIt = mUidToPackageNameMapping.find(uid);
+        if (nameIt != mUidToPackageNameMapping.end()) {
+            snapshot->packageNames[uid] = nameIt->second;
+        }
+    }
+}
+
+Result<void> UidIoPerfProcessor::onSnapshot(const CollectorSnapshot& snapshot) {
+    mData = {};
+    if (!snapshot.uidIoUsages) {
+        // Don't return an error to avoid pre-mature termination. Instead, process data from other
         // collectors.
         return {};
     }
 
-    const Result<std::unordered_map<uint32_t, UidIoUsage>>& usage = mUidIoStats->collect();
-    if (!usage) {
-        return Error() << "Failed to collect uid I/O usage: " << usage.error();
-    }
+    const std::unordered_map<uint32_t, UidIoUsage>& usage = *snapshot.uidIoUsages;
 
     // Fetch only the top N reads and writes from the usage records.
     UidIoUsage tempUsage = {};
-    std::vector<const UidIoUsage*> topNReads(mTopNStatsPerCategory, &tempUsage);
-    std::vector<const UidIoUsage*> topNWrites(mTopNStatsPerCategory, &tempUsage);
-    std::unordered_set<uint32_t> unmappedUids;
+    std::vector<const UidIoUsage*> topNReads(mOptions.topNStatsPerCategory, &tempUsage);
+    std::vector<const UidIoUsage*> topNWrites(mOptions.topNStatsPerCategory, &tempUsage);
 
-    for (const auto& uIt : *usage) {
+    for (const auto& uIt : usage) {
         const UidIoUsage& curUsage = uIt.second;
         if (curUsage.ios.isZero()) {
             continue;
         }
-        if (mUidToPackageNameMapping.find(curUsage.uid) == mUidToPackageNameMapping.end()) {
-            unmappedUids.insert(curUsage.uid);
-        }
-        uidIoPerfData->total[READ_BYTES][FOREGROUND] +=
-                curUsage.ios.metrics[READ_BYTES][FOREGROUND];
-        uidIoPerfData->total[READ_BYTES][BACKGROUND] +=
-                curUsage.ios.metrics[READ_BYTES][BACKGROUND];
-        uidIoPerfData->total[WRITE_BYTES][FOREGROUND] +=
-                curUsage.ios.metrics[WRITE_BYTES][FOREGROUND];
-        uidIoPerfData->total[WRITE_BYTES][BACKGROUND] +=
-                curUsage.ios.metrics[WRITE_BYTES][BACKGROUND];
-        uidIoPerfData->total[FSYNC_COUNT][FOREGROUND] +=
-                curUsage.ios.metrics[FSYNC_COUNT][FOREGROUND];
-        uidIoPerfData->total[FSYNC_COUNT][BACKGROUND] +=
-                curUsage.ios.metrics[FSYNC_COUNT][BACKGROUND];
+        mData.total[READ_BYTES][FOREGROUND] += curUsage.ios.metrics[READ_BYTES][FOREGROUND];
+        mData.total[READ_BYTES][BACKGROUND] += curUsage.ios.metrics[READ_BYTES][BACKGROUND];
+        mData.total[WRITE_BYTES][FOREGROUND] += curUsage.ios.metrics[WRITE_BYTES][FOREGROUND];
+        mData.total[WRITE_BYTES][BACKGROUND] += curUsage.ios.metrics[WRITE_BYTES][BACKGROUND];
+        mData.total[FSYNC_COUNT][FOREGROUND] += curUsage.ios.metrics[FSYNC_COUNT][FOREGROUND];
+        mData.total[FSYNC_COUNT][BACKGROUND] += curUsage.ios.metrics[FSYNC_COUNT][BACKGROUND];
 
         for (auto it = topNReads.begin(); it != topNReads.end(); ++it) {
             const UidIoUsage* curRead = *it;
             if (curRead->ios.sumReadBytes() < curUsage.ios.sumReadBytes()) {
                 topNReads.emplace(it, &curUsage);
-                if (collectionInfo.filterPackages.empty()) {
+                if (mOptions.filterPackages.empty()) {
                     topNReads.pop_back();
                 }
                 break;
@@ -786,7 +1322,7 @@ Result<void> IoPerfCollection::collectUidIoPerfDataLocked(const CollectionInfo&
             const UidIoUsage* curWrite = *it;
             if (curWrite->ios.sumWriteBytes() < curUsage.ios.sumWriteBytes()) {
                 topNWrites.emplace(it, &curUsage);
-                if (collectionInfo.filterPackages.empty()) {
+                if (mOptions.filterPackages.empty()) {
                     topNWrites.pop_back();
                 }
                 break;
@@ -794,11 +1330,6 @@ Result<void> IoPerfCollection::collectUidIoPerfDataLocked(const CollectionInfo&
         }
     }
 
-    const auto& ret = updateUidToPackageNameMapping(unmappedUids);
-    if (!ret) {
-        ALOGW("%s", ret.error().message().c_str());
-    }
-
     // Convert the top N I/O usage to UidIoPerfData.
     for (const auto& usage : topNReads) {
         if (usage->ios.isZero()) {
@@ -814,15 +1345,15 @@ Result<void> IoPerfCollection::collectUidIoPerfDataLocked(const CollectionInfo&
                 .fsync = {usage->ios.metrics[FSYNC_COUNT][FOREGROUND],
                           usage->ios.metrics[FSYNC_COUNT][BACKGROUND]},
         };
-        if (mUidToPackageNameMapping.find(usage->uid) != mUidToPackageNameMapping.end()) {
-            stats.packageName = mUidToPackageNameMapping[usage->uid];
+        const auto& nameIt = snapshot.packageNames.find(usage->uid);
+        if (nameIt != snapshot.packageNames.end()) {
+            stats.packageName = nameIt->second;
         }
-        if (!collectionInfo.filterPackages.empty() &&
-            collectionInfo.filterPackages.find(stats.packageName) ==
-                    collectionInfo.filterPackages.end()) {
+        if (!mOptions.filterPackages.empty() &&
+            mOptions.filterPackages.find(stats.packageName) == mOptions.filterPackages.end()) {
             continue;
         }
-        uidIoPerfData->topNReads.emplace_back(stats);
+        mData.topNReads.emplace_back(stats);
     }
 
     for (const auto& usage : topNWrites) {
@@ -839,69 +1370,204 @@ Result<void> IoPerfCollection::collectUidIoPerfDataLocked(const CollectionInfo&
                 .fsync = {usage->ios.metrics[FSYNC_COUNT][FOREGROUND],
                           usage->ios.metrics[FSYNC_COUNT][BACKGROUND]},
         };
-        if (mUidToPackageNameMapping.find(usage->uid) != mUidToPackageNameMapping.end()) {
-            stats.packageName = mUidToPackageNameMapping[usage->uid];
+        const auto& nameIt = snapshot.packageNames.find(usage->uid);
+        if (nameIt != snapshot.packageNames.end()) {
+            stats.packageName = nameIt->second;
         }
-        if (!collectionInfo.filterPackages.empty() &&
-            collectionInfo.filterPackages.find(stats.packageName) ==
-                    collectionInfo.filterPackages.end()) {
+        if (!mOptions.filterPackages.empty() &&
+            mOptions.filterPackages.find(stats.packageName) == mOptions.filterPackages.end()) {
             continue;
         }
-        uidIoPerfData->topNWrites.emplace_back(stats);
+        mData.topNWrites.emplace_back(stats);
+    }
+    return {};
+}
+
+Result<void> SystemIoPerfProcessor::onSnapshot(const CollectorSnapshot& snapshot) {
+    mData = {};
+    if (!snapshot.procStatInfo) {
+        // Don't return an error to avoid pre-mature termination. Instead, process data from other
+        // collectors.
+        return {};
     }
+
+    const auto& procStatInfo = snapshot.procStatInfo;
+
+    mData.cpuIoWaitTime = procStatInfo->cpuStats.ioWaitTime;
+    mData.totalCpuTime = procStatInfo->totalCpuTime();
+    mData.ioBlockedProcessesCnt = procStatInfo->ioBlockedProcessesCnt;
+    mData.totalProcessesCnt = procStatInfo->totalProcessesCnt();
     return {};
 }
 
-Result<void> IoPerfCollection::collectSystemIoPerfDataLocked(SystemIoPerfData* systemIoPerfData) {
-    if (!mProcStat->enabled()) {
-        // Don't return an error to avoid pre-mature termination. Instead, fetch data from other
+Result<void> DiskIoPerfProcessor::onSnapshot(const CollectorSnapshot& snapshot) {
+    mData = {};
+    if (!snapshot.diskUsages) {
+        // Don't return an error to avoid pre-mature termination. Instead, process data from other
         // collectors.
         return {};
     }
 
-    const Result<ProcStatInfo>& procStatInfo = mProcStat->collect();
-    if (!procStatInfo) {
-        return Error() << "Failed to collect proc stats: " << procStatInfo.error();
+    mData.durationMillis = static_cast<uint64_t>(ns2ms(snapshot.uptime - mLastUptime));
+    mLastUptime = snapshot.uptime;
+    for (const auto& usage : *snapshot.diskUsages) {
+        const DiskIoStats& stats = usage.stats;
+        if (stats.readsCompleted == 0 && stats.writesCompleted == 0 &&
+            stats.discardsCompleted == 0 && stats.ioInProgress == 0) {
+            continue;
+        }
+        mData.devices.emplace_back(DiskIoPerfData::DeviceStats{
+                .name = usage.name,
+                .reads = stats.readsCompleted,
+                .readKb = stats.sectorsRead / 2,
+                .writes = stats.writesCompleted,
+                .writeKb = stats.sectorsWritten / 2,
+                .discards = stats.discardsCompleted,
+                .discardKb = stats.sectorsDiscarded / 2,
+                .waitTimeMillis =
+                        stats.readTimeMillis + stats.writeTimeMillis + stats.discardTimeMillis,
+                .ioTimeMillis = stats.ioTimeMillis,
+                .weightedIoTimeMillis = stats.weightedIoTimeMillis,
+                .ioInProgress = stats.ioInProgress,
+        });
     }
+    return {};
+}
 
-    systemIoPerfData->cpuIoWaitTime = procStatInfo->cpuStats.ioWaitTime;
-    systemIoPerfData->totalCpuTime = procStatInfo->totalCpuTime();
-    systemIoPerfData->ioBlockedProcessesCnt = procStatInfo->ioBlockedProcessesCnt;
-    systemIoPerfData->totalProcessesCnt = procStatInfo->totalProcessesCnt();
+Result<void> CpuCorePerfProcessor::onSnapshot(const CollectorSnapshot& snapshot) {
+    mData = {};
+    if (!snapshot.cpuCoreUsages) {
+        // Don't return an error to avoid pre-mature termination. Instead, process data from other
+        // collectors.
+        return {};
+    }
+
+    for (const auto& usage : *snapshot.cpuCoreUsages) {
+        CpuCorePerfData::CoreStats stats = {
+                .cpu = usage.cpu,
+                .busyTime = usage.busyTime(),
+                .ioWaitTime = usage.cpuStats.ioWaitTime,
+                .totalCpuTime = usage.totalCpuTime(),
+        };
+        for (const auto& it : usage.timeInState) {
+            if (it.second != 0) {
+                stats.timeInState.emplace_back(it);
+            }
+        }
+        mData.cores.emplace_back(stats);
+    }
     return {};
 }
 
-Result<void> IoPerfCollection::collectProcessIoPerfDataLocked(
-        const CollectionInfo& collectionInfo, ProcessIoPerfData* processIoPerfData) {
-    if (!mProcPidStat->enabled()) {
-        // Don't return an error to avoid pre-mature termination. Instead, fetch data from other
+Result<void> MemoryPerfProcessor::onSnapshot(const CollectorSnapshot& snapshot) {
+    mData = {};
+    if (snapshot.memInfo) {
+        const auto& memInfo = snapshot.memInfo;
+        mData.memInfo = *memInfo;
+        if (mLastMemAvailableKb != 0) {
+            mData.memAvailableDeltaKb = static_cast<int64_t>(memInfo->memAvailableKb) -
+                    static_cast<int64_t>(mLastMemAvailableKb);
+        }
+        mLastMemAvailableKb = memInfo->memAvailableKb;
+    }
+    if (!snapshot.processMemStats) {
+        // Don't return an error to avoid pre-mature termination. Instead, process data from other
         // collectors.
         return {};
     }
 
-    const Result<std::vector<ProcessStats>>& processStats = mProcPidStat->collect();
-    if (!processStats) {
-        return Error() << "Failed to collect process stats: " << processStats.error();
+    const auto& processMemStats = snapshot.processMemStats;
+
+    const auto& uidMemStats = getUidMemStats(*processMemStats, mOptions.topNStatsPerSubcategory);
+    UidMemStats temp = {};
+    std::vector<const UidMemStats*> topNRssUids(mOptions.topNStatsPerCategory, &temp);
+    mData.totalRssKb = 0;
+    mData.totalSwapKb = 0;
+    for (const auto& it : *uidMemStats) {
+        const UidMemStats& curStats = it.second;
+        mData.totalRssKb += curStats.rssKb;
+        mData.totalSwapKb += curStats.swapKb;
+        for (auto it = topNRssUids.begin(); it != topNRssUids.end(); ++it) {
+            const UidMemStats* topStats = *it;
+            if (topStats->rssKb < curStats.rssKb) {
+                topNRssUids.emplace(it, &curStats);
+                if (mOptions.filterPackages.empty()) {
+                    topNRssUids.pop_back();
+                }
+                break;
+            }
+        }
     }
 
-    const auto& uidProcessStats = getUidProcessStats(*processStats, mTopNStatsPerSubcategory);
-    std::unordered_set<uint32_t> unmappedUids;
-    // Fetch only the top N I/O blocked UIDs and UIDs with most major page faults.
+    for (const auto& it : topNRssUids) {
+        if (it->rssKb == 0) {
+            // End of non-zero elements. This case occurs when the number of UIDs with resident
+            // memory is < |ro.carwatchdog.top_n_stats_per_category|.
+            break;
+        }
+        MemoryPerfData::UidStats stats = {
+                .userId = multiuser_get_user_id(it->uid),
+                .packageName = std::to_string(it->uid),
+                .rssKb = it->rssKb,
+                .swapKb = it->swapKb,
+                .rssDeltaKb = static_cast<int64_t>(it->rssKb),
+        };
+        const auto& nameIt = snapshot.packageNames.find(it->uid);
+        if (nameIt != snapshot.packageNames.end()) {
+            stats.packageName = nameIt->second;
+        }
+        const auto& lastIt = mLastUidRssKb.find(it->uid);
+        if (lastIt != mLastUidRssKb.end()) {
+            stats.rssDeltaKb -= static_cast<int64_t>(lastIt->second);
+        }
+        if (!mOptions.filterPackages.empty() &&
+            mOptions.filterPackages.find(stats.packageName) == mOptions.filterPackages.end()) {
+            continue;
+        }
+        for (const auto& pIt : it->topNProcesses) {
+            if (pIt.rssKb == 0) {
+                break;
+            }
+            stats.topNProcesses.emplace_back(pIt);
+        }
+        mData.topNRssUids.emplace_back(stats);
+    }
+
+    mLastUidRssKb.clear();
+    for (const auto& it : *uidMemStats) {
+        mLastUidRssKb[it.first] = it.second.rssKb;
+    }
+    return {};
+}
+
+Result<void> ProcessIoPerfProcessor::onSnapshot(const CollectorSnapshot& snapshot) {
+    mData = {};
+    if (!snapshot.processStats) {
+        // Don't return an error to avoid pre-mature termination. Instead, process data from other
+        // collectors.
+        return {};
+    }
+
+    const auto& processStats = snapshot.processStats;
+
+    const auto& uidProcessStats =
+            getUidProcessStats(*processStats, mOptions.topNStatsPerSubcategory);
+    // Fetch only the top N I/O blocked UIDs and UIDs with most major page faults and CPU time.
     UidProcessStats temp = {};
-    std::vector<const UidProcessStats*> topNIoBlockedUids(mTopNStatsPerCategory, &temp);
-    std::vector<const UidProcessStats*> topNMajorFaultUids(mTopNStatsPerCategory, &temp);
-    processIoPerfData->totalMajorFaults = 0;
+    std::vector<const UidProcessStats*> topNIoBlockedUids(mOptions.topNStatsPerCategory, &temp);
+    std::vector<const UidProcessStats*> topNMajorFaultUids(mOptions.topNStatsPerCategory, &temp);
+    std::vector<const UidProcessStats*> topNCpuTimeUids(mOptions.topNStatsPerCategory, &temp);
+    mData.totalMajorFaults = 0;
+    mData.totalCpuTimeMillis = 0;
     for (const auto& it : *uidProcessStats) {
         const UidProcessStats& curStats = it.second;
-        if (mUidToPackageNameMapping.find(curStats.uid) == mUidToPackageNameMapping.end()) {
-            unmappedUids.insert(curStats.uid);
-        }
-        processIoPerfData->totalMajorFaults += curStats.majorFaults;
+        mData.totalMajorFaults += curStats.majorFaults;
+        mData.totalCpuTimeMillis += curStats.cpuTimeMillis;
         for (auto it = topNIoBlockedUids.begin(); it != topNIoBlockedUids.end(); ++it) {
             const UidProcessStats* topStats = *it;
             if (topStats->ioBlockedTasksCnt < curStats.ioBlockedTasksCnt) {
                 topNIoBlockedUids.emplace(it, &curStats);
-                if (collectionInfo.filterPackages.empty()) {
+                if (mOptions.filterPackages.empty()) {
                     topNIoBlockedUids.pop_back();
                 }
                 break;
@@ -911,17 +1577,22 @@ Result<void> IoPerfCollection::collectProcessIoPerfDataLocked(
             const UidProcessStats* topStats = *it;
             if (topStats->majorFaults < curStats.majorFaults) {
                 topNMajorFaultUids.emplace(it, &curStats);
-                if (collectionInfo.filterPackages.empty()) {
+                if (mOptions.filterPackages.empty()) {
                     topNMajorFaultUids.pop_back();
                 }
                 break;
             }
         }
-    }
-
-    const auto& ret = updateUidToPackageNameMapping(unmappedUids);
-    if (!ret) {
-        ALOGW("%s", ret.error().message().c_str());
+        for (auto it = topNCpuTimeUids.begin(); it != topNCpuTimeUids.end(); ++it) {
+            const UidProcessStats* topStats = *it;
+            if (topStats->cpuTimeMillis < curStats.cpuTimeMillis) {
+                topNCpuTimeUids.emplace(it, &curStats);
+                if (mOptions.filterPackages.empty()) {
+                    topNCpuTimeUids.pop_back();
+                }
+                break;
+            }
+        }
     }
 
     // Convert the top N uid process stats to ProcessIoPerfData.
@@ -936,12 +1607,12 @@ Result<void> IoPerfCollection::collectProcessIoPerfDataLocked(
                 .packageName = std::to_string(it->uid),
                 .count = it->ioBlockedTasksCnt,
         };
-        if (mUidToPackageNameMapping.find(it->uid) != mUidToPackageNameMapping.end()) {
-            stats.packageName = mUidToPackageNameMapping[it->uid];
+        const auto& nameIt = snapshot.packageNames.find(it->uid);
+        if (nameIt != snapshot.packageNames.end()) {
+            stats.packageName = nameIt->second;
         }
-        if (!collectionInfo.filterPackages.empty() &&
-            collectionInfo.filterPackages.find(stats.packageName) ==
-                    collectionInfo.filterPackages.end()) {
+        if (!mOptions.filterPackages.empty() &&
+            mOptions.filterPackages.find(stats.packageName) == mOptions.filterPackages.end()) {
             continue;
         }
         for (const auto& pIt : it->topNIoBlockedProcesses) {
@@ -951,8 +1622,8 @@ Result<void> IoPerfCollection::collectProcessIoPerfDataLocked(
             stats.topNProcesses.emplace_back(
                     ProcessIoPerfData::UidStats::ProcessStats{pIt.comm, pIt.count});
         }
-        processIoPerfData->topNIoBlockedUids.emplace_back(stats);
-        processIoPerfData->topNIoBlockedUidsTotalTaskCnt.emplace_back(it->totalTasksCnt);
+        mData.topNIoBlockedUids.emplace_back(stats);
+        mData.topNIoBlockedUidsTotalTaskCnt.emplace_back(it->totalTasksCnt);
     }
     for (const auto& it : topNMajorFaultUids) {
         if (it->majorFaults == 0) {
@@ -965,12 +1636,12 @@ Result<void> IoPerfCollection::collectProcessIoPerfDataLocked(
                 .packageName = std::to_string(it->uid),
                 .count = it->majorFaults,
         };
-        if (mUidToPackageNameMapping.find(it->uid) != mUidToPackageNameMapping.end()) {
-            stats.packageName = mUidToPackageNameMapping[it->uid];
+        const auto& nameIt = snapshot.packageNames.find(it->uid);
+        if (nameIt != snapshot.packageNames.end()) {
+            stats.packageName = nameIt->second;
         }
-        if (!collectionInfo.filterPackages.empty() &&
-            collectionInfo.filterPackages.find(stats.packageName) ==
-                    collectionInfo.filterPackages.end()) {
+        if (!mOptions.filterPackages.empty() &&
+            mOptions.filterPackages.find(stats.packageName) == mOptions.filterPackages.end()) {
             continue;
         }
         for (const auto& pIt : it->topNMajorFaultProcesses) {
@@ -980,16 +1651,44 @@ Result<void> IoPerfCollection::collectProcessIoPerfDataLocked(
             stats.topNProcesses.emplace_back(
                     ProcessIoPerfData::UidStats::ProcessStats{pIt.comm, pIt.count});
         }
-        processIoPerfData->topNMajorFaultUids.emplace_back(stats);
+        mData.topNMajorFaultUids.emplace_back(stats);
+    }
+    for (const auto& it : topNCpuTimeUids) {
+        if (it->cpuTimeMillis == 0) {
+            // End of non-zero elements. This case occurs when the number of UIDs that ran on the
+            // CPU is < |ro.carwatchdog.top_n_stats_per_category|.
+            break;
+        }
+        ProcessIoPerfData::UidStats stats = {
+                .userId = multiuser_get_user_id(it->uid),
+                .packageName = std::to_string(it->uid),
+                .count = it->cpuTimeMillis,
+        };
+        const auto& nameIt = snapshot.packageNames.find(it->uid);
+        if (nameIt != snapshot.packageNames.end()) {
+            stats.packageName = nameIt->second;
+        }
+        if (!mOptions.filterPackages.empty() &&
+            mOptions.filterPackages.find(stats.packageName) == mOptions.filterPackages.end()) {
+            continue;
+        }
+        for (const auto& pIt : it->topNCpuTimeProcesses) {
+            if (pIt.count == 0) {
+                break;
+            }
+            stats.topNProcesses.emplace_back(
+                    ProcessIoPerfData::UidStats::ProcessStats{pIt.comm, pIt.count});
+        }
+        mData.topNCpuTimeUids.emplace_back(stats);
     }
     if (mLastMajorFaults == 0) {
-        processIoPerfData->majorFaultsPercentChange = 0;
+        mData.majorFaultsPercentChange = 0;
     } else {
-        int64_t increase = processIoPerfData->totalMajorFaults - mLastMajorFaults;
-        processIoPerfData->majorFaultsPercentChange =
+        int64_t increase = mData.totalMajorFaults - mLastMajorFaults;
+        mData.majorFaultsPercentChange =
                 (static_cast<double>(increase) / static_cast<double>(mLastMajorFaults)) * 100.0;
     }
-    mLastMajorFaults = processIoPerfData->totalMajorFaults;
+    mLastMajorFaults = mData.totalMajorFaults;
     return {};
 }
 
@@ -36,7 +36,12 @@
 #include <unordered_set>
 #include <vector>
 
+#include "CpuCoreStats.h"
+#include "DataProcessor.h"
+#include "DiskStats.h"
 #include "LooperWrapper.h"
+#include "ProcMemInfo.h"
+#include "ProcPidMem.h"
 #include "ProcPidStat.h"
 #include "ProcStat.h"
 #include "UidIoStats.h"
@@ -76,6 +81,31 @@ struct SystemIoPerfData {
 
 std::string toString(const SystemIoPerfData& perfData);
 
+// Performance data collected from the `/proc/diskstats` file.
+struct DiskIoPerfData {
+    struct DeviceStats {
+        std::string name;
+        uint64_t reads = 0;
+        uint64_t readKb = 0;
+        uint64_t writes = 0;
+        uint64_t writeKb = 0;
+        uint64_t discards = 0;
+        uint64_t discardKb = 0;
+        // Time spent by the completed requests, including the time spent in the queue.
+        uint64_t waitTimeMillis = 0;
+        // Time the device was busy, and the same weighted by the number of requests in flight.
+        uint64_t ioTimeMillis = 0;
+        uint64_t weightedIoTimeMillis = 0;
+        uint64_t ioInProgress = 0;
+    };
+    // Time since the last collection. The rates in the dump are calculated over this duration.
+    uint64_t durationMillis = 0;
+    // Devices without any activity are left out.
+    std::vector<DeviceStats> devices = {};
+};
+
+std::string toString(const DiskIoPerfData& data);
+
 // Performance data collected from the `/proc/[pid]/stat` and `/proc/[pid]/task/[tid]/stat` files.
 struct ProcessIoPerfData {
     struct UidStats {
@@ -95,19 +125,196 @@ struct ProcessIoPerfData {
     uint64_t totalMajorFaults = 0;
     // Percentage of increase/decrease in the major page faults since last collection.
     double majorFaultsPercentChange = 0.0;
+    // Counts of |topNCpuTimeUids| and their processes are CPU times in milliseconds.
+    std::vector<UidStats> topNCpuTimeUids = {};
+    uint64_t totalCpuTimeMillis = 0;
 };
 
 std::string toString(const ProcessIoPerfData& data);
 
+// Performance data collected from the per-CPU lines of the `/proc/stat` file and the
+// `/sys/devices/system/cpu/cpuN/cpufreq/stats/time_in_state` files.
+struct CpuCorePerfData {
+    struct CoreStats {
+        uint32_t cpu = 0;
+        uint64_t busyTime = 0;
+        uint64_t ioWaitTime = 0;
+        uint64_t totalCpuTime = 0;
+        // Time spent at each frequency since last collection, ordered by frequency in kHz.
+        // Frequencies the core didn't run at are left out.
+        std::vector<std::pair<uint32_t, uint64_t>> timeInState = {};
+    };
+    std::vector<CoreStats> cores = {};
+};
+
+std::string toString(const CpuCorePerfData& data);
+
+// Memory usage collected from the `/proc/meminfo` and `/proc/[pid]/status` files.
+struct MemoryPerfData {
+    struct UidStats {
+        userid_t userId = 0;
+        std::string packageName;
+        uint64_t rssKb = 0;
+        uint64_t swapKb = 0;
+        // Change in |rssKb| since the last memory collection.
+        int64_t rssDeltaKb = 0;
+        struct ProcessStats {
+            std::string comm = "";
+            uint64_t rssKb = 0;
+            uint64_t swapKb = 0;
+        };
+        std::vector<ProcessStats> topNProcesses = {};
+    };
+    MemInfo memInfo = {};
+    // Change in |memInfo.memAvailableKb| since the last memory collection.
+    int64_t memAvailableDeltaKb = 0;
+    std::vector<UidStats> topNRssUids = {};
+    uint64_t totalRssKb = 0;
+    uint64_t totalSwapKb = 0;
+};
+
+std::string toString(const MemoryPerfData& data);
+
 struct IoPerfRecord {
     time_t time;  // Collection time.
     UidIoPerfData uidIoPerfData;
     SystemIoPerfData systemIoPerfData;
+    DiskIoPerfData diskIoPerfData;
     ProcessIoPerfData processIoPerfData;
+    CpuCorePerfData cpuCorePerfData;
+    // Empty on collections that skip the memory collection. Refer to |kMemoryCollectionInterval|.
+    MemoryPerfData memoryPerfData;
 };
 
 std::string toString(const IoPerfRecord& record);
 
+// Built-in data processor of IoPerfCollection. Unlike the processors registered with
+// |IoPerfCollection::registerDataProcessor|, its data is kept in the records of the boot-time,
+// periodic, resume and custom collections and is reported with them.
+class IoPerfRecordProcessor : public DataProcessor {
+public:
+    struct Options {
+        // Top N per-UID stats per category and top N per-process stats per subcategory.
+        int topNStatsPerCategory = 0;
+        int topNStatsPerSubcategory = 0;
+        // Packages the data is filtered to. The data isn't filtered when this is empty.
+        std::unordered_set<std::string> filterPackages;
+    };
+
+    // Sets the options used by the following |onSnapshot| calls.
+    void setOptions(const Options& options) { mOptions = options; }
+
+    // Copies the data processed by the last |onSnapshot| call to |record|.
+    virtual void fillRecord(IoPerfRecord* record) = 0;
+
+    // The data is reported with the collection records.
+    android::base::Result<void> onDump(int /*fd*/) override { return {}; }
+
+protected:
+    Options mOptions;
+};
+
+// Processes the `/proc/uid_io/stats` data.
+class UidIoPerfProcessor : public IoPerfRecordProcessor {
+public:
+    std::string name() override { return "UID I/O"; }
+    DataSourceSet dataSources() override { return DataSourceSet().set(DataSource::UID_IO_STATS); }
+    android::base::Result<void> onSnapshot(const CollectorSnapshot& snapshot) override;
+    void fillRecord(IoPerfRecord* record) override { record->uidIoPerfData = mData; }
+
+private:
+    UidIoPerfData mData;
+};
+
+// Processes the `/proc/stats` data.
+class SystemIoPerfProcessor : public IoPerfRecordProcessor {
+public:
+    std::string name() override { return "System I/O"; }
+    DataSourceSet dataSources() override { return DataSourceSet().set(DataSource::PROC_STAT); }
+    android::base::Result<void> onSnapshot(const CollectorSnapshot& snapshot) override;
+    void fillRecord(IoPerfRecord* record) override { record->systemIoPerfData = mData; }
+
+private:
+    SystemIoPerfData mData;
+};
+
+// Processes the `/proc/diskstats` data.
+class DiskIoPerfProcessor : public IoPerfRecordProcessor {
+public:
+    DiskIoPerfProcessor() : mLastUptime(0) {}
+
+    std::string name() override { return "Disk I/O"; }
+    DataSourceSet dataSources() override { return DataSourceSet().set(DataSource::DISK_STATS); }
+    android::base::Result<void> onSnapshot(const CollectorSnapshot& snapshot) override;
+    void fillRecord(IoPerfRecord* record) override { record->diskIoPerfData = mData; }
+    android::base::Result<void> onRebaseline(const CollectorSnapshot& snapshot) override {
+        mLastUptime = snapshot.uptime;
+        return {};
+    }
+
+private:
+    DiskIoPerfData mData;
+    // Uptime of the last disk stats snapshot. The kernel counts the disk stats since boot so the
+    // first snapshot covers the time since boot.
+    nsecs_t mLastUptime;
+};
+
+// Processes the `/proc/[pid]/stat` and `/proc/[pid]/task/[tid]/stat` data.
+class ProcessIoPerfProcessor : public IoPerfRecordProcessor {
+public:
+    ProcessIoPerfProcessor() : mLastMajorFaults(0) {}
+
+    std::string name() override { return "Process I/O"; }
+    DataSourceSet dataSources() override { return DataSourceSet().set(DataSource::PROC_PID_STAT); }
+    android::base::Result<void> onSnapshot(const CollectorSnapshot& snapshot) override;
+    void fillRecord(IoPerfRecord* record) override { record->processIoPerfData = mData; }
+    android::base::Result<void> onRebaseline(const CollectorSnapshot& /*snapshot*/) override {
+        mLastMajorFaults = 0;
+        return {};
+    }
+
+private:
+    ProcessIoPerfData mData;
+    // Major faults delta from last snapshot. Useful when calculating the percentage change in
+    // major faults since last snapshot.
+    uint64_t mLastMajorFaults;
+};
+
+// Processes the per-CPU lines of the `/proc/stat` file and the
+// `/sys/devices/system/cpu/cpuN/cpufreq/stats/time_in_state` files data.
+class CpuCorePerfProcessor : public IoPerfRecordProcessor {
+public:
+    std::string name() override { return "CPU core"; }
+    DataSourceSet dataSources() override {
+        return DataSourceSet().set(DataSource::CPU_CORE_STATS);
+    }
+    android::base::Result<void> onSnapshot(const CollectorSnapshot& snapshot) override;
+    void fillRecord(IoPerfRecord* record) override { record->cpuCorePerfData = mData; }
+
+private:
+    CpuCorePerfData mData;
+};
+
+// Processes the `/proc/meminfo` and `/proc/[pid]/status` data.
+class MemoryPerfProcessor : public IoPerfRecordProcessor {
+public:
+    MemoryPerfProcessor() : mLastMemAvailableKb(0) {}
+
+    std::string name() override { return "Memory"; }
+    DataSourceSet dataSources() override {
+        return DataSourceSet().set(DataSource::PROC_MEM_INFO).set(DataSource::PROC_PID_MEM);
+    }
+    android::base::Result<void> onSnapshot(const CollectorSnapshot& snapshot) override;
+    void fillRecord(IoPerfRecord* record) override { record->memoryPerfData = mData; }
+
+private:
+    MemoryPerfData mData;
+    // Available memory and per-UID RSS from the last snapshot. Useful when calculating the memory
+    // usage change since last memory collection.
+    uint64_t mLastMemAvailableKb;
+    std::unordered_map<uint32_t, uint64_t> mLastUidRssKb;
+};
+
 struct CollectionInfo {
     std::chrono::nanoseconds interval = 0ns;  // Collection interval between subsequent collections.
     size_t maxCacheSize = 0;                  // Maximum cache size for the collection.
@@ -124,6 +331,8 @@ enum CollectionEvent {
     BOOT_TIME,
     PERIODIC,
     CUSTOM,
+    RESUME,
+    SUSPENDED,
     TERMINATED,
     LAST_EVENT,
 };
@@ -133,7 +342,13 @@ enum SwitchEvent {
     // collection event to periodic collection.
     END_BOOTTIME_COLLECTION = CollectionEvent::LAST_EVENT + 1,
     // Ends custom collection, discards collected data and starts periodic collection.
-    END_CUSTOM_COLLECTION
+    END_CUSTOM_COLLECTION,
+    // Re-baselines the collectors after resuming from suspend and starts either the resume or the
+    // periodic collection.
+    END_SUSPEND,
+    // Ends resume collection by collecting the last resume record and switching the collection
+    // event to periodic collection.
+    END_RESUME_COLLECTION
 };
 
 static inline std::string toString(CollectionEvent event) {
@@ -146,6 +361,10 @@ static inline std::string toString(CollectionEvent event) {
             return "PERIODIC";
         case CollectionEvent::CUSTOM:
             return "CUSTOM";
+        case CollectionEvent::RESUME:
+            return "RESUME";
+        case CollectionEvent::SUSPENDED:
+            return "SUSPENDED";
         case CollectionEvent::TERMINATED:
             return "TERMINATED";
         default:
@@ -163,12 +382,21 @@ public:
           mBoottimeCollection({}),
           mPeriodicCollection({}),
           mCustomCollection({}),
+          mResumeCollection({}),
+          mResumeCollectionDuration(0ns),
           mCurrCollectionEvent(CollectionEvent::INIT),
           mUidToPackageNameMapping({}),
           mUidIoStats(new UidIoStats()),
           mProcStat(new ProcStat()),
           mProcPidStat(new ProcPidStat()),
-          mLastMajorFaults(0) {}
+          mCpuCoreStats(new CpuCoreStats()),
+          mDiskStats(new DiskStats()),
+          mProcMemInfo(new ProcMemInfo()),
+          mProcPidMem(new ProcPidMem()),
+          mNextMemoryCollectionUptime(0),
+          mIoPerfRecordProcessors({new SystemIoPerfProcessor(), new DiskIoPerfProcessor(),
+                                   new CpuCorePerfProcessor(), new ProcessIoPerfProcessor(),
+                                   new MemoryPerfProcessor(), new UidIoPerfProcessor()}) {}
 
     ~IoPerfCollection() { terminate(); }
 
@@ -179,10 +407,24 @@ public:
     // Terminates the collection thread and returns.
     void terminate();
 
+    // Registers a processor that is called with the snapshot sampled on each collection, after
+    // the built-in processors in |mIoPerfRecordProcessors|. Returns an error when the processor is
+    // already registered.
+    android::base::Result<void> registerDataProcessor(const android::sp<DataProcessor>& processor);
+
     // Ends the boot-time collection, caches boot-time perf records, sends message to the looper to
     // begin the periodic collection, and returns immediately.
     virtual android::base::Result<void> onBootFinished();
 
+    // Stops the periodic or resume collection when the system enters suspend and returns
+    // immediately. The collected data is kept.
+    virtual android::base::Result<void> onSuspend();
+
+    // Sends message to the looper to re-baseline the collectors, so the first collection after
+    // resume doesn't report the usage accumulated across the suspend, and to start the resume
+    // collection when enabled. Otherwise, the periodic collection is restarted.
+    virtual android::base::Result<void> onResume();
+
     // Depending the arguments, it either:
     // 1. Starts custom collection.
     // 2. Ends custom collection and dumps the collected data.
@@ -216,6 +458,14 @@ private:
     // collection running or when a dump couldn't be generated from the custom collection.
     android::base::Result<void> endCustomCollection(int fd);
 
+    // Re-baselines the collectors and starts the resume collection when
+    // |mResumeCollectionDuration| is non-zero. Otherwise, starts the periodic collection.
+    android::base::Result<void> resumeCollection();
+
+    // Collects from all the enabled collectors and discards the data, so the next collection only
+    // reports the usage since this call.
+    android::base::Result<void> rebaselineCollectorsLocked();
+
     // Handles the messages received by the lopper.
     void handleMessage(const Message& message) override;
 
@@ -225,17 +475,17 @@ private:
     // Collects/stores the performance data for the current collection event.
     android::base::Result<void> collectLocked(CollectionInfo* collectionInfo);
 
-    // Collects performance data from the `/proc/uid_io/stats` file.
-    android::base::Result<void> collectUidIoPerfDataLocked(const CollectionInfo& collectionInfo,
-                                                           UidIoPerfData* uidIoPerfData);
+    // Reads each of the given |dataSources| that is enabled exactly once.
+    android::base::Result<CollectorSnapshot> sampleLocked(const DataSourceSet& dataSources);
 
-    // Collects performance data from the `/proc/stats` file.
-    android::base::Result<void> collectSystemIoPerfDataLocked(SystemIoPerfData* systemIoPerfData);
+    // Fills |snapshot->packageNames| for the UIDs in the snapshot.
+    void resolvePackageNamesLocked(CollectorSnapshot* snapshot);
 
-    // Collects performance data from the `/proc/[pid]/stat` and
-    // `/proc/[pid]/task/[tid]/stat` files.
-    android::base::Result<void> collectProcessIoPerfDataLocked(
-            const CollectionInfo& collectionInfo, ProcessIoPerfData* processIoPerfData);
+    // Processes the snapshot with the built-in |processor| and adds its data to |record|.
+    android::base::Result<void> processRecordLocked(
+            const android::sp<IoPerfRecordProcessor>& processor,
+            const CollectionInfo& collectionInfo, const CollectorSnapshot& snapshot,
+            IoPerfRecord* record);
 
     // Updates the |mUidToPackageNameMapping| for the given |uids|.
     android::base::Result<void> updateUidToPackageNameMapping(
@@ -271,8 +521,15 @@ private:
     // every custom collection.
     CollectionInfo mCustomCollection GUARDED_BY(mMutex);
 
-    // Tracks the current collection event. Updated on |start|, |onBootComplete|,
-    // |startCustomCollection| and |endCustomCollection|.
+    // Info for the |CollectionEvent::RESUME| collection event. The cache holds the records from
+    // the last resume only.
+    CollectionInfo mResumeCollection GUARDED_BY(mMutex);
+
+    // Duration of the resume collection. The resume collection is disabled when this is zero.
+    std::chrono::nanoseconds mResumeCollectionDuration GUARDED_BY(mMutex);
+
+    // Tracks the current collection event. Updated on |start|, |onBootComplete|, |onSuspend|,
+    // |onResume|, |startCustomCollection| and |endCustomCollection|.
     CollectionEvent mCurrCollectionEvent GUARDED_BY(mMutex);
 
     // Cache of uid to package name mapping.
@@ -287,9 +544,26 @@ private:
     // Collector/parser for `/proc/PID/*` stat files.
     android::sp<ProcPidStat> mProcPidStat GUARDED_BY(mMutex);
 
-    // Major faults delta from last collection. Useful when calculating the percentage change in
-    // major faults since last collection.
-    uint64_t mLastMajorFaults GUARDED_BY(mMutex);
+    // Collector/parser for the per-CPU lines of `/proc/stat` and the cpufreq time_in_state files.
+    android::sp<CpuCoreStats> mCpuCoreStats GUARDED_BY(mMutex);
+
+    // Collector/parser for `/proc/diskstats`.
+    android::sp<DiskStats> mDiskStats GUARDED_BY(mMutex);
+
+    // Collector/parser for `/proc/meminfo`.
+    android::sp<ProcMemInfo> mProcMemInfo GUARDED_BY(mMutex);
+
+    // Collector/parser for the memory usage in `/proc/PID/status` files.
+    android::sp<ProcPidMem> mProcPidMem GUARDED_BY(mMutex);
+
+    // Uptime at or after which the boot-time and periodic collections sample the memory usage.
+    nsecs_t mNextMemoryCollectionUptime GUARDED_BY(mMutex);
+
+    // Built-in processors whose data makes up the collection records, in processing order.
+    std::vector<android::sp<IoPerfRecordProcessor>> mIoPerfRecordProcessors GUARDED_BY(mMutex);
+
+    // Processors registered with |registerDataProcessor|, in registration order.
+    std::vector<android::sp<DataProcessor>> mDataProcessors GUARDED_BY(mMutex);
 
     // To get the package names from app uids.
     android::sp<android::content::pm::IPackageManagerNative> mPackageManager GUARDED_BY(mMutex);
@@ -303,9 +577,21 @@ private:
     FRIEND_TEST(IoPerfCollectionTest, TestUidIOStatsLessThanTopNStatsLimit);
     FRIEND_TEST(IoPerfCollectionTest, TestProcUidIoStatsContentsFromDevice);
     FRIEND_TEST(IoPerfCollectionTest, TestValidProcStatFile);
+    FRIEND_TEST(IoPerfCollectionTest, TestValidDiskStatsFile);
     FRIEND_TEST(IoPerfCollectionTest, TestValidProcPidContents);
+    FRIEND_TEST(IoPerfCollectionTest, TestValidProcPidCpuTimes);
     FRIEND_TEST(IoPerfCollectionTest, TestProcPidContentsLessThanTopNStatsLimit);
     FRIEND_TEST(IoPerfCollectionTest, TestCustomCollectionFiltersPackageNames);
+    FRIEND_TEST(IoPerfCollectionTest, TestValidCpuCoreStatFiles);
+    FRIEND_TEST(IoPerfCollectionTest, TestReadsProcStatOnceForAggregateAndPerCoreUsage);
+    FRIEND_TEST(IoPerfCollectionTest, TestValidMemoryContents);
+    FRIEND_TEST(IoPerfCollectionTest, TestMemoryCollectionCadence);
+    FRIEND_TEST(IoPerfCollectionTest, TestSuspendAndResume);
+    FRIEND_TEST(IoPerfCollectionTest, TestSuspendBeforePendingResumeIsHandled);
+    FRIEND_TEST(IoPerfCollectionTest, TestResumeCollection);
+    FRIEND_TEST(IoPerfCollectionTest, TestDataProcessorsShareSnapshot);
+    FRIEND_TEST(IoPerfCollectionTest, TestDataProcessorsReceiveRebaselineSnapshot);
+    FRIEND_TEST(IoPerfCollectionTest, TestSamplesOnlyRequestedDataSources);
 };
 
 }  // namespace watchdog
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "carwatchdogd"
+
+#include "ProcMemInfo.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+using android::base::Error;
+using android::base::ParseUint;
+using android::base::ReadFileToString;
+using android::base::Result;
+using android::base::Split;
+using android::base::Trim;
+
+// /proc/meminfo format:
+// <name>:<spaces><value> kB
+// Example line: MemTotal:        3888032 kB
+// Only the lines in |fieldsByName| are required. The rest vary across kernel versions and configs
+// and are ignored.
+Result<MemInfo> ProcMemInfo::collect() {
+    if (!kEnabled) {
+        return Error() << "Can not access " << kPath;
+    }
+
+    std::string buffer;
+    if (!ReadFileToString(kPath, &buffer)) {
+        return Error() << "ReadFileToString failed for " << kPath;
+    }
+
+    MemInfo info;
+    const std::unordered_map<std::string, uint64_t*> fieldsByName = {
+            {"MemTotal", &info.memTotalKb},
+            {"MemFree", &info.memFreeKb},
+            {"MemAvailable", &info.memAvailableKb},
+            {"Buffers", &info.buffersKb},
+            {"Cached", &info.cachedKb},
+            {"SwapTotal", &info.swapTotalKb},
+            {"SwapFree", &info.swapFreeKb},
+    };
+    std::unordered_set<std::string> readNames;
+    for (const auto& line : Split(buffer, "\n")) {
+        if (line.empty()) {
+            continue;
+        }
+        size_t nameEnd = line.find(':');
+        if (nameEnd == std::string::npos) {
+            return Error() << "Invalid line: \"" << line << "\" in file " << kPath;
+        }
+        std::string name = line.substr(0, nameEnd);
+        const auto& it = fieldsByName.find(name);
+        if (it == fieldsByName.end()) {
+            continue;
+        }
+        if (readNames.find(name) != readNames.end()) {
+            return Error() << "Duplicate " << name << " line: \"" << line << "\" in file "
+                           << kPath;
+        }
+        std::vector<std::string> fields = Split(Trim(line.substr(nameEnd + 1)), " ");
+        if (fields.size() != 2 || fields[1] != "kB" || !ParseUint(fields[0], it->second)) {
+            return Error() << "Invalid line: \"" << line << "\" in file " << kPath;
+        }
+        readNames.insert(name);
+    }
+    if (readNames.size() != fieldsByName.size()) {
+        return Error() << kPath << " is missing " << fieldsByName.size() - readNames.size()
+                       << " of the required lines";
+    }
+    return info;
+}
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
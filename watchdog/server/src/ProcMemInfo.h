@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WATCHDOG_SERVER_SRC_PROCMEMINFO_H_
+#define WATCHDOG_SERVER_SRC_PROCMEMINFO_H_
+
+#include <android-base/result.h>
+#include <stdint.h>
+#include <utils/RefBase.h>
+
+#include <string>
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+constexpr const char* kProcMemInfoPath = "/proc/meminfo";
+
+// System-wide memory usage in kB.
+struct MemInfo {
+    uint64_t memTotalKb = 0;      // Usable RAM.
+    uint64_t memFreeKb = 0;       // RAM left unused by the system.
+    uint64_t memAvailableKb = 0;  // Estimate of the RAM available without swapping.
+    uint64_t buffersKb = 0;       // Temporary storage for raw disk blocks.
+    uint64_t cachedKb = 0;        // In-memory cache for files read from the disk.
+    uint64_t swapTotalKb = 0;     // Total swap space, including zram.
+    uint64_t swapFreeKb = 0;      // Unused swap space.
+
+    bool operator==(const MemInfo& info) const {
+        return memTotalKb == info.memTotalKb && memFreeKb == info.memFreeKb &&
+                memAvailableKb == info.memAvailableKb && buffersKb == info.buffersKb &&
+                cachedKb == info.cachedKb && swapTotalKb == info.swapTotalKb &&
+                swapFreeKb == info.swapFreeKb;
+    }
+};
+
+// Collector/parser for `/proc/meminfo` file.
+class ProcMemInfo : public RefBase {
+public:
+    explicit ProcMemInfo(const std::string& path = kProcMemInfoPath) :
+          kEnabled(!access(path.c_str(), R_OK)), kPath(path) {}
+
+    virtual ~ProcMemInfo() {}
+
+    // Collects the current memory usage. Unlike the other collectors, these are levels and not
+    // counters so no delta is calculated.
+    virtual android::base::Result<MemInfo> collect();
+
+    // Returns true when the meminfo file is accessible. Otherwise, returns false.
+    // Called by IoPerfCollection and tests.
+    virtual bool enabled() { return kEnabled; }
+
+    virtual std::string filePath() { return kPath; }
+
+private:
+    // True if |kPath| is accessible.
+    const bool kEnabled;
+
+    // Path to meminfo file. Default path is |kProcMemInfoPath|.
+    const std::string kPath;
+};
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
+
+#endif  //  WATCHDOG_SERVER_SRC_PROCMEMINFO_H_
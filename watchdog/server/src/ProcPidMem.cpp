@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "carwatchdogd"
+
+#include "ProcPidMem.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+#include <dirent.h>
+#include <log/log.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+using android::base::Error;
+using android::base::ParseInt;
+using android::base::ParseUint;
+using android::base::ReadFileToString;
+using android::base::Result;
+using android::base::Split;
+using android::base::StartsWith;
+using android::base::Trim;
+
+namespace {
+
+enum ReadError {
+    ERR_INVALID_FILE = 0,
+    ERR_FILE_OPEN_READ = 1,
+    NUM_ERRORS = 2,
+};
+
+// Parses the "<value> kB" part of the VmRSS and VmSwap lines.
+bool parseKbValue(const std::string& value, uint64_t* kb) {
+    std::vector<std::string> fields = Split(Trim(value), " ");
+    return fields.size() == 2 && fields[1] == "kB" && ParseUint(fields[0], kb);
+}
+
+// /proc/PID/status lines read by this function:
+// Name:<tab><comm>
+// Tgid:<tab><tgid>
+// Uid:<tab><real uid><tab><effective uid><tab><saved set uid><tab><filesystem uid>
+// VmRSS:<spaces><resident set size> kB
+// VmSwap:<spaces><swapped out size> kB
+// The Vm* lines are missing for kernel threads. Returns false for those.
+Result<bool> readPidStatusFile(const std::string& path, ProcessMemStats* stats,
+                               int64_t* tgid) {
+    std::string buffer;
+    if (!ReadFileToString(path, &buffer)) {
+        return Error(ERR_FILE_OPEN_READ) << "ReadFileToString failed for " << path;
+    }
+    bool didReadUid = false;
+    bool didReadRss = false;
+    for (const auto& line : Split(buffer, "\n")) {
+        if (StartsWith(line, "Name:")) {
+            stats->comm = Trim(line.substr(5));
+        } else if (StartsWith(line, "Tgid:")) {
+            if (!ParseInt(Trim(line.substr(5)), tgid)) {
+                return Error(ERR_INVALID_FILE)
+                        << "Invalid tgid line: \"" << line << "\" in file " << path;
+            }
+        } else if (StartsWith(line, "Uid:")) {
+            std::vector<std::string> fields = Split(line, "\t");
+            if (fields.size() < 2 || !ParseInt(fields[1], &stats->uid)) {
+                return Error(ERR_INVALID_FILE)
+                        << "Invalid UID line: \"" << line << "\" in file " << path;
+            }
+            didReadUid = true;
+        } else if (StartsWith(line, "VmRSS:")) {
+            if (!parseKbValue(line.substr(6), &stats->rssKb)) {
+                return Error(ERR_INVALID_FILE)
+                        << "Invalid VmRSS line: \"" << line << "\" in file " << path;
+            }
+            didReadRss = true;
+        } else if (StartsWith(line, "VmSwap:")) {
+            if (!parseKbValue(line.substr(7), &stats->swapKb)) {
+                return Error(ERR_INVALID_FILE)
+                        << "Invalid VmSwap line: \"" << line << "\" in file " << path;
+            }
+        }
+    }
+    if (!didReadUid) {
+        return Error(ERR_INVALID_FILE) << "Incomplete file " << path;
+    }
+    return didReadRss;
+}
+
+}  // namespace
+
+Result<std::vector<ProcessMemStats>> ProcPidMem::collect() {
+    if (!kEnabled) {
+        return Error() << "Can not access PID status files under " << kPath;
+    }
+
+    auto procDirp = std::unique_ptr<DIR, int (*)(DIR*)>(opendir(kPath.c_str()), closedir);
+    if (!procDirp) {
+        return Error() << "Failed to open " << kPath << " directory";
+    }
+    std::vector<ProcessMemStats> processMemStats;
+    dirent* pidDir = nullptr;
+    while ((pidDir = readdir(procDirp.get())) != nullptr) {
+        uint32_t pid = 0;
+        if (pidDir->d_type != DT_DIR || !ParseUint(pidDir->d_name, &pid)) {
+            continue;
+        }
+        ProcessMemStats stats = {.pid = pid};
+        int64_t tgid = -1;
+        std::string path = StringPrintf((kPath + kStatusFileFormat).c_str(), pid);
+        const auto& ret = readPidStatusFile(path, &stats, &tgid);
+        if (!ret) {
+            // PID may disappear between scanning the directory and reading the status file.
+            // Thus treat ERR_FILE_OPEN_READ errors as soft errors.
+            if (ret.error().code() != ERR_FILE_OPEN_READ) {
+                return Error() << "Failed to read per-process status file: "
+                               << ret.error().message().c_str();
+            }
+            ALOGW("Failed to read per-process status file %s: %s", path.c_str(),
+                  ret.error().message().c_str());
+            continue;
+        }
+        if (!*ret || (tgid != -1 && tgid != pid)) {
+            // Skip kernel threads and non-process entries as threads share the address space of
+            // their process.
+            continue;
+        }
+        processMemStats.emplace_back(stats);
+    }
+    return processMemStats;
+}
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WATCHDOG_SERVER_SRC_PROCPIDMEM_H_
+#define WATCHDOG_SERVER_SRC_PROCPIDMEM_H_
+
+#include <android-base/result.h>
+#include <android-base/stringprintf.h>
+#include <stdint.h>
+#include <utils/RefBase.h>
+
+#include <string>
+#include <vector>
+
+#include "ProcPidStat.h"
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+struct ProcessMemStats {
+    uint32_t pid = 0;
+    int64_t uid = -1;       // -1 indicates a failure to read this value
+    std::string comm = "";
+    uint64_t rssKb = 0;     // Resident set size
+    uint64_t swapKb = 0;    // Anonymous memory swapped out, including to zram
+};
+
+// Collector/parser for the memory usage in `/proc/[pid]/status` files.
+class ProcPidMem : public RefBase {
+public:
+    explicit ProcPidMem(const std::string& path = kProcDirPath) :
+          kEnabled(!access(StringPrintf((path + kStatusFileFormat).c_str(), PID_FOR_INIT).c_str(),
+                           R_OK)),
+          kPath(path) {}
+
+    virtual ~ProcPidMem() {}
+
+    // Collects the current memory usage of all user-space processes. Kernel threads don't have
+    // an address space and thus are left out.
+    virtual android::base::Result<std::vector<ProcessMemStats>> collect();
+
+    // Called by IoPerfCollection and tests.
+    virtual bool enabled() { return kEnabled; }
+
+    virtual std::string dirPath() { return kPath; }
+
+private:
+    // True if the status file of the init process is accessible.
+    const bool kEnabled;
+
+    // Proc directory path. Default path is |kProcDirPath|.
+    const std::string kPath;
+};
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
+
+#endif  //  WATCHDOG_SERVER_SRC_PROCPIDMEM_H_
@@ -86,15 +86,20 @@ bool parsePidStatLine(const std::string& line, PidStat* pidStat) {
 
     // The required data is in the first 22 + |commEndOffset| fields so make sure there are at least
     // these many fields in the file.
+    uint64_t userTime = 0;
+    uint64_t systemTime = 0;
     if (fields.size() < 22 + commEndOffset || !ParseUint(fields[0], &pidStat->pid) ||
         !ParseUint(fields[3 + commEndOffset], &pidStat->ppid) ||
         !ParseUint(fields[11 + commEndOffset], &pidStat->majorFaults) ||
+        !ParseUint(fields[13 + commEndOffset], &userTime) ||
+        !ParseUint(fields[14 + commEndOffset], &systemTime) ||
         !ParseUint(fields[19 + commEndOffset], &pidStat->numThreads) ||
         !ParseUint(fields[21 + commEndOffset], &pidStat->startTime)) {
         ALOGW("Invalid proc pid stat contents: \"%s\"", line.c_str());
         return false;
     }
     pidStat->state = fields[2 + commEndOffset];
+    pidStat->cpuTime = userTime + systemTime;
     return true;
 }
 
@@ -140,6 +145,7 @@ Result<std::vector<ProcessStats>> ProcPidStat::collect() {
         ProcessStats deltaStats = curStats;
         const ProcessStats& cachedStats = cachedIt->second;
         deltaStats.process.majorFaults -= cachedStats.process.majorFaults;
+        deltaStats.process.cpuTime -= cachedStats.process.cpuTime;
         for (auto& deltaThread : deltaStats.threads) {
             const auto& cachedThread = cachedStats.threads.find(deltaThread.first);
             if (cachedThread == cachedStats.threads.end() ||
@@ -148,6 +154,7 @@ Result<std::vector<ProcessStats>> ProcPidStat::collect() {
                 continue;
             }
             deltaThread.second.majorFaults -= cachedThread->second.majorFaults;
+            deltaThread.second.cpuTime -= cachedThread->second.cpuTime;
         }
         delta.emplace_back(deltaStats);
     }
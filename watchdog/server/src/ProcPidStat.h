@@ -50,6 +50,7 @@ struct PidStat {
     uint64_t majorFaults = 0;
     uint32_t numThreads = 0;
     uint64_t startTime = 0;  // Useful when identifying PID/TID reuse
+    uint64_t cpuTime = 0;    // Time spent in user and kernel modes, in clock ticks
 };
 
 struct ProcessStats {
@@ -112,6 +113,7 @@ private:
     std::string mPath;
 
     FRIEND_TEST(IoPerfCollectionTest, TestValidProcPidContents);
+    FRIEND_TEST(IoPerfCollectionTest, TestValidProcPidCpuTimes);
     FRIEND_TEST(ProcPidStatTest, TestValidStatFiles);
     FRIEND_TEST(ProcPidStatTest, TestHandlesProcessTerminationBetweenScanningAndParsing);
     FRIEND_TEST(ProcPidStatTest, TestHandlesPidTidReuse);
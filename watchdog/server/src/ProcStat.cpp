@@ -75,9 +75,16 @@ Result<ProcStatInfo> ProcStat::collect() {
     if (!kEnabled) {
         return Error() << "Can not access " << kPath;
     }
+    std::string buffer;
+    if (!ReadFileToString(kPath, &buffer)) {
+        return Error() << "ReadFileToString failed for " << kPath;
+    }
+    return collectFrom(buffer);
+}
 
+Result<ProcStatInfo> ProcStat::collectFrom(const std::string& contents) {
     Mutex::Autolock lock(mMutex);
-    const auto& info = getProcStatLocked();
+    const auto& info = parseProcStatLocked(contents);
     if (!info) {
         return Error() << "Failed to get proc stat contents: " << info.error();
     }
@@ -104,13 +111,8 @@ Result<ProcStatInfo> ProcStat::collect() {
     return delta;
 }
 
-Result<ProcStatInfo> ProcStat::getProcStatLocked() const {
-    std::string buffer;
-    if (!ReadFileToString(kPath, &buffer)) {
-        return Error() << "ReadFileToString failed for " << kPath;
-    }
-
-    std::vector<std::string> lines = Split(std::move(buffer), "\n");
+Result<ProcStatInfo> ProcStat::parseProcStatLocked(const std::string& contents) const {
+    std::vector<std::string> lines = Split(contents, "\n");
     ProcStatInfo info;
     bool didReadProcsRunning = false;
     bool didReadProcsBlocked = false;
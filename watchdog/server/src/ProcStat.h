@@ -74,15 +74,19 @@ public:
     // Collects proc stat delta since the last collection.
     virtual android::base::Result<ProcStatInfo> collect();
 
+    // Same as |collect| but parses |contents|, which were read from |filePath|. Lets the caller
+    // share a single read of the file with CpuCoreStats.
+    virtual android::base::Result<ProcStatInfo> collectFrom(const std::string& contents);
+
     // Returns true when the proc stat file is accessible. Otherwise, returns false.
     // Called by IoPerfCollection and tests.
     virtual bool enabled() { return kEnabled; }
 
-    virtual std::string filePath() { return kProcStatPath; }
+    virtual std::string filePath() { return kPath; }
 
 private:
-    // Reads the contents of |kPath|.
-    android::base::Result<ProcStatInfo> getProcStatLocked() const;
+    // Parses the contents of |kPath|.
+    android::base::Result<ProcStatInfo> parseProcStatLocked(const std::string& contents) const;
 
     // Makes sure only one collection is running at any given time.
     Mutex mMutex;
@@ -18,6 +18,8 @@
 
 #include "ServiceManager.h"
 
+#include <log/log.h>
+
 namespace android {
 namespace automotive {
 namespace watchdog {
@@ -30,11 +32,12 @@ using android::base::Result;
 
 sp<WatchdogProcessService> ServiceManager::sWatchdogProcessService = nullptr;
 sp<IoPerfCollection> ServiceManager::sIoPerfCollection = nullptr;
+sp<IoOveruseMonitor> ServiceManager::sIoOveruseMonitor = nullptr;
 sp<WatchdogBinderMediator> ServiceManager::sWatchdogBinderMediator = nullptr;
 
 Result<void> ServiceManager::startServices(const sp<Looper>& looper) {
     if (sWatchdogProcessService != nullptr || sIoPerfCollection != nullptr ||
-        sWatchdogBinderMediator != nullptr) {
+        sIoOveruseMonitor != nullptr || sWatchdogBinderMediator != nullptr) {
         return Error(INVALID_OPERATION) << "Cannot start services more than once";
     }
     auto result = startProcessAnrMonitor(looper);
@@ -57,6 +60,7 @@ void ServiceManager::terminateServices() {
         sIoPerfCollection->terminate();
         sIoPerfCollection = nullptr;
     }
+    sIoOveruseMonitor = nullptr;
     if (sWatchdogBinderMediator != nullptr) {
         sWatchdogBinderMediator->terminate();
         sWatchdogBinderMediator = nullptr;
@@ -70,18 +74,35 @@ Result<void> ServiceManager::startProcessAnrMonitor(const sp<Looper>& looper) {
 
 Result<void> ServiceManager::startIoPerfCollection() {
     sp<IoPerfCollection> service = new IoPerfCollection();
-    const auto& result = service->start();
+    sp<IoOveruseMonitor> monitor = new IoOveruseMonitor();
+    auto result = monitor->init();
+    if (!result.ok()) {
+        ALOGW("%s. No I/O overuse budget is enforced", result.error().message().c_str());
+    }
+    result = service->registerDataProcessor(monitor);
+    if (!result.ok()) {
+        return Error(result.error().code())
+                << "Failed to register I/O overuse monitor: " << result.error();
+    }
+    result = service->registerDataProcessor(sWatchdogProcessService);
+    if (!result.ok()) {
+        return Error(result.error().code())
+                << "Failed to register watchdog process service: " << result.error();
+    }
+    result = service->start();
     if (!result.ok()) {
         return Error(result.error().code())
                 << "Failed to start I/O performance collection: " << result.error();
     }
     sIoPerfCollection = service;
+    sIoOveruseMonitor = monitor;
     return {};
 }
 
 Result<void> ServiceManager::startBinderMediator() {
     sWatchdogBinderMediator = new WatchdogBinderMediator();
-    const auto& result = sWatchdogBinderMediator->init(sWatchdogProcessService, sIoPerfCollection);
+    const auto& result = sWatchdogBinderMediator->init(sWatchdogProcessService, sIoPerfCollection,
+                                                       sIoOveruseMonitor);
     if (!result.ok()) {
         return Error(result.error().code())
                 << "Failed to start binder mediator: " << result.error();
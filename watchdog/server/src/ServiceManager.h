@@ -21,6 +21,7 @@
 #include <utils/Looper.h>
 #include <utils/StrongPointer.h>
 
+#include "IoOveruseMonitor.h"
 #include "IoPerfCollection.h"
 #include "WatchdogBinderMediator.h"
 #include "WatchdogProcessService.h"
@@ -41,6 +42,7 @@ private:
 
     static android::sp<WatchdogProcessService> sWatchdogProcessService;
     static android::sp<IoPerfCollection> sIoPerfCollection;
+    static android::sp<IoOveruseMonitor> sIoOveruseMonitor;
     static android::sp<WatchdogBinderMediator> sWatchdogBinderMediator;
 };
 
@@ -70,18 +70,22 @@ Status fromExceptionCode(int32_t exceptionCode, std::string message) {
 }  // namespace
 
 Result<void> WatchdogBinderMediator::init(sp<WatchdogProcessService> watchdogProcessService,
-                                          sp<IoPerfCollection> ioPerfCollection) {
-    if (watchdogProcessService == nullptr || ioPerfCollection == nullptr) {
+                                          sp<IoPerfCollection> ioPerfCollection,
+                                          sp<IoOveruseMonitor> ioOveruseMonitor) {
+    if (watchdogProcessService == nullptr || ioPerfCollection == nullptr ||
+        ioOveruseMonitor == nullptr) {
         return Error(INVALID_OPERATION)
-                << "Must initialize both process and I/O perf collection service before starting "
-                << "carwatchdog binder mediator";
+                << "Must initialize process service, I/O perf collection and I/O overuse monitor "
+                << "before starting carwatchdog binder mediator";
     }
-    if (mWatchdogProcessService != nullptr || mIoPerfCollection != nullptr) {
+    if (mWatchdogProcessService != nullptr || mIoPerfCollection != nullptr ||
+        mIoOveruseMonitor != nullptr) {
         return Error(INVALID_OPERATION)
                 << "Cannot initialize carwatchdog binder mediator more than once";
     }
     mWatchdogProcessService = watchdogProcessService;
     mIoPerfCollection = ioPerfCollection;
+    mIoOveruseMonitor = ioOveruseMonitor;
     status_t status =
             defaultServiceManager()
                     ->addService(String16("android.automotive.watchdog.ICarWatchdog/default"),
@@ -210,7 +214,20 @@ Status WatchdogBinderMediator::notifySystemStateChange(StateType type, int32_t a
                 return fromExceptionCode(Status::EX_ILLEGAL_ARGUMENT,
                                          StringPrintf("Invalid power cycle %d", powerCycle));
             }
-            return mWatchdogProcessService->notifyPowerCycleChange(powerCycle);
+            Status status = mWatchdogProcessService->notifyPowerCycleChange(powerCycle);
+            if (!status.isOk()) {
+                return status;
+            }
+            Result<void> ret;
+            if (powerCycle == PowerCycle::POWER_CYCLE_SUSPEND) {
+                ret = mIoPerfCollection->onSuspend();
+            } else if (powerCycle == PowerCycle::POWER_CYCLE_RESUME) {
+                ret = mIoPerfCollection->onResume();
+            }
+            if (!ret.ok()) {
+                return fromExceptionCode(ret.error().code(), ret.error().message());
+            }
+            return Status::ok();
         }
         case StateType::USER_STATE: {
             userid_t userId = static_cast<userid_t>(arg1);
@@ -236,6 +253,34 @@ Status WatchdogBinderMediator::notifySystemStateChange(StateType type, int32_t a
                              StringPrintf("Invalid state change type %d", type));
 }
 
+Status WatchdogBinderMediator::registerIoOveruseListener(
+        const sp<IIoOveruseListener>& listener) {
+    Status status = checkSystemUser();
+    if (!status.isOk()) {
+        return status;
+    }
+    auto ret = mIoOveruseMonitor->registerListener(listener);
+    if (!ret.ok()) {
+        return fromExceptionCode(ret.error().code() == DEAD_OBJECT ? Status::EX_ILLEGAL_STATE
+                                                                   : Status::EX_ILLEGAL_ARGUMENT,
+                                 ret.error().message());
+    }
+    return Status::ok();
+}
+
+Status WatchdogBinderMediator::unregisterIoOveruseListener(
+        const sp<IIoOveruseListener>& listener) {
+    Status status = checkSystemUser();
+    if (!status.isOk()) {
+        return status;
+    }
+    auto ret = mIoOveruseMonitor->unregisterListener(listener);
+    if (!ret.ok()) {
+        return fromExceptionCode(Status::EX_ILLEGAL_ARGUMENT, ret.error().message());
+    }
+    return Status::ok();
+}
+
 }  // namespace watchdog
 }  // namespace automotive
 }  // namespace android
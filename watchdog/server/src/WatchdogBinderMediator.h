@@ -28,6 +28,7 @@
 #include <utils/StrongPointer.h>
 #include <utils/Vector.h>
 
+#include "IoOveruseMonitor.h"
 #include "IoPerfCollection.h"
 #include "WatchdogProcessService.h"
 
@@ -38,16 +39,24 @@ namespace watchdog {
 class ServiceManager;
 
 // WatchdogBinderMediator implements the carwatchdog binder APIs such that it forwards the calls
-// either to process ANR service or I/O performance data collection.
+// either to process ANR service, I/O performance data collection or I/O overuse monitor.
 class WatchdogBinderMediator : public BnCarWatchdog, public IBinder::DeathRecipient {
 public:
-    WatchdogBinderMediator() : mWatchdogProcessService(nullptr), mIoPerfCollection(nullptr) {}
+    WatchdogBinderMediator() :
+          mWatchdogProcessService(nullptr),
+          mIoPerfCollection(nullptr),
+          mIoOveruseMonitor(nullptr) {}
 
     status_t dump(int fd, const Vector<String16>& args) override;
     binder::Status registerClient(const sp<ICarWatchdogClient>& client,
                                   TimeoutLength timeout) override {
         return mWatchdogProcessService->registerClient(client, timeout);
     }
+    binder::Status registerHeartbeatClient(const sp<ICarWatchdogClient>& client,
+                                           TimeoutLength timeout,
+                                           os::ParcelFileDescriptor* heartbeat) override {
+        return mWatchdogProcessService->registerHeartbeatClient(client, timeout, heartbeat);
+    }
     binder::Status unregisterClient(const sp<ICarWatchdogClient>& client) override {
         return mWatchdogProcessService->unregisterClient(client);
     }
@@ -65,13 +74,17 @@ public:
     binder::Status tellDumpFinished(const android::sp<ICarWatchdogMonitor>& monitor,
                                     int32_t pid) override;
     binder::Status notifySystemStateChange(StateType type, int32_t arg1, int32_t arg2) override;
+    binder::Status registerIoOveruseListener(const sp<IIoOveruseListener>& listener) override;
+    binder::Status unregisterIoOveruseListener(const sp<IIoOveruseListener>& listener) override;
 
 protected:
     android::base::Result<void> init(android::sp<WatchdogProcessService> watchdogProcessService,
-                                     android::sp<IoPerfCollection> ioPerfCollection);
+                                     android::sp<IoPerfCollection> ioPerfCollection,
+                                     android::sp<IoOveruseMonitor> ioOveruseMonitor);
     void terminate() {
         mWatchdogProcessService = nullptr;
         mIoPerfCollection = nullptr;
+        mIoOveruseMonitor = nullptr;
     }
 
 private:
@@ -82,6 +95,7 @@ private:
 
     android::sp<WatchdogProcessService> mWatchdogProcessService;
     android::sp<IoPerfCollection> mIoPerfCollection;
+    android::sp<IoOveruseMonitor> mIoOveruseMonitor;
 
     friend class ServiceManager;
     friend class WatchdogBinderMediatorTest;
@@ -21,9 +21,24 @@
 
 #include <android-base/chrono_utils.h>
 #include <android-base/file.h>
+#include <android-base/parseint.h>
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
+#include <android-base/strings.h>
 #include <binder/IPCThreadState.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 
 namespace android {
 namespace automotive {
@@ -31,12 +46,18 @@ namespace watchdog {
 
 using std::literals::chrono_literals::operator""s;
 using android::base::Error;
+using android::base::ErrnoError;
 using android::base::GetProperty;
+using android::base::ParseUint;
+using android::base::ReadFileToString;
 using android::base::Result;
+using android::base::Split;
 using android::base::StringAppendF;
 using android::base::StringPrintf;
+using android::base::unique_fd;
 using android::base::WriteStringToFd;
 using android::binder::Status;
+using android::os::ParcelFileDescriptor;
 
 namespace {
 
@@ -44,6 +65,25 @@ const std::vector<TimeoutLength> kTimeouts = {TimeoutLength::TIMEOUT_CRITICAL,
                                               TimeoutLength::TIMEOUT_MODERATE,
                                               TimeoutLength::TIMEOUT_NORMAL};
 
+// Clients that miss their deadline while the system is saturated are likely starved rather than
+// hung. Thus their deadline is extended by the timeout duration, up to this many times.
+const int kMaxDeadlineExtensions = 2;
+
+// Number of deadline extensions reported in the dump.
+const size_t kMaxDeadlineExtensionHistorySize = 20;
+
+// Number of recoveries from processes that weren't responding reported in the dump.
+const size_t kMaxRecoveryHistorySize = 20;
+
+// Message sent when the dump deadline of a process that isn't responding passes. Distinct from the
+// health check messages, which use the TimeoutLength values.
+const int kDumpDeadlineMessage = 100;
+
+// The system is saturated when any of the below thresholds is reached.
+const uint32_t kSaturatedRunnableProcessesPerCpu = 2;
+const uint32_t kSaturatedIoBlockedProcessesPerCpu = 1;
+const double kSaturatedIoWaitPercent = 30.0;
+
 std::chrono::nanoseconds timeoutToDurationNs(const TimeoutLength& timeout) {
     switch (timeout) {
         case TimeoutLength::TIMEOUT_CRITICAL:
@@ -55,6 +95,30 @@ std::chrono::nanoseconds timeoutToDurationNs(const TimeoutLength& timeout) {
     }
 }
 
+std::string timeoutToString(const TimeoutLength& timeout) {
+    switch (timeout) {
+        case TimeoutLength::TIMEOUT_CRITICAL:
+            return "CRITICAL";
+        case TimeoutLength::TIMEOUT_MODERATE:
+            return "MODERATE";
+        case TimeoutLength::TIMEOUT_NORMAL:
+            return "NORMAL";
+    }
+}
+
+double ioWaitPercent(const ProcStatInfo& load) {
+    uint64_t totalCpuTime = load.totalCpuTime();
+    return totalCpuTime == 0 ? 0.0 : (load.cpuStats.ioWaitTime * 100.0) / totalCpuTime;
+}
+
+bool isSystemSaturated(const ProcStatInfo& load) {
+    static const uint32_t numCpus =
+            static_cast<uint32_t>(std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L));
+    return load.runnableProcessesCnt >= kSaturatedRunnableProcessesPerCpu * numCpus ||
+            load.ioBlockedProcessesCnt >= kSaturatedIoBlockedProcessesPerCpu * numCpus ||
+            ioWaitPercent(load) >= kSaturatedIoWaitPercent;
+}
+
 std::string pidArrayToString(const std::vector<int32_t>& pids) {
     size_t size = pids.size();
     if (size == 0) {
@@ -69,6 +133,30 @@ std::string pidArrayToString(const std::vector<int32_t>& pids) {
     return buffer;
 }
 
+// Returns the start time of the process, which is the 22nd field in `/proc/[pid]/stat`.
+Result<uint64_t> getProcessStartTime(pid_t pid) {
+    std::string path = StringPrintf("/proc/%d/stat", pid);
+    std::string buffer;
+    if (!ReadFileToString(path, &buffer)) {
+        return Error() << "ReadFileToString failed for " << path;
+    }
+    // The process name may contain spaces and parentheses, so skip past the last ')'.
+    size_t commEnd = buffer.rfind(')');
+    if (commEnd == std::string::npos) {
+        return Error() << "Invalid contents in " << path;
+    }
+    std::vector<std::string> fields = Split(buffer.substr(commEnd + 2), " ");
+    uint64_t startTime;
+    if (fields.size() < 20 || !ParseUint(fields[19], &startTime)) {
+        return Error() << "Invalid contents in " << path;
+    }
+    return startTime;
+}
+
+double toSeconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
 bool isSystemShuttingDown() {
     std::string sysPowerCtl;
     std::istringstream tokenStream(GetProperty("sys.powerctl", ""));
@@ -78,13 +166,20 @@ bool isSystemShuttingDown() {
 
 }  // namespace
 
-WatchdogProcessService::WatchdogProcessService(const sp<Looper>& handlerLooper) :
-      mHandlerLooper(handlerLooper), mLastSessionId(0) {
+WatchdogProcessService::WatchdogProcessService(const sp<Looper>& handlerLooper,
+                                               std::chrono::nanoseconds dumpBudget) :
+      mHandlerLooper(handlerLooper),
+      mLastSystemLoadUptime(0),
+      mHeartbeatHealthChecks(0),
+      mPingHealthChecks(0),
+      mDumpBudget(dumpBudget),
+      mLastSessionId(0) {
     mMessageHandler = new MessageHandlerImpl(this);
     mWatchdogEnabled = true;
     for (const auto& timeout : kTimeouts) {
         mClients.insert(std::make_pair(timeout, std::vector<ClientInfo>()));
         mPingedClients.insert(std::make_pair(timeout, PingedClientMap()));
+        mDeadlineExtensionCount.insert(std::make_pair(timeout, 0));
     }
 }
 
@@ -94,6 +189,31 @@ Status WatchdogProcessService::registerClient(const sp<ICarWatchdogClient>& clie
     return registerClientLocked(client, timeout, ClientType::Regular);
 }
 
+Status WatchdogProcessService::registerHeartbeatClient(const sp<ICarWatchdogClient>& client,
+                                                       TimeoutLength timeout,
+                                                       ParcelFileDescriptor* heartbeat) {
+    Mutex::Autolock lock(mMutex);
+    // A registered client keeps its region. A new region wouldn't be read by the health checks.
+    if (isRegisteredLocked(client)) {
+        ALOGW("Cannot register the client in heartbeat mode: the client is already registered.");
+        return Status::fromExceptionCode(Status::EX_ILLEGAL_STATE,
+                                         "The client is already registered");
+    }
+    unique_fd fd;
+    const auto& region = HeartbeatRegion::create(&fd);
+    if (!region.ok()) {
+        std::string errorMsg = StringPrintf("Failed to create the heartbeat region: %s",
+                                            region.error().message().c_str());
+        ALOGW("Cannot register the client: %s", errorMsg.c_str());
+        return Status::fromExceptionCode(Status::EX_SERVICE_SPECIFIC, errorMsg.c_str());
+    }
+    Status status = registerClientLocked(client, timeout, ClientType::Regular, *region);
+    if (status.isOk()) {
+        *heartbeat = ParcelFileDescriptor(std::move(fd));
+    }
+    return status;
+}
+
 Status WatchdogProcessService::unregisterClient(const sp<ICarWatchdogClient>& client) {
     Mutex::Autolock lock(mMutex);
     sp<IBinder> binder = BnCarWatchdog::asBinder(client);
@@ -190,7 +310,13 @@ Status WatchdogProcessService::tellDumpFinished(const sp<ICarWatchdogMonitor>& m
                 fromExceptionCode(Status::EX_ILLEGAL_ARGUMENT,
                                   "The monitor is not registered or an invalid monitor is given");
     }
-    ALOGI("Process(pid: %d) has been dumped and killed", pid);
+    const auto it = mPendingDumps.find(pid);
+    if (it == mPendingDumps.end()) {
+        ALOGI("Process(pid: %d) has been dumped", pid);
+        return Status::ok();
+    }
+    killProcessLocked(it->second, /*dumpFinished=*/true);
+    mPendingDumps.erase(it);
     return Status::ok();
 }
 
@@ -201,10 +327,13 @@ Status WatchdogProcessService::notifyPowerCycleChange(PowerCycle cycle) {
     switch (cycle) {
         case PowerCycle::POWER_CYCLE_SHUTDOWN:
             mWatchdogEnabled = false;
+            mLastSystemLoad.reset();
             buffer = "SHUTDOWN power cycle";
             break;
         case PowerCycle::POWER_CYCLE_SUSPEND:
             mWatchdogEnabled = false;
+            // The load from before the suspend says nothing about the system after the resume.
+            mLastSystemLoad.reset();
             buffer = "SUSPEND power cycle";
             break;
         case PowerCycle::POWER_CYCLE_RESUME:
@@ -282,6 +411,38 @@ Result<void> WatchdogProcessService::dump(int fd, const Vector<String16>& /*args
         }
     }
     WriteStringToFd(StringPrintf("%sStopped users: %s\n", indent, buffer.c_str()), fd);
+    WriteStringToFd(StringPrintf("%sClient health checks: %" PRIu64 " by heartbeat, %" PRIu64
+                                 " by ping\n",
+                                 indent, mHeartbeatHealthChecks, mPingHealthChecks),
+                    fd);
+    if (mDeadlineExtensions.empty()) {
+        WriteStringToFd(StringPrintf("%sDeadline extensions: none\n", indent), fd);
+    } else {
+        WriteStringToFd(StringPrintf("%sDeadline extensions\n", indent), fd);
+        for (const auto& extension : mDeadlineExtensions) {
+            WriteStringToFd(StringPrintf("%s%s\n", doubleIndent, extension.toString().c_str()),
+                            fd);
+        }
+    }
+    std::vector<int32_t> pendingPids;
+    for (const auto& it : mPendingDumps) {
+        pendingPids.push_back(it.first);
+    }
+    std::sort(pendingPids.begin(), pendingPids.end());
+    WriteStringToFd(StringPrintf("%sProcesses being dumped: %s\n", indent,
+                                 pendingPids.empty() ? "none"
+                                                     : pidArrayToString(pendingPids).c_str()),
+                    fd);
+    if (mRecoveries.empty()) {
+        WriteStringToFd(StringPrintf("%sRecoveries: none\n", indent), fd);
+        return {};
+    }
+    WriteStringToFd(StringPrintf("%sRecoveries\n", indent), fd);
+    for (const auto& recovery : mRecoveries) {
+        WriteStringToFd(StringPrintf("%s%s\n", doubleIndent,
+                                     recovery.toString(mDumpBudget).c_str()),
+                        fd);
+    }
     return {};
 }
 
@@ -291,29 +452,47 @@ void WatchdogProcessService::doHealthCheck(int what) {
         return;
     }
     const TimeoutLength timeout = static_cast<TimeoutLength>(what);
+    if (extendDeadlineIfSystemSaturated(timeout)) {
+        return;
+    }
     dumpAndKillClientsIfNotResponding(timeout);
 
-    /* Generates a temporary/local vector containing clients.
+    /* Generates a temporary/local vector containing clients to ping.
      * Using a local copy may send unnecessary ping messages to clients after they are unregistered.
      * Clients should be able to handle them.
      */
-    std::vector<ClientInfo> clientsToCheck;
+    std::vector<ClientInfo> clientsToPing;
+    bool hasClients = false;
     PingedClientMap& pingedClients = mPingedClients[timeout];
     {
         Mutex::Autolock lock(mMutex);
         pingedClients.clear();
-        clientsToCheck = mClients[timeout];
-        for (auto& clientInfo : clientsToCheck) {
+        mDeadlineExtensionCount[timeout] = 0;
+        std::vector<ClientInfo>& clients = mClients[timeout];
+        hasClients = !clients.empty();
+        for (auto& clientInfo : clients) {
             if (mStoppedUserId.count(clientInfo.userId) > 0) {
                 continue;
             }
-            int sessionId = getNewSessionId();
-            clientInfo.sessionId = sessionId;
-            pingedClients.insert(std::make_pair(sessionId, clientInfo));
+            // Clients in heartbeat mode are alive as long as their counter advances. They are
+            // pinged only when the counter stalls.
+            if (clientInfo.heartbeat != nullptr) {
+                uint64_t heartbeat = clientInfo.heartbeat->read();
+                if (heartbeat != clientInfo.lastHeartbeat) {
+                    clientInfo.lastHeartbeat = heartbeat;
+                    ++mHeartbeatHealthChecks;
+                    continue;
+                }
+            }
+            ++mPingHealthChecks;
+            ClientInfo clientToPing = clientInfo;
+            clientToPing.sessionId = getNewSessionId();
+            pingedClients.insert(std::make_pair(clientToPing.sessionId, clientToPing));
+            clientsToPing.push_back(clientToPing);
         }
     }
 
-    for (const auto& clientInfo : clientsToCheck) {
+    for (const auto& clientInfo : clientsToPing) {
         Status status = clientInfo.client->checkIfAlive(clientInfo.sessionId, timeout);
         if (!status.isOk()) {
             ALOGW("Sending a ping message to client(pid: %d) failed: %s", clientInfo.pid,
@@ -324,14 +503,28 @@ void WatchdogProcessService::doHealthCheck(int what) {
             }
         }
     }
-    // Though the size of pingedClients is a more specific measure, clientsToCheck is used as a
-    // conservative approach.
-    if (clientsToCheck.size() > 0) {
+    // Clients in heartbeat mode are checked even when none of them is pinged. Thus keep health
+    // checking as long as any client is registered.
+    if (hasClients) {
         auto durationNs = timeoutToDurationNs(timeout);
         mHandlerLooper->sendMessageDelayed(durationNs.count(), mMessageHandler, Message(what));
     }
 }
 
+void WatchdogProcessService::killProcessesPastDumpDeadline() {
+    Mutex::Autolock lock(mMutex);
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (auto it = mPendingDumps.begin(); it != mPendingDumps.end();) {
+        if (it->second.deadlineUptime > now) {
+            ++it;
+            continue;
+        }
+        killProcessLocked(it->second, /*dumpFinished=*/false);
+        it = mPendingDumps.erase(it);
+    }
+    scheduleDumpDeadlineLocked();
+}
+
 void WatchdogProcessService::terminate() {
     Mutex::Autolock lock(mMutex);
     for (const auto& timeout : kTimeouts) {
@@ -367,8 +560,9 @@ bool WatchdogProcessService::isRegisteredLocked(const sp<ICarWatchdogClient>& cl
     return findClientAndProcessLocked(kTimeouts, binder, nullptr);
 }
 
-Status WatchdogProcessService::registerClientLocked(const sp<ICarWatchdogClient>& client,
-                                                    TimeoutLength timeout, ClientType clientType) {
+Status WatchdogProcessService::registerClientLocked(
+        const sp<ICarWatchdogClient>& client, TimeoutLength timeout, ClientType clientType,
+        const std::shared_ptr<HeartbeatRegion>& heartbeat) {
     const char* clientName = clientType == ClientType::Regular ? "client" : "mediator";
     if (isRegisteredLocked(client)) {
         ALOGW("Cannot register the %s: the %s is already registered.", clientName, clientName);
@@ -385,7 +579,7 @@ Status WatchdogProcessService::registerClientLocked(const sp<ICarWatchdogClient>
     std::vector<ClientInfo>& clients = mClients[timeout];
     pid_t callingPid = IPCThreadState::self()->getCallingPid();
     uid_t callingUid = IPCThreadState::self()->getCallingUid();
-    clients.push_back(ClientInfo(client, callingPid, callingUid, clientType));
+    clients.push_back(ClientInfo(client, callingPid, callingUid, clientType, heartbeat));
 
     // If the client array becomes non-empty, start health checking.
     if (clients.size() == 1) {
@@ -456,12 +650,84 @@ bool WatchdogProcessService::findClientAndProcessLocked(const std::vector<Timeou
 Result<void> WatchdogProcessService::startHealthCheckingLocked(TimeoutLength timeout) {
     PingedClientMap& clients = mPingedClients[timeout];
     clients.clear();
+    mDeadlineExtensionCount[timeout] = 0;
     int what = static_cast<int>(timeout);
     auto durationNs = timeoutToDurationNs(timeout);
     mHandlerLooper->sendMessageDelayed(durationNs.count(), mMessageHandler, Message(what));
     return {};
 }
 
+Result<void> WatchdogProcessService::onSnapshot(const CollectorSnapshot& snapshot) {
+    Mutex::Autolock lock(mMutex);
+    mLastSystemLoad = snapshot.procStatInfo;
+    mLastSystemLoadUptime = snapshot.uptime;
+    return {};
+}
+
+Result<void> WatchdogProcessService::onDump(int fd) {
+    Mutex::Autolock lock(mMutex);
+    std::string buffer = "Last system load: none\n";
+    if (mLastSystemLoad.has_value()) {
+        buffer = StringPrintf("Last system load: runnable processes = %" PRIu32
+                              ", I/O blocked processes = %" PRIu32 ", I/O wait = %.2f%%\n",
+                              mLastSystemLoad->runnableProcessesCnt,
+                              mLastSystemLoad->ioBlockedProcessesCnt,
+                              ioWaitPercent(*mLastSystemLoad));
+    }
+    if (!WriteStringToFd(buffer, fd)) {
+        return Error(FAILED_TRANSACTION) << "Failed to dump the last system load";
+    }
+    return {};
+}
+
+bool WatchdogProcessService::extendDeadlineIfSystemSaturated(TimeoutLength timeout) {
+    Mutex::Autolock lock(mMutex);
+    // The load is averaged over the whole collection interval, which is far longer than the
+    // health check timeouts outside of the boot-time and custom collections. A load sampled before
+    // the current deadline says nothing about why the clients missed it.
+    if (!mLastSystemLoad.has_value() ||
+        systemTime(SYSTEM_TIME_MONOTONIC) - mLastSystemLoadUptime >
+                timeoutToDurationNs(timeout).count() ||
+        !isSystemSaturated(*mLastSystemLoad)) {
+        return false;
+    }
+    std::vector<int32_t> pids;
+    for (const auto& it : mPingedClients[timeout]) {
+        if (mStoppedUserId.count(it.second.userId) == 0) {
+            pids.push_back(it.second.pid);
+        }
+    }
+    if (pids.empty()) {
+        return false;
+    }
+    int& extensionCount = mDeadlineExtensionCount[timeout];
+    if (extensionCount >= kMaxDeadlineExtensions) {
+        ALOGW("Not extending the %s deadline of processes(pid = %s) any further: Already extended "
+              "%d times",
+              timeoutToString(timeout).c_str(), pidArrayToString(pids).c_str(), extensionCount);
+        return false;
+    }
+    ++extensionCount;
+    DeadlineExtension extension = {
+            .time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()),
+            .timeout = timeout,
+            .duration = timeoutToDurationNs(timeout),
+            .pids = pids,
+            .systemLoad = *mLastSystemLoad,
+    };
+    ALOGW("System is saturated. Extending the %s deadline of processes(pid = %s) by %" PRId64
+          " seconds",
+          timeoutToString(timeout).c_str(), pidArrayToString(pids).c_str(),
+          std::chrono::duration_cast<std::chrono::seconds>(extension.duration).count());
+    mDeadlineExtensions.push_back(extension);
+    if (mDeadlineExtensions.size() > kMaxDeadlineExtensionHistorySize) {
+        mDeadlineExtensions.pop_front();
+    }
+    mHandlerLooper->sendMessageDelayed(extension.duration.count(), mMessageHandler,
+                                       Message(static_cast<int>(timeout)));
+    return true;
+}
+
 Result<void> WatchdogProcessService::dumpAndKillClientsIfNotResponding(TimeoutLength timeout) {
     std::vector<int32_t> processIds;
     std::vector<sp<ICarWatchdogClient>> clientsToNotify;
@@ -517,13 +783,84 @@ Result<void> WatchdogProcessService::dumpAndKillAllProcesses(
               pidString.c_str());
         return {};
     }
-    monitor->onClientsNotResponding(processesNotResponding);
+    std::vector<int32_t> processesToDump;
+    {
+        Mutex::Autolock lock(mMutex);
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (const auto& pid : processesNotResponding) {
+            if (mPendingDumps.find(pid) != mPendingDumps.end()) {
+                continue;
+            }
+            const auto& startTime = getProcessStartTime(pid);
+            if (!startTime.ok()) {
+                ALOGW("Skip dumping and killing process(pid: %d): %s", pid,
+                      startTime.error().message().c_str());
+                continue;
+            }
+            mPendingDumps[pid] = {
+                    .pid = pid,
+                    .startTime = *startTime,
+                    .notRespondingUptime = now,
+                    .deadlineUptime = now + mDumpBudget.count(),
+            };
+            processesToDump.push_back(pid);
+        }
+        if (processesToDump.empty()) {
+            return {};
+        }
+        scheduleDumpDeadlineLocked();
+    }
+    // The monitor reports each process through tellDumpFinished as soon as its dump finishes, so
+    // the processes are killed independently of each other.
+    monitor->onClientsNotResponding(processesToDump);
     if (DEBUG) {
-        ALOGD("Dumping and killing processes is requested: %s", pidString.c_str());
+        ALOGD("Dumping and killing processes is requested: %s",
+              pidArrayToString(processesToDump).c_str());
     }
     return {};
 }
 
+void WatchdogProcessService::killProcessLocked(const PendingDump& pendingDump, bool dumpFinished) {
+    pid_t pid = pendingDump.pid;
+    const char* reason = dumpFinished ? "its dump finished" : "its dump deadline passed";
+    int killErrno = 0;
+    const auto& startTime = getProcessStartTime(pid);
+    if (!startTime.ok() || *startTime != pendingDump.startTime) {
+        // The process has already exited, possibly killed by the monitor, and its PID may have
+        // been reused.
+        ALOGI("Process(pid: %d) has already exited when %s", pid, reason);
+    } else if (kill(pid, SIGKILL) != 0 && errno != ESRCH) {
+        killErrno = errno;
+        ALOGE("Failed to kill process(pid: %d) when %s: %s", pid, reason, strerror(killErrno));
+    } else {
+        ALOGI("Killed process(pid: %d) as %s", pid, reason);
+    }
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    mRecoveries.push_back({
+            .time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()),
+            .pid = pid,
+            .dumpFinished = dumpFinished,
+            .killErrno = killErrno,
+            .timeToRecovery = std::chrono::nanoseconds(now - pendingDump.notRespondingUptime),
+    });
+    if (mRecoveries.size() > kMaxRecoveryHistorySize) {
+        mRecoveries.pop_front();
+    }
+}
+
+void WatchdogProcessService::scheduleDumpDeadlineLocked() {
+    mHandlerLooper->removeMessages(mMessageHandler, kDumpDeadlineMessage);
+    if (mPendingDumps.empty()) {
+        return;
+    }
+    nsecs_t nextDeadline = std::numeric_limits<nsecs_t>::max();
+    for (const auto& it : mPendingDumps) {
+        nextDeadline = std::min(nextDeadline, it.second.deadlineUptime);
+    }
+    nsecs_t delay = std::max(nextDeadline - systemTime(SYSTEM_TIME_MONOTONIC), nsecs_t(0));
+    mHandlerLooper->sendMessageDelayed(delay, mMessageHandler, Message(kDumpDeadlineMessage));
+}
+
 int32_t WatchdogProcessService::getNewSessionId() {
     // Make sure that session id is always positive number.
     if (++mLastSessionId <= 0) {
@@ -537,13 +874,74 @@ bool WatchdogProcessService::isWatchdogEnabled() {
     return mWatchdogEnabled;
 }
 
+WatchdogProcessService::HeartbeatRegion::~HeartbeatRegion() {
+    munmap(const_cast<uint64_t*>(mCounter), sizeof(uint64_t));
+}
+
+Result<std::shared_ptr<WatchdogProcessService::HeartbeatRegion>>
+WatchdogProcessService::HeartbeatRegion::create(unique_fd* fd) {
+    // The memfd is created here rather than by the client so it is labeled carwatchdogd_tmpfs,
+    // which only the watchdog clients are allowed to map.
+    unique_fd regionFd(memfd_create("carwatchdog_heartbeat", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (regionFd.get() < 0) {
+        return ErrnoError() << "Failed to create the region";
+    }
+    if (ftruncate(regionFd.get(), sizeof(uint64_t)) != 0) {
+        return ErrnoError() << "Failed to size the region";
+    }
+    // The client must not be able to shrink the region. Otherwise, reading the counter would
+    // crash the daemon with SIGBUS.
+    if (fcntl(regionFd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        return ErrnoError() << "Failed to seal the region";
+    }
+    void* addr = mmap(nullptr, sizeof(uint64_t), PROT_READ, MAP_SHARED, regionFd.get(), 0);
+    if (addr == MAP_FAILED) {
+        return ErrnoError() << "Failed to map the region";
+    }
+    *fd = std::move(regionFd);
+    return std::shared_ptr<HeartbeatRegion>(new HeartbeatRegion(static_cast<uint64_t*>(addr)));
+}
+
+uint64_t WatchdogProcessService::HeartbeatRegion::read() const {
+    return __atomic_load_n(mCounter, __ATOMIC_ACQUIRE);
+}
+
 std::string WatchdogProcessService::ClientInfo::toString() {
     std::string buffer;
-    StringAppendF(&buffer, "pid = %d, userId = %d, type = %s", pid, userId,
-                  type == Regular ? "Regular" : "Mediator");
+    StringAppendF(&buffer, "pid = %d, userId = %d, type = %s, heartbeat = %s", pid, userId,
+                  type == Regular ? "Regular" : "Mediator",
+                  heartbeat == nullptr ? "false" : "true");
     return buffer;
 }
 
+std::string WatchdogProcessService::DeadlineExtension::toString() const {
+    std::stringstream timestamp;
+    timestamp << std::put_time(std::localtime(&time), "%c %Z");
+    return StringPrintf("%s: Extended the %s deadline of processes(pid = %s) by %" PRId64
+                        " seconds (runnable processes = %" PRIu32
+                        ", I/O blocked processes = %" PRIu32 ", I/O wait = %.2f%%)",
+                        timestamp.str().c_str(), timeoutToString(timeout).c_str(),
+                        pidArrayToString(pids).c_str(),
+                        std::chrono::duration_cast<std::chrono::seconds>(duration).count(),
+                        systemLoad.runnableProcessesCnt, systemLoad.ioBlockedProcessesCnt,
+                        ioWaitPercent(systemLoad));
+}
+
+std::string WatchdogProcessService::Recovery::toString(std::chrono::nanoseconds dumpBudget) const {
+    std::stringstream timestamp;
+    timestamp << std::put_time(std::localtime(&time), "%c %Z");
+    std::string reason = dumpFinished
+            ? "its dump finished"
+            : StringPrintf("its dump didn't finish within %.2f seconds", toSeconds(dumpBudget));
+    if (killErrno != 0) {
+        return StringPrintf("%s: Failed to kill process(pid = %d) after %s: %s",
+                            timestamp.str().c_str(), pid, reason.c_str(), strerror(killErrno));
+    }
+    return StringPrintf("%s: Recovered from process(pid = %d) after %s. Time to recovery = %.2f "
+                        "seconds",
+                        timestamp.str().c_str(), pid, reason.c_str(), toSeconds(timeToRecovery));
+}
+
 WatchdogProcessService::MessageHandlerImpl::MessageHandlerImpl(
         const sp<WatchdogProcessService>& service) :
       mService(service) {}
@@ -555,6 +953,9 @@ void WatchdogProcessService::MessageHandlerImpl::handleMessage(const Message& me
         case static_cast<int>(TimeoutLength::TIMEOUT_NORMAL):
             mService->doHealthCheck(message.what);
             break;
+        case kDumpDeadlineMessage:
+            mService->killProcessesPastDumpDeadline();
+            break;
         default:
             ALOGW("Unknown message: %d", message.what);
     }
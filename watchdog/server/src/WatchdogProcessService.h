@@ -18,9 +18,11 @@
 #define WATCHDOG_SERVER_SRC_WATCHDOGPROCESSSERVICE_H_
 
 #include <android-base/result.h>
+#include <android-base/unique_fd.h>
 #include <android/automotive/watchdog/BnCarWatchdog.h>
 #include <android/automotive/watchdog/PowerCycle.h>
 #include <android/automotive/watchdog/UserState.h>
+#include <android/os/ParcelFileDescriptor.h>
 #include <binder/IBinder.h>
 #include <binder/Status.h>
 #include <cutils/multiuser.h>
@@ -28,24 +30,42 @@
 #include <utils/Mutex.h>
 #include <utils/String16.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 #include <utils/Vector.h>
 
+#include <chrono>
 #include <unordered_map>
 #include <unordered_set>
+#include <deque>
+#include <memory>
+#include <optional>
 #include <vector>
 
+#include "DataProcessor.h"
+
 namespace android {
 namespace automotive {
 namespace watchdog {
 
-class WatchdogProcessService : public IBinder::DeathRecipient {
+// Time given to the monitor to dump a process that isn't responding before the process is killed.
+constexpr std::chrono::nanoseconds kDefaultDumpBudget = std::chrono::seconds(10);
+
+// The service is registered as a data processor with IoPerfCollection, which provides the system
+// load used to extend the health check deadlines when the system is saturated.
+class WatchdogProcessService : public IBinder::DeathRecipient, public DataProcessor {
 public:
-    explicit WatchdogProcessService(const android::sp<Looper>& handlerLooper);
+    // |dumpBudget| is the time each process that isn't responding is given to be dumped before it
+    // is killed.
+    explicit WatchdogProcessService(const android::sp<Looper>& handlerLooper,
+                                    std::chrono::nanoseconds dumpBudget = kDefaultDumpBudget);
 
     virtual android::base::Result<void> dump(int fd, const Vector<String16>& args);
 
     virtual binder::Status registerClient(const sp<ICarWatchdogClient>& client,
                                           TimeoutLength timeout);
+    virtual binder::Status registerHeartbeatClient(const sp<ICarWatchdogClient>& client,
+                                                   TimeoutLength timeout,
+                                                   os::ParcelFileDescriptor* heartbeat);
     virtual binder::Status unregisterClient(const sp<ICarWatchdogClient>& client);
     virtual binder::Status registerMediator(const sp<ICarWatchdogClient>& mediator);
     virtual binder::Status unregisterMediator(const sp<ICarWatchdogClient>& mediator);
@@ -61,7 +81,14 @@ public:
     virtual binder::Status notifyUserStateChange(userid_t userId, UserState state);
     virtual void binderDied(const android::wp<IBinder>& who);
 
+    std::string name() override { return "Watchdog process service"; }
+    DataSourceSet dataSources() override { return DataSourceSet().set(DataSource::PROC_STAT); }
+    android::base::Result<void> onSnapshot(const CollectorSnapshot& snapshot) override;
+    android::base::Result<void> onDump(int fd) override;
+
     void doHealthCheck(int what);
+    // Kills the processes whose dump didn't finish within the dump budget.
+    void killProcessesPastDumpDeadline();
     void terminate();
 
 private:
@@ -70,13 +97,35 @@ private:
         Mediator,
     };
 
+    // Read-only mapping of the heartbeat counter shared by a client registered in heartbeat mode.
+    class HeartbeatRegion {
+    public:
+        HeartbeatRegion(const HeartbeatRegion&) = delete;
+        HeartbeatRegion& operator=(const HeartbeatRegion&) = delete;
+        ~HeartbeatRegion();
+
+        // Creates and maps a new counter. |fd| is set to the memfd holding it, sealed against
+        // resizing, for the client to map read-write.
+        static android::base::Result<std::shared_ptr<HeartbeatRegion>> create(
+                android::base::unique_fd* fd);
+
+        uint64_t read() const;
+
+    private:
+        explicit HeartbeatRegion(const uint64_t* counter) : mCounter(counter) {}
+
+        const uint64_t* mCounter;
+    };
+
     struct ClientInfo {
         ClientInfo(const android::sp<ICarWatchdogClient>& client, pid_t pid, userid_t userId,
-                   ClientType type) :
+                   ClientType type, const std::shared_ptr<HeartbeatRegion>& heartbeat) :
               client(client),
               pid(pid),
               userId(userId),
-              type(type) {}
+              type(type),
+              heartbeat(heartbeat),
+              lastHeartbeat(heartbeat == nullptr ? 0 : heartbeat->read()) {}
         std::string toString();
 
         android::sp<ICarWatchdogClient> client;
@@ -84,10 +133,42 @@ private:
         userid_t userId;
         int sessionId;
         ClientType type;
+        // Set only for clients registered in heartbeat mode.
+        std::shared_ptr<HeartbeatRegion> heartbeat;
+        // Heartbeat counter read on the last health check.
+        uint64_t lastHeartbeat;
     };
 
     typedef std::unordered_map<int, ClientInfo> PingedClientMap;
 
+    struct DeadlineExtension {
+        time_t time;
+        TimeoutLength timeout;
+        std::chrono::nanoseconds duration;
+        std::vector<int32_t> pids;
+        ProcStatInfo systemLoad;
+        std::string toString() const;
+    };
+
+    // Process that isn't responding and is being dumped by the monitor.
+    struct PendingDump {
+        pid_t pid;
+        // Start time of the process. Used to detect PID reuse before killing the process.
+        uint64_t startTime;
+        nsecs_t notRespondingUptime;
+        nsecs_t deadlineUptime;
+    };
+
+    struct Recovery {
+        time_t time;
+        pid_t pid;
+        bool dumpFinished;
+        // errno of the failed kill. Zero when the process was recovered.
+        int killErrno;
+        std::chrono::nanoseconds timeToRecovery;
+        std::string toString(std::chrono::nanoseconds dumpBudget) const;
+    };
+
     class MessageHandlerImpl : public MessageHandler {
     public:
         explicit MessageHandlerImpl(const android::sp<WatchdogProcessService>& service);
@@ -99,16 +180,20 @@ private:
     };
 
 private:
-    binder::Status registerClientLocked(const android::sp<ICarWatchdogClient>& client,
-                                        TimeoutLength timeout, ClientType clientType);
+    binder::Status registerClientLocked(
+            const android::sp<ICarWatchdogClient>& client, TimeoutLength timeout,
+            ClientType clientType, const std::shared_ptr<HeartbeatRegion>& heartbeat = nullptr);
     binder::Status unregisterClientLocked(const std::vector<TimeoutLength>& timeouts,
                                           android::sp<IBinder> binder, ClientType clientType);
     bool isRegisteredLocked(const android::sp<ICarWatchdogClient>& client);
     binder::Status tellClientAliveLocked(const android::sp<ICarWatchdogClient>& client,
                                          int32_t sessionId);
     base::Result<void> startHealthCheckingLocked(TimeoutLength timeout);
+    bool extendDeadlineIfSystemSaturated(TimeoutLength timeout);
     base::Result<void> dumpAndKillClientsIfNotResponding(TimeoutLength timeout);
     base::Result<void> dumpAndKillAllProcesses(const std::vector<int32_t>& processesNotResponding);
+    void killProcessLocked(const PendingDump& pendingDump, bool dumpFinished);
+    void scheduleDumpDeadlineLocked();
     int32_t getNewSessionId();
     bool isWatchdogEnabled();
 
@@ -126,6 +211,24 @@ private:
     std::unordered_set<userid_t> mStoppedUserId GUARDED_BY(mMutex);
     android::sp<ICarWatchdogMonitor> mMonitor GUARDED_BY(mMutex);
     bool mWatchdogEnabled GUARDED_BY(mMutex);
+    // System load sampled on the last I/O performance collection. Unset when the load couldn't be
+    // sampled and while the system is suspended.
+    std::optional<ProcStatInfo> mLastSystemLoad GUARDED_BY(mMutex);
+    // Uptime at which |mLastSystemLoad| was sampled.
+    nsecs_t mLastSystemLoadUptime GUARDED_BY(mMutex);
+    // Number of times the deadline of the current health check was extended, per timeout.
+    std::unordered_map<TimeoutLength, int> mDeadlineExtensionCount GUARDED_BY(mMutex);
+    // Most recent deadline extensions, oldest first. Reported in the dump.
+    std::deque<DeadlineExtension> mDeadlineExtensions GUARDED_BY(mMutex);
+    // Number of client health checks answered by the heartbeat counter and by binder pings.
+    uint64_t mHeartbeatHealthChecks GUARDED_BY(mMutex);
+    uint64_t mPingHealthChecks GUARDED_BY(mMutex);
+    const std::chrono::nanoseconds mDumpBudget;
+    // Processes being dumped, keyed by PID. Each process is killed as soon as its own dump
+    // finishes or its dump deadline passes.
+    std::unordered_map<pid_t, PendingDump> mPendingDumps GUARDED_BY(mMutex);
+    // Most recent recoveries from processes that weren't responding, oldest first.
+    std::deque<Recovery> mRecoveries GUARDED_BY(mMutex);
     // mLastSessionId is accessed only within main thread. No need for mutual-exclusion.
     int32_t mLastSessionId;
 };
@@ -0,0 +1,259 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CpuCoreStats.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <inttypes.h>
+
+#include <string>
+#include <vector>
+
+#include "CpuDir.h"
+#include "gmock/gmock.h"
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+using android::base::WriteStringToFile;
+using testing::populateCpuDir;
+
+namespace {
+
+std::string toString(const std::vector<CpuCoreUsage>& usages) {
+    std::string buffer;
+    for (const auto& usage : usages) {
+        const auto& cpuStats = usage.cpuStats;
+        StringAppendF(&buffer,
+                      "cpu%" PRIu32 ": UserTime: %" PRIu64 " NiceTime: %" PRIu64
+                      " SysTime: %" PRIu64 " IdleTime: %" PRIu64 " IoWaitTime: %" PRIu64
+                      " IrqTime: %" PRIu64 " SoftIrqTime: %" PRIu64 " StealTime: %" PRIu64
+                      " GuestTime: %" PRIu64 " GuestNiceTime: %" PRIu64 "\nTime in state:",
+                      usage.cpu, cpuStats.userTime, cpuStats.niceTime, cpuStats.sysTime,
+                      cpuStats.idleTime, cpuStats.ioWaitTime, cpuStats.irqTime,
+                      cpuStats.softIrqTime, cpuStats.stealTime, cpuStats.guestTime,
+                      cpuStats.guestNiceTime);
+        for (const auto& it : usage.timeInState) {
+            StringAppendF(&buffer, " %" PRIu32 ": %" PRIu64, it.first, it.second);
+        }
+        StringAppendF(&buffer, "\n");
+    }
+    return buffer;
+}
+
+std::string procStatContents(const std::vector<std::string>& cpuLines) {
+    std::string buffer = "cpu  6200 5700 1700 3100 1100 5200 3900 0 0 0\n";
+    for (const auto& line : cpuLines) {
+        buffer += line + "\n";
+    }
+    buffer += "intr 694351583 0 0 0 297062868 0 5922464 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+              "0 0 0\n"
+              "ctxt 579020168\n"
+              "btime 1579718450\n"
+              "processes 113804\n"
+              "procs_running 17\n"
+              "procs_blocked 5\n"
+              "softirq 33275060 934664 11958403 5111 516325 200333 0 341482 10651335 0 8667407\n";
+    return buffer;
+}
+
+}  // namespace
+
+TEST(CpuCoreStatsTest, TestValidStatFiles) {
+    TemporaryFile procStat;
+    TemporaryDir cpuDir;
+    ASSERT_NE(procStat.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(procStatContents({
+                                          "cpu0 2400 2900 600 690 340 4300 2100 0 0 0",
+                                          "cpu1 1900 2380 510 760 51 370 1500 0 0 0",
+                                  }),
+                                  procStat.path));
+    // Only cpu0 has cpufreq stats.
+    auto ret = populateCpuDir(cpuDir.path, {{0, "300000 100\n1200000 500\n1800000 2000\n"}});
+    ASSERT_TRUE(ret) << "Failed to populate cpu dir: " << ret.error();
+
+    std::vector<CpuCoreUsage> expectedFirstDelta = {
+            {.cpu = 0,
+             .cpuStats = {2400, 2900, 600, 690, 340, 4300, 2100, 0, 0, 0},
+             .timeInState = {{300000, 100}, {1200000, 500}, {1800000, 2000}}},
+            {.cpu = 1, .cpuStats = {1900, 2380, 510, 760, 51, 370, 1500, 0, 0, 0}},
+    };
+
+    CpuCoreStats cpuCoreStats(procStat.path, cpuDir.path);
+    ASSERT_TRUE(cpuCoreStats.enabled()) << "Temporary file is inaccessible";
+
+    const auto& actualFirstDelta = cpuCoreStats.collect();
+    ASSERT_RESULT_OK(actualFirstDelta);
+    EXPECT_EQ(expectedFirstDelta, *actualFirstDelta)
+            << "First snapshot doesn't match.\nExpected:\n"
+            << toString(expectedFirstDelta) << "\nActual:\n"
+            << toString(*actualFirstDelta);
+
+    ASSERT_TRUE(WriteStringToFile(procStatContents({
+                                          "cpu0 4400 3400 700 890 800 4500 3100 0 0 0",
+                                          "cpu1 5900 3380 610 960 100 670 2000 0 0 0",
+                                  }),
+                                  procStat.path));
+    ret = populateCpuDir(cpuDir.path, {{0, "300000 150\n1200000 500\n1800000 2900\n"}});
+    ASSERT_TRUE(ret) << "Failed to populate cpu dir: " << ret.error();
+
+    std::vector<CpuCoreUsage> expectedSecondDelta = {
+            {.cpu = 0,
+             .cpuStats = {2000, 500, 100, 200, 460, 200, 1000, 0, 0, 0},
+             .timeInState = {{300000, 50}, {1200000, 0}, {1800000, 900}}},
+            {.cpu = 1, .cpuStats = {4000, 1000, 100, 200, 49, 300, 500, 0, 0, 0}},
+    };
+
+    const auto& actualSecondDelta = cpuCoreStats.collect();
+    ASSERT_RESULT_OK(actualSecondDelta);
+    EXPECT_EQ(expectedSecondDelta, *actualSecondDelta)
+            << "Second snapshot doesn't match.\nExpected:\n"
+            << toString(expectedSecondDelta) << "\nActual:\n"
+            << toString(*actualSecondDelta);
+}
+
+TEST(CpuCoreStatsTest, TestHandlesHotpluggedCores) {
+    TemporaryFile procStat;
+    TemporaryDir cpuDir;
+    ASSERT_NE(procStat.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(procStatContents({
+                                          "cpu0 2400 2900 600 690 340 4300 2100 0 0 0",
+                                          "cpu1 1900 2380 510 760 51 370 1500 0 0 0",
+                                  }),
+                                  procStat.path));
+    auto ret = populateCpuDir(cpuDir.path, {{0, "300000 100\n"}, {1, "300000 200\n"}});
+    ASSERT_TRUE(ret) << "Failed to populate cpu dir: " << ret.error();
+
+    CpuCoreStats cpuCoreStats(procStat.path, cpuDir.path);
+    ASSERT_RESULT_OK(cpuCoreStats.collect());
+
+    // cpu1 goes offline and is no longer listed.
+    ASSERT_TRUE(WriteStringToFile(procStatContents({
+                                          "cpu0 2500 2900 600 790 340 4300 2100 0 0 0",
+                                  }),
+                                  procStat.path));
+    ret = populateCpuDir(cpuDir.path, {{0, "300000 300\n"}});
+    ASSERT_TRUE(ret) << "Failed to populate cpu dir: " << ret.error();
+
+    std::vector<CpuCoreUsage> expectedDelta = {
+            {.cpu = 0,
+             .cpuStats = {100, 0, 0, 100, 0, 0, 0, 0, 0, 0},
+             .timeInState = {{300000, 200}}},
+    };
+    auto actualDelta = cpuCoreStats.collect();
+    ASSERT_RESULT_OK(actualDelta);
+    EXPECT_EQ(expectedDelta, *actualDelta) << "Offline core delta doesn't match.\nExpected:\n"
+                                           << toString(expectedDelta) << "\nActual:\n"
+                                           << toString(*actualDelta);
+
+    // cpu1 comes back online with its cpufreq stats reset.
+    ASSERT_TRUE(WriteStringToFile(procStatContents({
+                                          "cpu0 2500 2900 600 890 340 4300 2100 0 0 0",
+                                          "cpu1 2000 2380 510 860 51 370 1500 0 0 0",
+                                  }),
+                                  procStat.path));
+    ret = populateCpuDir(cpuDir.path, {{0, "300000 400\n"}, {1, "300000 20\n"}});
+    ASSERT_TRUE(ret) << "Failed to populate cpu dir: " << ret.error();
+
+    expectedDelta = {
+            {.cpu = 0,
+             .cpuStats = {0, 0, 0, 100, 0, 0, 0, 0, 0, 0},
+             .timeInState = {{300000, 100}}},
+            {.cpu = 1,
+             .cpuStats = {100, 0, 0, 100, 0, 0, 0, 0, 0, 0},
+             .timeInState = {{300000, 20}}},
+    };
+    actualDelta = cpuCoreStats.collect();
+    ASSERT_RESULT_OK(actualDelta);
+    EXPECT_EQ(expectedDelta, *actualDelta) << "Online core delta doesn't match.\nExpected:\n"
+                                           << toString(expectedDelta) << "\nActual:\n"
+                                           << toString(*actualDelta);
+}
+
+TEST(CpuCoreStatsTest, TestErrorOnCorruptedCpuLine) {
+    TemporaryFile procStat;
+    TemporaryDir cpuDir;
+    ASSERT_NE(procStat.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(procStatContents({
+                                          "cpu0 2400 2900 600 690 340 4300 2100 0 0 0",
+                                          "cpu1 1900 2380 510 CORRUPTED DATA",
+                                  }),
+                                  procStat.path));
+
+    CpuCoreStats cpuCoreStats(procStat.path, cpuDir.path);
+    ASSERT_TRUE(cpuCoreStats.enabled()) << "Temporary file is inaccessible";
+    EXPECT_FALSE(cpuCoreStats.collect().ok()) << "No error returned for corrupted file";
+}
+
+TEST(CpuCoreStatsTest, TestErrorOnDuplicateCpuLine) {
+    TemporaryFile procStat;
+    TemporaryDir cpuDir;
+    ASSERT_NE(procStat.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(procStatContents({
+                                          "cpu0 2400 2900 600 690 340 4300 2100 0 0 0",
+                                          "cpu0 1900 2380 510 760 51 370 1500 0 0 0",
+                                  }),
+                                  procStat.path));
+
+    CpuCoreStats cpuCoreStats(procStat.path, cpuDir.path);
+    EXPECT_FALSE(cpuCoreStats.collect().ok()) << "No error returned for duplicate cpu line";
+}
+
+TEST(CpuCoreStatsTest, TestErrorOnMissingCpuLines) {
+    TemporaryFile procStat;
+    TemporaryDir cpuDir;
+    ASSERT_NE(procStat.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(procStatContents({}), procStat.path));
+
+    CpuCoreStats cpuCoreStats(procStat.path, cpuDir.path);
+    EXPECT_FALSE(cpuCoreStats.collect().ok()) << "No error returned due to missing cpuN lines";
+}
+
+TEST(CpuCoreStatsTest, TestErrorOnCorruptedTimeInStateFile) {
+    TemporaryFile procStat;
+    TemporaryDir cpuDir;
+    ASSERT_NE(procStat.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(procStatContents({
+                                          "cpu0 2400 2900 600 690 340 4300 2100 0 0 0",
+                                  }),
+                                  procStat.path));
+    auto ret = populateCpuDir(cpuDir.path, {{0, "300000 100\n1200000 CORRUPTED DATA\n"}});
+    ASSERT_TRUE(ret) << "Failed to populate cpu dir: " << ret.error();
+
+    CpuCoreStats cpuCoreStats(procStat.path, cpuDir.path);
+    EXPECT_FALSE(cpuCoreStats.collect().ok()) << "No error returned for corrupted time_in_state";
+}
+
+TEST(CpuCoreStatsTest, TestCpuCoreStatsFromDevice) {
+    CpuCoreStats cpuCoreStats;
+    ASSERT_TRUE(cpuCoreStats.enabled()) << kProcStatPath << " file is inaccessible";
+
+    const auto& usages = cpuCoreStats.collect();
+    ASSERT_RESULT_OK(usages);
+
+    // The cpu0 line should be always present as the boot CPU can't be taken offline.
+    ASSERT_FALSE(usages->empty());
+    EXPECT_EQ(usages->front().cpu, 0);
+    EXPECT_GT(usages->front().totalCpuTime(), 0);
+}
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
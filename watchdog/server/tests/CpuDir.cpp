@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2020, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CpuDir.h"
+
+#include <android-base/file.h>
+#include <android-base/result.h>
+#include <android-base/stringprintf.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "CpuCoreStats.h"
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+namespace testing {
+
+using android::base::Error;
+using android::base::Result;
+using android::base::StringPrintf;
+using android::base::WriteStringToFile;
+
+namespace {
+
+Result<void> makeDir(std::string path) {
+    if (mkdir(path.c_str(), 0700) && errno != EEXIST) {
+        return Error() << "Could not mkdir " << path << ": " << strerror(errno);
+    }
+    return {};
+}
+
+}  // namespace
+
+Result<void> populateCpuDir(const std::string& cpuDirPath,
+                            const std::unordered_map<uint32_t, std::string>& timeInState) {
+    for (const auto& it : timeInState) {
+        // Create the /sys/devices/system/cpu/cpuN/cpufreq/stats dirs one level at a time.
+        std::string path = StringPrintf("%s/cpu%" PRIu32, cpuDirPath.c_str(), it.first);
+        for (const char* dir : {"", "/cpufreq", "/stats"}) {
+            path += dir;
+            const auto& ret = makeDir(path);
+            if (!ret) {
+                return Error() << "Failed to create per-CPU directory: " << ret.error();
+            }
+        }
+        path = StringPrintf((cpuDirPath + kTimeInStateFileFormat).c_str(), it.first);
+        if (!WriteStringToFile(it.second, path)) {
+            return Error() << "Failed to write time_in_state file " << path;
+        }
+    }
+    return {};
+}
+
+}  // namespace testing
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
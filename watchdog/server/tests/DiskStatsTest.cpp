@@ -0,0 +1,373 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DiskStats.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+using android::base::Result;
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+using android::base::WriteStringToFile;
+
+namespace {
+
+std::string toString(const std::vector<DiskUsage>& usages) {
+    std::string buffer;
+    for (const auto& usage : usages) {
+        const DiskIoStats& stats = usage.stats;
+        StringAppendF(&buffer,
+                      "%s: Reads: %" PRIu64 " Sectors read: %" PRIu64 " Read time: %" PRIu64
+                      " Writes: %" PRIu64 " Sectors written: %" PRIu64 " Write time: %" PRIu64
+                      " In progress: %" PRIu64 " I/O time: %" PRIu64
+                      " Weighted I/O time: %" PRIu64 " Discards: %" PRIu64
+                      " Sectors discarded: %" PRIu64 " Discard time: %" PRIu64 "\n",
+                      usage.name.c_str(), stats.readsCompleted, stats.sectorsRead,
+                      stats.readTimeMillis, stats.writesCompleted, stats.sectorsWritten,
+                      stats.writeTimeMillis, stats.ioInProgress, stats.ioTimeMillis,
+                      stats.weightedIoTimeMillis, stats.discardsCompleted, stats.sectorsDiscarded,
+                      stats.discardTimeMillis);
+    }
+    return buffer;
+}
+
+Result<void> populateSysBlockDir(const std::string& path, const std::vector<std::string>& disks) {
+    for (const auto& disk : disks) {
+        std::string diskPath = path + "/" + disk;
+        if (mkdir(diskPath.c_str(), 0700)) {
+            return android::base::Error() << "Could not mkdir " << diskPath;
+        }
+    }
+    return {};
+}
+
+}  // namespace
+
+TEST(DiskStatsTest, TestValidDiskStatsFile) {
+    constexpr char firstSnapshot[] =
+            "   7       0 loop0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n"
+            " 179       0 mmcblk0 12000 1200 2400000 30000 8000 900 1600000 50000 1 40000 80000 "
+            "100 0 20000 300\n"
+            " 179       1 mmcblk0p1 11000 1100 2200000 29000 7000 800 1400000 49000 1 39000 79000 "
+            "100 0 20000 300\n"
+            " 254       0 dm-0 500 0 4000 600 200 0 1600 400 0 900 1000 0 0 0 0\n";
+    std::vector<DiskUsage> expectedFirstDelta = {
+            {.name = "loop0"},
+            {.name = "mmcblk0",
+             .stats = {.readsCompleted = 12000,
+                       .sectorsRead = 2400000,
+                       .readTimeMillis = 30000,
+                       .writesCompleted = 8000,
+                       .sectorsWritten = 1600000,
+                       .writeTimeMillis = 50000,
+                       .ioInProgress = 1,
+                       .ioTimeMillis = 40000,
+                       .weightedIoTimeMillis = 80000,
+                       .discardsCompleted = 100,
+                       .sectorsDiscarded = 20000,
+                       .discardTimeMillis = 300}},
+            {.name = "dm-0",
+             .stats = {.readsCompleted = 500,
+                       .sectorsRead = 4000,
+                       .readTimeMillis = 600,
+                       .writesCompleted = 200,
+                       .sectorsWritten = 1600,
+                       .writeTimeMillis = 400,
+                       .ioInProgress = 0,
+                       .ioTimeMillis = 900,
+                       .weightedIoTimeMillis = 1000}},
+    };
+
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(firstSnapshot, tf.path));
+    TemporaryDir sysBlockDir;
+    auto ret = populateSysBlockDir(sysBlockDir.path, {"loop0", "mmcblk0", "dm-0"});
+    ASSERT_TRUE(ret) << "Failed to populate sys block dir: " << ret.error();
+
+    DiskStats diskStats(tf.path, sysBlockDir.path);
+    ASSERT_TRUE(diskStats.enabled()) << "Temporary file is inaccessible";
+
+    const auto& actualFirstDelta = diskStats.collect();
+    ASSERT_RESULT_OK(actualFirstDelta);
+    EXPECT_EQ(expectedFirstDelta, *actualFirstDelta)
+            << "First snapshot doesn't match.\nExpected:\n"
+            << toString(expectedFirstDelta) << "\nActual:\n"
+            << toString(*actualFirstDelta);
+
+    // dm-0 was removed and the counters of mmcblk0 moved forward.
+    constexpr char secondSnapshot[] =
+            "   7       0 loop0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n"
+            " 179       0 mmcblk0 12500 1300 2500000 30500 9000 1000 1700000 56000 4 43000 90000 "
+            "150 0 30000 400\n"
+            " 179       1 mmcblk0p1 11500 1200 2300000 29500 8000 900 1500000 55000 4 42000 89000 "
+            "150 0 30000 400\n";
+    std::vector<DiskUsage> expectedSecondDelta = {
+            {.name = "loop0"},
+            {.name = "mmcblk0",
+             .stats = {.readsCompleted = 500,
+                       .sectorsRead = 100000,
+                       .readTimeMillis = 500,
+                       .writesCompleted = 1000,
+                       .sectorsWritten = 100000,
+                       .writeTimeMillis = 6000,
+                       .ioInProgress = 4,
+                       .ioTimeMillis = 3000,
+                       .weightedIoTimeMillis = 10000,
+                       .discardsCompleted = 50,
+                       .sectorsDiscarded = 10000,
+                       .discardTimeMillis = 100}},
+    };
+
+    ASSERT_TRUE(WriteStringToFile(secondSnapshot, tf.path));
+    const auto& actualSecondDelta = diskStats.collect();
+    ASSERT_RESULT_OK(actualSecondDelta);
+    EXPECT_EQ(expectedSecondDelta, *actualSecondDelta)
+            << "Second snapshot doesn't match.\nExpected:\n"
+            << toString(expectedSecondDelta) << "\nActual:\n"
+            << toString(*actualSecondDelta);
+}
+
+TEST(DiskStatsTest, TestValidDiskStatsFileWithoutDiscardFields) {
+    // Kernels before 4.18 don't report the discard fields.
+    constexpr char contents[] =
+            " 179       0 mmcblk0 12000 1200 2400000 30000 8000 900 1600000 50000 2 40000 80000\n";
+    std::vector<DiskUsage> expected = {
+            {.name = "mmcblk0",
+             .stats = {.readsCompleted = 12000,
+                       .sectorsRead = 2400000,
+                       .readTimeMillis = 30000,
+                       .writesCompleted = 8000,
+                       .sectorsWritten = 1600000,
+                       .writeTimeMillis = 50000,
+                       .ioInProgress = 2,
+                       .ioTimeMillis = 40000,
+                       .weightedIoTimeMillis = 80000}},
+    };
+
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(contents, tf.path));
+    TemporaryDir sysBlockDir;
+    auto ret = populateSysBlockDir(sysBlockDir.path, {"mmcblk0"});
+    ASSERT_TRUE(ret) << "Failed to populate sys block dir: " << ret.error();
+
+    DiskStats diskStats(tf.path, sysBlockDir.path);
+    ASSERT_TRUE(diskStats.enabled()) << "Temporary file is inaccessible";
+
+    const auto& actual = diskStats.collect();
+    ASSERT_RESULT_OK(actual);
+    EXPECT_EQ(expected, *actual) << "Disk stats don't match.\nExpected:\n"
+                                 << toString(expected) << "\nActual:\n"
+                                 << toString(*actual);
+}
+
+TEST(DiskStatsTest, TestIgnoresFieldsOfNewerKernels) {
+    constexpr char contents[] =
+            " 179       0 mmcblk0 12000 1200 2400000 30000 8000 900 1600000 50000 2 40000 80000 "
+            "100 0 20000 300 50 60 7 8\n";
+    std::vector<DiskUsage> expected = {
+            {.name = "mmcblk0",
+             .stats = {.readsCompleted = 12000,
+                       .sectorsRead = 2400000,
+                       .readTimeMillis = 30000,
+                       .writesCompleted = 8000,
+                       .sectorsWritten = 1600000,
+                       .writeTimeMillis = 50000,
+                       .ioInProgress = 2,
+                       .ioTimeMillis = 40000,
+                       .weightedIoTimeMillis = 80000,
+                       .discardsCompleted = 100,
+                       .sectorsDiscarded = 20000,
+                       .discardTimeMillis = 300}},
+    };
+
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(contents, tf.path));
+    TemporaryDir sysBlockDir;
+    auto ret = populateSysBlockDir(sysBlockDir.path, {"mmcblk0"});
+    ASSERT_TRUE(ret) << "Failed to populate sys block dir: " << ret.error();
+
+    DiskStats diskStats(tf.path, sysBlockDir.path);
+    ASSERT_TRUE(diskStats.enabled()) << "Temporary file is inaccessible";
+
+    const auto& actual = diskStats.collect();
+    ASSERT_RESULT_OK(actual);
+    EXPECT_EQ(expected, *actual) << "Disk stats don't match.\nExpected:\n"
+                                 << toString(expected) << "\nActual:\n"
+                                 << toString(*actual);
+}
+
+TEST(DiskStatsTest, TestHandlesCounterWrapAround) {
+    // The times are 32-bit on every kernel.
+    constexpr char firstSnapshot[] =
+            " 179       0 mmcblk0 100 0 200 4294967000 10 0 80 4294967200 0 4294967290 "
+            "4294967295\n";
+    constexpr char secondSnapshot[] =
+            " 179       0 mmcblk0 200 0 400 150 20 0 160 30 0 10 20\n";
+    std::vector<DiskUsage> expectedSecondDelta = {
+            {.name = "mmcblk0",
+             .stats = {.readsCompleted = 100,
+                       .sectorsRead = 200,
+                       .readTimeMillis = 446,
+                       .writesCompleted = 10,
+                       .sectorsWritten = 80,
+                       .writeTimeMillis = 126,
+                       .ioInProgress = 0,
+                       .ioTimeMillis = 16,
+                       .weightedIoTimeMillis = 21}},
+    };
+
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(firstSnapshot, tf.path));
+    TemporaryDir sysBlockDir;
+    auto ret = populateSysBlockDir(sysBlockDir.path, {"mmcblk0"});
+    ASSERT_TRUE(ret) << "Failed to populate sys block dir: " << ret.error();
+
+    DiskStats diskStats(tf.path, sysBlockDir.path);
+    ASSERT_TRUE(diskStats.enabled()) << "Temporary file is inaccessible";
+    ASSERT_RESULT_OK(diskStats.collect());
+
+    ASSERT_TRUE(WriteStringToFile(secondSnapshot, tf.path));
+    const auto& actualSecondDelta = diskStats.collect();
+    ASSERT_RESULT_OK(actualSecondDelta);
+    EXPECT_EQ(expectedSecondDelta, *actualSecondDelta)
+            << "Second snapshot doesn't match.\nExpected:\n"
+            << toString(expectedSecondDelta) << "\nActual:\n"
+            << toString(*actualSecondDelta);
+}
+
+TEST(DiskStatsTest, TestReportsNoActivityOnCounterReset) {
+    constexpr char firstSnapshot[] =
+            " 179       0 mmcblk0 8589934592 0 8589934600 100 10 0 80 20 0 30 40\n";
+    constexpr char secondSnapshot[] =
+            " 179       0 mmcblk0 200 0 400 150 20 0 160 30 0 40 60\n";
+    std::vector<DiskUsage> expectedSecondDelta = {
+            {.name = "mmcblk0",
+             .stats = {.readsCompleted = 0,
+                       .sectorsRead = 0,
+                       .readTimeMillis = 50,
+                       .writesCompleted = 10,
+                       .sectorsWritten = 80,
+                       .writeTimeMillis = 10,
+                       .ioInProgress = 0,
+                       .ioTimeMillis = 10,
+                       .weightedIoTimeMillis = 20}},
+    };
+
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(firstSnapshot, tf.path));
+    TemporaryDir sysBlockDir;
+    auto ret = populateSysBlockDir(sysBlockDir.path, {"mmcblk0"});
+    ASSERT_TRUE(ret) << "Failed to populate sys block dir: " << ret.error();
+
+    DiskStats diskStats(tf.path, sysBlockDir.path);
+    ASSERT_TRUE(diskStats.enabled()) << "Temporary file is inaccessible";
+    ASSERT_RESULT_OK(diskStats.collect());
+
+    ASSERT_TRUE(WriteStringToFile(secondSnapshot, tf.path));
+    const auto& actualSecondDelta = diskStats.collect();
+    ASSERT_RESULT_OK(actualSecondDelta);
+    EXPECT_EQ(expectedSecondDelta, *actualSecondDelta)
+            << "Second snapshot doesn't match.\nExpected:\n"
+            << toString(expectedSecondDelta) << "\nActual:\n"
+            << toString(*actualSecondDelta);
+}
+
+TEST(DiskStatsTest, TestReportsNoActivityOnSmallCounterReset) {
+    // Counters far from 2^32 didn't wrap around, whatever their size in the kernel.
+    constexpr char firstSnapshot[] =
+            " 179       0 mmcblk0 1000 0 2000 1000 500 0 800 900 0 3000 4000\n";
+    constexpr char secondSnapshot[] =
+            " 179       0 mmcblk0 200 0 400 150 20 0 160 30 0 40 60\n";
+    std::vector<DiskUsage> expectedSecondDelta = {
+            {.name = "mmcblk0", .stats = {}},
+    };
+
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(firstSnapshot, tf.path));
+    TemporaryDir sysBlockDir;
+    auto ret = populateSysBlockDir(sysBlockDir.path, {"mmcblk0"});
+    ASSERT_TRUE(ret) << "Failed to populate sys block dir: " << ret.error();
+
+    DiskStats diskStats(tf.path, sysBlockDir.path);
+    ASSERT_TRUE(diskStats.enabled()) << "Temporary file is inaccessible";
+    ASSERT_RESULT_OK(diskStats.collect());
+
+    ASSERT_TRUE(WriteStringToFile(secondSnapshot, tf.path));
+    const auto& actualSecondDelta = diskStats.collect();
+    ASSERT_RESULT_OK(actualSecondDelta);
+    EXPECT_EQ(expectedSecondDelta, *actualSecondDelta)
+            << "Second snapshot doesn't match.\nExpected:\n"
+            << toString(expectedSecondDelta) << "\nActual:\n"
+            << toString(*actualSecondDelta);
+}
+
+TEST(DiskStatsTest, TestErrorOnCorruptedDiskStatsFile) {
+    constexpr char contents[] =
+            " 179       0 mmcblk0 12000 1200 2400000 CORRUPTED DATA 900 1600000 50000 1 40000 "
+            "80000 100 0 20000 300\n";
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(contents, tf.path));
+    TemporaryDir sysBlockDir;
+
+    DiskStats diskStats(tf.path, sysBlockDir.path);
+    ASSERT_TRUE(diskStats.enabled()) << "Temporary file is inaccessible";
+    EXPECT_FALSE(diskStats.collect().ok()) << "No error returned for corrupted file";
+}
+
+TEST(DiskStatsTest, TestErrorOnDuplicateDevice) {
+    constexpr char contents[] =
+            " 179       0 mmcblk0 12000 1200 2400000 30000 8000 900 1600000 50000 2 40000 80000\n"
+            " 179       0 mmcblk0 12000 1200 2400000 30000 8000 900 1600000 50000 2 40000 80000\n";
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(contents, tf.path));
+    TemporaryDir sysBlockDir;
+
+    DiskStats diskStats(tf.path, sysBlockDir.path);
+    ASSERT_TRUE(diskStats.enabled()) << "Temporary file is inaccessible";
+    EXPECT_FALSE(diskStats.collect().ok()) << "No error returned for duplicate device";
+}
+
+TEST(DiskStatsTest, TestDiskStatsContentsFromDevice) {
+    DiskStats diskStats;
+    ASSERT_TRUE(diskStats.enabled()) << kDiskStatsPath << " file is inaccessible";
+
+    const auto& usages = diskStats.collect();
+    ASSERT_RESULT_OK(usages);
+}
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
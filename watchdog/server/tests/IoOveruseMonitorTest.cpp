@@ -0,0 +1,310 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "IoOveruseMonitor.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <gtest/gtest.h>
+#include <inttypes.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "UidIoStats.h"
+#include "gmock/gmock.h"
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+using android::sp;
+using android::base::ReadFileToString;
+using android::base::StringPrintf;
+using android::base::WriteStringToFile;
+using binder::Status;
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::Return;
+
+namespace {
+
+constexpr uint32_t kSystemUid = 1000;
+constexpr uint32_t kAppUid = 1010001;
+constexpr uint32_t kOtherAppUid = 1010002;
+
+// Window of 2400 seconds split into 100 second buckets. Applications may write 1000 bytes in the
+// foreground and system UIDs may write 2000 bytes in the background within the window.
+constexpr const char* kConfig =
+        "# Test config\n"
+        "window 2400\n"
+        "category system 0 2000\n"
+        "category application 1000 0\n"
+        "package com.example.heavy 5000 0\n";
+
+class MockBinder : public BBinder {
+public:
+    MOCK_METHOD(status_t, linkToDeath,
+                (const sp<DeathRecipient>& recipient, void* cookie, uint32_t flags), (override));
+    MOCK_METHOD(status_t, unlinkToDeath,
+                (const wp<DeathRecipient>& recipient, void* cookie, uint32_t flags,
+                 wp<DeathRecipient>* outRecipient),
+                (override));
+};
+
+class MockIoOveruseListener : public IIoOveruseListenerDefault {
+public:
+    MockIoOveruseListener() {
+        mBinder = new MockBinder();
+        EXPECT_CALL(*mBinder, linkToDeath(_, nullptr, 0)).WillRepeatedly(Return(OK));
+        EXPECT_CALL(*mBinder, unlinkToDeath(_, nullptr, 0, nullptr)).WillRepeatedly(Return(OK));
+        EXPECT_CALL(*this, onAsBinder()).WillRepeatedly(Return(mBinder.get()));
+    }
+
+    MOCK_METHOD(IBinder*, onAsBinder, (), (override));
+    MOCK_METHOD(Status, onIoOveruse,
+                (int32_t uid, const String16& packageName, int64_t foregroundWrittenBytes,
+                 int64_t backgroundWrittenBytes, int64_t windowDurationSeconds),
+                (override));
+
+private:
+    sp<MockBinder> mBinder;
+};
+
+// Returns a snapshot with the given foreground and background write bytes per UID.
+CollectorSnapshot makeSnapshot(
+        time_t time, const std::unordered_map<uint32_t, std::pair<uint64_t, uint64_t>>& writes,
+        const std::unordered_map<uint32_t, std::string>& packageNames = {}) {
+    CollectorSnapshot snapshot;
+    snapshot.time = time;
+    snapshot.uidIoUsages = std::unordered_map<uint32_t, UidIoUsage>();
+    for (const auto& it : writes) {
+        (*snapshot.uidIoUsages)[it.first] = {
+                .uid = it.first,
+                .ios = IoUsage(0, 0, it.second.first, it.second.second, 0, 0),
+        };
+    }
+    snapshot.packageNames = packageNames;
+    return snapshot;
+}
+
+}  // namespace
+
+class IoOveruseMonitorTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        ASSERT_TRUE(WriteStringToFile(kConfig, mConfigFile.path));
+        ASSERT_TRUE(WriteStringToFile("boot-1\n", mBootIdFile.path));
+        mStatePath = StringPrintf("%s/io_overuse_state.txt", mStateDir.path);
+        mListener = new MockIoOveruseListener();
+        mMonitor = newMonitor();
+    }
+    virtual void TearDown() {
+        mMonitor = nullptr;
+        mListener = nullptr;
+    }
+    sp<IoOveruseMonitor> newMonitor() {
+        sp<IoOveruseMonitor> monitor =
+                new IoOveruseMonitor(mConfigFile.path, mStatePath, mBootIdFile.path);
+        EXPECT_TRUE(monitor->init().ok());
+        EXPECT_TRUE(monitor->registerListener(mListener).ok());
+        return monitor;
+    }
+
+    TemporaryFile mConfigFile;
+    TemporaryFile mBootIdFile;
+    TemporaryDir mStateDir;
+    std::string mStatePath;
+    sp<MockIoOveruseListener> mListener;
+    sp<IoOveruseMonitor> mMonitor;
+};
+
+TEST_F(IoOveruseMonitorTest, TestParsesConfig) {
+    Mutex::Autolock lock(mMonitor->mMutex);
+    const IoOveruseConfig& config = mMonitor->mConfig;
+    ASSERT_EQ(config.windowDuration, std::chrono::seconds(2400));
+    ASSERT_EQ(config.categoryBudgets[PackageCategory::SYSTEM].foregroundWriteBytes, 0);
+    ASSERT_EQ(config.categoryBudgets[PackageCategory::SYSTEM].backgroundWriteBytes, 2000);
+    ASSERT_EQ(config.categoryBudgets[PackageCategory::APPLICATION].foregroundWriteBytes, 1000);
+    ASSERT_EQ(config.categoryBudgets[PackageCategory::APPLICATION].backgroundWriteBytes, 0);
+    ASSERT_EQ(config.packageBudgets.size(), 1);
+    ASSERT_EQ(config.packageBudgets.at("com.example.heavy").foregroundWriteBytes, 5000);
+}
+
+TEST_F(IoOveruseMonitorTest, TestErrorOnInvalidConfig) {
+    TemporaryFile configFile;
+    ASSERT_TRUE(WriteStringToFile("category vendor 100 100\n", configFile.path));
+    sp<IoOveruseMonitor> monitor = new IoOveruseMonitor(configFile.path, mStatePath);
+    ASSERT_FALSE(monitor->init().ok()) << "No error returned on unknown category";
+
+    ASSERT_TRUE(WriteStringToFile("window 0\n", configFile.path));
+    ASSERT_FALSE(monitor->init().ok()) << "No error returned on zero window duration";
+}
+
+TEST_F(IoOveruseMonitorTest, TestNotifiesOncePerWindow) {
+    EXPECT_CALL(*mListener, onIoOveruse(_, _, _, _, _)).Times(0);
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(1000, {{kAppUid, {600, 0}}})).ok());
+
+    EXPECT_CALL(*mListener, onIoOveruse(kAppUid, String16(""), 1100, 0, 2400))
+            .WillOnce(Return(Status::ok()));
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(1100, {{kAppUid, {500, 0}}})).ok());
+
+    // The UID is still over its budget but was already notified within the window.
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(1200, {{kAppUid, {500, 0}}})).ok());
+
+    // A window after the last notification, the writes at 1100 and 1200 are still within the
+    // window and the UID is notified again.
+    EXPECT_CALL(*mListener, onIoOveruse(kAppUid, String16(""), 1100, 0, 2400))
+            .WillOnce(Return(Status::ok()));
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(3500, {{kAppUid, {100, 0}}})).ok());
+}
+
+TEST_F(IoOveruseMonitorTest, TestNotifiesOnUidIoStatsSequence) {
+    // Format: uid fgRdChar fgWrChar fgRdBytes fgWrBytes bgRdChar bgWrChar bgRdBytes bgWrBytes
+    // fgFsync bgFsync
+    const std::vector<std::string> uidIoStatsSequence = {
+            "1010001 0 0 0 400 0 0 0 0 0 0\n1000 0 0 0 0 0 0 0 1000 0 0\n",
+            "1010001 0 0 0 900 0 0 0 0 0 0\n1000 0 0 0 0 0 0 0 1500 0 0\n",
+            "1010001 0 0 0 1100 0 0 0 0 0 0\n1000 0 0 0 0 0 0 0 2500 0 0\n",
+    };
+    TemporaryFile tf;
+    ASSERT_TRUE(WriteStringToFile(uidIoStatsSequence[0], tf.path));
+    sp<UidIoStats> uidIoStats = new UidIoStats(tf.path);
+    EXPECT_CALL(*mListener, onIoOveruse(_, _, _, _, _)).Times(0);
+    EXPECT_CALL(*mListener, onIoOveruse(kAppUid, _, 1100, 0, 2400))
+            .WillOnce(Return(Status::ok()));
+    EXPECT_CALL(*mListener, onIoOveruse(kSystemUid, _, 0, 2500, 2400))
+            .WillOnce(Return(Status::ok()));
+    for (size_t i = 0; i < uidIoStatsSequence.size(); ++i) {
+        ASSERT_TRUE(WriteStringToFile(uidIoStatsSequence[i], tf.path));
+        CollectorSnapshot snapshot;
+        snapshot.time = 1000 + i * 10;
+        const auto& uidIoUsages = uidIoStats->collect();
+        ASSERT_TRUE(uidIoUsages.ok()) << uidIoUsages.error();
+        snapshot.uidIoUsages = *uidIoUsages;
+        ASSERT_TRUE(mMonitor->onSnapshot(snapshot).ok());
+    }
+}
+
+TEST_F(IoOveruseMonitorTest, TestExpiresWritesOutsideWindow) {
+    EXPECT_CALL(*mListener, onIoOveruse(_, _, _, _, _)).Times(0);
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(1000, {{kAppUid, {900, 0}}})).ok());
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(1500, {{kSystemUid, {0, 1500}}})).ok());
+
+    // The bucket starting at 1000 ends 2400 seconds before 3500, so its writes are expired.
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(3500, {{kAppUid, {900, 0}}})).ok());
+
+    // Foreground writes by a system UID are unlimited.
+    EXPECT_CALL(*mListener, onIoOveruse(kSystemUid, _, 100000, 2100, 2400))
+            .WillOnce(Return(Status::ok()));
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(3600, {{kSystemUid, {100000, 600}}})).ok());
+}
+
+TEST_F(IoOveruseMonitorTest, TestPackageBudgetOverridesCategoryBudget) {
+    EXPECT_CALL(*mListener, onIoOveruse(kAppUid, _, _, _, _)).Times(0);
+    EXPECT_CALL(*mListener,
+                onIoOveruse(kOtherAppUid, String16("com.example.light"), 2000, 0, 2400))
+            .WillOnce(Return(Status::ok()));
+    ASSERT_TRUE(mMonitor
+                        ->onSnapshot(makeSnapshot(1000,
+                                                  {{kAppUid, {2000, 0}},
+                                                   {kOtherAppUid, {2000, 0}}},
+                                                  {{kAppUid, "com.example.heavy"},
+                                                   {kOtherAppUid, "com.example.light"}}))
+                        .ok());
+}
+
+TEST_F(IoOveruseMonitorTest, TestRestoresStateAfterRestart) {
+    EXPECT_CALL(*mListener, onIoOveruse(_, _, _, _, _)).Times(0);
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(1000, {{kAppUid, {900, 0}}})).ok());
+
+    // Reboots, so the writes reported after the restart are all new.
+    ASSERT_TRUE(WriteStringToFile("boot-2\n", mBootIdFile.path));
+    mMonitor = newMonitor();
+    EXPECT_CALL(*mListener, onIoOveruse(kAppUid, _, 1100, 0, 2400))
+            .WillOnce(Return(Status::ok()));
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(1050, {{kAppUid, {200, 0}}})).ok());
+
+    // The last notification time is restored as well.
+    ASSERT_TRUE(WriteStringToFile("boot-3\n", mBootIdFile.path));
+    mMonitor = newMonitor();
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(1150, {{kAppUid, {100, 0}}})).ok());
+}
+
+TEST_F(IoOveruseMonitorTest, TestAccountsWritesSinceBootOnceAfterRestart) {
+    // Format: uid fgRdChar fgWrChar fgRdBytes fgWrBytes bgRdChar bgWrChar bgRdBytes bgWrBytes
+    // fgFsync bgFsync
+    TemporaryFile tf;
+    ASSERT_TRUE(WriteStringToFile("1010001 0 0 0 900 0 0 0 0 0 0\n", tf.path));
+    sp<UidIoStats> uidIoStats = new UidIoStats(tf.path);
+    EXPECT_CALL(*mListener, onIoOveruse(_, _, _, _, _)).Times(0);
+    CollectorSnapshot snapshot;
+    snapshot.time = 1000;
+    auto uidIoUsages = uidIoStats->collect();
+    ASSERT_TRUE(uidIoUsages.ok()) << uidIoUsages.error();
+    snapshot.uidIoUsages = *uidIoUsages;
+    ASSERT_TRUE(mMonitor->onSnapshot(snapshot).ok());
+
+    // Restarts within the same boot. The first collection of the new process reports all the
+    // 1000 bytes written since boot, of which only 100 bytes weren't accounted yet.
+    ASSERT_TRUE(WriteStringToFile("1010001 0 0 0 1000 0 0 0 0 0 0\n", tf.path));
+    mMonitor = newMonitor();
+    uidIoStats = new UidIoStats(tf.path);
+    snapshot.time = 1050;
+    uidIoUsages = uidIoStats->collect();
+    ASSERT_TRUE(uidIoUsages.ok()) << uidIoUsages.error();
+    snapshot.uidIoUsages = *uidIoUsages;
+    ASSERT_TRUE(mMonitor->onSnapshot(snapshot).ok());
+
+    EXPECT_CALL(*mListener, onIoOveruse(kAppUid, _, 1200, 0, 2400))
+            .WillOnce(Return(Status::ok()));
+    ASSERT_TRUE(WriteStringToFile("1010001 0 0 0 1200 0 0 0 0 0 0\n", tf.path));
+    snapshot.time = 1100;
+    uidIoUsages = uidIoStats->collect();
+    ASSERT_TRUE(uidIoUsages.ok()) << uidIoUsages.error();
+    snapshot.uidIoUsages = *uidIoUsages;
+    ASSERT_TRUE(mMonitor->onSnapshot(snapshot).ok());
+}
+
+TEST_F(IoOveruseMonitorTest, TestAccountsWritesAcrossSuspend) {
+    EXPECT_CALL(*mListener, onIoOveruse(_, _, _, _, _)).Times(0);
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(1000, {{kAppUid, {900, 0}}})).ok());
+
+    // The writes since the last collection before suspend are handed over on resume.
+    ASSERT_TRUE(mMonitor->onRebaseline(makeSnapshot(1100, {{kAppUid, {50, 0}}})).ok());
+    std::string state;
+    ASSERT_TRUE(ReadFileToString(mStatePath, &state));
+    EXPECT_THAT(state, HasSubstr(StringPrintf("total %" PRIu32 " 950 0\n", kAppUid)))
+            << "Persisted totals fell behind the kernel counters";
+
+    EXPECT_CALL(*mListener, onIoOveruse(kAppUid, _, 1050, 0, 2400))
+            .WillOnce(Return(Status::ok()));
+    ASSERT_TRUE(mMonitor->onSnapshot(makeSnapshot(1150, {{kAppUid, {100, 0}}})).ok());
+}
+
+TEST_F(IoOveruseMonitorTest, TestErrorOnInvalidListener) {
+    sp<IoOveruseMonitor> monitor = new IoOveruseMonitor(mConfigFile.path, mStatePath);
+    ASSERT_FALSE(monitor->registerListener(nullptr).ok()) << "No error returned on nullptr";
+    ASSERT_FALSE(monitor->unregisterListener(mListener).ok())
+            << "No error returned on unregistered listener";
+    ASSERT_TRUE(monitor->registerListener(mListener).ok());
+    ASSERT_TRUE(monitor->unregisterListener(mListener).ok());
+}
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
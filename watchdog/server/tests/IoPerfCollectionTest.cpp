@@ -19,6 +19,7 @@
 #include <WatchdogProperties.sysprop.h>
 #include <android-base/file.h>
 #include <cutils/android_filesystem_config.h>
+#include <sys/stat.h>
 
 #include <algorithm>
 #include <future>
@@ -26,8 +27,13 @@
 #include <string>
 #include <vector>
 
+#include "CpuCoreStats.h"
+#include "CpuDir.h"
+#include "DiskStats.h"
 #include "LooperStub.h"
+#include "ProcMemInfo.h"
 #include "ProcPidDir.h"
+#include "ProcPidMem.h"
 #include "ProcPidStat.h"
 #include "ProcStat.h"
 #include "UidIoStats.h"
@@ -39,8 +45,10 @@ namespace watchdog {
 
 using android::base::Error;
 using android::base::Result;
+using android::base::StringPrintf;
 using android::base::WriteStringToFile;
 using testing::LooperStub;
+using testing::populateCpuDir;
 using testing::populateProcPidDir;
 
 namespace {
@@ -49,6 +57,8 @@ const std::chrono::seconds kTestBootInterval = 1s;
 const std::chrono::seconds kTestPeriodicInterval = 2s;
 const std::chrono::seconds kTestCustomInterval = 3s;
 const std::chrono::seconds kTestCustomCollectionDuration = 11s;
+const std::chrono::seconds kTestResumeInterval = 2s;
+const std::chrono::seconds kTestResumeCollectionDuration = 7s;
 
 class UidIoStatsStub : public UidIoStats {
 public:
@@ -73,7 +83,7 @@ private:
 class ProcStatStub : public ProcStat {
 public:
     explicit ProcStatStub(bool enabled = false) : mEnabled(enabled) {}
-    Result<ProcStatInfo> collect() override {
+    Result<ProcStatInfo> collectFrom(const std::string& /*contents*/) override {
         if (mCache.empty()) {
             return Error() << "Cache is empty";
         }
@@ -110,6 +120,113 @@ private:
     std::queue<std::vector<ProcessStats>> mCache;
 };
 
+class CpuCoreStatsStub : public CpuCoreStats {
+public:
+    explicit CpuCoreStatsStub(bool enabled = false) : mEnabled(enabled) {}
+    Result<std::vector<CpuCoreUsage>> collectFrom(const std::string& /*contents*/) override {
+        if (mCache.empty()) {
+            return Error() << "Cache is empty";
+        }
+        const auto entry = mCache.front();
+        mCache.pop();
+        return entry;
+    }
+    bool enabled() override { return mEnabled; }
+    std::string filePath() override { return kProcStatPath; }
+    void push(const std::vector<CpuCoreUsage>& entry) { mCache.push(entry); }
+
+private:
+    bool mEnabled;
+    std::queue<std::vector<CpuCoreUsage>> mCache;
+};
+
+class DiskStatsStub : public DiskStats {
+public:
+    explicit DiskStatsStub(bool enabled = false) : mEnabled(enabled) {}
+    Result<std::vector<DiskUsage>> collect() override {
+        if (mCache.empty()) {
+            return Error() << "Cache is empty";
+        }
+        const auto entry = mCache.front();
+        mCache.pop();
+        return entry;
+    }
+    bool enabled() override { return mEnabled; }
+    std::string filePath() override { return kDiskStatsPath; }
+    void push(const std::vector<DiskUsage>& entry) { mCache.push(entry); }
+
+private:
+    bool mEnabled;
+    std::queue<std::vector<DiskUsage>> mCache;
+};
+
+class ProcMemInfoStub : public ProcMemInfo {
+public:
+    explicit ProcMemInfoStub(bool enabled = false) : mEnabled(enabled) {}
+    Result<MemInfo> collect() override {
+        if (mCache.empty()) {
+            return Error() << "Cache is empty";
+        }
+        const auto entry = mCache.front();
+        mCache.pop();
+        return entry;
+    }
+    bool enabled() override { return mEnabled; }
+    std::string filePath() override { return kProcMemInfoPath; }
+    void push(const MemInfo& entry) { mCache.push(entry); }
+
+private:
+    bool mEnabled;
+    std::queue<MemInfo> mCache;
+};
+
+class ProcPidMemStub : public ProcPidMem {
+public:
+    explicit ProcPidMemStub(bool enabled = false) : mEnabled(enabled) {}
+    Result<std::vector<ProcessMemStats>> collect() override {
+        if (mCache.empty()) {
+            return Error() << "Cache is empty";
+        }
+        const auto entry = mCache.front();
+        mCache.pop();
+        return entry;
+    }
+    bool enabled() override { return mEnabled; }
+    std::string dirPath() override { return kProcDirPath; }
+    void push(const std::vector<ProcessMemStats>& entry) { mCache.push(entry); }
+
+private:
+    bool mEnabled;
+    std::queue<std::vector<ProcessMemStats>> mCache;
+};
+
+class DataProcessorStub : public DataProcessor {
+public:
+    DataProcessorStub(const std::string& name, const DataSourceSet& dataSources) :
+          mName(name), mDataSources(dataSources) {}
+    std::string name() override { return mName; }
+    DataSourceSet dataSources() override { return mDataSources; }
+    Result<void> onSnapshot(const CollectorSnapshot& snapshot) override {
+        mSnapshots.push_back(snapshot);
+        return {};
+    }
+    Result<void> onRebaseline(const CollectorSnapshot& snapshot) override {
+        mRebaselineSnapshots.push_back(snapshot);
+        return {};
+    }
+    Result<void> onDump(int /*fd*/) override { return {}; }
+    const std::vector<CollectorSnapshot>& snapshots() const { return mSnapshots; }
+    const std::vector<CollectorSnapshot>& rebaselineSnapshots() const {
+        return mRebaselineSnapshots;
+    }
+
+private:
+    std::string mName;
+    DataSourceSet mDataSources;
+    std::vector<CollectorSnapshot> mSnapshots;
+    std::vector<CollectorSnapshot> mRebaselineSnapshots;
+};
+
 bool isEqual(const UidIoPerfData& lhs, const UidIoPerfData& rhs) {
     if (lhs.topNReads.size() != rhs.topNReads.size() ||
         lhs.topNWrites.size() != rhs.topNWrites.size()) {
@@ -141,11 +258,27 @@ bool isEqual(const SystemIoPerfData& lhs, const SystemIoPerfData& rhs) {
             lhs.totalProcessesCnt == rhs.totalProcessesCnt;
 }
 
+bool isEqual(const DiskIoPerfData& lhs, const DiskIoPerfData& rhs) {
+    auto comp = [&](const DiskIoPerfData::DeviceStats& l,
+                    const DiskIoPerfData::DeviceStats& r) -> bool {
+        return l.name == r.name && l.reads == r.reads && l.readKb == r.readKb &&
+                l.writes == r.writes && l.writeKb == r.writeKb && l.discards == r.discards &&
+                l.discardKb == r.discardKb && l.waitTimeMillis == r.waitTimeMillis &&
+                l.ioTimeMillis == r.ioTimeMillis &&
+                l.weightedIoTimeMillis == r.weightedIoTimeMillis &&
+                l.ioInProgress == r.ioInProgress;
+    };
+    return lhs.durationMillis == rhs.durationMillis && lhs.devices.size() == rhs.devices.size() &&
+            std::equal(lhs.devices.begin(), lhs.devices.end(), rhs.devices.begin(), comp);
+}
+
 bool isEqual(const ProcessIoPerfData& lhs, const ProcessIoPerfData& rhs) {
     if (lhs.topNIoBlockedUids.size() != rhs.topNIoBlockedUids.size() ||
         lhs.topNMajorFaultUids.size() != rhs.topNMajorFaultUids.size() ||
         lhs.totalMajorFaults != rhs.totalMajorFaults ||
-        lhs.majorFaultsPercentChange != rhs.majorFaultsPercentChange) {
+        lhs.majorFaultsPercentChange != rhs.majorFaultsPercentChange ||
+        lhs.topNCpuTimeUids.size() != rhs.topNCpuTimeUids.size() ||
+        lhs.totalCpuTimeMillis != rhs.totalCpuTimeMillis) {
         return false;
     }
     auto comp = [&](const ProcessIoPerfData::UidStats& l,
@@ -168,13 +301,47 @@ bool isEqual(const ProcessIoPerfData& lhs, const ProcessIoPerfData& rhs) {
                        rhs.topNIoBlockedUidsTotalTaskCnt.begin()) &&
             lhs.topNMajorFaultUids.size() == rhs.topNMajorFaultUids.size() &&
             std::equal(lhs.topNMajorFaultUids.begin(), lhs.topNMajorFaultUids.end(),
-                       rhs.topNMajorFaultUids.begin(), comp);
+                       rhs.topNMajorFaultUids.begin(), comp) &&
+            std::equal(lhs.topNCpuTimeUids.begin(), lhs.topNCpuTimeUids.end(),
+                       rhs.topNCpuTimeUids.begin(), comp);
+}
+
+bool isEqual(const CpuCorePerfData& lhs, const CpuCorePerfData& rhs) {
+    auto comp = [&](const CpuCorePerfData::CoreStats& l,
+                    const CpuCorePerfData::CoreStats& r) -> bool {
+        return l.cpu == r.cpu && l.busyTime == r.busyTime && l.ioWaitTime == r.ioWaitTime &&
+                l.totalCpuTime == r.totalCpuTime && l.timeInState == r.timeInState;
+    };
+    return lhs.cores.size() == rhs.cores.size() &&
+            std::equal(lhs.cores.begin(), lhs.cores.end(), rhs.cores.begin(), comp);
+}
+
+bool isEqual(const MemoryPerfData& lhs, const MemoryPerfData& rhs) {
+    auto procComp = [&](const MemoryPerfData::UidStats::ProcessStats& l,
+                        const MemoryPerfData::UidStats::ProcessStats& r) -> bool {
+        return l.comm == r.comm && l.rssKb == r.rssKb && l.swapKb == r.swapKb;
+    };
+    auto comp = [&](const MemoryPerfData::UidStats& l, const MemoryPerfData::UidStats& r) -> bool {
+        return l.userId == r.userId && l.packageName == r.packageName && l.rssKb == r.rssKb &&
+                l.swapKb == r.swapKb && l.rssDeltaKb == r.rssDeltaKb &&
+                l.topNProcesses.size() == r.topNProcesses.size() &&
+                std::equal(l.topNProcesses.begin(), l.topNProcesses.end(),
+                           r.topNProcesses.begin(), procComp);
+    };
+    return lhs.memInfo == rhs.memInfo && lhs.memAvailableDeltaKb == rhs.memAvailableDeltaKb &&
+            lhs.totalRssKb == rhs.totalRssKb && lhs.totalSwapKb == rhs.totalSwapKb &&
+            lhs.topNRssUids.size() == rhs.topNRssUids.size() &&
+            std::equal(lhs.topNRssUids.begin(), lhs.topNRssUids.end(), rhs.topNRssUids.begin(),
+                       comp);
 }
 
 bool isEqual(const IoPerfRecord& lhs, const IoPerfRecord& rhs) {
     return isEqual(lhs.uidIoPerfData, rhs.uidIoPerfData) &&
             isEqual(lhs.systemIoPerfData, rhs.systemIoPerfData) &&
-            isEqual(lhs.processIoPerfData, rhs.processIoPerfData);
+            isEqual(lhs.diskIoPerfData, rhs.diskIoPerfData) &&
+            isEqual(lhs.processIoPerfData, rhs.processIoPerfData) &&
+            isEqual(lhs.cpuCorePerfData, rhs.cpuCorePerfData) &&
+            isEqual(lhs.memoryPerfData, rhs.memoryPerfData);
 }
 
 }  // namespace
@@ -222,6 +389,10 @@ TEST(IoPerfCollectionTest, TestValidCollectionSequence) {
     collector->mUidIoStats = uidIoStatsStub;
     collector->mProcStat = procStatStub;
     collector->mProcPidStat = procPidStatStub;
+    collector->mCpuCoreStats = new CpuCoreStatsStub();
+    collector->mDiskStats = new DiskStatsStub();
+    collector->mProcMemInfo = new ProcMemInfoStub();
+    collector->mProcPidMem = new ProcPidMemStub();
     collector->mHandlerLooper = looperStub;
 
     auto ret = collector->start();
@@ -784,6 +955,10 @@ TEST(IoPerfCollectionTest, TestCollectionTerminatesOnZeroEnabledCollectors) {
     collector->mUidIoStats = new UidIoStatsStub();
     collector->mProcStat = new ProcStatStub();
     collector->mProcPidStat = new ProcPidStatStub();
+    collector->mCpuCoreStats = new CpuCoreStatsStub();
+    collector->mDiskStats = new DiskStatsStub();
+    collector->mProcMemInfo = new ProcMemInfoStub();
+    collector->mProcPidMem = new ProcPidMemStub();
 
     const auto& ret = collector->start();
     ASSERT_TRUE(ret) << ret.error().message();
@@ -807,6 +982,10 @@ TEST(IoPerfCollectionTest, TestCollectionTerminatesOnError) {
     collector->mUidIoStats = new UidIoStatsStub(true);
     collector->mProcStat = new ProcStatStub(true);
     collector->mProcPidStat = new ProcPidStatStub(true);
+    collector->mCpuCoreStats = new CpuCoreStatsStub();
+    collector->mDiskStats = new DiskStatsStub();
+    collector->mProcMemInfo = new ProcMemInfoStub();
+    collector->mProcPidMem = new ProcPidMemStub();
 
     // Stub caches are empty so polling them should trigger error.
     const auto& ret = collector->start();
@@ -836,6 +1015,10 @@ TEST(IoPerfCollectionTest, TestCustomCollectionFiltersPackageNames) {
     collector->mUidIoStats = uidIoStatsStub;
     collector->mProcStat = procStatStub;
     collector->mProcPidStat = procPidStatStub;
+    collector->mCpuCoreStats = new CpuCoreStatsStub();
+    collector->mDiskStats = new DiskStatsStub();
+    collector->mProcMemInfo = new ProcMemInfoStub();
+    collector->mProcPidMem = new ProcPidMemStub();
     collector->mHandlerLooper = looperStub;
     // Filter by package name should ignore this limit.
     collector->mTopNStatsPerCategory = 1;
@@ -999,6 +1182,10 @@ TEST(IoPerfCollectionTest, TestCustomCollectionTerminatesAfterMaxDuration) {
     collector->mUidIoStats = uidIoStatsStub;
     collector->mProcStat = procStatStub;
     collector->mProcPidStat = procPidStatStub;
+    collector->mCpuCoreStats = new CpuCoreStatsStub();
+    collector->mDiskStats = new DiskStatsStub();
+    collector->mProcMemInfo = new ProcMemInfoStub();
+    collector->mProcPidMem = new ProcPidMemStub();
     collector->mHandlerLooper = looperStub;
 
     auto ret = collector->start();
@@ -1063,6 +1250,244 @@ TEST(IoPerfCollectionTest, TestCustomCollectionTerminatesAfterMaxDuration) {
     collector->terminate();
 }
 
+TEST(IoPerfCollectionTest, TestSuspendAndResume) {
+    sp<UidIoStatsStub> uidIoStatsStub = new UidIoStatsStub(true);
+    sp<ProcStatStub> procStatStub = new ProcStatStub(true);
+    sp<ProcPidStatStub> procPidStatStub = new ProcPidStatStub(true);
+    sp<LooperStub> looperStub = new LooperStub();
+
+    sp<IoPerfCollection> collector = new IoPerfCollection();
+    collector->mUidIoStats = uidIoStatsStub;
+    collector->mProcStat = procStatStub;
+    collector->mProcPidStat = procPidStatStub;
+    collector->mCpuCoreStats = new CpuCoreStatsStub();
+    collector->mDiskStats = new DiskStatsStub();
+    collector->mProcMemInfo = new ProcMemInfoStub();
+    collector->mProcPidMem = new ProcPidMemStub();
+    collector->mHandlerLooper = looperStub;
+
+    auto ret = collector->start();
+    ASSERT_TRUE(ret) << ret.error().message();
+    collector->mPeriodicCollection.interval = kTestPeriodicInterval;
+    collector->mResumeCollectionDuration = 0ns;
+
+    // Dummy boot-time collection
+    uidIoStatsStub->push({});
+    procStatStub->push(ProcStatInfo{});
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+
+    ret = collector->onSuspend();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ASSERT_EQ(collector->mCurrCollectionEvent, CollectionEvent::BOOT_TIME)
+            << "Boot-time collection shouldn't be suspended";
+
+    // Dummy periodic collection
+    ret = collector->onBootFinished();
+    ASSERT_TRUE(ret) << ret.error().message();
+    uidIoStatsStub->push({});
+    procStatStub->push(ProcStatInfo{});
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ASSERT_EQ(collector->mCurrCollectionEvent, CollectionEvent::PERIODIC);
+
+    ret = collector->onSuspend();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ASSERT_EQ(collector->mCurrCollectionEvent, CollectionEvent::SUSPENDED);
+    size_t numPeriodicRecords = collector->mPeriodicCollection.records.size();
+
+    // No collection should happen while suspended.
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ASSERT_EQ(collector->mPeriodicCollection.records.size(), numPeriodicRecords)
+            << "Periodic collection happened while suspended";
+
+    // The counters accumulated across suspend are consumed by the re-baseline on resume.
+    ret = collector->onResume();
+    ASSERT_TRUE(ret) << ret.error().message();
+    uidIoStatsStub->push({{1009, {.uid = 1009, .ios = {0, 20000, 0, 30000, 0, 300}}}});
+    procStatStub->push(ProcStatInfo{
+            /*stats=*/{6200, 5700, 1700, 3100, /*ioWaitTime=*/1100, 5200, 3900, 0, 0, 0},
+            /*runnableCnt=*/17,
+            /*ioBlockedCnt=*/5,
+    });
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ASSERT_EQ(collector->mCurrCollectionEvent, CollectionEvent::PERIODIC);
+    ASSERT_EQ(collector->mPeriodicCollection.records.size(), numPeriodicRecords)
+            << "Re-baselining the collectors shouldn't add a record";
+
+    uidIoStatsStub->push({});
+    procStatStub->push(ProcStatInfo{
+            /*stats=*/{100, 0, 0, 0, /*ioWaitTime=*/10, 0, 0, 0, 0, 0},
+            /*runnableCnt=*/1,
+            /*ioBlockedCnt=*/0,
+    });
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ASSERT_EQ(looperStub->numSecondsElapsed(), kTestPeriodicInterval.count())
+            << "First periodic collection after resume didn't happen at "
+            << kTestPeriodicInterval.count() << " seconds interval";
+    ASSERT_EQ(collector->mPeriodicCollection.records.size(), numPeriodicRecords + 1);
+    const IoPerfRecord& record = collector->mPeriodicCollection.records.back();
+    EXPECT_EQ(record.systemIoPerfData.cpuIoWaitTime, 10);
+    EXPECT_EQ(record.systemIoPerfData.totalCpuTime, 110);
+    EXPECT_EQ(record.uidIoPerfData.topNReads.size(), 0)
+            << "I/O accumulated across suspend reported after resume";
+    collector->terminate();
+}
+
+TEST(IoPerfCollectionTest, TestSuspendBeforePendingResumeIsHandled) {
+    sp<UidIoStatsStub> uidIoStatsStub = new UidIoStatsStub(true);
+    sp<ProcStatStub> procStatStub = new ProcStatStub(true);
+    sp<ProcPidStatStub> procPidStatStub = new ProcPidStatStub(true);
+    sp<LooperStub> looperStub = new LooperStub();
+
+    sp<IoPerfCollection> collector = new IoPerfCollection();
+    collector->mUidIoStats = uidIoStatsStub;
+    collector->mProcStat = procStatStub;
+    collector->mProcPidStat = procPidStatStub;
+    collector->mCpuCoreStats = new CpuCoreStatsStub();
+    collector->mDiskStats = new DiskStatsStub();
+    collector->mProcMemInfo = new ProcMemInfoStub();
+    collector->mProcPidMem = new ProcPidMemStub();
+    collector->mHandlerLooper = looperStub;
+
+    auto ret = collector->start();
+    ASSERT_TRUE(ret) << ret.error().message();
+    collector->mPeriodicCollection.interval = kTestPeriodicInterval;
+    collector->mResumeCollectionDuration = 0ns;
+
+    // Dummy boot-time collection
+    uidIoStatsStub->push({});
+    procStatStub->push(ProcStatInfo{});
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+
+    // Dummy periodic collection
+    ret = collector->onBootFinished();
+    ASSERT_TRUE(ret) << ret.error().message();
+    uidIoStatsStub->push({});
+    procStatStub->push(ProcStatInfo{});
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ASSERT_EQ(collector->mCurrCollectionEvent, CollectionEvent::PERIODIC);
+
+    // The looper doesn't run between the calls, so the resume is still pending on the second
+    // suspend.
+    ret = collector->onSuspend();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ret = collector->onResume();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ret = collector->onSuspend();
+    ASSERT_TRUE(ret) << ret.error().message();
+    size_t numPeriodicRecords = collector->mPeriodicCollection.records.size();
+
+    uidIoStatsStub->push({});
+    procStatStub->push(ProcStatInfo{});
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ASSERT_EQ(collector->mCurrCollectionEvent, CollectionEvent::SUSPENDED)
+            << "Pending resume undid the later suspend";
+    ASSERT_EQ(collector->mPeriodicCollection.records.size(), numPeriodicRecords)
+            << "Periodic collection happened while suspended";
+    collector->terminate();
+}
+
+TEST(IoPerfCollectionTest, TestResumeCollection) {
+    sp<UidIoStatsStub> uidIoStatsStub = new UidIoStatsStub(true);
+    sp<ProcStatStub> procStatStub = new ProcStatStub(true);
+    sp<ProcPidStatStub> procPidStatStub = new ProcPidStatStub(true);
+    sp<LooperStub> looperStub = new LooperStub();
+
+    sp<IoPerfCollection> collector = new IoPerfCollection();
+    collector->mUidIoStats = uidIoStatsStub;
+    collector->mProcStat = procStatStub;
+    collector->mProcPidStat = procPidStatStub;
+    collector->mCpuCoreStats = new CpuCoreStatsStub();
+    collector->mDiskStats = new DiskStatsStub();
+    collector->mProcMemInfo = new ProcMemInfoStub();
+    collector->mProcPidMem = new ProcPidMemStub();
+    collector->mHandlerLooper = looperStub;
+
+    auto ret = collector->start();
+    ASSERT_TRUE(ret) << ret.error().message();
+    collector->mPeriodicCollection.interval = kTestPeriodicInterval;
+    collector->mResumeCollection.interval = kTestResumeInterval;
+    collector->mResumeCollectionDuration = kTestResumeCollectionDuration;
+
+    // Dummy boot-time collection
+    uidIoStatsStub->push({});
+    procStatStub->push(ProcStatInfo{});
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+
+    // Dummy periodic collection
+    ret = collector->onBootFinished();
+    ASSERT_TRUE(ret) << ret.error().message();
+    uidIoStatsStub->push({});
+    procStatStub->push(ProcStatInfo{});
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+
+    ret = collector->onSuspend();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ret = collector->onResume();
+    ASSERT_TRUE(ret) << ret.error().message();
+
+    // Re-baseline
+    uidIoStatsStub->push({});
+    procStatStub->push(ProcStatInfo{});
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ASSERT_EQ(collector->mCurrCollectionEvent, CollectionEvent::RESUME);
+    ASSERT_EQ(collector->mResumeCollection.records.size(), 0);
+
+    // Resume collections happen once every |kTestResumeInterval| until the message to end the
+    // resume collection is processed. The last resume record is collected on this message.
+    size_t maxIterations = static_cast<size_t>(kTestResumeCollectionDuration.count() /
+                                                kTestResumeInterval.count());
+    size_t numIterations = 0;
+    while (collector->mCurrCollectionEvent == CollectionEvent::RESUME) {
+        ASSERT_LE(numIterations, maxIterations)
+                << "Resume collection didn't end after " << kTestResumeCollectionDuration.count()
+                << " seconds";
+        uidIoStatsStub->push({});
+        procStatStub->push(ProcStatInfo{});
+        procPidStatStub->push({});
+        ret = looperStub->pollCache();
+        ASSERT_TRUE(ret) << ret.error().message();
+        ++numIterations;
+        if (collector->mCurrCollectionEvent == CollectionEvent::RESUME) {
+            ASSERT_EQ(looperStub->numSecondsElapsed(), kTestResumeInterval.count())
+                    << "Resume collection didn't happen at " << kTestResumeInterval.count()
+                    << " seconds interval in iteration " << numIterations;
+        }
+    }
+    ASSERT_EQ(collector->mCurrCollectionEvent, CollectionEvent::PERIODIC);
+    ASSERT_EQ(collector->mResumeCollection.records.size(), numIterations);
+
+    uidIoStatsStub->push({});
+    procStatStub->push(ProcStatInfo{});
+    procPidStatStub->push({});
+    ret = looperStub->pollCache();
+    ASSERT_TRUE(ret) << ret.error().message();
+    ASSERT_EQ(looperStub->numSecondsElapsed(), kTestPeriodicInterval.count())
+            << "Periodic collection didn't resume at " << kTestPeriodicInterval.count()
+            << " seconds interval";
+    collector->terminate();
+}
+
 TEST(IoPerfCollectionTest, TestValidUidIoStatFile) {
     // Format: uid fgRdChar fgWrChar fgRdBytes fgWrBytes bgRdChar bgWrChar bgRdBytes bgWrBytes
     // fgFsync bgFsync
@@ -1113,12 +1538,18 @@ TEST(IoPerfCollectionTest, TestValidUidIoStatFile) {
     ASSERT_TRUE(WriteStringToFile(firstSnapshot, tf.path));
 
     IoPerfCollection collector;
+    sp<UidIoPerfProcessor> processor = new UidIoPerfProcessor();
+    IoPerfRecord record = {};
     collector.mUidIoStats = new UidIoStats(tf.path);
     collector.mTopNStatsPerCategory = 2;
     ASSERT_TRUE(collector.mUidIoStats->enabled()) << "Temporary file is inaccessible";
 
     struct UidIoPerfData actualUidIoPerfData = {};
-    auto ret = collector.collectUidIoPerfDataLocked(CollectionInfo{}, &actualUidIoPerfData);
+    auto snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::UID_IO_STATS));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    collector.resolvePackageNamesLocked(&*snapshot);
+    auto ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualUidIoPerfData = record.uidIoPerfData;
     ASSERT_RESULT_OK(ret);
     EXPECT_TRUE(isEqual(expectedUidIoPerfData, actualUidIoPerfData))
         << "First snapshot doesn't match.\nExpected:\n"
@@ -1168,7 +1599,11 @@ TEST(IoPerfCollectionTest, TestValidUidIoStatFile) {
     });
     ASSERT_TRUE(WriteStringToFile(secondSnapshot, tf.path));
     actualUidIoPerfData = {};
-    ret = collector.collectUidIoPerfDataLocked(CollectionInfo{}, &actualUidIoPerfData);
+    snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::UID_IO_STATS));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    collector.resolvePackageNamesLocked(&*snapshot);
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualUidIoPerfData = record.uidIoPerfData;
     ASSERT_RESULT_OK(ret);
     EXPECT_TRUE(isEqual(expectedUidIoPerfData, actualUidIoPerfData))
         << "Second snapshot doesn't match.\nExpected:\n"
@@ -1208,12 +1643,19 @@ TEST(IoPerfCollectionTest, TestUidIOStatsLessThanTopNStatsLimit) {
     ASSERT_TRUE(WriteStringToFile(contents, tf.path));
 
     IoPerfCollection collector;
+    sp<UidIoPerfProcessor> processor = new UidIoPerfProcessor();
+    IoPerfRecord record = {};
     collector.mUidIoStats = new UidIoStats(tf.path);
     collector.mTopNStatsPerCategory = 10;
     ASSERT_TRUE(collector.mUidIoStats->enabled()) << "Temporary file is inaccessible";
 
     struct UidIoPerfData actualUidIoPerfData = {};
-    const auto& ret = collector.collectUidIoPerfDataLocked(CollectionInfo{}, &actualUidIoPerfData);
+    auto snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::UID_IO_STATS));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    collector.resolvePackageNamesLocked(&*snapshot);
+    const auto& ret =
+            collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualUidIoPerfData = record.uidIoPerfData;
     ASSERT_RESULT_OK(ret);
     EXPECT_TRUE(isEqual(expectedUidIoPerfData, actualUidIoPerfData))
         << "Collected data doesn't match.\nExpected:\n"
@@ -1250,11 +1692,16 @@ TEST(IoPerfCollectionTest, TestValidProcStatFile) {
     ASSERT_TRUE(WriteStringToFile(firstSnapshot, tf.path));
 
     IoPerfCollection collector;
+    sp<SystemIoPerfProcessor> processor = new SystemIoPerfProcessor();
+    IoPerfRecord record = {};
     collector.mProcStat = new ProcStat(tf.path);
     ASSERT_TRUE(collector.mProcStat->enabled()) << "Temporary file is inaccessible";
 
     struct SystemIoPerfData actualSystemIoPerfData = {};
-    auto ret = collector.collectSystemIoPerfDataLocked(&actualSystemIoPerfData);
+    auto snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::PROC_STAT));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    auto ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualSystemIoPerfData = record.systemIoPerfData;
     ASSERT_RESULT_OK(ret);
     EXPECT_TRUE(isEqual(expectedSystemIoPerfData, actualSystemIoPerfData))
             << "First snapshot doesn't match.\nExpected:\n"
@@ -1284,7 +1731,10 @@ TEST(IoPerfCollectionTest, TestValidProcStatFile) {
 
     ASSERT_TRUE(WriteStringToFile(secondSnapshot, tf.path));
     actualSystemIoPerfData = {};
-    ret = collector.collectSystemIoPerfDataLocked(&actualSystemIoPerfData);
+    snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::PROC_STAT));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualSystemIoPerfData = record.systemIoPerfData;
     ASSERT_RESULT_OK(ret);
     EXPECT_TRUE(isEqual(expectedSystemIoPerfData, actualSystemIoPerfData))
             << "Second snapshot doesn't match.\nExpected:\n"
@@ -1292,6 +1742,205 @@ TEST(IoPerfCollectionTest, TestValidProcStatFile) {
             << toString(actualSystemIoPerfData);
 }
 
+TEST(IoPerfCollectionTest, TestValidDiskStatsFile) {
+    constexpr char firstSnapshot[] =
+            "   7       0 loop0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n"
+            " 179       0 mmcblk0 12000 1200 2400000 30000 8000 900 1600000 50000 1 40000 80000 "
+            "100 0 20000 300\n"
+            " 179       1 mmcblk0p1 11000 1100 2200000 29000 7000 800 1400000 49000 1 39000 79000 "
+            "100 0 20000 300\n";
+    constexpr char secondSnapshot[] =
+            "   7       0 loop0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n"
+            " 179       0 mmcblk0 12500 1300 2500000 30500 9000 1000 1700000 56000 4 43000 90000 "
+            "150 0 30000 400\n"
+            " 179       1 mmcblk0p1 11500 1200 2300000 29500 8000 900 1500000 55000 4 42000 89000 "
+            "150 0 30000 400\n";
+    // The idle loop device and the partition are left out.
+    struct DiskIoPerfData expectedDiskIoPerfData = {
+            .durationMillis = 10000,
+            .devices = {{
+                    .name = "mmcblk0",
+                    .reads = 500,
+                    .readKb = 50000,
+                    .writes = 1000,
+                    .writeKb = 50000,
+                    .discards = 50,
+                    .discardKb = 5000,
+                    .waitTimeMillis = 6600,
+                    .ioTimeMillis = 3000,
+                    .weightedIoTimeMillis = 10000,
+                    .ioInProgress = 4,
+            }},
+    };
+
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(firstSnapshot, tf.path));
+    TemporaryDir sysBlockDir;
+    for (const auto& disk : {"loop0", "mmcblk0"}) {
+        ASSERT_EQ(mkdir(StringPrintf("%s/%s", sysBlockDir.path, disk).c_str(), 0700), 0);
+    }
+
+    IoPerfCollection collector;
+    sp<DiskIoPerfProcessor> processor = new DiskIoPerfProcessor();
+    IoPerfRecord record = {};
+    sp<LooperStub> looperStub = new LooperStub();
+    collector.mHandlerLooper = looperStub;
+    collector.mDiskStats = new DiskStats(tf.path, sysBlockDir.path);
+    ASSERT_TRUE(collector.mDiskStats->enabled()) << "Temporary file is inaccessible";
+
+    struct DiskIoPerfData actualDiskIoPerfData = {};
+    auto snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::DISK_STATS));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    auto ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualDiskIoPerfData = record.diskIoPerfData;
+    ASSERT_TRUE(ret) << "Failed to collect first snapshot: " << ret.error();
+
+    ASSERT_TRUE(WriteStringToFile(secondSnapshot, tf.path));
+
+    actualDiskIoPerfData = {};
+    snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::DISK_STATS));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    snapshot->uptime += std::chrono::nanoseconds(10s).count();
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualDiskIoPerfData = record.diskIoPerfData;
+    ASSERT_TRUE(ret) << "Failed to collect second snapshot: " << ret.error();
+    EXPECT_TRUE(isEqual(expectedDiskIoPerfData, actualDiskIoPerfData))
+            << "Second snapshot doesn't match.\nExpected:\n"
+            << toString(expectedDiskIoPerfData) << "\nActual:\n"
+            << toString(actualDiskIoPerfData);
+}
+
+TEST(IoPerfCollectionTest, TestValidCpuCoreStatFiles) {
+    constexpr char firstSnapshot[] =
+            "cpu  3300 5280 1110 1450 391 4670 3600 0 0 0\n"
+            "cpu0 2400 2900 600 690 340 4300 2100 0 0 0\n"
+            "cpu1 900 2380 510 760 51 370 1500 0 0 0\n"
+            "intr 694351583 0 0 0 297062868 0 5922464 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+            "0 0\n"
+            "ctxt 579020168\n"
+            "btime 1579718450\n"
+            "processes 113804\n"
+            "procs_running 17\n"
+            "procs_blocked 5\n"
+            "softirq 33275060 934664 11958403 5111 516325 200333 0 341482 10651335 0 8667407\n";
+    struct CpuCorePerfData expectedCpuCorePerfData = {
+            .cores = {{.cpu = 0,
+                       .busyTime = 12300,
+                       .ioWaitTime = 340,
+                       .totalCpuTime = 13330,
+                       .timeInState = {{300000, 100}, {1800000, 2000}}},
+                      {.cpu = 1,
+                       .busyTime = 5660,
+                       .ioWaitTime = 51,
+                       .totalCpuTime = 6471,
+                       .timeInState = {{300000, 4000}}}},
+    };
+
+    TemporaryFile procStat;
+    TemporaryDir cpuDir;
+    ASSERT_NE(procStat.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(firstSnapshot, procStat.path));
+    auto ret = populateCpuDir(cpuDir.path,
+                              {{0, "300000 100\n1200000 0\n1800000 2000\n"},
+                               {1, "300000 4000\n1200000 0\n"}});
+    ASSERT_TRUE(ret) << "Failed to populate cpu dir: " << ret.error();
+
+    IoPerfCollection collector;
+    sp<CpuCorePerfProcessor> processor = new CpuCorePerfProcessor();
+    IoPerfRecord record = {};
+    collector.mCpuCoreStats = new CpuCoreStats(procStat.path, cpuDir.path);
+    ASSERT_TRUE(collector.mCpuCoreStats->enabled()) << "Temporary file is inaccessible";
+
+    struct CpuCorePerfData actualCpuCorePerfData = {};
+    auto snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::CPU_CORE_STATS));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualCpuCorePerfData = record.cpuCorePerfData;
+    ASSERT_RESULT_OK(ret);
+    EXPECT_TRUE(isEqual(expectedCpuCorePerfData, actualCpuCorePerfData))
+            << "First snapshot doesn't match.\nExpected:\n"
+            << toString(expectedCpuCorePerfData) << "\nActual:\n"
+            << toString(actualCpuCorePerfData);
+
+    // cpu1 is throttled and runs only at the lowest frequency while cpu0 is saturated.
+    constexpr char secondSnapshot[] =
+            "cpu  6300 5280 1110 1650 491 4670 3600 0 0 0\n"
+            "cpu0 5400 2900 600 690 340 4300 2100 0 0 0\n"
+            "cpu1 900 2380 510 960 151 370 1500 0 0 0\n"
+            "intr 694351583 0 0 0 297062868 0 5922464 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 "
+            "0 0\n"
+            "ctxt 579020168\n"
+            "btime 1579718450\n"
+            "processes 113804\n"
+            "procs_running 10\n"
+            "procs_blocked 2\n"
+            "softirq 33275060 934664 11958403 5111 516325 200333 0 341482 10651335 0 8667407\n";
+    expectedCpuCorePerfData = {
+            .cores = {{.cpu = 0,
+                       .busyTime = 3000,
+                       .ioWaitTime = 0,
+                       .totalCpuTime = 3000,
+                       .timeInState = {{1800000, 3000}}},
+                      {.cpu = 1,
+                       .busyTime = 0,
+                       .ioWaitTime = 100,
+                       .totalCpuTime = 300,
+                       .timeInState = {{300000, 300}}}},
+    };
+
+    ASSERT_TRUE(WriteStringToFile(secondSnapshot, procStat.path));
+    ret = populateCpuDir(cpuDir.path,
+                         {{0, "300000 100\n1200000 0\n1800000 5000\n"},
+                          {1, "300000 4300\n1200000 0\n"}});
+    ASSERT_TRUE(ret) << "Failed to populate cpu dir: " << ret.error();
+    actualCpuCorePerfData = {};
+    snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::CPU_CORE_STATS));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualCpuCorePerfData = record.cpuCorePerfData;
+    ASSERT_RESULT_OK(ret);
+    EXPECT_TRUE(isEqual(expectedCpuCorePerfData, actualCpuCorePerfData))
+            << "Second snapshot doesn't match.\nExpected:\n"
+            << toString(expectedCpuCorePerfData) << "\nActual:\n"
+            << toString(actualCpuCorePerfData);
+}
+
+TEST(IoPerfCollectionTest, TestReadsProcStatOnceForAggregateAndPerCoreUsage) {
+    constexpr char contents[] =
+            "cpu  3300 5280 1110 1450 391 4670 3600 0 0 0\n"
+            "cpu0 2400 2900 600 690 340 4300 2100 0 0 0\n"
+            "cpu1 900 2380 510 760 51 370 1500 0 0 0\n"
+            "procs_running 17\n"
+            "procs_blocked 5\n";
+    TemporaryFile procStat;
+    TemporaryFile unreadProcStat;
+    TemporaryDir cpuDir;
+    ASSERT_NE(procStat.fd, -1);
+    ASSERT_NE(unreadProcStat.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(contents, procStat.path));
+    ASSERT_TRUE(WriteStringToFile("cpu0 corrupted\n", unreadProcStat.path));
+
+    // The per-core usage is parsed from the contents read for the aggregate usage, so the
+    // corrupted file given to CpuCoreStats is never read.
+    IoPerfCollection collector;
+    collector.mProcStat = new ProcStat(procStat.path);
+    collector.mCpuCoreStats = new CpuCoreStats(unreadProcStat.path, cpuDir.path);
+    ASSERT_TRUE(collector.mProcStat->enabled()) << "Temporary file is inaccessible";
+    ASSERT_TRUE(collector.mCpuCoreStats->enabled()) << "Temporary file is inaccessible";
+
+    auto snapshot = collector.sampleLocked(
+            DataSourceSet().set(DataSource::PROC_STAT).set(DataSource::CPU_CORE_STATS));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    ASSERT_TRUE(snapshot->procStatInfo);
+    EXPECT_EQ(snapshot->procStatInfo->runnableProcessesCnt, 17);
+    EXPECT_EQ(snapshot->procStatInfo->cpuStats.userTime, 3300);
+    ASSERT_TRUE(snapshot->cpuCoreUsages);
+    ASSERT_EQ(snapshot->cpuCoreUsages->size(), 2);
+    EXPECT_EQ((*snapshot->cpuCoreUsages)[0].cpuStats.userTime, 2400);
+    EXPECT_EQ((*snapshot->cpuCoreUsages)[1].cpuStats.userTime, 900);
+}
+
 TEST(IoPerfCollectionTest, TestValidProcPidContents) {
     std::unordered_map<uint32_t, std::vector<uint32_t>> pidToTids = {
             {1, {1, 453}},
@@ -1368,6 +2017,8 @@ TEST(IoPerfCollectionTest, TestValidProcPidContents) {
     ASSERT_TRUE(ret) << "Failed to populate proc pid dir: " << ret.error();
 
     IoPerfCollection collector;
+    sp<ProcessIoPerfProcessor> processor = new ProcessIoPerfProcessor();
+    IoPerfRecord record = {};
     collector.mProcPidStat = new ProcPidStat(firstSnapshot.path);
     collector.mTopNStatsPerCategory = 2;
     collector.mTopNStatsPerSubcategory = 2;
@@ -1375,7 +2026,11 @@ TEST(IoPerfCollectionTest, TestValidProcPidContents) {
             << "Files under the temporary proc directory are inaccessible";
 
     struct ProcessIoPerfData actualProcessIoPerfData = {};
-    ret = collector.collectProcessIoPerfDataLocked(CollectionInfo{}, &actualProcessIoPerfData);
+    auto snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::PROC_PID_STAT));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    collector.resolvePackageNamesLocked(&*snapshot);
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualProcessIoPerfData = record.processIoPerfData;
     ASSERT_TRUE(ret) << "Failed to collect first snapshot: " << ret.error();
     EXPECT_TRUE(isEqual(expectedProcessIoPerfData, actualProcessIoPerfData))
             << "First snapshot doesn't match.\nExpected:\n"
@@ -1435,7 +2090,151 @@ TEST(IoPerfCollectionTest, TestValidProcPidContents) {
     collector.mProcPidStat->mPath = secondSnapshot.path;
 
     actualProcessIoPerfData = {};
-    ret = collector.collectProcessIoPerfDataLocked(CollectionInfo{}, &actualProcessIoPerfData);
+    snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::PROC_PID_STAT));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    collector.resolvePackageNamesLocked(&*snapshot);
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualProcessIoPerfData = record.processIoPerfData;
+    ASSERT_TRUE(ret) << "Failed to collect second snapshot: " << ret.error();
+    EXPECT_TRUE(isEqual(expectedProcessIoPerfData, actualProcessIoPerfData))
+            << "Second snapshot doesn't match.\nExpected:\n"
+            << toString(expectedProcessIoPerfData) << "\nActual:\n"
+            << toString(actualProcessIoPerfData);
+}
+
+TEST(IoPerfCollectionTest, TestValidProcPidCpuTimes) {
+    ASSERT_EQ(sysconf(_SC_CLK_TCK), 100) << "Expected CPU times are in 10ms clock ticks";
+    std::unordered_map<uint32_t, std::vector<uint32_t>> pidToTids = {
+            {1, {1}},
+            {1000, {1000, 1100}},
+            {2000, {2000}},
+            {3000, {3000}},
+    };
+    std::unordered_map<uint32_t, std::string> perProcessStat = {
+            {1, "1 (init) S 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0\n"},
+            {1000, "1000 (system_server) S 1 0 0 0 0 0 0 0 0 0 300 100 0 0 0 0 2 0 1000\n"},
+            {2000, "2000 (car_service) S 1 0 0 0 0 0 0 0 0 0 50 50 0 0 0 0 1 0 2000\n"},
+            {3000, "3000 (vold) S 1 0 0 0 0 0 0 0 0 0 150 50 0 0 0 0 1 0 300\n"},
+    };
+    std::unordered_map<uint32_t, std::string> perProcessStatus = {
+            {1, "Pid:\t1\nTgid:\t1\nUid:\t0\t0\t0\t0\n"},
+            {1000, "Pid:\t1000\nTgid:\t1000\nUid:\t1001000\t1001000\t1001000\t1001000\n"},
+            {2000, "Pid:\t2000\nTgid:\t2000\nUid:\t1001000\t1001000\t1001000\t1001000\n"},
+            {3000, "Pid:\t3000\nTgid:\t3000\nUid:\t0\t0\t0\t0\n"},
+    };
+    std::unordered_map<uint32_t, std::string> perThreadStat = {
+            {1, "1 (init) S 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0\n"},
+            {1000, "1000 (system_server) S 1 0 0 0 0 0 0 0 0 0 200 50 0 0 0 0 2 0 1000\n"},
+            {1100, "1100 (system_server) S 1 0 0 0 0 0 0 0 0 0 100 50 0 0 0 0 2 0 1200\n"},
+            {2000, "2000 (car_service) S 1 0 0 0 0 0 0 0 0 0 50 50 0 0 0 0 1 0 2000\n"},
+            {3000, "3000 (vold) S 1 0 0 0 0 0 0 0 0 0 150 50 0 0 0 0 1 0 300\n"},
+    };
+    struct ProcessIoPerfData expectedProcessIoPerfData = {};
+    expectedProcessIoPerfData.topNCpuTimeUids.push_back({
+            // uid: 1001000
+            .userId = 10,
+            .packageName = "shared:android.uid.system",
+            .count = 5000,
+            .topNProcesses = {{"system_server", 4000}, {"car_service", 1000}},
+    });
+    expectedProcessIoPerfData.topNCpuTimeUids.push_back({
+            // uid: 0
+            .userId = 0,
+            .packageName = "root",
+            .count = 2000,
+            .topNProcesses = {{"vold", 2000}},
+    });
+    expectedProcessIoPerfData.totalCpuTimeMillis = 7000;
+
+    TemporaryDir firstSnapshot;
+    auto ret = populateProcPidDir(firstSnapshot.path, pidToTids, perProcessStat, perProcessStatus,
+                                  perThreadStat);
+    ASSERT_TRUE(ret) << "Failed to populate proc pid dir: " << ret.error();
+
+    IoPerfCollection collector;
+    sp<ProcessIoPerfProcessor> processor = new ProcessIoPerfProcessor();
+    IoPerfRecord record = {};
+    collector.mProcPidStat = new ProcPidStat(firstSnapshot.path);
+    collector.mTopNStatsPerCategory = 2;
+    collector.mTopNStatsPerSubcategory = 2;
+    collector.mUidToPackageNameMapping[0] = "root";
+    collector.mUidToPackageNameMapping[1001000] = "shared:android.uid.system";
+    collector.mUidToPackageNameMapping[10045] = "com.example.app";
+    ASSERT_TRUE(collector.mProcPidStat->enabled())
+            << "Files under the temporary proc directory are inaccessible";
+
+    struct ProcessIoPerfData actualProcessIoPerfData = {};
+    auto snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::PROC_PID_STAT));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    collector.resolvePackageNamesLocked(&*snapshot);
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualProcessIoPerfData = record.processIoPerfData;
+    ASSERT_TRUE(ret) << "Failed to collect first snapshot: " << ret.error();
+    EXPECT_TRUE(isEqual(expectedProcessIoPerfData, actualProcessIoPerfData))
+            << "First snapshot doesn't match.\nExpected:\n"
+            << toString(expectedProcessIoPerfData) << "\nActual:\n"
+            << toString(actualProcessIoPerfData);
+
+    // car_service stays idle, a new app process starts and vold overtakes system_server.
+    pidToTids = {
+            {1, {1}},
+            {1000, {1000, 1100}},
+            {2000, {2000}},
+            {3000, {3000}},
+            {4000, {4000}},
+    };
+    perProcessStat = {
+            {1, "1 (init) S 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0\n"},
+            {1000, "1000 (system_server) S 1 0 0 0 0 0 0 0 0 0 500 200 0 0 0 0 2 0 1000\n"},
+            {2000, "2000 (car_service) S 1 0 0 0 0 0 0 0 0 0 50 50 0 0 0 0 1 0 2000\n"},
+            {3000, "3000 (vold) S 1 0 0 0 0 0 0 0 0 0 450 150 0 0 0 0 1 0 300\n"},
+            {4000, "4000 (com.example.app) S 1 0 0 0 0 0 0 0 0 0 120 30 0 0 0 0 1 0 4500\n"},
+    };
+    perProcessStatus = {
+            {1, "Pid:\t1\nTgid:\t1\nUid:\t0\t0\t0\t0\n"},
+            {1000, "Pid:\t1000\nTgid:\t1000\nUid:\t1001000\t1001000\t1001000\t1001000\n"},
+            {2000, "Pid:\t2000\nTgid:\t2000\nUid:\t1001000\t1001000\t1001000\t1001000\n"},
+            {3000, "Pid:\t3000\nTgid:\t3000\nUid:\t0\t0\t0\t0\n"},
+            {4000, "Pid:\t4000\nTgid:\t4000\nUid:\t10045\t10045\t10045\t10045\n"},
+    };
+    perThreadStat = {
+            {1, "1 (init) S 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 1 0 0\n"},
+            {1000, "1000 (system_server) S 1 0 0 0 0 0 0 0 0 0 350 100 0 0 0 0 2 0 1000\n"},
+            {1100, "1100 (system_server) S 1 0 0 0 0 0 0 0 0 0 150 100 0 0 0 0 2 0 1200\n"},
+            {2000, "2000 (car_service) S 1 0 0 0 0 0 0 0 0 0 50 50 0 0 0 0 1 0 2000\n"},
+            {3000, "3000 (vold) S 1 0 0 0 0 0 0 0 0 0 450 150 0 0 0 0 1 0 300\n"},
+            {4000, "4000 (com.example.app) S 1 0 0 0 0 0 0 0 0 0 120 30 0 0 0 0 1 0 4500\n"},
+    };
+    expectedProcessIoPerfData = {};
+    expectedProcessIoPerfData.topNCpuTimeUids.push_back({
+            // uid: 0
+            .userId = 0,
+            .packageName = "root",
+            .count = 4000,
+            .topNProcesses = {{"vold", 4000}},
+    });
+    expectedProcessIoPerfData.topNCpuTimeUids.push_back({
+            // uid: 1001000
+            .userId = 10,
+            .packageName = "shared:android.uid.system",
+            .count = 3000,
+            .topNProcesses = {{"system_server", 3000}},
+    });
+    expectedProcessIoPerfData.totalCpuTimeMillis = 8500;
+
+    TemporaryDir secondSnapshot;
+    ret = populateProcPidDir(secondSnapshot.path, pidToTids, perProcessStat, perProcessStatus,
+                             perThreadStat);
+    ASSERT_TRUE(ret) << "Failed to populate proc pid dir: " << ret.error();
+
+    collector.mProcPidStat->mPath = secondSnapshot.path;
+
+    actualProcessIoPerfData = {};
+    snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::PROC_PID_STAT));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    collector.resolvePackageNamesLocked(&*snapshot);
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualProcessIoPerfData = record.processIoPerfData;
     ASSERT_TRUE(ret) << "Failed to collect second snapshot: " << ret.error();
     EXPECT_TRUE(isEqual(expectedProcessIoPerfData, actualProcessIoPerfData))
             << "Second snapshot doesn't match.\nExpected:\n"
@@ -1474,11 +2273,17 @@ TEST(IoPerfCollectionTest, TestProcPidContentsLessThanTopNStatsLimit) {
     ASSERT_TRUE(ret) << "Failed to populate proc pid dir: " << ret.error();
 
     IoPerfCollection collector;
+    sp<ProcessIoPerfProcessor> processor = new ProcessIoPerfProcessor();
+    IoPerfRecord record = {};
     collector.mTopNStatsPerCategory = 5;
     collector.mTopNStatsPerSubcategory = 3;
     collector.mProcPidStat = new ProcPidStat(prodDir.path);
     struct ProcessIoPerfData actualProcessIoPerfData = {};
-    ret = collector.collectProcessIoPerfDataLocked(CollectionInfo{}, &actualProcessIoPerfData);
+    auto snapshot = collector.sampleLocked(DataSourceSet().set(DataSource::PROC_PID_STAT));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    collector.resolvePackageNamesLocked(&*snapshot);
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualProcessIoPerfData = record.processIoPerfData;
     ASSERT_TRUE(ret) << "Failed to collect proc pid contents: " << ret.error();
     EXPECT_TRUE(isEqual(expectedProcessIoPerfData, actualProcessIoPerfData))
             << "proc pid contents don't match.\nExpected:\n"
@@ -1486,6 +2291,345 @@ TEST(IoPerfCollectionTest, TestProcPidContentsLessThanTopNStatsLimit) {
             << toString(actualProcessIoPerfData);
 }
 
+TEST(IoPerfCollectionTest, TestValidMemoryContents) {
+    constexpr char firstMemInfo[] =
+            "MemTotal:        3888032 kB\n"
+            "MemFree:          180196 kB\n"
+            "MemAvailable:    1500000 kB\n"
+            "Buffers:           70000 kB\n"
+            "Cached:          1200000 kB\n"
+            "SwapCached:        20000 kB\n"
+            "SwapTotal:       1000000 kB\n"
+            "SwapFree:         800000 kB\n";
+    std::unordered_map<uint32_t, std::vector<uint32_t>> pidToTids = {
+            {1, {1}},
+            {1000, {1000}},
+            {2000, {2000}},
+            {3000, {3000}},
+    };
+    std::unordered_map<uint32_t, std::string> perProcessStatus = {
+            {1,
+             "Name:\tinit\nTgid:\t1\nUid:\t0\t0\t0\t0\n"
+             "VmRSS:\t    4000 kB\nVmSwap:\t       0 kB\n"},
+            {1000,
+             "Name:\tsystem_server\nTgid:\t1000\nUid:\t1001000\t1001000\t1001000\t1001000\n"
+             "VmRSS:\t  300000 kB\nVmSwap:\t   20000 kB\n"},
+            {2000,
+             "Name:\tcar_service\nTgid:\t2000\nUid:\t1001000\t1001000\t1001000\t1001000\n"
+             "VmRSS:\t  100000 kB\nVmSwap:\t    5000 kB\n"},
+            {3000,
+             "Name:\tcom.example.app\nTgid:\t3000\nUid:\t10045\t10045\t10045\t10045\n"
+             "VmRSS:\t   50000 kB\nVmSwap:\t       0 kB\n"},
+    };
+    struct MemoryPerfData expectedMemoryPerfData = {
+            .memInfo = {.memTotalKb = 3888032,
+                        .memFreeKb = 180196,
+                        .memAvailableKb = 1500000,
+                        .buffersKb = 70000,
+                        .cachedKb = 1200000,
+                        .swapTotalKb = 1000000,
+                        .swapFreeKb = 800000},
+            .memAvailableDeltaKb = 0,
+            .topNRssUids = {{
+                                    .userId = 10,
+                                    .packageName = "shared:android.uid.system",
+                                    .rssKb = 400000,
+                                    .swapKb = 25000,
+                                    .rssDeltaKb = 400000,
+                                    .topNProcesses = {{"system_server", 300000, 20000},
+                                                      {"car_service", 100000, 5000}},
+                            },
+                            {
+                                    .userId = 0,
+                                    .packageName = "com.example.app",
+                                    .rssKb = 50000,
+                                    .swapKb = 0,
+                                    .rssDeltaKb = 50000,
+                                    .topNProcesses = {{"com.example.app", 50000, 0}},
+                            }},
+            .totalRssKb = 454000,
+            .totalSwapKb = 25000,
+    };
+
+    TemporaryFile firstMemInfoFile;
+    ASSERT_NE(firstMemInfoFile.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(firstMemInfo, firstMemInfoFile.path));
+    TemporaryDir firstSnapshot;
+    auto ret = populateProcPidDir(firstSnapshot.path, pidToTids, {}, perProcessStatus, {});
+    ASSERT_TRUE(ret) << "Failed to populate proc pid dir: " << ret.error();
+
+    IoPerfCollection collector;
+    sp<MemoryPerfProcessor> processor = new MemoryPerfProcessor();
+    IoPerfRecord record = {};
+    collector.mProcMemInfo = new ProcMemInfo(firstMemInfoFile.path);
+    collector.mProcPidMem = new ProcPidMem(firstSnapshot.path);
+    collector.mTopNStatsPerCategory = 2;
+    collector.mTopNStatsPerSubcategory = 2;
+    collector.mUidToPackageNameMapping[0] = "root";
+    collector.mUidToPackageNameMapping[1001000] = "shared:android.uid.system";
+    collector.mUidToPackageNameMapping[10045] = "com.example.app";
+    ASSERT_TRUE(collector.mProcMemInfo->enabled()) << "Temporary file is inaccessible";
+    ASSERT_TRUE(collector.mProcPidMem->enabled())
+            << "Files under the temporary proc directory are inaccessible";
+
+    struct MemoryPerfData actualMemoryPerfData = {};
+    auto snapshot = collector.sampleLocked(
+            DataSourceSet().set(DataSource::PROC_MEM_INFO).set(DataSource::PROC_PID_MEM));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    collector.resolvePackageNamesLocked(&*snapshot);
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualMemoryPerfData = record.memoryPerfData;
+    ASSERT_TRUE(ret) << "Failed to collect first snapshot: " << ret.error();
+    EXPECT_TRUE(isEqual(expectedMemoryPerfData, actualMemoryPerfData))
+            << "First snapshot doesn't match.\nExpected:\n"
+            << toString(expectedMemoryPerfData) << "\nActual:\n"
+            << toString(actualMemoryPerfData);
+
+    // system_server grows, car_service exits, the app gets swapped out and a kernel thread
+    // shows up.
+    constexpr char secondMemInfo[] =
+            "MemTotal:        3888032 kB\n"
+            "MemFree:          100000 kB\n"
+            "MemAvailable:    1200000 kB\n"
+            "Buffers:           60000 kB\n"
+            "Cached:          1000000 kB\n"
+            "SwapTotal:       1000000 kB\n"
+            "SwapFree:         700000 kB\n";
+    pidToTids = {
+            {1, {1}},
+            {1000, {1000}},
+            {3000, {3000}},
+            {4000, {4000}},
+    };
+    perProcessStatus = {
+            {1,
+             "Name:\tinit\nTgid:\t1\nUid:\t0\t0\t0\t0\n"
+             "VmRSS:\t    4000 kB\nVmSwap:\t       0 kB\n"},
+            {1000,
+             "Name:\tsystem_server\nTgid:\t1000\nUid:\t1001000\t1001000\t1001000\t1001000\n"
+             "VmRSS:\t  450000 kB\nVmSwap:\t   30000 kB\n"},
+            {3000,
+             "Name:\tcom.example.app\nTgid:\t3000\nUid:\t10045\t10045\t10045\t10045\n"
+             "VmRSS:\t   20000 kB\nVmSwap:\t   30000 kB\n"},
+            // Kernel threads don't have the Vm* lines.
+            {4000, "Name:\tkworker/0:1\nTgid:\t4000\nUid:\t0\t0\t0\t0\n"},
+    };
+    expectedMemoryPerfData = {
+            .memInfo = {.memTotalKb = 3888032,
+                        .memFreeKb = 100000,
+                        .memAvailableKb = 1200000,
+                        .buffersKb = 60000,
+                        .cachedKb = 1000000,
+                        .swapTotalKb = 1000000,
+                        .swapFreeKb = 700000},
+            .memAvailableDeltaKb = -300000,
+            .topNRssUids = {{
+                                    .userId = 10,
+                                    .packageName = "shared:android.uid.system",
+                                    .rssKb = 450000,
+                                    .swapKb = 30000,
+                                    .rssDeltaKb = 50000,
+                                    .topNProcesses = {{"system_server", 450000, 30000}},
+                            },
+                            {
+                                    .userId = 0,
+                                    .packageName = "com.example.app",
+                                    .rssKb = 20000,
+                                    .swapKb = 30000,
+                                    .rssDeltaKb = -30000,
+                                    .topNProcesses = {{"com.example.app", 20000, 30000}},
+                            }},
+            .totalRssKb = 474000,
+            .totalSwapKb = 60000,
+    };
+
+    TemporaryFile secondMemInfoFile;
+    ASSERT_NE(secondMemInfoFile.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(secondMemInfo, secondMemInfoFile.path));
+    TemporaryDir secondSnapshot;
+    ret = populateProcPidDir(secondSnapshot.path, pidToTids, {}, perProcessStatus, {});
+    ASSERT_TRUE(ret) << "Failed to populate proc pid dir: " << ret.error();
+
+    collector.mProcMemInfo = new ProcMemInfo(secondMemInfoFile.path);
+    collector.mProcPidMem = new ProcPidMem(secondSnapshot.path);
+
+    actualMemoryPerfData = {};
+    snapshot = collector.sampleLocked(
+            DataSourceSet().set(DataSource::PROC_MEM_INFO).set(DataSource::PROC_PID_MEM));
+    ASSERT_TRUE(snapshot) << "Failed to sample data sources: " << snapshot.error();
+    collector.resolvePackageNamesLocked(&*snapshot);
+    ret = collector.processRecordLocked(processor, CollectionInfo{}, *snapshot, &record);
+    actualMemoryPerfData = record.memoryPerfData;
+    ASSERT_TRUE(ret) << "Failed to collect second snapshot: " << ret.error();
+    EXPECT_TRUE(isEqual(expectedMemoryPerfData, actualMemoryPerfData))
+            << "Second snapshot doesn't match.\nExpected:\n"
+            << toString(expectedMemoryPerfData) << "\nActual:\n"
+            << toString(actualMemoryPerfData);
+}
+
+TEST(IoPerfCollectionTest, TestMemoryCollectionCadence) {
+    IoPerfCollection collector;
+    sp<ProcMemInfoStub> procMemInfoStub = new ProcMemInfoStub(true);
+    sp<ProcPidMemStub> procPidMemStub = new ProcPidMemStub(true);
+    collector.mUidIoStats = new UidIoStatsStub();
+    collector.mProcStat = new ProcStatStub();
+    collector.mProcPidStat = new ProcPidStatStub();
+    collector.mCpuCoreStats = new CpuCoreStatsStub();
+    collector.mDiskStats = new DiskStatsStub();
+    collector.mProcMemInfo = procMemInfoStub;
+    collector.mProcPidMem = procPidMemStub;
+    collector.mTopNStatsPerCategory = 1;
+    collector.mTopNStatsPerSubcategory = 1;
+    collector.mUidToPackageNameMapping[0] = "root";
+    collector.mCurrCollectionEvent = CollectionEvent::PERIODIC;
+
+    MemInfo memInfo = {.memTotalKb = 1000, .memAvailableKb = 500};
+    std::vector<ProcessMemStats> processMemStats = {
+            {.pid = 1, .uid = 0, .comm = "init", .rssKb = 100, .swapKb = 0}};
+    procMemInfoStub->push(memInfo);
+    procPidMemStub->push(processMemStats);
+
+    CollectionInfo collectionInfo = {.maxCacheSize = 10};
+    auto ret = collector.collectLocked(&collectionInfo);
+    ASSERT_TRUE(ret) << "Failed to collect first record: " << ret.error();
+    ASSERT_EQ(collectionInfo.records.size(), 1);
+    EXPECT_EQ(collectionInfo.records[0].memoryPerfData.memInfo, memInfo);
+    EXPECT_EQ(collectionInfo.records[0].memoryPerfData.totalRssKb, 100);
+
+    // The stubs have no more entries so collecting the memory usage again within
+    // |kMemoryCollectionInterval| would fail.
+    ret = collector.collectLocked(&collectionInfo);
+    ASSERT_TRUE(ret) << "Failed to collect second record: " << ret.error();
+    ASSERT_EQ(collectionInfo.records.size(), 2);
+    EXPECT_TRUE(isEqual(collectionInfo.records[1].memoryPerfData, MemoryPerfData{}))
+            << "Memory usage collected before the memory collection interval elapsed:\n"
+            << toString(collectionInfo.records[1].memoryPerfData);
+
+    // Custom collections sample the memory usage on every collection.
+    collector.mCurrCollectionEvent = CollectionEvent::CUSTOM;
+    procMemInfoStub->push(memInfo);
+    procPidMemStub->push(processMemStats);
+    ret = collector.collectLocked(&collectionInfo);
+    ASSERT_TRUE(ret) << "Failed to collect third record: " << ret.error();
+    ASSERT_EQ(collectionInfo.records.size(), 3);
+    EXPECT_EQ(collectionInfo.records[2].memoryPerfData.memInfo, memInfo);
+    EXPECT_EQ(collectionInfo.records[2].memoryPerfData.totalRssKb, 100);
+}
+
+TEST(IoPerfCollectionTest, TestDataProcessorsShareSnapshot) {
+    IoPerfCollection collector;
+    sp<ProcStatStub> procStatStub = new ProcStatStub(true);
+    collector.mUidIoStats = new UidIoStatsStub();
+    collector.mProcStat = procStatStub;
+    collector.mProcPidStat = new ProcPidStatStub();
+    collector.mCpuCoreStats = new CpuCoreStatsStub();
+    collector.mDiskStats = new DiskStatsStub();
+    collector.mProcMemInfo = new ProcMemInfoStub();
+    collector.mProcPidMem = new ProcPidMemStub();
+    collector.mCurrCollectionEvent = CollectionEvent::PERIODIC;
+
+    sp<DataProcessorStub> firstProcessor =
+            new DataProcessorStub("First", DataSourceSet().set(DataSource::PROC_STAT));
+    sp<DataProcessorStub> secondProcessor =
+            new DataProcessorStub("Second", DataSourceSet().set(DataSource::PROC_STAT));
+    ASSERT_RESULT_OK(collector.registerDataProcessor(firstProcessor));
+    ASSERT_RESULT_OK(collector.registerDataProcessor(secondProcessor));
+    ASSERT_FALSE(collector.registerDataProcessor(firstProcessor))
+            << "Registered the same data processor twice";
+    ASSERT_FALSE(collector.registerDataProcessor(nullptr)) << "Registered a null data processor";
+
+    // The stub has a single entry so reading `/proc/stat` more than once per collection would fail.
+    ProcStatInfo procStatInfo{
+            /*stats=*/{2900, 7900, 4900, 8900, /*ioWaitTime=*/5900, 6966, 7980, 0, 0, 2930},
+            /*runnableCnt=*/100, /*ioBlockedCnt=*/57};
+    procStatStub->push(procStatInfo);
+
+    CollectionInfo collectionInfo = {.maxCacheSize = 10};
+    const auto& ret = collector.collectLocked(&collectionInfo);
+    ASSERT_TRUE(ret) << "Failed to collect: " << ret.error();
+    ASSERT_EQ(collectionInfo.records.size(), 1);
+    EXPECT_EQ(collectionInfo.records[0].systemIoPerfData.ioBlockedProcessesCnt, 57);
+
+    for (const auto& processor : {firstProcessor, secondProcessor}) {
+        ASSERT_EQ(processor->snapshots().size(), 1) << processor->name();
+        const CollectorSnapshot& snapshot = processor->snapshots()[0];
+        ASSERT_TRUE(snapshot.procStatInfo) << processor->name();
+        EXPECT_EQ(*snapshot.procStatInfo, procStatInfo) << processor->name();
+        EXPECT_EQ(snapshot.uptime, firstProcessor->snapshots()[0].uptime) << processor->name();
+    }
+}
+
+TEST(IoPerfCollectionTest, TestDataProcessorsReceiveRebaselineSnapshot) {
+    IoPerfCollection collector;
+    sp<UidIoStatsStub> uidIoStatsStub = new UidIoStatsStub(true);
+    sp<ProcStatStub> procStatStub = new ProcStatStub(true);
+    collector.mUidIoStats = uidIoStatsStub;
+    collector.mProcStat = procStatStub;
+    collector.mProcPidStat = new ProcPidStatStub();
+    collector.mCpuCoreStats = new CpuCoreStatsStub();
+    collector.mDiskStats = new DiskStatsStub();
+    collector.mProcMemInfo = new ProcMemInfoStub();
+    collector.mProcPidMem = new ProcPidMemStub();
+
+    sp<DataProcessorStub> processor =
+            new DataProcessorStub("I/O", DataSourceSet().set(DataSource::UID_IO_STATS));
+    ASSERT_RESULT_OK(collector.registerDataProcessor(processor));
+
+    // The usage accumulated across suspend is handed to the processor as a re-baseline rather
+    // than as a collection.
+    uidIoStatsStub->push({{1009, {.uid = 1009, .ios = {0, 20000, 0, 30000, 0, 300}}}});
+    procStatStub->push(ProcStatInfo{});
+    ASSERT_RESULT_OK(collector.rebaselineCollectorsLocked());
+
+    EXPECT_TRUE(processor->snapshots().empty()) << "Re-baseline delivered as a collection";
+    ASSERT_EQ(processor->rebaselineSnapshots().size(), 1);
+    const CollectorSnapshot& snapshot = processor->rebaselineSnapshots()[0];
+    ASSERT_TRUE(snapshot.uidIoUsages);
+    ASSERT_EQ(snapshot.uidIoUsages->count(1009), 1);
+    EXPECT_EQ(snapshot.uidIoUsages->at(1009).ios.sumWriteBytes(), 30000);
+}
+
+TEST(IoPerfCollectionTest, TestSamplesOnlyRequestedDataSources) {
+    IoPerfCollection collector;
+    sp<ProcMemInfoStub> procMemInfoStub = new ProcMemInfoStub(true);
+    collector.mUidIoStats = new UidIoStatsStub();
+    collector.mProcStat = new ProcStatStub();
+    collector.mProcPidStat = new ProcPidStatStub();
+    collector.mCpuCoreStats = new CpuCoreStatsStub();
+    collector.mDiskStats = new DiskStatsStub();
+    collector.mProcMemInfo = procMemInfoStub;
+    collector.mProcPidMem = new ProcPidMemStub();
+    collector.mCurrCollectionEvent = CollectionEvent::PERIODIC;
+
+    MemInfo memInfo = {.memTotalKb = 1000, .memAvailableKb = 500};
+    procMemInfoStub->push(memInfo);
+
+    CollectionInfo collectionInfo = {.maxCacheSize = 10};
+    auto ret = collector.collectLocked(&collectionInfo);
+    ASSERT_TRUE(ret) << "Failed to collect first record: " << ret.error();
+
+    // Memory usage isn't due for the built-in processing, so `/proc/meminfo` is sampled only
+    // because the processor requests it. The stub has no more entries so this fails otherwise.
+    sp<DataProcessorStub> processor =
+            new DataProcessorStub("Memory", DataSourceSet().set(DataSource::PROC_MEM_INFO));
+    ASSERT_RESULT_OK(collector.registerDataProcessor(processor));
+    ret = collector.collectLocked(&collectionInfo);
+    ASSERT_FALSE(ret) << "Didn't sample the data source requested by the data processor";
+
+    procMemInfoStub->push(memInfo);
+    ret = collector.collectLocked(&collectionInfo);
+    ASSERT_TRUE(ret) << "Failed to collect third record: " << ret.error();
+    ASSERT_EQ(processor->snapshots().size(), 1);
+    const CollectorSnapshot& snapshot = processor->snapshots()[0];
+    ASSERT_TRUE(snapshot.memInfo);
+    EXPECT_EQ(*snapshot.memInfo, memInfo);
+    EXPECT_FALSE(snapshot.processMemStats) << "Sampled a disabled data source";
+    EXPECT_FALSE(snapshot.procStatInfo) << "Sampled a disabled data source";
+    EXPECT_TRUE(isEqual(collectionInfo.records.back().memoryPerfData, MemoryPerfData{}))
+            << "Memory usage processed before the memory collection interval elapsed:\n"
+            << toString(collectionInfo.records.back().memoryPerfData);
+}
+
 TEST(IoPerfCollectionTest, TestHandlesInvalidDumpArguments) {
     sp<IoPerfCollection> collector = new IoPerfCollection();
     collector->start();
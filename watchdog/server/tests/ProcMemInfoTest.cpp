@@ -0,0 +1,151 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ProcMemInfo.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <inttypes.h>
+
+#include <string>
+
+#include "gmock/gmock.h"
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+using android::base::StringPrintf;
+using android::base::WriteStringToFile;
+
+namespace {
+
+std::string toString(const MemInfo& info) {
+    return StringPrintf("MemTotal: %" PRIu64 " kB MemFree: %" PRIu64 " kB MemAvailable: %" PRIu64
+                        " kB Buffers: %" PRIu64 " kB Cached: %" PRIu64 " kB SwapTotal: %" PRIu64
+                        " kB SwapFree: %" PRIu64 " kB",
+                        info.memTotalKb, info.memFreeKb, info.memAvailableKb, info.buffersKb,
+                        info.cachedKb, info.swapTotalKb, info.swapFreeKb);
+}
+
+}  // namespace
+
+TEST(ProcMemInfoTest, TestValidMemInfoFile) {
+    constexpr char contents[] =
+            "MemTotal:        3888032 kB\n"
+            "MemFree:          180196 kB\n"
+            "MemAvailable:    1492680 kB\n"
+            "Buffers:           71780 kB\n"
+            "Cached:          1287672 kB\n"
+            "SwapCached:        22092 kB\n"
+            "Active:          1379584 kB\n"
+            "Inactive:        1210072 kB\n"
+            "SwapTotal:       1048572 kB\n"
+            "SwapFree:         800000 kB\n"
+            "Dirty:               244 kB\n"
+            "HugePages_Total:       0\n"
+            "Hugepagesize:       2048 kB\n";
+    MemInfo expected = {
+            .memTotalKb = 3888032,
+            .memFreeKb = 180196,
+            .memAvailableKb = 1492680,
+            .buffersKb = 71780,
+            .cachedKb = 1287672,
+            .swapTotalKb = 1048572,
+            .swapFreeKb = 800000,
+    };
+
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(contents, tf.path));
+
+    ProcMemInfo procMemInfo(tf.path);
+    ASSERT_TRUE(procMemInfo.enabled()) << "Temporary file is inaccessible";
+
+    const auto& actual = procMemInfo.collect();
+    ASSERT_RESULT_OK(actual);
+    EXPECT_EQ(expected, *actual) << "Memory info doesn't match.\nExpected:\n"
+                                 << toString(expected) << "\nActual:\n"
+                                 << toString(*actual);
+}
+
+TEST(ProcMemInfoTest, TestErrorOnCorruptedMemInfoFile) {
+    constexpr char contents[] =
+            "MemTotal:        3888032 kB\n"
+            "MemFree:          CORRUPTED DATA\n"
+            "MemAvailable:    1492680 kB\n"
+            "Buffers:           71780 kB\n"
+            "Cached:          1287672 kB\n"
+            "SwapTotal:       1048572 kB\n"
+            "SwapFree:         800000 kB\n";
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(contents, tf.path));
+
+    ProcMemInfo procMemInfo(tf.path);
+    ASSERT_TRUE(procMemInfo.enabled()) << "Temporary file is inaccessible";
+    EXPECT_FALSE(procMemInfo.collect().ok()) << "No error returned for corrupted file";
+}
+
+TEST(ProcMemInfoTest, TestErrorOnMissingMemAvailableLine) {
+    constexpr char contents[] =
+            "MemTotal:        3888032 kB\n"
+            "MemFree:          180196 kB\n"
+            "Buffers:           71780 kB\n"
+            "Cached:          1287672 kB\n"
+            "SwapTotal:       1048572 kB\n"
+            "SwapFree:         800000 kB\n";
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(contents, tf.path));
+
+    ProcMemInfo procMemInfo(tf.path);
+    ASSERT_TRUE(procMemInfo.enabled()) << "Temporary file is inaccessible";
+    EXPECT_FALSE(procMemInfo.collect().ok()) << "No error returned for missing MemAvailable line";
+}
+
+TEST(ProcMemInfoTest, TestErrorOnDuplicateLine) {
+    constexpr char contents[] =
+            "MemTotal:        3888032 kB\n"
+            "MemFree:          180196 kB\n"
+            "MemFree:          180196 kB\n"
+            "Buffers:           71780 kB\n"
+            "Cached:          1287672 kB\n"
+            "SwapTotal:       1048572 kB\n"
+            "SwapFree:         800000 kB\n";
+    TemporaryFile tf;
+    ASSERT_NE(tf.fd, -1);
+    ASSERT_TRUE(WriteStringToFile(contents, tf.path));
+
+    ProcMemInfo procMemInfo(tf.path);
+    ASSERT_TRUE(procMemInfo.enabled()) << "Temporary file is inaccessible";
+    EXPECT_FALSE(procMemInfo.collect().ok()) << "No error returned for duplicate MemFree line";
+}
+
+TEST(ProcMemInfoTest, TestProcMemInfoContentsFromDevice) {
+    ProcMemInfo procMemInfo;
+    ASSERT_TRUE(procMemInfo.enabled()) << kProcMemInfoPath << " file is inaccessible";
+
+    const auto& info = procMemInfo.collect();
+    ASSERT_RESULT_OK(info);
+
+    EXPECT_GT(info->memTotalKb, 0);
+    EXPECT_LE(info->memAvailableKb, info->memTotalKb);
+}
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ProcPidMem.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <inttypes.h>
+
+#include <algorithm>
+#include <string>
+
+#include "ProcPidDir.h"
+#include "gmock/gmock.h"
+
+namespace android {
+namespace automotive {
+namespace watchdog {
+
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+using testing::populateProcPidDir;
+
+namespace {
+
+std::string toString(const std::vector<ProcessMemStats>& stats) {
+    std::string buffer;
+    StringAppendF(&buffer, "Number of processes: %d\n", static_cast<int>(stats.size()));
+    for (const auto& it : stats) {
+        StringAppendF(&buffer,
+                      "PID: %" PRIu32 ", UID: %" PRIi64 ", Comm: %s, RSS: %" PRIu64
+                      " kB, Swap: %" PRIu64 " kB\n",
+                      it.pid, it.uid, it.comm.c_str(), it.rssKb, it.swapKb);
+    }
+    return buffer;
+}
+
+bool isEqual(std::vector<ProcessMemStats>* lhs, std::vector<ProcessMemStats>* rhs) {
+    if (lhs->size() != rhs->size()) {
+        return false;
+    }
+    auto comp = [&](const ProcessMemStats& l, const ProcessMemStats& r) -> bool {
+        return l.pid < r.pid;
+    };
+    std::sort(lhs->begin(), lhs->end(), comp);
+    std::sort(rhs->begin(), rhs->end(), comp);
+    return std::equal(lhs->begin(), lhs->end(), rhs->begin(),
+                      [&](const ProcessMemStats& l, const ProcessMemStats& r) -> bool {
+                          return l.pid == r.pid && l.uid == r.uid && l.comm == r.comm &&
+                                  l.rssKb == r.rssKb && l.swapKb == r.swapKb;
+                      });
+}
+
+}  // namespace
+
+TEST(ProcPidMemTest, TestValidStatusFiles) {
+    std::unordered_map<uint32_t, std::vector<uint32_t>> pidToTids = {
+            {1, {1}},
+            {2, {2}},
+            {1000, {1000, 1001}},
+    };
+
+    std::unordered_map<uint32_t, std::string> perProcessStatus = {
+            {1,
+             "Name:\tinit\nUmask:\t0000\nState:\tS (sleeping)\nTgid:\t1\nPid:\t1\n"
+             "Uid:\t0\t0\t0\t0\nVmPeak:\t   40000 kB\nVmRSS:\t    4096 kB\n"
+             "RssAnon:\t    2048 kB\nVmSwap:\t     128 kB\nThreads:\t1\n"},
+            // Kernel threads don't have the Vm* lines.
+            {2,
+             "Name:\tkthreadd\nUmask:\t0000\nState:\tS (sleeping)\nTgid:\t2\nPid:\t2\n"
+             "Uid:\t0\t0\t0\t0\nThreads:\t1\n"},
+            {1000,
+             "Name:\tsystem_server\nUmask:\t0077\nState:\tS (sleeping)\nTgid:\t1000\n"
+             "Pid:\t1000\nUid:\t10001000\t10001000\t10001000\t10001000\n"
+             "VmRSS:\t  302400 kB\nVmSwap:\t   12000 kB\nThreads:\t2\n"},
+    };
+
+    std::vector<ProcessMemStats> expected = {
+            {.pid = 1, .uid = 0, .comm = "init", .rssKb = 4096, .swapKb = 128},
+            {.pid = 1000, .uid = 10001000, .comm = "system_server", .rssKb = 302400,
+             .swapKb = 12000},
+    };
+
+    TemporaryDir procDir;
+    const auto& ret = populateProcPidDir(procDir.path, pidToTids, {}, perProcessStatus, {});
+    ASSERT_TRUE(ret) << "Failed to populate proc pid dir: " << ret.error();
+
+    ProcPidMem procPidMem(procDir.path);
+    ASSERT_TRUE(procPidMem.enabled())
+            << "Files under the path `" << procDir.path << "` are inaccessible";
+
+    auto actual = procPidMem.collect();
+    ASSERT_TRUE(actual) << "Failed to collect proc pid memory: " << actual.error();
+    EXPECT_TRUE(isEqual(&expected, &actual.value())) << "Memory stats don't match.\nExpected:\n"
+                                                     << toString(expected) << "\nActual:\n"
+                                                     << toString(*actual);
+}
+
+TEST(ProcPidMemTest, TestHandlesProcessTerminationBetweenScanningAndParsing) {
+    std::unordered_map<uint32_t, std::vector<uint32_t>> pidToTids = {
+            {1, {1}},
+            {100, {100}},
+    };
+
+    // Process 100 terminated before its status file was read.
+    std::unordered_map<uint32_t, std::string> perProcessStatus = {
+            {1, "Name:\tinit\nTgid:\t1\nUid:\t0\t0\t0\t0\nVmRSS:\t    4096 kB\n"},
+    };
+
+    std::vector<ProcessMemStats> expected = {
+            {.pid = 1, .uid = 0, .comm = "init", .rssKb = 4096, .swapKb = 0},
+    };
+
+    TemporaryDir procDir;
+    const auto& ret = populateProcPidDir(procDir.path, pidToTids, {}, perProcessStatus, {});
+    ASSERT_TRUE(ret) << "Failed to populate proc pid dir: " << ret.error();
+
+    ProcPidMem procPidMem(procDir.path);
+    ASSERT_TRUE(procPidMem.enabled())
+            << "Files under the path `" << procDir.path << "` are inaccessible";
+
+    auto actual = procPidMem.collect();
+    ASSERT_TRUE(actual) << "Failed to collect proc pid memory: " << actual.error();
+    EXPECT_TRUE(isEqual(&expected, &actual.value())) << "Memory stats don't match.\nExpected:\n"
+                                                     << toString(expected) << "\nActual:\n"
+                                                     << toString(*actual);
+}
+
+TEST(ProcPidMemTest, TestErrorOnCorruptedProcessStatusFile) {
+    std::unordered_map<uint32_t, std::vector<uint32_t>> pidToTids = {
+            {1, {1}},
+    };
+
+    std::unordered_map<uint32_t, std::string> perProcessStatus = {
+            {1, "Name:\tinit\nTgid:\t1\nUid:\t0\t0\t0\t0\nVmRSS:\tCORRUPTED DATA\n"},
+    };
+
+    TemporaryDir procDir;
+    const auto& ret = populateProcPidDir(procDir.path, pidToTids, {}, perProcessStatus, {});
+    ASSERT_TRUE(ret) << "Failed to populate proc pid dir: " << ret.error();
+
+    ProcPidMem procPidMem(procDir.path);
+    ASSERT_TRUE(procPidMem.enabled())
+            << "Files under the path `" << procDir.path << "` are inaccessible";
+
+    const auto& actual = procPidMem.collect();
+    ASSERT_FALSE(actual) << "No error returned for invalid process status file";
+}
+
+}  // namespace watchdog
+}  // namespace automotive
+}  // namespace android
@@ -39,9 +39,9 @@ namespace {
 std::string toString(const PidStat& stat) {
     return StringPrintf("PID: %" PRIu32 ", PPID: %" PRIu32 ", Comm: %s, State: %s, "
                         "Major page faults: %" PRIu64 ", Num threads: %" PRIu32
-                        ", Start time: %" PRIu64,
+                        ", Start time: %" PRIu64 ", CPU time: %" PRIu64,
                         stat.pid, stat.ppid, stat.comm.c_str(), stat.state.c_str(),
-                        stat.majorFaults, stat.numThreads, stat.startTime);
+                        stat.majorFaults, stat.numThreads, stat.startTime, stat.cpuTime);
 }
 
 std::string toString(const ProcessStats& stats) {
@@ -68,7 +68,8 @@ std::string toString(const std::vector<ProcessStats>& stats) {
 bool isEqual(const PidStat& lhs, const PidStat& rhs) {
     return lhs.pid == rhs.pid && lhs.comm == rhs.comm && lhs.state == rhs.state &&
             lhs.ppid == rhs.ppid && lhs.majorFaults == rhs.majorFaults &&
-            lhs.numThreads == rhs.numThreads && lhs.startTime == rhs.startTime;
+            lhs.numThreads == rhs.numThreads && lhs.startTime == rhs.startTime &&
+            lhs.cpuTime == rhs.cpuTime;
 }
 
 bool isEqual(std::vector<ProcessStats>* lhs, std::vector<ProcessStats>* rhs) {
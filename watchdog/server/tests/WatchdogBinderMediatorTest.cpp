@@ -34,6 +34,7 @@ namespace watchdog {
 
 using android::sp;
 using android::base::Result;
+using android::os::ParcelFileDescriptor;
 using binder::Status;
 using ::testing::_;
 using ::testing::Return;
@@ -47,6 +48,10 @@ public:
 
     MOCK_METHOD(Status, registerClient,
                 (const sp<ICarWatchdogClient>& client, TimeoutLength timeout), (override));
+    MOCK_METHOD(Status, registerHeartbeatClient,
+                (const sp<ICarWatchdogClient>& client, TimeoutLength timeout,
+                 ParcelFileDescriptor* heartbeat),
+                (override));
     MOCK_METHOD(Status, unregisterClient, (const sp<ICarWatchdogClient>& client), (override));
     MOCK_METHOD(Status, registerMediator, (const sp<ICarWatchdogClient>& mediator), (override));
     MOCK_METHOD(Status, unregisterMediator, (const sp<ICarWatchdogClient>& mediator), (override));
@@ -69,11 +74,22 @@ class MockIoPerfCollection : public IoPerfCollection {
 public:
     MockIoPerfCollection() {}
     MOCK_METHOD(Result<void>, onBootFinished, (), (override));
+    MOCK_METHOD(Result<void>, onSuspend, (), (override));
+    MOCK_METHOD(Result<void>, onResume, (), (override));
     MOCK_METHOD(Result<void>, onCustomCollection, (int fd, const Vector<String16>& args),
                 (override));
     MOCK_METHOD(Result<void>, onDump, (int fd), (override));
 };
 
+class MockIoOveruseMonitor : public IoOveruseMonitor {
+public:
+    MockIoOveruseMonitor() {}
+    MOCK_METHOD(Result<void>, registerListener, (const sp<IIoOveruseListener>& listener),
+                (override));
+    MOCK_METHOD(Result<void>, unregisterListener, (const sp<IIoOveruseListener>& listener),
+                (override));
+};
+
 class MockICarWatchdogClient : public ICarWatchdogClient {
 public:
     MOCK_METHOD(Status, checkIfAlive, (int32_t sessionId, TimeoutLength timeout), (override));
@@ -91,6 +107,17 @@ public:
     MOCK_METHOD(std::string, getInterfaceHash, (), (override));
 };
 
+class MockIIoOveruseListener : public IIoOveruseListener {
+public:
+    MOCK_METHOD(Status, onIoOveruse,
+                (int32_t uid, const String16& packageName, int64_t foregroundWrittenBytes,
+                 int64_t backgroundWrittenBytes, int64_t windowDurationSeconds),
+                (override));
+    MOCK_METHOD(IBinder*, onAsBinder, (), (override));
+    MOCK_METHOD(int32_t, getInterfaceVersion, (), (override));
+    MOCK_METHOD(std::string, getInterfaceHash, (), (override));
+};
+
 class ScopedChangeCallingUid : public RefBase {
 public:
     explicit ScopedChangeCallingUid(uid_t uid) {
@@ -124,15 +151,19 @@ protected:
     virtual void SetUp() {
         mMockWatchdogProcessService = new MockWatchdogProcessService();
         mMockIoPerfCollection = new MockIoPerfCollection();
+        mMockIoOveruseMonitor = new MockIoOveruseMonitor();
         mWatchdogBinderMediator = new WatchdogBinderMediator();
-        mWatchdogBinderMediator->init(mMockWatchdogProcessService, mMockIoPerfCollection);
+        mWatchdogBinderMediator->init(mMockWatchdogProcessService, mMockIoPerfCollection,
+                                      mMockIoOveruseMonitor);
     }
     virtual void TearDown() {
         mWatchdogBinderMediator->terminate();
         ASSERT_TRUE(mWatchdogBinderMediator->mWatchdogProcessService == nullptr);
         ASSERT_TRUE(mWatchdogBinderMediator->mIoPerfCollection == nullptr);
+        ASSERT_TRUE(mWatchdogBinderMediator->mIoOveruseMonitor == nullptr);
         mMockWatchdogProcessService = nullptr;
         mMockIoPerfCollection = nullptr;
+        mMockIoOveruseMonitor = nullptr;
         mWatchdogBinderMediator = nullptr;
         mScopedChangeCallingUid = nullptr;
     }
@@ -140,17 +171,26 @@ protected:
     void setSystemCallingUid() { mScopedChangeCallingUid = new ScopedChangeCallingUid(AID_SYSTEM); }
     sp<MockWatchdogProcessService> mMockWatchdogProcessService;
     sp<MockIoPerfCollection> mMockIoPerfCollection;
+    sp<MockIoOveruseMonitor> mMockIoOveruseMonitor;
     sp<WatchdogBinderMediator> mWatchdogBinderMediator;
     sp<ScopedChangeCallingUid> mScopedChangeCallingUid;
 };
 
 TEST_F(WatchdogBinderMediatorTest, TestErrorOnNullptrDuringInit) {
     sp<WatchdogBinderMediator> mediator = new WatchdogBinderMediator();
-    ASSERT_FALSE(mediator->init(nullptr, new MockIoPerfCollection()).ok())
+    ASSERT_FALSE(
+            mediator->init(nullptr, new MockIoPerfCollection(), new MockIoOveruseMonitor()).ok())
             << "No error returned on nullptr watchdog process service";
-    ASSERT_FALSE(mediator->init(new MockWatchdogProcessService(), nullptr).ok())
+    ASSERT_FALSE(
+            mediator->init(new MockWatchdogProcessService(), nullptr, new MockIoOveruseMonitor())
+                    .ok())
             << "No error returned on nullptr I/O perf collection";
-    ASSERT_FALSE(mediator->init(nullptr, nullptr).ok()) << "No error returned on nullptr";
+    ASSERT_FALSE(
+            mediator->init(new MockWatchdogProcessService(), new MockIoPerfCollection(), nullptr)
+                    .ok())
+            << "No error returned on nullptr I/O overuse monitor";
+    ASSERT_FALSE(mediator->init(nullptr, nullptr, nullptr).ok())
+            << "No error returned on nullptr";
 }
 
 TEST_F(WatchdogBinderMediatorTest, TestHandlesEmptyDumpArgs) {
@@ -190,6 +230,16 @@ TEST_F(WatchdogBinderMediatorTest, TestRegisterClient) {
     ASSERT_TRUE(status.isOk()) << status;
 }
 
+TEST_F(WatchdogBinderMediatorTest, TestRegisterHeartbeatClient) {
+    sp<ICarWatchdogClient> client = new MockICarWatchdogClient();
+    TimeoutLength timeout = TimeoutLength::TIMEOUT_CRITICAL;
+    ParcelFileDescriptor heartbeat;
+    EXPECT_CALL(*mMockWatchdogProcessService, registerHeartbeatClient(client, timeout, &heartbeat))
+            .WillOnce(Return(Status::ok()));
+    Status status = mWatchdogBinderMediator->registerHeartbeatClient(client, timeout, &heartbeat);
+    ASSERT_TRUE(status.isOk()) << status;
+}
+
 TEST_F(WatchdogBinderMediatorTest, TestUnregisterClient) {
     sp<ICarWatchdogClient> client = new MockICarWatchdogClient();
     EXPECT_CALL(*mMockWatchdogProcessService, unregisterClient(client))
@@ -322,12 +372,35 @@ TEST_F(WatchdogBinderMediatorTest, TestNotifyPowerCycleChange) {
     EXPECT_CALL(*mMockWatchdogProcessService,
                 notifyPowerCycleChange(PowerCycle::POWER_CYCLE_SUSPEND))
             .WillOnce(Return(Status::ok()));
+    EXPECT_CALL(*mMockIoPerfCollection, onSuspend()).WillOnce(Return(Result<void>()));
     Status status =
             mWatchdogBinderMediator
                     ->notifySystemStateChange(type,
                                               static_cast<int32_t>(PowerCycle::POWER_CYCLE_SUSPEND),
                                               -1);
     ASSERT_TRUE(status.isOk()) << status;
+
+    EXPECT_CALL(*mMockWatchdogProcessService,
+                notifyPowerCycleChange(PowerCycle::POWER_CYCLE_RESUME))
+            .WillOnce(Return(Status::ok()));
+    EXPECT_CALL(*mMockIoPerfCollection, onResume()).WillOnce(Return(Result<void>()));
+    status = mWatchdogBinderMediator
+                     ->notifySystemStateChange(type,
+                                               static_cast<int32_t>(PowerCycle::POWER_CYCLE_RESUME),
+                                               -1);
+    ASSERT_TRUE(status.isOk()) << status;
+
+    EXPECT_CALL(*mMockWatchdogProcessService,
+                notifyPowerCycleChange(PowerCycle::POWER_CYCLE_SHUTDOWN))
+            .WillOnce(Return(Status::ok()));
+    EXPECT_CALL(*mMockIoPerfCollection, onSuspend()).Times(0);
+    EXPECT_CALL(*mMockIoPerfCollection, onResume()).Times(0);
+    status = mWatchdogBinderMediator
+                     ->notifySystemStateChange(type,
+                                               static_cast<int32_t>(
+                                                       PowerCycle::POWER_CYCLE_SHUTDOWN),
+                                               -1);
+    ASSERT_TRUE(status.isOk()) << status;
 }
 
 TEST_F(WatchdogBinderMediatorTest, TestErrorOnNotifyPowerCycleChangeWithInvalidArgs) {
@@ -383,6 +456,38 @@ TEST_F(WatchdogBinderMediatorTest, TestNotifyBootPhaseChangeWithNonBootCompleted
     ASSERT_TRUE(status.isOk()) << status;
 }
 
+TEST_F(WatchdogBinderMediatorTest, TestRegisterIoOveruseListener) {
+    setSystemCallingUid();
+    sp<IIoOveruseListener> listener = new MockIIoOveruseListener();
+    EXPECT_CALL(*mMockIoOveruseMonitor, registerListener(listener))
+            .WillOnce(Return(Result<void>()));
+    Status status = mWatchdogBinderMediator->registerIoOveruseListener(listener);
+    ASSERT_TRUE(status.isOk()) << status;
+}
+
+TEST_F(WatchdogBinderMediatorTest, TestErrorOnRegisterIoOveruseListenerWithNonSystemCallingUid) {
+    sp<IIoOveruseListener> listener = new MockIIoOveruseListener();
+    EXPECT_CALL(*mMockIoOveruseMonitor, registerListener(_)).Times(0);
+    Status status = mWatchdogBinderMediator->registerIoOveruseListener(listener);
+    ASSERT_FALSE(status.isOk()) << status;
+}
+
+TEST_F(WatchdogBinderMediatorTest, TestUnregisterIoOveruseListener) {
+    setSystemCallingUid();
+    sp<IIoOveruseListener> listener = new MockIIoOveruseListener();
+    EXPECT_CALL(*mMockIoOveruseMonitor, unregisterListener(listener))
+            .WillOnce(Return(Result<void>()));
+    Status status = mWatchdogBinderMediator->unregisterIoOveruseListener(listener);
+    ASSERT_TRUE(status.isOk()) << status;
+}
+
+TEST_F(WatchdogBinderMediatorTest, TestErrorOnUnregisterIoOveruseListenerWithNonSystemCallingUid) {
+    sp<IIoOveruseListener> listener = new MockIIoOveruseListener();
+    EXPECT_CALL(*mMockIoOveruseMonitor, unregisterListener(_)).Times(0);
+    Status status = mWatchdogBinderMediator->unregisterIoOveruseListener(listener);
+    ASSERT_FALSE(status.isOk()) << status;
+}
+
 }  // namespace watchdog
 }  // namespace automotive
 }  // namespace android
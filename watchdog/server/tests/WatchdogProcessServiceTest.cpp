@@ -16,6 +16,17 @@
 
 #include "WatchdogProcessService.h"
 
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memory>
+
 #include "gmock/gmock.h"
 
 namespace android {
@@ -23,9 +34,18 @@ namespace automotive {
 namespace watchdog {
 
 using android::sp;
+using android::base::ReadFileToString;
+using android::base::StringPrintf;
+using android::base::unique_fd;
+using android::os::ParcelFileDescriptor;
 using binder::Status;
+using std::literals::chrono_literals::operator""ms;
+using std::literals::chrono_literals::operator""s;
 using ::testing::_;
+using ::testing::DoAll;
+using ::testing::HasSubstr;
 using ::testing::Return;
+using ::testing::SaveArg;
 
 namespace {
 
@@ -45,6 +65,8 @@ public:
     sp<MockBinder> getBinder() const { return mBinder; }
 
     MOCK_METHOD(IBinder*, onAsBinder, (), (override));
+    MOCK_METHOD(Status, checkIfAlive, (int32_t sessionId, TimeoutLength timeout), (override));
+    MOCK_METHOD(Status, prepareProcessTermination, (), (override));
 
 private:
     sp<MockBinder> mBinder;
@@ -56,23 +78,161 @@ public:
     sp<MockBinder> getBinder() const { return mBinder; }
 
     MOCK_METHOD(IBinder*, onAsBinder, (), (override));
+    MOCK_METHOD(Status, onClientsNotResponding, (const std::vector<int32_t>& pids), (override));
 
 private:
     sp<MockBinder> mBinder;
 };
 
+const ProcStatInfo kIdleSystemLoad(
+        /*stats=*/{100, 0, 50, /*idleTime=*/840, /*ioWaitTime=*/10, 0, 0, 0, 0, 0},
+        /*runnableCnt=*/1,
+        /*ioBlockedCnt=*/0);
+
+// Far more runnable processes than any device has CPUs.
+const ProcStatInfo kCpuSaturatedSystemLoad(
+        /*stats=*/{900, 0, 100, /*idleTime=*/0, /*ioWaitTime=*/0, 0, 0, 0, 0, 0},
+        /*runnableCnt=*/10000,
+        /*ioBlockedCnt=*/0);
+
+const ProcStatInfo kIoSaturatedSystemLoad(
+        /*stats=*/{100, 0, 50, /*idleTime=*/350, /*ioWaitTime=*/500, 0, 0, 0, 0, 0},
+        /*runnableCnt=*/1,
+        /*ioBlockedCnt=*/1);
+
+// Heartbeat region of a fake client in heartbeat mode. The counter is bumped through the client's
+// own mapping, as a client process would.
+class FakeHeartbeat {
+public:
+    FakeHeartbeat() : mCounter(nullptr) {}
+    ~FakeHeartbeat() {
+        if (mCounter != nullptr) {
+            munmap(mCounter, sizeof(uint64_t));
+        }
+    }
+    // Maps the region returned on registration.
+    bool map(const ParcelFileDescriptor& region) {
+        mFd.reset(dup(region.get().get()));
+        if (mFd.get() < 0) {
+            return false;
+        }
+        void* addr = mmap(nullptr, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, mFd.get(),
+                          0);
+        if (addr == MAP_FAILED) {
+            return false;
+        }
+        mCounter = static_cast<uint64_t*>(addr);
+        return true;
+    }
+    void beat() { __atomic_fetch_add(mCounter, 1, __ATOMIC_RELEASE); }
+    int fd() const { return mFd.get(); }
+
+private:
+    unique_fd mFd;
+    uint64_t* mCounter;
+};
+
+// Waits up to |timeout| for the child process to exit. Returns true when it was killed by SIGKILL.
+bool waitForKill(pid_t pid, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    do {
+        int status = 0;
+        pid_t ret = waitpid(pid, &status, WNOHANG);
+        if (ret == pid) {
+            return WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL;
+        }
+        if (ret < 0) {
+            return false;
+        }
+        usleep(1000);
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
+}
+
 }  // namespace
 
 class WatchdogProcessServiceTest : public ::testing::Test {
 protected:
     void SetUp() override {
-        sp<Looper> looper(Looper::prepare(/*opts=*/0));
-        mWatchdogProcessService = new WatchdogProcessService(looper);
+        mLooper = Looper::prepare(/*opts=*/0);
+        mWatchdogProcessService = new WatchdogProcessService(mLooper);
     }
 
-    void TearDown() override { mWatchdogProcessService = nullptr; }
+    void TearDown() override {
+        mWatchdogProcessService = nullptr;
+        mLooper = nullptr;
+        // Reap the children left behind by a failed test. The children already reaped by
+        // |waitForKill| aren't ours anymore, so they are not signaled.
+        for (pid_t pid : mChildPids) {
+            if (waitpid(pid, nullptr, WNOHANG) == 0) {
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+            }
+        }
+    }
+
+    // Forks a child process that idles until it is killed.
+    pid_t forkIdleProcess() {
+        pid_t pid = fork();
+        if (pid == 0) {
+            while (true) {
+                pause();
+            }
+        }
+        if (pid > 0) {
+            mChildPids.push_back(pid);
+        }
+        return pid;
+    }
+
+    // Runs the health check for |timeout| after the I/O performance collection reports
+    // |systemLoad|, sampled |loadAge| ago.
+    void doHealthCheck(TimeoutLength timeout, const ProcStatInfo& systemLoad,
+                       std::chrono::nanoseconds loadAge = std::chrono::nanoseconds(0)) {
+        CollectorSnapshot snapshot;
+        snapshot.uptime = systemTime(SYSTEM_TIME_MONOTONIC) - loadAge.count();
+        snapshot.procStatInfo = systemLoad;
+        auto ret = mWatchdogProcessService->onSnapshot(snapshot);
+        EXPECT_TRUE(ret.ok()) << ret.error().message();
+        mWatchdogProcessService->doHealthCheck(static_cast<int>(timeout));
+    }
+
+    // Registers |client| in heartbeat mode and maps the returned region to |heartbeat|.
+    void registerHeartbeatClient(const sp<ICarWatchdogClient>& client, TimeoutLength timeout,
+                                 FakeHeartbeat* heartbeat) {
+        ParcelFileDescriptor region;
+        Status status = mWatchdogProcessService->registerHeartbeatClient(client, timeout, &region);
+        ASSERT_TRUE(status.isOk()) << status;
+        ASSERT_TRUE(heartbeat->map(region)) << "Failed to map the heartbeat region";
+    }
+
+    std::string dump() {
+        TemporaryFile dump;
+        auto ret = mWatchdogProcessService->dump(dump.fd, Vector<String16>());
+        EXPECT_TRUE(ret.ok()) << ret.error().message();
+        std::string contents;
+        EXPECT_TRUE(ReadFileToString(dump.path, &contents));
+        return contents;
+    }
+
+    // Reports |pids| as not responding through a mediator, which triggers dumping and killing
+    // them.
+    void reportNotRespondingThroughMediator(const sp<MockCarWatchdogClient>& mediator,
+                                            const sp<MockCarWatchdogMonitor>& monitor,
+                                            const std::vector<int32_t>& pids) {
+        mWatchdogProcessService->registerMonitor(monitor);
+        mWatchdogProcessService->registerMediator(mediator);
+        int32_t sessionId = 0;
+        EXPECT_CALL(*mediator, checkIfAlive(_, TimeoutLength::TIMEOUT_CRITICAL))
+                .WillOnce(DoAll(SaveArg<0>(&sessionId), Return(Status::ok())));
+        doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kIdleSystemLoad);
+        Status status = mWatchdogProcessService->tellMediatorAlive(mediator, pids, sessionId);
+        EXPECT_TRUE(status.isOk()) << status;
+    }
 
+    sp<Looper> mLooper;
     sp<WatchdogProcessService> mWatchdogProcessService;
+    std::vector<pid_t> mChildPids;
 };
 
 sp<MockCarWatchdogClient> createMockCarWatchdogClient(status_t linkToDeathResult) {
@@ -134,6 +294,25 @@ TEST_F(WatchdogProcessServiceTest, TestRegisterClient_BinderDied) {
             << "When linkToDeath fails, registerClient should return an error";
 }
 
+TEST_F(WatchdogProcessServiceTest, TestRegisterHeartbeatClient_RegionCannotBeResized) {
+    sp<MockCarWatchdogClient> client = expectNormalCarWatchdogClient();
+    FakeHeartbeat heartbeat;
+    registerHeartbeatClient(client, TimeoutLength::TIMEOUT_CRITICAL, &heartbeat);
+
+    // Shrinking the region would crash the daemon with SIGBUS when it reads the counter.
+    ASSERT_NE(ftruncate(heartbeat.fd(), 0), 0) << "Client shrank the heartbeat region";
+    ASSERT_NE(ftruncate(heartbeat.fd(), 4096), 0) << "Client grew the heartbeat region";
+    ASSERT_NE(fcntl(heartbeat.fd(), F_ADD_SEALS, F_SEAL_WRITE), 0)
+            << "Client sealed the heartbeat region against writes";
+
+    ParcelFileDescriptor region;
+    ASSERT_FALSE(mWatchdogProcessService
+                         ->registerHeartbeatClient(client, TimeoutLength::TIMEOUT_CRITICAL, &region)
+                         .isOk())
+            << "Registering the same client twice should return an error";
+    ASSERT_LT(region.get().get(), 0) << "Returned a region for a client that wasn't registered";
+}
+
 TEST_F(WatchdogProcessServiceTest, TestRegisterMediator) {
     sp<ICarWatchdogClient> mediator = expectNormalCarWatchdogClient();
     Status status = mWatchdogProcessService->registerMediator(mediator);
@@ -207,6 +386,246 @@ TEST_F(WatchdogProcessServiceTest, TestTellDumpFinished) {
     ASSERT_TRUE(status.isOk()) << status;
 }
 
+TEST_F(WatchdogProcessServiceTest, TestKillsNotRespondingClientWhenSystemIsNotSaturated) {
+    sp<MockCarWatchdogClient> client = expectNormalCarWatchdogClient();
+    sp<MockCarWatchdogMonitor> monitor = expectNormalCarWatchdogMonitor();
+    mWatchdogProcessService->registerMonitor(monitor);
+    mWatchdogProcessService->registerClient(client, TimeoutLength::TIMEOUT_CRITICAL);
+
+    EXPECT_CALL(*client, checkIfAlive(_, TimeoutLength::TIMEOUT_CRITICAL))
+            .WillOnce(Return(Status::ok()));
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kIdleSystemLoad);
+
+    EXPECT_CALL(*client, prepareProcessTermination()).WillOnce(Return(Status::ok()));
+    EXPECT_CALL(*monitor, onClientsNotResponding(std::vector<int32_t>{getpid()}))
+            .WillOnce(Return(Status::ok()));
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kIdleSystemLoad);
+
+    ASSERT_THAT(dump(), HasSubstr("Deadline extensions: none"));
+}
+
+TEST_F(WatchdogProcessServiceTest, TestExtendsDeadlineWhenSystemIsSaturated) {
+    sp<MockCarWatchdogClient> client = expectNormalCarWatchdogClient();
+    sp<MockCarWatchdogMonitor> monitor = expectNormalCarWatchdogMonitor();
+    mWatchdogProcessService->registerMonitor(monitor);
+    mWatchdogProcessService->registerClient(client, TimeoutLength::TIMEOUT_CRITICAL);
+
+    int32_t sessionId = 0;
+    EXPECT_CALL(*client, checkIfAlive(_, TimeoutLength::TIMEOUT_CRITICAL))
+            .WillOnce(DoAll(SaveArg<0>(&sessionId), Return(Status::ok())));
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kIdleSystemLoad);
+
+    // The client is starved by the saturated CPU, so the deadline is extended instead of killing
+    // the client or pinging it again.
+    EXPECT_CALL(*client, checkIfAlive(_, _)).Times(0);
+    EXPECT_CALL(*client, prepareProcessTermination()).Times(0);
+    EXPECT_CALL(*monitor, onClientsNotResponding(_)).Times(0);
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kCpuSaturatedSystemLoad);
+    ASSERT_THAT(dump(),
+                HasSubstr(StringPrintf("Extended the CRITICAL deadline of processes(pid = %d) by 3 "
+                                       "seconds (runnable processes = 10000",
+                                       getpid())));
+
+    // The client responds within the extended deadline, so the next health check begins.
+    Status status = mWatchdogProcessService->tellClientAlive(client, sessionId);
+    ASSERT_TRUE(status.isOk()) << status;
+    EXPECT_CALL(*client, checkIfAlive(_, TimeoutLength::TIMEOUT_CRITICAL))
+            .WillOnce(Return(Status::ok()));
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kCpuSaturatedSystemLoad);
+}
+
+TEST_F(WatchdogProcessServiceTest, TestKillsNotRespondingClientWhenSystemLoadIsStale) {
+    sp<MockCarWatchdogClient> client = expectNormalCarWatchdogClient();
+    sp<MockCarWatchdogMonitor> monitor = expectNormalCarWatchdogMonitor();
+    mWatchdogProcessService->registerMonitor(monitor);
+    mWatchdogProcessService->registerClient(client, TimeoutLength::TIMEOUT_CRITICAL);
+
+    EXPECT_CALL(*client, checkIfAlive(_, TimeoutLength::TIMEOUT_CRITICAL))
+            .WillOnce(Return(Status::ok()));
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kIdleSystemLoad);
+
+    // The saturated load was sampled before the 3 second deadline began, so it doesn't explain
+    // the missed deadline.
+    EXPECT_CALL(*client, prepareProcessTermination()).WillOnce(Return(Status::ok()));
+    EXPECT_CALL(*monitor, onClientsNotResponding(std::vector<int32_t>{getpid()}))
+            .WillOnce(Return(Status::ok()));
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kCpuSaturatedSystemLoad,
+                  /*loadAge=*/60s);
+
+    ASSERT_THAT(dump(), HasSubstr("Deadline extensions: none"));
+}
+
+TEST_F(WatchdogProcessServiceTest, TestDropsSystemLoadOnSuspend) {
+    sp<MockCarWatchdogClient> client = expectNormalCarWatchdogClient();
+    sp<MockCarWatchdogMonitor> monitor = expectNormalCarWatchdogMonitor();
+    mWatchdogProcessService->registerMonitor(monitor);
+    mWatchdogProcessService->registerClient(client, TimeoutLength::TIMEOUT_CRITICAL);
+
+    CollectorSnapshot snapshot;
+    snapshot.uptime = systemTime(SYSTEM_TIME_MONOTONIC);
+    snapshot.procStatInfo = kCpuSaturatedSystemLoad;
+    auto ret = mWatchdogProcessService->onSnapshot(snapshot);
+    ASSERT_TRUE(ret.ok()) << ret.error().message();
+    mWatchdogProcessService->notifyPowerCycleChange(PowerCycle::POWER_CYCLE_SUSPEND);
+    mWatchdogProcessService->notifyPowerCycleChange(PowerCycle::POWER_CYCLE_RESUME);
+
+    EXPECT_CALL(*client, checkIfAlive(_, TimeoutLength::TIMEOUT_CRITICAL))
+            .WillOnce(Return(Status::ok()));
+    mWatchdogProcessService->doHealthCheck(static_cast<int>(TimeoutLength::TIMEOUT_CRITICAL));
+
+    EXPECT_CALL(*client, prepareProcessTermination()).WillOnce(Return(Status::ok()));
+    EXPECT_CALL(*monitor, onClientsNotResponding(std::vector<int32_t>{getpid()}))
+            .WillOnce(Return(Status::ok()));
+    mWatchdogProcessService->doHealthCheck(static_cast<int>(TimeoutLength::TIMEOUT_CRITICAL));
+
+    ASSERT_THAT(dump(), HasSubstr("Deadline extensions: none"));
+}
+
+TEST_F(WatchdogProcessServiceTest, TestKillsNotRespondingClientAfterMaxDeadlineExtensions) {
+    sp<MockCarWatchdogClient> client = expectNormalCarWatchdogClient();
+    sp<MockCarWatchdogMonitor> monitor = expectNormalCarWatchdogMonitor();
+    mWatchdogProcessService->registerMonitor(monitor);
+    mWatchdogProcessService->registerClient(client, TimeoutLength::TIMEOUT_MODERATE);
+
+    EXPECT_CALL(*client, checkIfAlive(_, TimeoutLength::TIMEOUT_MODERATE))
+            .WillOnce(Return(Status::ok()));
+    doHealthCheck(TimeoutLength::TIMEOUT_MODERATE, kIdleSystemLoad);
+
+    EXPECT_CALL(*monitor, onClientsNotResponding(_)).Times(0);
+    doHealthCheck(TimeoutLength::TIMEOUT_MODERATE, kIoSaturatedSystemLoad);
+    doHealthCheck(TimeoutLength::TIMEOUT_MODERATE, kIoSaturatedSystemLoad);
+    std::string contents = dump();
+    ASSERT_THAT(contents, HasSubstr("I/O wait = 50.00%"));
+    ASSERT_NE(contents.find("Extended the MODERATE deadline"),
+              contents.rfind("Extended the MODERATE deadline"))
+            << "Deadline wasn't extended twice:\n"
+            << contents;
+
+    // The deadline is extended only a bounded number of times, so a hung client is still killed.
+    EXPECT_CALL(*client, prepareProcessTermination()).WillOnce(Return(Status::ok()));
+    EXPECT_CALL(*monitor, onClientsNotResponding(std::vector<int32_t>{getpid()}))
+            .WillOnce(Return(Status::ok()));
+    doHealthCheck(TimeoutLength::TIMEOUT_MODERATE, kIoSaturatedSystemLoad);
+}
+
+TEST_F(WatchdogProcessServiceTest, TestHealthChecksHeartbeatClientsWithoutPinging) {
+    const int kNumClients = 100;
+    const int kNumHealthChecks = 3;
+    std::vector<sp<MockCarWatchdogClient>> clients;
+    std::vector<std::unique_ptr<FakeHeartbeat>> heartbeats;
+    for (int i = 0; i < kNumClients; ++i) {
+        sp<MockCarWatchdogClient> client = expectNormalCarWatchdogClient();
+        auto heartbeat = std::make_unique<FakeHeartbeat>();
+        registerHeartbeatClient(client, TimeoutLength::TIMEOUT_CRITICAL, heartbeat.get());
+        EXPECT_CALL(*client, checkIfAlive(_, _)).Times(0);
+        EXPECT_CALL(*client, prepareProcessTermination()).Times(0);
+        clients.push_back(client);
+        heartbeats.push_back(std::move(heartbeat));
+    }
+
+    // Every client bumps its counter within the timeout, so the health checks don't make any
+    // binder call.
+    for (int i = 0; i < kNumHealthChecks; ++i) {
+        for (auto& heartbeat : heartbeats) {
+            heartbeat->beat();
+        }
+        doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kIdleSystemLoad);
+    }
+
+    ASSERT_THAT(dump(),
+                HasSubstr(StringPrintf("Client health checks: %d by heartbeat, 0 by ping",
+                                       kNumClients * kNumHealthChecks)));
+}
+
+TEST_F(WatchdogProcessServiceTest, TestPingsHeartbeatClientWhenCounterStalls) {
+    sp<MockCarWatchdogClient> client = expectNormalCarWatchdogClient();
+    sp<MockCarWatchdogMonitor> monitor = expectNormalCarWatchdogMonitor();
+    FakeHeartbeat heartbeat;
+    mWatchdogProcessService->registerMonitor(monitor);
+    registerHeartbeatClient(client, TimeoutLength::TIMEOUT_CRITICAL, &heartbeat);
+
+    // The counter hasn't changed since the registration, so the client is pinged and it responds.
+    int32_t sessionId = 0;
+    EXPECT_CALL(*client, checkIfAlive(_, TimeoutLength::TIMEOUT_CRITICAL))
+            .WillOnce(DoAll(SaveArg<0>(&sessionId), Return(Status::ok())));
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kIdleSystemLoad);
+    Status status = mWatchdogProcessService->tellClientAlive(client, sessionId);
+    ASSERT_TRUE(status.isOk()) << status;
+
+    heartbeat.beat();
+    EXPECT_CALL(*client, checkIfAlive(_, _)).Times(0);
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kIdleSystemLoad);
+
+    // The counter stalls and the client doesn't respond to the ping either, so it is killed.
+    EXPECT_CALL(*client, checkIfAlive(_, TimeoutLength::TIMEOUT_CRITICAL))
+            .WillOnce(Return(Status::ok()));
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kIdleSystemLoad);
+
+    EXPECT_CALL(*client, prepareProcessTermination()).WillOnce(Return(Status::ok()));
+    EXPECT_CALL(*monitor, onClientsNotResponding(std::vector<int32_t>{getpid()}))
+            .WillOnce(Return(Status::ok()));
+    doHealthCheck(TimeoutLength::TIMEOUT_CRITICAL, kIdleSystemLoad);
+
+    ASSERT_THAT(dump(), HasSubstr("Client health checks: 1 by heartbeat, 2 by ping"));
+}
+
+TEST_F(WatchdogProcessServiceTest, TestKillsEachProcessAsSoonAsItsDumpFinishes) {
+    pid_t firstPid = forkIdleProcess();
+    ASSERT_GT(firstPid, 0);
+    pid_t secondPid = forkIdleProcess();
+    ASSERT_GT(secondPid, 0);
+    sp<MockCarWatchdogClient> mediator = expectNormalCarWatchdogClient();
+    sp<MockCarWatchdogMonitor> monitor = expectNormalCarWatchdogMonitor();
+    EXPECT_CALL(*monitor, onClientsNotResponding(std::vector<int32_t>{firstPid, secondPid}))
+            .WillOnce(Return(Status::ok()));
+    reportNotRespondingThroughMediator(mediator, monitor, {firstPid, secondPid});
+
+    // The second process is killed once its own dump finishes, without waiting for the first one.
+    Status status = mWatchdogProcessService->tellDumpFinished(monitor, secondPid);
+    ASSERT_TRUE(status.isOk()) << status;
+    EXPECT_TRUE(waitForKill(secondPid, 1000ms)) << "Process wasn't killed when its dump finished";
+    EXPECT_FALSE(waitForKill(firstPid, 0ms)) << "Process was killed before its dump finished";
+
+    // The dump budget hasn't expired yet, so the first process is kept alive for its dump.
+    mWatchdogProcessService->killProcessesPastDumpDeadline();
+    EXPECT_FALSE(waitForKill(firstPid, 0ms)) << "Process was killed before its dump deadline";
+
+    std::string contents = dump();
+    EXPECT_THAT(contents, HasSubstr(StringPrintf("Processes being dumped: %d", firstPid)));
+    EXPECT_THAT(contents,
+                HasSubstr(StringPrintf("Recovered from process(pid = %d) after its dump finished. "
+                                       "Time to recovery = ",
+                                       secondPid)));
+
+    status = mWatchdogProcessService->tellDumpFinished(monitor, firstPid);
+    ASSERT_TRUE(status.isOk()) << status;
+    EXPECT_TRUE(waitForKill(firstPid, 1000ms)) << "Process wasn't killed when its dump finished";
+    EXPECT_THAT(dump(), HasSubstr("Processes being dumped: none"));
+}
+
+TEST_F(WatchdogProcessServiceTest, TestKillsProcessWhenItsDumpBudgetExpires) {
+    mWatchdogProcessService = new WatchdogProcessService(mLooper, 0s);
+    pid_t pid = forkIdleProcess();
+    ASSERT_GT(pid, 0);
+    sp<MockCarWatchdogClient> mediator = expectNormalCarWatchdogClient();
+    sp<MockCarWatchdogMonitor> monitor = expectNormalCarWatchdogMonitor();
+    EXPECT_CALL(*monitor, onClientsNotResponding(std::vector<int32_t>{pid}))
+            .WillOnce(Return(Status::ok()));
+    reportNotRespondingThroughMediator(mediator, monitor, {pid});
+
+    // The monitor never reports the dump as finished, so the process is killed at its deadline.
+    mWatchdogProcessService->killProcessesPastDumpDeadline();
+    EXPECT_TRUE(waitForKill(pid, 1000ms)) << "Process wasn't killed when its dump budget expired";
+    EXPECT_THAT(dump(),
+                HasSubstr(StringPrintf("Recovered from process(pid = %d) after its dump didn't "
+                                       "finish within 0.00 seconds",
+                                       pid)));
+
+    // Late dump completion doesn't kill anything again.
+    Status status = mWatchdogProcessService->tellDumpFinished(monitor, pid);
+    ASSERT_TRUE(status.isOk()) << status;
+}
+
 }  // namespace watchdog
 }  // namespace automotive
 }  // namespace android